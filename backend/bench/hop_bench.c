@@ -0,0 +1,202 @@
+/*
+ * Gateway-to-service hop latency over TCP loopback and over a Unix socket.
+ *
+ * Sends the same GET to one service both ways, alternating between the two
+ * transports so drift on the host hits both equally, and reports the
+ * latency percentiles of each. By default every request opens a new
+ * connection the way the gateway does, --keepalive reuses one connection
+ * per transport to isolate the per-request cost.
+ *
+ * The service needs UNIX_SOCKET set so it listens on both. Run it on the
+ * same host, or in a container sharing the socket volume.
+ *
+ * Build from backend/bench:
+ *
+ *   gcc -O2 hop_bench.c -lcurl -o hop_bench
+ *
+ * Usage:
+ *
+ *   ./hop_bench --socket /run/trello/project.sock [--url http://localhost:8081/metrics]
+ *       [--requests 10000] [--keepalive]
+ *
+ * The URL defaults to /metrics on $PROJECT_PORT.
+ */
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <curl/curl.h>
+
+#define DEFAULT_REQUESTS 10000
+#define URL_SIZE 512
+
+typedef enum {
+    TRANSPORT_TCP,
+    TRANSPORT_UNIX,
+    TRANSPORT_COUNT
+} Transport;
+
+static const char* transport_names[TRANSPORT_COUNT] = { "tcp", "unix" };
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static size_t discard(void* data, size_t size, size_t count, void* userp) {
+    return size * count;
+}
+
+static CURL* create_handle(const char* url, const char* socket_path) {
+    CURL* curl = curl_easy_init();
+    if (curl == NULL) {
+        return NULL;
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+    if (socket_path) {
+        curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, socket_path);
+    }
+    else {
+        curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    }
+    return curl;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(const uint64_t* sorted, size_t count, double q) {
+    if (count == 0) {
+        return 0;
+    }
+    size_t index = (size_t)(q * (count - 1) + 0.5);
+    return sorted[index] / 1000.0;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s --socket PATH [options]\n"
+        "  --socket PATH   the service's UNIX_SOCKET\n"
+        "  --url URL       the same service over TCP (http://localhost:$PROJECT_PORT/metrics)\n"
+        "  --requests N    requests per transport (%d)\n"
+        "  --keepalive     reuse one connection per transport\n",
+        program, DEFAULT_REQUESTS);
+}
+
+int main(int argc, char** argv) {
+    static struct option options[] = {
+        { "socket", required_argument, NULL, 's' },
+        { "url", required_argument, NULL, 'u' },
+        { "requests", required_argument, NULL, 'n' },
+        { "keepalive", no_argument, NULL, 'k' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    const char* socket_path = NULL;
+    char url[URL_SIZE] = "";
+    int requests = DEFAULT_REQUESTS;
+    int keepalive = 0;
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (option) {
+            case 's': socket_path = optarg; break;
+            case 'u': snprintf(url, sizeof(url), "%s", optarg); break;
+            case 'n': requests = atoi(optarg); break;
+            case 'k': keepalive = 1; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (socket_path == NULL || requests <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (url[0] == '\0') {
+        const char* port = getenv("PROJECT_PORT");
+        snprintf(url, sizeof(url), "http://localhost:%s/metrics", port ? port : "8081");
+    }
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    uint64_t* samples[TRANSPORT_COUNT];
+    size_t counts[TRANSPORT_COUNT] = { 0 };
+    size_t errors[TRANSPORT_COUNT] = { 0 };
+    CURL* handles[TRANSPORT_COUNT] = { NULL, NULL };
+    for (int t = 0; t < TRANSPORT_COUNT; t++) {
+        samples[t] = malloc(requests * sizeof(uint64_t));
+        if (samples[t] == NULL) {
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < requests; i++) {
+        for (int t = 0; t < TRANSPORT_COUNT; t++) {
+            const char* path = t == TRANSPORT_UNIX ? socket_path : NULL;
+            uint64_t start = now_ns();
+            if (handles[t] == NULL) {
+                handles[t] = create_handle(url, path);
+            }
+            CURLcode result = handles[t] ? curl_easy_perform(handles[t]) : CURLE_FAILED_INIT;
+            long status = 0;
+            if (result == CURLE_OK) {
+                curl_easy_getinfo(handles[t], CURLINFO_RESPONSE_CODE, &status);
+            }
+            // The gateway makes a new handle, and so a new connection, for every request
+            if (!keepalive && handles[t]) {
+                curl_easy_cleanup(handles[t]);
+                handles[t] = NULL;
+            }
+            uint64_t elapsed = now_ns() - start;
+
+            if (result != CURLE_OK || status >= 500) {
+                errors[t]++;
+                if (errors[t] == 1) {
+                    fprintf(stderr, "%s: %s\n", transport_names[t],
+                        result != CURLE_OK ? curl_easy_strerror(result) : "server error");
+                }
+                continue;
+            }
+            samples[t][counts[t]++] = elapsed;
+        }
+    }
+
+    int failed = 0;
+    fprintf(stderr, "%d requests per transport, %s\n\n", requests, keepalive ? "keep-alive" : "new connection each");
+    fprintf(stderr, "%-6s %9s %8s %9s %9s %9s %9s\n", "hop", "requests", "errors", "p50 us", "p90 us", "p99 us", "max us");
+    for (int t = 0; t < TRANSPORT_COUNT; t++) {
+        qsort(samples[t], counts[t], sizeof(uint64_t), compare_u64);
+        printf("%-6s %9zu %8zu %9.1f %9.1f %9.1f %9.1f\n",
+            transport_names[t], counts[t], errors[t],
+            percentile_us(samples[t], counts[t], 0.50),
+            percentile_us(samples[t], counts[t], 0.90),
+            percentile_us(samples[t], counts[t], 0.99),
+            counts[t] ? samples[t][counts[t] - 1] / 1000.0 : 0);
+        if (errors[t] * 100 > (size_t)requests) {
+            failed = 1;
+        }
+    }
+    if (counts[TRANSPORT_TCP] && counts[TRANSPORT_UNIX]) {
+        double tcp = percentile_us(samples[TRANSPORT_TCP], counts[TRANSPORT_TCP], 0.50);
+        double unix_socket = percentile_us(samples[TRANSPORT_UNIX], counts[TRANSPORT_UNIX], 0.50);
+        fprintf(stderr, "\nUnix socket median is %.1f%% of TCP\n", tcp > 0 ? 100.0 * unix_socket / tcp : 0);
+    }
+
+    for (int t = 0; t < TRANSPORT_COUNT; t++) {
+        if (handles[t]) {
+            curl_easy_cleanup(handles[t]);
+        }
+        free(samples[t]);
+    }
+    curl_global_cleanup();
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Request body decoding microbenchmark.
+ *
+ * Compares the default cJSON path (build a tree, then parse_*_from_json copies
+ * the fields out) with the tree-less parse_*_from_body decoder used by
+ * FAST_JSON builds, on task and project payloads shaped like the ones the
+ * frontend sends. Each model lives in its own service, so there is one
+ * binary per model. Build from backend/bench:
+ *
+ *   gcc -O2 -DBENCH_TASK -I../docker/task-service json_bench.c \
+ *       ../docker/task-service/model.c ../docker/task-service/json_reader.c \
+ *       ../docker/task-service/logger.c -lcjson -pthread -o json_bench_task
+ *
+ *   gcc -O2 -DBENCH_PROJECT -I../docker/project-service json_bench.c \
+ *       ../docker/project-service/model.c ../docker/project-service/json_reader.c \
+ *       ../docker/project-service/logger.c -lcjson -pthread -o json_bench_project
+ *
+ * Usage: ./json_bench_task [iterations]
+ *
+ * Logging from the model parsers is switched off while timing, results go
+ * to stderr.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cjson/cJSON.h>
+#include "model.h"
+#include "logger.h"
+
+#define DEFAULT_ITERATIONS 200000
+
+#if defined(BENCH_TASK)
+typedef Task Model;
+#define MODEL_NAME "task"
+#define PARSE_FROM_JSON parse_task_from_json
+#define PARSE_FROM_BODY parse_task_from_body
+#elif defined(BENCH_PROJECT)
+typedef Project Model;
+#define MODEL_NAME "project"
+#define PARSE_FROM_JSON parse_project_from_json
+#define PARSE_FROM_BODY parse_project_from_body
+#else
+#error "Build with -DBENCH_TASK or -DBENCH_PROJECT"
+#endif
+
+static const char* members_json =
+    "[\"marko.petrovic\", \"ana.jovanovic\", \"nikola.ilic\", \"jelena.markovic\", "
+    "\"stefan.nikolic\", \"milica.stojanovic\", \"luka.pavlovic\", \"sara.djordjevic\"]";
+
+static char* build_payload(void) {
+    char* payload = malloc(4096);
+    if (payload == NULL) {
+        return NULL;
+    }
+#if defined(BENCH_TASK)
+    char description[450];
+    const char* sentence = "Update the sprint board after review and attach the meeting notes. ";
+    description[0] = '\0';
+    while (strlen(description) + strlen(sentence) < sizeof(description) - 1) {
+        strcat(description, sentence);
+    }
+    snprintf(payload, 4096,
+        "{\"project_id\": \"665f1c2ab9d4e81f2c3a7b10\", \"name\": \"Prepare release notes\", "
+        "\"description\": \"%s\", \"members\": %s, \"creator_id\": \"marko.petrovic\", "
+        "\"status\": 0}",
+        description, members_json);
+#else
+    snprintf(payload, 4096,
+        "{\"moderator\": \"marko.petrovic\", \"project\": \"Mobile app redesign\", "
+        "\"members\": %s, \"estimated_completion_date\": \"2025-09-30\", "
+        "\"min_members\": 2, \"max_members\": 12}",
+        members_json);
+#endif
+    return payload;
+}
+
+static double elapsed_ns(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static void report(const char* label, double total_ns, long iterations, size_t payload_size) {
+    double per_op = total_ns / iterations;
+    double mb_per_s = (payload_size * (double)iterations) / (total_ns / 1e9) / (1024.0 * 1024.0);
+    fprintf(stderr, "  %-28s %10.1f ns/op %10.1f MB/s\n", label, per_op, mb_per_s);
+}
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) {
+        iterations = DEFAULT_ITERATIONS;
+    }
+
+    char* payload = build_payload();
+    if (payload == NULL) {
+        fprintf(stderr, "Failed to build payload\n");
+        return 1;
+    }
+    size_t payload_size = strlen(payload);
+
+    log_level = LOG_LEVEL_OFF;
+
+    // Both decoders must agree before their speed means anything
+    Model from_json, from_body;
+    cJSON* json = cJSON_ParseWithLength(payload, payload_size);
+    int json_result = json ? PARSE_FROM_JSON(json, &from_json) : -1;
+    cJSON_Delete(json);
+    int body_result = PARSE_FROM_BODY(payload, payload_size, &from_body);
+    if (json_result != 0 || body_result != 0 || memcmp(&from_json, &from_body, sizeof(Model)) != 0) {
+        fprintf(stderr, "Decoders disagree (json=%d, body=%d)\n", json_result, body_result);
+        free(payload);
+        return 1;
+    }
+
+    fprintf(stderr, "%s payload, %zu bytes, %ld iterations\n", MODEL_NAME, payload_size, iterations);
+
+    struct timespec start, end;
+    volatile int sink = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        cJSON* tree = cJSON_ParseWithLength(payload, payload_size);
+        sink += tree != NULL;
+        cJSON_Delete(tree);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report("cJSON_Parse only", elapsed_ns(&start, &end), iterations, payload_size);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        Model model;
+        cJSON* tree = cJSON_ParseWithLength(payload, payload_size);
+        sink += PARSE_FROM_JSON(tree, &model);
+        cJSON_Delete(tree);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report("cJSON + parse_from_json", elapsed_ns(&start, &end), iterations, payload_size);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        Model model;
+        sink += PARSE_FROM_BODY(payload, payload_size, &model);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report("parse_from_body", elapsed_ns(&start, &end), iterations, payload_size);
+
+    free(payload);
+    return sink == -1;
+}
@@ -0,0 +1,634 @@
+/*
+ * End-to-end load generator for the user, project and task services.
+ *
+ * Logs in once, creates a project and a task to work on, then replays a
+ * weighted mix of the routes the frontend uses from a pool of worker
+ * threads. With --rate the arrivals are open-loop: request k is due at
+ * start + k / rate whether or not earlier requests have finished, and its
+ * latency is measured from when it was due, so a stalled server shows up
+ * in the percentiles instead of silently slowing the generator down.
+ * Without --rate every worker sends back to back (closed loop).
+ *
+ * The services only need a local mongod. The account used must already
+ * exist, and must have the MANAGER role to create the project and tasks.
+ *
+ * Build from backend/bench:
+ *
+ *   gcc -O2 load_bench.c -lcurl -pthread -o load_bench
+ *
+ * Usage:
+ *
+ *   ./load_bench --user marko --password secret --member ana \
+ *       [--target direct|gateway] [--concurrency 16] [--rate 500] \
+ *       [--duration 30] [--mix login=5,projects=25,...] [--max-p99 50]
+ *
+ * Direct mode talks to http://localhost:$USER_PORT, $PROJECT_PORT and
+ * $TASK_PORT, the same variables docker-compose uses. Gateway mode sends
+ * everything through https://localhost:$GATEWAY_PORT. Override either with
+ * --users-url, --projects-url, --tasks-url or --gateway-url.
+ *
+ * The exit status is 2 when --max-p99 is given and any route is slower, or
+ * when more than 1% of a route's requests fail, so CI can gate on it.
+ */
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <curl/curl.h>
+
+#define DEFAULT_CONCURRENCY 8
+#define DEFAULT_DURATION 30
+#define MAX_WORKERS 256
+#define URL_SIZE 512
+#define BODY_SIZE 1024
+#define ID_SIZE 25
+
+typedef enum {
+    OP_LOGIN,
+    OP_LIST_PROJECTS,
+    OP_GET_PROJECT,
+    OP_CREATE_TASK,
+    OP_LIST_TASKS,
+    OP_FLIP_STATUS,
+    OP_ADD_MEMBER,
+    OP_REMOVE_MEMBER,
+    OP_COUNT
+} Operation;
+
+static const char* op_names[OP_COUNT] = {
+    "login", "projects", "project", "create_task", "tasks", "status", "add_member", "remove_member"
+};
+
+// Read-heavy, roughly what a board page does
+static int op_weights[OP_COUNT] = { 5, 25, 15, 10, 20, 15, 5, 5 };
+
+typedef struct {
+    char users[URL_SIZE];
+    char projects[URL_SIZE];
+    char tasks[URL_SIZE];
+    int insecure;
+} Targets;
+
+typedef struct {
+    uint64_t* samples;      // Latencies in microseconds
+    size_t count;
+    size_t capacity;
+    size_t errors;
+} OpStats;
+
+typedef struct {
+    pthread_t thread;
+    CURL* curl;
+    unsigned int seed;
+    int member_added;
+    int status_flipped;
+    OpStats stats[OP_COUNT];
+} Worker;
+
+typedef struct {
+    char* data;
+    size_t size;
+} Response;
+
+static Targets targets;
+static const char* username = NULL;
+static const char* password = NULL;
+static const char* member = NULL;
+static char auth_header[1024];
+static char project_id[ID_SIZE];
+static char task_id[ID_SIZE];
+
+static double rate = 0;
+static int duration = DEFAULT_DURATION;
+static uint64_t start_time;
+static uint64_t end_time;
+static atomic_ullong next_arrival = 0;
+static atomic_uint task_counter = 0;
+
+static uint64_t now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void sleep_until(uint64_t target_us) {
+    struct timespec target = { target_us / 1000000, (target_us % 1000000) * 1000 };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL) != 0) {
+    }
+}
+
+static size_t collect_body(void* contents, size_t size, size_t nmemb, void* userp) {
+    size_t realsize = size * nmemb;
+    Response* response = (Response*)userp;
+    if (response == NULL) {
+        return realsize;
+    }
+    char* data = realloc(response->data, response->size + realsize + 1);
+    if (data == NULL) {
+        return 0;
+    }
+    response->data = data;
+    memcpy(response->data + response->size, contents, realsize);
+    response->size += realsize;
+    response->data[response->size] = '\0';
+    return realsize;
+}
+
+/**
+ * Sends one request on the worker's handle, keeping the connection alive
+ * between calls. Returns the HTTP status, or 0 when the transfer failed.
+ */
+static long send_request(CURL* curl, const char* method, const char* url, const char* body, Response* response) {
+    struct curl_slist* headers = NULL;
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+    if (auth_header[0] != '\0') {
+        headers = curl_slist_append(headers, auth_header);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect_body);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+    if (strcmp(method, "GET") == 0) {
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, NULL);
+    }
+    else {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body ? body : "");
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)(body ? strlen(body) : 0));
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, strcmp(method, "POST") == 0 ? NULL : method);
+    }
+
+    long http_code = 0;
+    if (curl_easy_perform(curl) == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    }
+    curl_slist_free_all(headers);
+    return http_code;
+}
+
+static CURL* create_handle(void) {
+    CURL* curl = curl_easy_init();
+    if (curl == NULL) {
+        return NULL;
+    }
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    if (targets.insecure) {
+        // The gateway's certificate in docker-compose is self-signed
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    }
+    return curl;
+}
+
+// Finds the ObjectId of the document whose value for key is name, in mongoc's extended JSON
+static int find_id_by_name(const char* json, const char* key, const char* name, char* id_out) {
+    char needle[256];
+    snprintf(needle, sizeof(needle), "\"%s\" : \"%s\"", key, name);
+    const char* match = json ? strstr(json, needle) : NULL;
+    if (match == NULL) {
+        return -1;
+    }
+    // _id is the first field of every document, so take the last one before the match
+    const char* id = NULL;
+    for (const char* p = strstr(json, "\"$oid\" : \""); p && p < match; p = strstr(p + 1, "\"$oid\" : \"")) {
+        id = p + strlen("\"$oid\" : \"");
+    }
+    if (id == NULL || strlen(id) < ID_SIZE - 1) {
+        return -1;
+    }
+    memcpy(id_out, id, ID_SIZE - 1);
+    id_out[ID_SIZE - 1] = '\0';
+    return 0;
+}
+
+static int build_request(Worker* worker, Operation op, const char** method, char* url, char* body) {
+    body[0] = '\0';
+    switch (op) {
+        case OP_LOGIN:
+            *method = "POST";
+            snprintf(url, URL_SIZE, "%s/login", targets.users);
+            snprintf(body, BODY_SIZE, "{\"username_or_email\": \"%s\", \"password\": \"%s\"}", username, password);
+            break;
+        case OP_LIST_PROJECTS:
+            *method = "GET";
+            snprintf(url, URL_SIZE, "%s/projects", targets.projects);
+            break;
+        case OP_GET_PROJECT:
+            *method = "GET";
+            snprintf(url, URL_SIZE, "%s/projects/%s", targets.projects, project_id);
+            break;
+        case OP_CREATE_TASK:
+            *method = "POST";
+            snprintf(url, URL_SIZE, "%s/tasks", targets.tasks);
+            snprintf(body, BODY_SIZE,
+                "{\"project_id\": \"%s\", \"name\": \"Load task %u\", "
+                "\"description\": \"Created by load_bench\", \"members\": [\"%s\"], "
+                "\"creator_id\": \"%s\"}",
+                project_id, atomic_fetch_add(&task_counter, 1), username, username);
+            break;
+        case OP_LIST_TASKS:
+            *method = "GET";
+            snprintf(url, URL_SIZE, "%s/tasks/project/%s", targets.tasks, project_id);
+            break;
+        case OP_FLIP_STATUS:
+            *method = "PATCH";
+            snprintf(url, URL_SIZE, "%s/tasks/status/%s", targets.tasks, task_id);
+            worker->status_flipped = !worker->status_flipped;
+            snprintf(body, BODY_SIZE, "{\"status\": \"%s\"}", worker->status_flipped ? "in_progress" : "pending");
+            break;
+        case OP_ADD_MEMBER:
+        case OP_REMOVE_MEMBER:
+            // Alternate per worker so the task does not fill up with duplicates
+            op = worker->member_added ? OP_REMOVE_MEMBER : OP_ADD_MEMBER;
+            worker->member_added = !worker->member_added;
+            *method = "POST";
+            snprintf(url, URL_SIZE, "%s/tasks/%s/%s", targets.tasks, task_id,
+                op == OP_ADD_MEMBER ? "add-member" : "remove-member");
+            snprintf(body, BODY_SIZE, "{\"member_id\": \"%s\"}", member);
+            break;
+        default:
+            return -1;
+    }
+    return op;
+}
+
+static Operation pick_operation(Worker* worker) {
+    int total = 0;
+    for (int i = 0; i < OP_COUNT; i++) {
+        total += op_weights[i];
+    }
+    int choice = rand_r(&worker->seed) % total;
+    for (int i = 0; i < OP_COUNT; i++) {
+        if (choice < op_weights[i]) {
+            return (Operation)i;
+        }
+        choice -= op_weights[i];
+    }
+    return OP_LIST_PROJECTS;
+}
+
+static void record(OpStats* stats, uint64_t latency, int failed) {
+    if (stats->count == stats->capacity) {
+        size_t capacity = stats->capacity ? stats->capacity * 2 : 4096;
+        uint64_t* samples = realloc(stats->samples, capacity * sizeof(uint64_t));
+        if (samples == NULL) {
+            return;
+        }
+        stats->samples = samples;
+        stats->capacity = capacity;
+    }
+    stats->samples[stats->count++] = latency;
+    stats->errors += failed;
+}
+
+static void* run_worker(void* arg) {
+    Worker* worker = (Worker*)arg;
+    char url[URL_SIZE];
+    char body[BODY_SIZE];
+    uint64_t interval = rate > 0 ? (uint64_t)(1e6 / rate) : 0;
+
+    for (;;) {
+        uint64_t due;
+        if (interval) {
+            due = start_time + atomic_fetch_add(&next_arrival, 1) * interval;
+            if (due >= end_time) {
+                break;
+            }
+            sleep_until(due);
+        }
+        else {
+            due = now_us();
+            if (due >= end_time) {
+                break;
+            }
+        }
+
+        const char* method;
+        int op = build_request(worker, pick_operation(worker), &method, url, body);
+        if (op < 0) {
+            continue;
+        }
+        long status = send_request(worker->curl, method, url, body[0] ? body : NULL, NULL);
+        record(&worker->stats[op], now_us() - due, status < 200 || status >= 300);
+    }
+    return NULL;
+}
+
+// Logs in and creates the project and task every worker operates on
+static int prepare(void) {
+    CURL* curl = create_handle();
+    if (curl == NULL) {
+        return -1;
+    }
+    char url[URL_SIZE];
+    char body[BODY_SIZE];
+    char name[64];
+    Response response = { NULL, 0 };
+    int result = -1;
+
+    snprintf(url, URL_SIZE, "%s/login", targets.users);
+    snprintf(body, BODY_SIZE, "{\"username_or_email\": \"%s\", \"password\": \"%s\"}", username, password);
+    long status = send_request(curl, "POST", url, body, &response);
+    const char* token = response.data ? strstr(response.data, "\"token\": \"") : NULL;
+    if (status != 200 || token == NULL) {
+        fprintf(stderr, "Login failed with status %ld\n", status);
+        goto cleanup;
+    }
+    token += strlen("\"token\": \"");
+    snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %.*s", (int)strcspn(token, "\""), token);
+
+    snprintf(name, sizeof(name), "load-bench-%ld", (long)time(NULL));
+    snprintf(url, URL_SIZE, "%s/newproject", targets.projects);
+    snprintf(body, BODY_SIZE,
+        "{\"project\": \"%s\", \"members\": [\"%s\", \"%s\"], "
+        "\"estimated_completion_date\": \"2099-12-31\", \"min_members\": 1, \"max_members\": 50}",
+        name, username, member);
+    status = send_request(curl, "POST", url, body, NULL);
+    if (status < 200 || status >= 300) {
+        fprintf(stderr, "Creating project failed with status %ld\n", status);
+        goto cleanup;
+    }
+
+    free(response.data);
+    response = (Response){ NULL, 0 };
+    snprintf(url, URL_SIZE, "%s/projects", targets.projects);
+    send_request(curl, "GET", url, NULL, &response);
+    if (find_id_by_name(response.data, "project", name, project_id) != 0) {
+        fprintf(stderr, "Could not find project %s after creating it\n", name);
+        goto cleanup;
+    }
+
+    snprintf(url, URL_SIZE, "%s/tasks", targets.tasks);
+    snprintf(body, BODY_SIZE,
+        "{\"project_id\": \"%s\", \"name\": \"%s\", \"description\": \"Status and member target\", "
+        "\"members\": [\"%s\"], \"creator_id\": \"%s\"}",
+        project_id, name, username, username);
+    status = send_request(curl, "POST", url, body, NULL);
+    if (status < 200 || status >= 300) {
+        fprintf(stderr, "Creating task failed with status %ld\n", status);
+        goto cleanup;
+    }
+
+    free(response.data);
+    response = (Response){ NULL, 0 };
+    snprintf(url, URL_SIZE, "%s/tasks/project/%s", targets.tasks, project_id);
+    send_request(curl, "GET", url, NULL, &response);
+    if (find_id_by_name(response.data, "name", name, task_id) != 0) {
+        fprintf(stderr, "Could not find task %s after creating it\n", name);
+        goto cleanup;
+    }
+
+    fprintf(stderr, "Using project %s and task %s\n", project_id, task_id);
+    result = 0;
+
+cleanup:
+    free(response.data);
+    curl_easy_cleanup(curl);
+    return result;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(const uint64_t* sorted, size_t count, double q) {
+    if (count == 0) {
+        return 0;
+    }
+    size_t index = (size_t)(q * (count - 1) + 0.5);
+    return sorted[index] / 1000.0;
+}
+
+// Prints one line per route, returns nonzero when a route breaks the limits
+static int report(Worker* workers, int concurrency, double elapsed_s, double max_p99_ms) {
+    int failed = 0;
+    size_t total = 0;
+
+    fprintf(stderr, "\n%-14s %9s %8s %10s %9s %9s %9s %9s\n",
+        "route", "requests", "errors", "req/s", "p50 ms", "p99 ms", "p999 ms", "max ms");
+    for (int op = 0; op < OP_COUNT; op++) {
+        OpStats merged = { NULL, 0, 0, 0 };
+        for (int w = 0; w < concurrency; w++) {
+            OpStats* stats = &workers[w].stats[op];
+            for (size_t i = 0; i < stats->count; i++) {
+                record(&merged, stats->samples[i], 0);
+            }
+            merged.errors += stats->errors;
+        }
+        if (merged.count == 0) {
+            continue;
+        }
+        qsort(merged.samples, merged.count, sizeof(uint64_t), compare_u64);
+
+        double p99 = percentile_ms(merged.samples, merged.count, 0.99);
+        printf("%-14s %9zu %8zu %10.1f %9.2f %9.2f %9.2f %9.2f\n",
+            op_names[op], merged.count, merged.errors, merged.count / elapsed_s,
+            percentile_ms(merged.samples, merged.count, 0.50), p99,
+            percentile_ms(merged.samples, merged.count, 0.999),
+            merged.samples[merged.count - 1] / 1000.0);
+
+        if (max_p99_ms > 0 && p99 > max_p99_ms) {
+            fprintf(stderr, "%s: p99 %.2f ms is over the %.2f ms limit\n", op_names[op], p99, max_p99_ms);
+            failed = 1;
+        }
+        if (merged.errors * 100 > merged.count) {
+            fprintf(stderr, "%s: %zu of %zu requests failed\n", op_names[op], merged.errors, merged.count);
+            failed = 1;
+        }
+        total += merged.count;
+        free(merged.samples);
+    }
+
+    fprintf(stderr, "\n%zu requests in %.1f s, %.1f req/s", total, elapsed_s, total / elapsed_s);
+    if (rate > 0) {
+        fprintf(stderr, " (target %.1f)", rate);
+    }
+    fprintf(stderr, "\n");
+    return failed;
+}
+
+static int parse_mix(char* mix) {
+    int weights[OP_COUNT] = { 0 };
+    for (char* item = strtok(mix, ","); item; item = strtok(NULL, ",")) {
+        char* equals = strchr(item, '=');
+        if (equals == NULL) {
+            return -1;
+        }
+        *equals = '\0';
+        int found = 0;
+        for (int i = 0; i < OP_COUNT; i++) {
+            if (strcmp(item, op_names[i]) == 0) {
+                weights[i] = atoi(equals + 1);
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "Unknown route %s in --mix\n", item);
+            return -1;
+        }
+    }
+    int total = 0;
+    for (int i = 0; i < OP_COUNT; i++) {
+        total += weights[i];
+    }
+    if (total <= 0) {
+        return -1;
+    }
+    memcpy(op_weights, weights, sizeof(op_weights));
+    return 0;
+}
+
+static void default_url(char* out, const char* scheme, const char* port_env, const char* fallback_port, const char* prefix) {
+    const char* port = getenv(port_env);
+    snprintf(out, URL_SIZE, "%s://localhost:%s%s", scheme, port ? port : fallback_port, prefix);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s --user NAME --password PASSWORD --member NAME [options]\n"
+        "  --target direct|gateway   talk to each service or go through the gateway (direct)\n"
+        "  --concurrency N           worker threads, each with one keep-alive connection (%d)\n"
+        "  --rate R                  open-loop arrivals per second across all workers (closed loop)\n"
+        "  --duration S              seconds to run (%d)\n"
+        "  --mix route=weight,...    routes: login projects project create_task tasks status\n"
+        "                            add_member remove_member\n"
+        "  --max-p99 MS              fail when any route's p99 is above this\n"
+        "  --users-url, --projects-url, --tasks-url, --gateway-url URL\n",
+        program, DEFAULT_CONCURRENCY, DEFAULT_DURATION);
+}
+
+int main(int argc, char** argv) {
+    static struct option options[] = {
+        { "user", required_argument, NULL, 'u' },
+        { "password", required_argument, NULL, 'p' },
+        { "member", required_argument, NULL, 'm' },
+        { "target", required_argument, NULL, 't' },
+        { "concurrency", required_argument, NULL, 'c' },
+        { "rate", required_argument, NULL, 'r' },
+        { "duration", required_argument, NULL, 'd' },
+        { "mix", required_argument, NULL, 'x' },
+        { "max-p99", required_argument, NULL, 'l' },
+        { "users-url", required_argument, NULL, 'U' },
+        { "projects-url", required_argument, NULL, 'P' },
+        { "tasks-url", required_argument, NULL, 'T' },
+        { "gateway-url", required_argument, NULL, 'G' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int concurrency = DEFAULT_CONCURRENCY;
+    double max_p99_ms = 0;
+    const char* target = "direct";
+    const char* users_url = NULL;
+    const char* projects_url = NULL;
+    const char* tasks_url = NULL;
+    const char* gateway_url = NULL;
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (option) {
+            case 'u': username = optarg; break;
+            case 'p': password = optarg; break;
+            case 'm': member = optarg; break;
+            case 't': target = optarg; break;
+            case 'c': concurrency = atoi(optarg); break;
+            case 'r': rate = atof(optarg); break;
+            case 'd': duration = atoi(optarg); break;
+            case 'x':
+                if (parse_mix(optarg) != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'l': max_p99_ms = atof(optarg); break;
+            case 'U': users_url = optarg; break;
+            case 'P': projects_url = optarg; break;
+            case 'T': tasks_url = optarg; break;
+            case 'G': gateway_url = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (!username || !password || !member || concurrency <= 0 || concurrency > MAX_WORKERS || duration <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (strcmp(target, "gateway") == 0) {
+        // The gateway picks the service from the first path segment
+        char base[URL_SIZE];
+        if (gateway_url) {
+            snprintf(base, sizeof(base), "%s", gateway_url);
+        }
+        else {
+            default_url(base, "https", "GATEWAY_PORT", "8443", "");
+        }
+        snprintf(targets.users, URL_SIZE, "%s/user", base);
+        snprintf(targets.projects, URL_SIZE, "%s/project", base);
+        snprintf(targets.tasks, URL_SIZE, "%s/task", base);
+        targets.insecure = 1;
+    }
+    else {
+        default_url(targets.users, "http", "USER_PORT", "8080", "");
+        default_url(targets.projects, "http", "PROJECT_PORT", "8081", "");
+        default_url(targets.tasks, "http", "TASK_PORT", "8082", "");
+    }
+    if (users_url) snprintf(targets.users, URL_SIZE, "%s", users_url);
+    if (projects_url) snprintf(targets.projects, URL_SIZE, "%s", projects_url);
+    if (tasks_url) snprintf(targets.tasks, URL_SIZE, "%s", tasks_url);
+
+    curl_global_init(CURL_GLOBAL_ALL);
+    if (prepare() != 0) {
+        curl_global_cleanup();
+        return 1;
+    }
+
+    Worker* workers = calloc(concurrency, sizeof(Worker));
+    if (workers == NULL) {
+        curl_global_cleanup();
+        return 1;
+    }
+
+    fprintf(stderr, "%d workers for %d s, %s\n", concurrency, duration,
+        rate > 0 ? "open loop" : "closed loop");
+    start_time = now_us() + 100000;
+    end_time = start_time + (uint64_t)duration * 1000000;
+
+    int started = 0;
+    for (; started < concurrency; started++) {
+        workers[started].curl = create_handle();
+        workers[started].seed = (unsigned int)(start_time + started * 7919);
+        if (workers[started].curl == NULL ||
+            pthread_create(&workers[started].thread, NULL, run_worker, &workers[started]) != 0) {
+            fprintf(stderr, "Could only start %d workers\n", started);
+            break;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    double elapsed_s = (now_us() - start_time) / 1e6;
+
+    int failed = report(workers, started, elapsed_s, max_p99_ms);
+
+    for (int i = 0; i < concurrency; i++) {
+        if (workers[i].curl) {
+            curl_easy_cleanup(workers[i].curl);
+        }
+        for (int op = 0; op < OP_COUNT; op++) {
+            free(workers[i].stats[op].samples);
+        }
+    }
+    free(workers);
+    curl_global_cleanup();
+    return failed ? 2 : 0;
+}
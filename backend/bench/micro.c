@@ -0,0 +1,72 @@
+#include "micro.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MICRO_MAX_ROUNDS 64
+
+volatile long micro_sink = 0;
+
+static const char* suite_name = "micro";
+static long iterations = MICRO_DEFAULT_ITERATIONS;
+static long warmup = MICRO_DEFAULT_WARMUP;
+static int rounds = MICRO_DEFAULT_ROUNDS;
+
+void micro_init(const char* suite, int argc, char** argv) {
+    static struct option options[] = {
+        { "iterations", required_argument, NULL, 'i' },
+        { "warmup", required_argument, NULL, 'w' },
+        { "rounds", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    suite_name = suite;
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (option) {
+            case 'i': iterations = atol(optarg); break;
+            case 'w': warmup = atol(optarg); break;
+            case 'r': rounds = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [--iterations N] [--warmup N] [--rounds N]\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (iterations <= 0) iterations = MICRO_DEFAULT_ITERATIONS;
+    if (warmup < 0) warmup = 0;
+    if (rounds <= 0 || rounds > MICRO_MAX_ROUNDS) rounds = MICRO_DEFAULT_ROUNDS;
+}
+
+static double elapsed_ns(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+void micro_run(const char* name, MicroFunction fn, void* arg) {
+    double per_call[MICRO_MAX_ROUNDS];
+
+    for (long i = 0; i < warmup; i++) {
+        fn(arg);
+    }
+    for (int r = 0; r < rounds; r++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long i = 0; i < iterations; i++) {
+            fn(arg);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        per_call[r] = elapsed_ns(&start, &end) / iterations;
+    }
+    qsort(per_call, rounds, sizeof(double), compare_double);
+
+    printf("{\"suite\": \"%s\", \"benchmark\": \"%s\", \"iterations\": %ld, \"rounds\": %d, "
+        "\"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f, \"max_ns_per_op\": %.1f}\n",
+        suite_name, name, iterations, rounds, per_call[rounds / 2], per_call[0], per_call[rounds - 1]);
+    fflush(stdout);
+}
@@ -0,0 +1,27 @@
+#ifndef MICRO_H
+#define MICRO_H
+
+#define MICRO_DEFAULT_ITERATIONS 100000
+#define MICRO_DEFAULT_WARMUP 10000
+#define MICRO_DEFAULT_ROUNDS 5
+
+typedef void (*MicroFunction)(void* arg);
+
+// Results land here so the compiler cannot drop the calls being measured
+extern volatile long micro_sink;
+
+/**
+ * Reads --iterations, --warmup and --rounds. suite names the binary in the
+ * output, e.g. "user" or "gateway".
+ */
+void micro_init(const char* suite, int argc, char** argv);
+
+/**
+ * Calls fn warmup times, then times rounds batches of iterations calls and
+ * prints one JSON object per line to stdout with the median, fastest and
+ * slowest round in ns per call. Lines from every suite can be concatenated
+ * and compared across commits with run_micro.sh --baseline.
+ */
+void micro_run(const char* name, MicroFunction fn, void* arg);
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Project service microbenchmark for parse_project_from_json on an already
+ * parsed body. Build from backend/bench:
+ *
+ *   P=../docker/project-service
+ *   gcc -O2 -I$P micro_project.c micro.c $P/model.c $P/json_reader.c \
+ *       $P/logger.c -lcjson -pthread -o micro_project
+ */
+#include <stdio.h>
+#include <cjson/cJSON.h>
+#include "micro.h"
+#include "model.h"
+
+static const char* project_body =
+    "{\"moderator\": \"marko.petrovic\", \"project\": \"Mobile app redesign\", "
+    "\"members\": [\"marko.petrovic\", \"ana.jovanovic\", \"nikola.ilic\", \"jelena.markovic\", "
+    "\"stefan.nikolic\", \"milica.stojanovic\"], \"estimated_completion_date\": \"2025-09-30\", "
+    "\"min_members\": 2, \"max_members\": 12}";
+
+static void bench_parse_project(void* arg) {
+    Project project;
+    micro_sink += parse_project_from_json((const cJSON*)arg, &project);
+}
+
+int main(int argc, char** argv) {
+    micro_init("project", argc, argv);
+
+    cJSON* json = cJSON_Parse(project_body);
+    if (json == NULL) {
+        fprintf(stderr, "Could not parse the project body\n");
+        return 1;
+    }
+    micro_run("parse_project_from_json", bench_parse_project, json);
+    cJSON_Delete(json);
+    return 0;
+}
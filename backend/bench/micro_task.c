@@ -0,0 +1,95 @@
+/*
+ * Task service microbenchmarks: parse_task_from_json on an already parsed
+ * body, and the BSON to JSON conversion get_tasks_by_project runs on every
+ * document of a project. Build from backend/bench:
+ *
+ *   T=../docker/task-service
+ *   gcc -O2 -I$T micro_task.c micro.c $T/repo.c $T/model.c $T/json_reader.c \
+ *       $T/arena.c $T/logger.c $T/metrics.c \
+ *       -lcjson -pthread $(pkg-config --cflags --libs libmongoc-1.0) -o micro_task
+ *
+ * No database is needed, the documents are built in memory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cjson/cJSON.h>
+#include <mongoc/mongoc.h>
+#include "micro.h"
+#include "model.h"
+#include "repo.h"
+
+#define PROJECT_TASKS 25
+
+static const char* task_body =
+    "{\"project_id\": \"665f1c2ab9d4e81f2c3a7b10\", \"name\": \"Prepare release notes\", "
+    "\"description\": \"Update the sprint board after review and attach the meeting notes.\", "
+    "\"members\": [\"marko.petrovic\", \"ana.jovanovic\", \"nikola.ilic\", \"jelena.markovic\"], "
+    "\"creator_id\": \"marko.petrovic\", \"status\": 0}";
+
+static const char* members[] = { "marko.petrovic", "ana.jovanovic", "nikola.ilic", "jelena.markovic" };
+
+static void bench_parse_task(void* arg) {
+    Task task;
+    micro_sink += parse_task_from_json((const cJSON*)arg, &task);
+}
+
+// Same steps as get_tasks_by_project once the cursor has produced the documents
+static void bench_tasks_to_json(void* arg) {
+    bson_t** docs = (bson_t**)arg;
+    cJSON* tasks_array = cJSON_CreateArray();
+    for (int i = 0; i < PROJECT_TASKS; i++) {
+        append_task_json(tasks_array, docs[i]);
+    }
+    char* result = cJSON_PrintUnformatted(tasks_array);
+    micro_sink += result != NULL;
+    cJSON_free(result);
+    cJSON_Delete(tasks_array);
+}
+
+static bson_t* build_task_document(int index) {
+    char name[64];
+    snprintf(name, sizeof(name), "Task %d of the release checklist", index);
+
+    bson_t* doc = bson_new();
+    bson_oid_t oid;
+    bson_oid_init(&oid, NULL);
+    BSON_APPEND_OID(doc, "_id", &oid);
+    BSON_APPEND_UTF8(doc, "project_id", "665f1c2ab9d4e81f2c3a7b10");
+    BSON_APPEND_UTF8(doc, "name", name);
+    BSON_APPEND_UTF8(doc, "description", "Update the sprint board after review and attach the meeting notes.");
+    BSON_APPEND_UTF8(doc, "creator_id", "marko.petrovic");
+    BSON_APPEND_INT32(doc, "status", index % 3);
+
+    bson_t members_array;
+    BSON_APPEND_ARRAY_BEGIN(doc, "members", &members_array);
+    for (int i = 0; i < 4; i++) {
+        char str_idx[16];
+        snprintf(str_idx, sizeof(str_idx), "%d", i);
+        BSON_APPEND_UTF8(&members_array, str_idx, members[i]);
+    }
+    bson_append_array_end(doc, &members_array);
+    return doc;
+}
+
+int main(int argc, char** argv) {
+    micro_init("task", argc, argv);
+
+    cJSON* json = cJSON_Parse(task_body);
+    if (json == NULL) {
+        fprintf(stderr, "Could not parse the task body\n");
+        return 1;
+    }
+    micro_run("parse_task_from_json", bench_parse_task, json);
+    cJSON_Delete(json);
+
+    bson_t* docs[PROJECT_TASKS];
+    for (int i = 0; i < PROJECT_TASKS; i++) {
+        docs[i] = build_task_document(i);
+    }
+    micro_run("get_tasks_by_project_bson_to_json", bench_tasks_to_json, docs);
+    for (int i = 0; i < PROJECT_TASKS; i++) {
+        bson_destroy(docs[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * User service microbenchmarks: JWT verification, password hashing and the
+ * password blacklist. Build from backend/bench, with L8W8JWT pointing at a
+ * built l8w8jwt tree (the Dockerfile builds one next to the service):
+ *
+ *   U=../docker/user-service
+ *   gcc -O2 -I$U -I$L8W8JWT/include/l8w8jwt micro_user.c micro.c \
+ *       $U/jwt_middleware.c $U/repo.c $U/SHA.c $U/password_validator.c \
+ *       $U/logger.c $U/metrics.c \
+ *       $L8W8JWT/bin/release/libl8w8jwt.a $L8W8JWT/mbedtls/library/libmbedtls.a \
+ *       $L8W8JWT/mbedtls/library/libmbedx509.a $L8W8JWT/mbedtls/library/libmbedcrypto.a \
+ *       -lcjson -lcurl -lmicrohttpd -pthread $(pkg-config --cflags --libs libmongoc-1.0) \
+ *       -o micro_user
+ *
+ * Run it from backend/docker/user-service so common_passwords.txt is found.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "micro.h"
+#include "algs.h"
+#include "encode.h"
+#include "jwt_middleware.h"
+#include "password_validator.h"
+#include "repo.h"
+
+static const char* hmac_key = "micro-benchmark-key-that-is-long-enough-for-hs512";
+
+static char* make_token(void) {
+    char* jwt = NULL;
+    size_t jwt_length = 0;
+
+    struct l8w8jwt_encoding_params params;
+    l8w8jwt_encoding_params_init(&params);
+    params.alg = L8W8JWT_ALG_HS512;
+    params.sub = "marko.petrovic";
+    params.iss = "Trello Clone";
+    params.aud = "MANAGER";
+    params.iat = l8w8jwt_time(NULL);
+    params.exp = l8w8jwt_time(NULL) + 3600;
+    params.secret_key = (unsigned char*)hmac_key;
+    params.secret_key_length = strlen(hmac_key);
+    params.out = &jwt;
+    params.out_length = &jwt_length;
+
+    return l8w8jwt_encode(&params) == L8W8JWT_SUCCESS ? jwt : NULL;
+}
+
+static void bench_validate_jwt(void* arg) {
+    AuthContext auth;
+    micro_sink += validate_jwt_token((const char*)arg, &auth);
+}
+
+static void bench_password_hash(void* arg) {
+    char hash[41];
+    micro_sink += password_hash((const char*)arg, hash);
+}
+
+static void bench_blacklisted(void* arg) {
+    micro_sink += is_password_blacklisted((const char*)arg);
+}
+
+int main(int argc, char** argv) {
+    micro_init("user", argc, argv);
+    setenv("HMAC_KEY", hmac_key, 1);
+
+    char* token = make_token();
+    if (token == NULL) {
+        fprintf(stderr, "Could not create a token\n");
+        return 1;
+    }
+    micro_run("validate_jwt_token", bench_validate_jwt, token);
+    l8w8jwt_free(token);
+
+    micro_run("password_hash", bench_password_hash, "correct horse battery staple");
+
+    if (init_password_validator() != 0) {
+        fprintf(stderr, "common_passwords.txt not found, the blacklist is empty\n");
+    }
+    // A hit near the top of the list and a miss that has to check every entry
+    micro_run("is_password_blacklisted_hit", bench_blacklisted, "password");
+    micro_run("is_password_blacklisted_miss", bench_blacklisted, "Tr3llo-board-2025!");
+    cleanup_password_validator();
+    return 0;
+}
@@ -0,0 +1,83 @@
+#!/bin/sh
+# Builds and runs every microbenchmark suite, one JSON object per line.
+#
+#   ./run_micro.sh [--output results.jsonl] [--baseline previous.jsonl] [--threshold 10]
+#
+# With --baseline the run fails when any benchmark's median ns/op is more
+# than threshold percent slower than the same benchmark in the baseline.
+# The user suite needs L8W8JWT pointing at a built l8w8jwt tree and is
+# skipped without it. Extra arguments after -- go to every suite, e.g.
+# -- --iterations 20000.
+set -e
+
+cd "$(dirname "$0")"
+OUTPUT=micro_results.jsonl
+BASELINE=
+THRESHOLD=10
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --output) OUTPUT=$2; shift 2 ;;
+        --baseline) BASELINE=$2; shift 2 ;;
+        --threshold) THRESHOLD=$2; shift 2 ;;
+        --) shift; break ;;
+        *) echo "Unknown option $1" >&2; exit 1 ;;
+    esac
+done
+
+BUILD=${BUILD_DIR:-build}
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:--O2}
+MONGOC=$(pkg-config --cflags --libs libmongoc-1.0)
+U=../docker/user-service
+T=../docker/task-service
+P=../docker/project-service
+G=../docker/api-gateway
+mkdir -p "$BUILD"
+BUILD=$(cd "$BUILD" && pwd)
+
+$CC $CFLAGS -I$G micro_gateway.c micro.c $G/proxy.c -lcurl -o "$BUILD/micro_gateway"
+$CC $CFLAGS -I$P micro_project.c micro.c $P/model.c $P/json_reader.c $P/logger.c \
+    -lcjson -pthread -o "$BUILD/micro_project"
+$CC $CFLAGS -I$T micro_task.c micro.c $T/repo.c $T/model.c $T/json_reader.c $T/arena.c \
+    $T/logger.c $T/metrics.c -lcjson -pthread $MONGOC -o "$BUILD/micro_task"
+if [ -n "$L8W8JWT" ]; then
+    $CC $CFLAGS -I$U -I"$L8W8JWT/include/l8w8jwt" micro_user.c micro.c $U/jwt_middleware.c \
+        $U/repo.c $U/SHA.c $U/password_validator.c $U/logger.c $U/metrics.c \
+        "$L8W8JWT/bin/release/libl8w8jwt.a" "$L8W8JWT/mbedtls/library/libmbedtls.a" \
+        "$L8W8JWT/mbedtls/library/libmbedx509.a" "$L8W8JWT/mbedtls/library/libmbedcrypto.a" \
+        -lcjson -lcurl -lmicrohttpd -pthread $MONGOC -o "$BUILD/micro_user"
+fi
+
+: > "$OUTPUT"
+"$BUILD/micro_gateway" "$@" >> "$OUTPUT"
+"$BUILD/micro_project" "$@" >> "$OUTPUT"
+"$BUILD/micro_task" "$@" >> "$OUTPUT"
+if [ -x "$BUILD/micro_user" ]; then
+    # The blacklist is read from the working directory
+    (cd $U && "$BUILD/micro_user" "$@") >> "$OUTPUT"
+else
+    echo "L8W8JWT is not set, skipping the user suite" >&2
+fi
+cat "$OUTPUT"
+
+[ -z "$BASELINE" ] && exit 0
+
+# Join on suite/benchmark and flag anything slower than the threshold
+awk -v threshold="$THRESHOLD" '
+    function field(line, key,    pattern, value) {
+        pattern = "\"" key "\": \"?[^,}\"]*"
+        if (!match(line, pattern)) return ""
+        value = substr(line, RSTART, RLENGTH)
+        sub(/^"[^"]*": "?/, "", value)
+        return value
+    }
+    FNR == NR { baseline[field($0, "suite") "/" field($0, "benchmark")] = field($0, "ns_per_op"); next }
+    {
+        name = field($0, "suite") "/" field($0, "benchmark")
+        if (!(name in baseline) || baseline[name] <= 0) next
+        change = (field($0, "ns_per_op") - baseline[name]) * 100 / baseline[name]
+        printf "%-45s %10.1f -> %10.1f ns/op  %+6.1f%%\n", name, baseline[name], field($0, "ns_per_op"), change > "/dev/stderr"
+        if (change > threshold) failed = 1
+    }
+    END { exit failed }
+' "$BASELINE" "$OUTPUT"
@@ -0,0 +1,317 @@
+/*
+ * TLS handshake benchmark for the gateway.
+ *
+ * Runs two phases of equal length from a pool of client threads. The full
+ * phase opens a new connection and does a fresh handshake each time, the
+ * resumed phase hands every connection the session of an earlier one, so
+ * with tickets or the session cache on the server skips the certificate
+ * signature and key exchange. Each handshake is closed right after it
+ * completes, no HTTP request is sent.
+ *
+ * With --server-pid the gateway's CPU time is read from /proc before and
+ * after each phase, and the rates are also reported per CPU-second of the
+ * server, which is the handshakes one core can take.
+ *
+ * Build from backend/bench:
+ *
+ *   gcc -O2 tls_bench.c -lgnutls -pthread -o tls_bench
+ *
+ * Usage:
+ *
+ *   ./tls_bench [--host localhost] [--port 8443] [--threads 4] [--duration 10]
+ *       [--tls12] [--server-pid PID]
+ *
+ * The port defaults to $GATEWAY_PORT. --tls12 caps the client at TLS 1.2,
+ * where resumption goes through the session id cache unless tickets are on.
+ */
+#include <getopt.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <gnutls/gnutls.h>
+
+#define DEFAULT_THREADS 4
+#define DEFAULT_DURATION 10
+#define MAX_THREADS 256
+
+typedef enum {
+    PHASE_FULL,
+    PHASE_RESUMED,
+    PHASE_COUNT
+} Phase;
+
+static const char* phase_names[PHASE_COUNT] = { "full", "resumed" };
+
+typedef struct {
+    pthread_t thread;
+    size_t handshakes[PHASE_COUNT];
+    size_t errors[PHASE_COUNT];
+    size_t not_resumed;             // Resumption offered but the server did a full handshake
+} Worker;
+
+static const char* host = "localhost";
+static const char* port = NULL;
+static const char* priorities = "NORMAL";
+static struct addrinfo* address = NULL;
+static gnutls_certificate_credentials_t credentials;
+static Phase phase;
+static uint64_t phase_end;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Gateway CPU time in seconds, negative when it cannot be read
+static double server_cpu_seconds(long pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%ld/stat", pid);
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    char line[1024];
+    double seconds = -1;
+    if (fgets(line, sizeof(line), f)) {
+        // utime and stime are fields 14 and 15, counted after the parenthesised command name
+        char* p = strrchr(line, ')');
+        unsigned long utime, stime;
+        if (p && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) == 2) {
+            seconds = (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+        }
+    }
+    fclose(f);
+    return seconds;
+}
+
+static int connect_socket(void) {
+    int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * One handshake, resuming from resume_data when it is given. With save set
+ * the connection also reads a response, since TLS 1.3 tickets only arrive
+ * after the handshake, and the session is stored there for later use.
+ * Returns 1 for a full handshake, 2 for a resumed one, -1 on failure.
+ */
+static int handshake(const gnutls_datum_t* resume_data, gnutls_datum_t* save) {
+    int fd = connect_socket();
+    if (fd < 0) {
+        return -1;
+    }
+
+    gnutls_session_t session;
+    int result = -1;
+    if (gnutls_init(&session, GNUTLS_CLIENT) != GNUTLS_E_SUCCESS) {
+        close(fd);
+        return -1;
+    }
+    gnutls_priority_set_direct(session, priorities, NULL);
+    gnutls_credentials_set(session, GNUTLS_CRD_CERTIFICATE, credentials);
+    gnutls_server_name_set(session, GNUTLS_NAME_DNS, host, strlen(host));
+    gnutls_transport_set_int(session, fd);
+    if (resume_data) {
+        gnutls_session_set_data(session, resume_data->data, resume_data->size);
+    }
+
+    int ret;
+    do {
+        ret = gnutls_handshake(session);
+    } while (ret < 0 && gnutls_error_is_fatal(ret) == 0);
+
+    if (ret == GNUTLS_E_SUCCESS) {
+        result = gnutls_session_is_resumed(session) ? 2 : 1;
+        if (save) {
+            static const char request[] = "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+            char buffer[4096];
+            gnutls_record_send(session, request, sizeof(request) - 1);
+            while (gnutls_record_recv(session, buffer, sizeof(buffer)) > 0) {
+            }
+            if (gnutls_session_get_data2(session, save) != GNUTLS_E_SUCCESS) {
+                result = -1;
+            }
+        }
+        gnutls_bye(session, GNUTLS_SHUT_WR);
+    }
+    else {
+        fprintf(stderr, "Handshake failed: %s\n", gnutls_strerror(ret));
+    }
+
+    gnutls_deinit(session);
+    close(fd);
+    return result;
+}
+
+static void* run_worker(void* arg) {
+    Worker* worker = (Worker*)arg;
+    Phase current = phase;
+    gnutls_datum_t resume_data = { NULL, 0 };
+
+    if (current == PHASE_RESUMED && handshake(NULL, &resume_data) < 0) {
+        worker->errors[current]++;
+        return NULL;
+    }
+
+    while (now_us() < phase_end) {
+        int result = handshake(current == PHASE_RESUMED ? &resume_data : NULL, NULL);
+        if (result < 0) {
+            worker->errors[current]++;
+            continue;
+        }
+        worker->handshakes[current]++;
+        if (current == PHASE_RESUMED && result != 2) {
+            worker->not_resumed++;
+        }
+    }
+
+    gnutls_free(resume_data.data);
+    return NULL;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --host NAME        gateway host (localhost)\n"
+        "  --port PORT        gateway port ($GATEWAY_PORT or 8443)\n"
+        "  --threads N        client threads (%d)\n"
+        "  --duration S       seconds per phase (%d)\n"
+        "  --tls12            offer TLS 1.2 only\n"
+        "  --server-pid PID   also report handshakes per gateway CPU-second\n",
+        program, DEFAULT_THREADS, DEFAULT_DURATION);
+}
+
+int main(int argc, char** argv) {
+    static struct option options[] = {
+        { "host", required_argument, NULL, 'h' },
+        { "port", required_argument, NULL, 'p' },
+        { "threads", required_argument, NULL, 't' },
+        { "duration", required_argument, NULL, 'd' },
+        { "tls12", no_argument, NULL, '2' },
+        { "server-pid", required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int threads = DEFAULT_THREADS;
+    int duration = DEFAULT_DURATION;
+    long server_pid = 0;
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (option) {
+            case 'h': host = optarg; break;
+            case 'p': port = optarg; break;
+            case 't': threads = atoi(optarg); break;
+            case 'd': duration = atoi(optarg); break;
+            case '2': priorities = "NORMAL:-VERS-ALL:+VERS-TLS1.2"; break;
+            case 's': server_pid = atol(optarg); break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (threads <= 0 || threads > MAX_THREADS || duration <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (port == NULL) {
+        port = getenv("GATEWAY_PORT") ? getenv("GATEWAY_PORT") : "8443";
+    }
+
+    struct addrinfo hints = { 0 };
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &address) != 0) {
+        fprintf(stderr, "Cannot resolve %s:%s\n", host, port);
+        return 1;
+    }
+
+    // A server that drops the connection during gnutls_bye must not kill the benchmark
+    signal(SIGPIPE, SIG_IGN);
+    gnutls_global_init();
+    // The gateway's certificate is self-signed, only the handshake cost is of interest
+    gnutls_certificate_allocate_credentials(&credentials);
+
+    Worker* workers = calloc(threads, sizeof(Worker));
+    if (workers == NULL) {
+        return 1;
+    }
+
+    double elapsed_s[PHASE_COUNT];
+    double cpu_s[PHASE_COUNT];
+    for (phase = 0; phase < PHASE_COUNT; phase++) {
+        double cpu_start = server_pid ? server_cpu_seconds(server_pid) : -1;
+        uint64_t start = now_us();
+        phase_end = start + (uint64_t)duration * 1000000;
+
+        int started = 0;
+        for (; started < threads; started++) {
+            if (pthread_create(&workers[started].thread, NULL, run_worker, &workers[started]) != 0) {
+                fprintf(stderr, "Could only start %d threads\n", started);
+                break;
+            }
+        }
+        for (int i = 0; i < started; i++) {
+            pthread_join(workers[i].thread, NULL);
+        }
+
+        elapsed_s[phase] = (now_us() - start) / 1e6;
+        double cpu_end = server_pid ? server_cpu_seconds(server_pid) : -1;
+        cpu_s[phase] = cpu_start >= 0 && cpu_end >= 0 ? cpu_end - cpu_start : -1;
+    }
+
+    int failed = 0;
+    fprintf(stderr, "\n%-8s %11s %8s %12s %14s %12s\n",
+        "phase", "handshakes", "errors", "per second", "per cpu-second", "not resumed");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        size_t handshakes = 0;
+        size_t errors = 0;
+        size_t not_resumed = 0;
+        for (int i = 0; i < threads; i++) {
+            handshakes += workers[i].handshakes[p];
+            errors += workers[i].errors[p];
+            if (p == PHASE_RESUMED) {
+                not_resumed += workers[i].not_resumed;
+            }
+        }
+        char per_cpu[32] = "-";
+        if (cpu_s[p] > 0) {
+            snprintf(per_cpu, sizeof(per_cpu), "%.1f", handshakes / cpu_s[p]);
+        }
+        printf("%-8s %11zu %8zu %12.1f %14s %12zu\n",
+            phase_names[p], handshakes, errors, handshakes / elapsed_s[p], per_cpu, not_resumed);
+
+        if (errors * 100 > handshakes) {
+            fprintf(stderr, "%s: %zu of %zu handshakes failed\n", phase_names[p], errors, handshakes + errors);
+            failed = 1;
+        }
+        if (p == PHASE_RESUMED && not_resumed * 2 > handshakes) {
+            fprintf(stderr, "Most sessions were not resumed, are tickets and the session cache off?\n");
+            failed = 1;
+        }
+    }
+
+    free(workers);
+    gnutls_certificate_free_credentials(credentials);
+    gnutls_global_deinit();
+    freeaddrinfo(address);
+    return failed ? 2 : 0;
+}
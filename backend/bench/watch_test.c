@@ -0,0 +1,246 @@
+/*
+ * Change stream invalidation test for the project service's response cache.
+ *
+ * Starts the two watchers project-service runs, one on a projects and one
+ * on a tasks collection, and serves cached responses from a small MHD
+ * daemon the way the service's handlers do. Then writes through Mongo and
+ * checks that:
+ *
+ *   - an insert into projects bumps that project's cache version and the
+ *     cached response is evicted,
+ *   - an insert into tasks does the same for the task's project_id,
+ *   - a task delete, which carries no project, stales every entry,
+ *   - dropping the projects collection, which ends the stream with an
+ *     invalidate event, stales every entry as well.
+ *
+ * Change streams need a replica set, a local single node is enough:
+ *
+ *   mongod --replSet rs0 --dbpath /tmp/rs0 --port 27017 &
+ *   mongosh --eval 'rs.initiate()'
+ *
+ * The test uses its own databases, watch_test_trello and watch_test_tasks,
+ * and drops them when it is done. Build from backend/bench:
+ *
+ *   P=../docker/project-service
+ *   gcc -O2 -I$P watch_test.c $P/response_cache.c $P/cache_watcher.c $P/compression.c \
+ *       $P/request.c $P/arena.c $P/repo.c $P/model.c $P/json_reader.c $P/logger.c $P/metrics.c \
+ *       -lmicrohttpd -lcurl -lcjson -lz -pthread $(pkg-config --cflags --libs libmongoc-1.0) \
+ *       -o watch_test
+ *
+ * Usage:
+ *
+ *   DBURI='mongodb://localhost:27017/?replicaSet=rs0' ./watch_test [--port 18090]
+ *
+ * Prints one line per check and exits non-zero when any of them fails.
+ */
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <mongoc/mongoc.h>
+#include "cache_watcher.h"
+#include "compression.h"
+#include "logger.h"
+#include "response_cache.h"
+
+#define PROJECTS_DB "watch_test_trello"
+#define TASKS_DB "watch_test_tasks"
+#define WAIT_MS 10000
+#define POLL_MS 50
+
+static int port = 18090;
+static int failures = 0;
+
+// GET /<project_id> answers from the cache, X-Cache says whether it was a hit
+static enum MHD_Result serve(void* cls, struct MHD_Connection* connection,
+    const char* url, const char* method, const char* version,
+    const char* upload_data, size_t* upload_data_size, void** con_cls) {
+
+    const char* project_id = url + 1;
+    uint64_t cache_version = response_cache_version(project_id);
+    unsigned int status;
+    const char* result = "hit";
+    struct MHD_Response* response = response_cache_lookup(connection, url, cache_version, &status);
+    if (response == NULL) {
+        char body[128];
+        snprintf(body, sizeof(body), "{\"project_id\": \"%s\"}", project_id);
+        result = "miss";
+        response = response_cache_store(connection, url, cache_version, strdup(body), &status);
+    }
+    if (response == NULL) {
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "X-Cache", result);
+    enum MHD_Result ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+static size_t on_header(char* buffer, size_t size, size_t nitems, void* userdata) {
+    size_t length = size * nitems;
+    if (length > 13 && strncasecmp(buffer, "X-Cache: hit", 12) == 0) {
+        *(int*)userdata = 1;
+    }
+    return length;
+}
+
+static size_t discard(void* contents, size_t size, size_t nmemb, void* userp) {
+    return size * nmemb;
+}
+
+// 1 when the cache answered, 0 when the response was built, -1 on a transport error
+static int fetch(const char* project_id) {
+    char url[128];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/%s", port, project_id);
+    int hit = 0;
+    CURL* curl = curl_easy_init();
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, on_header);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &hit);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard);
+    CURLcode res = curl_easy_perform(curl);
+    curl_easy_cleanup(curl);
+    return res == CURLE_OK ? hit : -1;
+}
+
+static void check(int passed, const char* what) {
+    printf("%s %s\n", passed ? "ok  " : "FAIL", what);
+    if (!passed) {
+        failures++;
+    }
+}
+
+// Waits for the watcher to move the project's version past before
+static int wait_for_bump(const char* project_id, uint64_t before) {
+    for (int waited = 0; waited < WAIT_MS; waited += POLL_MS) {
+        if (response_cache_version(project_id) != before) {
+            return 1;
+        }
+        usleep(POLL_MS * 1000);
+    }
+    return 0;
+}
+
+// Caches the project's response and checks the second request is served from it
+static uint64_t warm(const char* project_id, const char* what) {
+    fetch(project_id);
+    char message[128];
+    snprintf(message, sizeof(message), "%s: cached before the write", what);
+    check(fetch(project_id) == 1, message);
+    return response_cache_version(project_id);
+}
+
+static void expect_evicted(const char* project_id, uint64_t before, const char* what) {
+    char message[128];
+    snprintf(message, sizeof(message), "%s: version bumped", what);
+    check(wait_for_bump(project_id, before), message);
+    snprintf(message, sizeof(message), "%s: cached entry evicted", what);
+    check(fetch(project_id) == 0, message);
+}
+
+static void new_id(char id[25]) {
+    bson_oid_t oid;
+    bson_oid_init(&oid, NULL);
+    bson_oid_to_string(&oid, id);
+}
+
+int main(int argc, char** argv) {
+    static struct option options[] = {
+        { "port", required_argument, NULL, 'p' },
+        { NULL, 0, NULL, 0 },
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        if (option == 'p') {
+            port = atoi(optarg);
+        }
+        else {
+            fprintf(stderr, "Usage: %s [--port 18090]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    log_init("watch-test");
+    setenv("DBURI", "mongodb://localhost:27017/?replicaSet=rs0", 0);
+    setenv("RESPONSE_CACHE_TTL", "300", 0);
+    mongoc_init();
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    response_cache_init();
+    compression_init();
+
+    mongoc_client_t* client = mongoc_client_new(getenv("DBURI"));
+    bson_error_t error;
+    if (client == NULL || !mongoc_client_get_server_status(client, NULL, NULL, &error)) {
+        fprintf(stderr, "Cannot reach %s\n", getenv("DBURI"));
+        return 2;
+    }
+    mongoc_collection_t* projects = mongoc_client_get_collection(client, PROJECTS_DB, "projects");
+    mongoc_collection_t* tasks = mongoc_client_get_collection(client, TASKS_DB, "tasks");
+
+    struct MHD_Daemon* daemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY, port, NULL, NULL,
+        serve, NULL, MHD_OPTION_END);
+    if (daemon == NULL) {
+        fprintf(stderr, "Cannot listen on port %d\n", port);
+        return 2;
+    }
+
+    // Each watcher stales the whole cache once its stream is open
+    uint64_t start = response_cache_version(NULL);
+    cache_watcher_start(PROJECTS_DB, "projects", NULL, NULL);
+    cache_watcher_start(TASKS_DB, "tasks", "project_id", NULL);
+    int opened = 0;
+    for (int waited = 0; waited < WAIT_MS && !opened; waited += POLL_MS) {
+        opened = response_cache_version(NULL) - start >= 2;
+        usleep(POLL_MS * 1000);
+    }
+    check(opened, "both change streams opened");
+
+    char project_id[25];
+    new_id(project_id);
+    bson_oid_t project_oid;
+    bson_oid_init_from_string(&project_oid, project_id);
+
+    uint64_t before = warm(project_id, "project insert");
+    bson_t* project = BCON_NEW("_id", BCON_OID(&project_oid), "name", BCON_UTF8("Watch test"));
+    check(mongoc_collection_insert_one(projects, project, NULL, NULL, &error), "project insert: written");
+    bson_destroy(project);
+    expect_evicted(project_id, before, "project insert");
+
+    before = warm(project_id, "task insert");
+    bson_t* task = BCON_NEW("project_id", BCON_UTF8(project_id), "name", BCON_UTF8("Watch test task"));
+    check(mongoc_collection_insert_one(tasks, task, NULL, NULL, &error), "task insert: written");
+    expect_evicted(project_id, before, "task insert");
+
+    // Deletes only carry the task's _id, so every project has to go
+    char other_id[25];
+    new_id(other_id);
+    before = warm(other_id, "task delete");
+    check(mongoc_collection_delete_many(tasks, task, NULL, NULL, &error), "task delete: written");
+    bson_destroy(task);
+    expect_evicted(other_id, before, "task delete");
+
+    before = warm(other_id, "collection drop");
+    check(mongoc_collection_drop(projects, &error), "collection drop: written");
+    expect_evicted(other_id, before, "collection drop");
+
+    MHD_stop_daemon(daemon);
+    mongoc_collection_drop(tasks, NULL);
+    mongoc_collection_destroy(projects);
+    mongoc_collection_destroy(tasks);
+
+    mongoc_database_t* database = mongoc_client_get_database(client, PROJECTS_DB);
+    mongoc_database_drop(database, NULL);
+    mongoc_database_destroy(database);
+    database = mongoc_client_get_database(client, TASKS_DB);
+    mongoc_database_drop(database, NULL);
+    mongoc_database_destroy(database);
+    mongoc_client_destroy(client);
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
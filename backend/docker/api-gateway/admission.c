@@ -0,0 +1,247 @@
+#include "admission.h"
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include "logger.h"
+#include "metrics.h"
+
+#define BUCKET_SLOTS 65536          // Direct-mapped, a colliding key takes over the bucket at its level
+#define TOKEN_UNIT 16               // Tokens are kept in sixteenths
+#define MAX_BURST (0xffff / TOKEN_UNIT)
+
+typedef enum {
+    BUDGET_IP,
+    BUDGET_USER,
+    BUDGET_AUTH,
+    BUDGET_COUNT
+} BudgetKind;
+
+typedef struct {
+    const char* env;
+    const char* fallback;
+    double units_per_ms;
+    uint32_t burst_units;
+} Budget;
+
+static Budget budgets[BUDGET_COUNT] = {
+    [BUDGET_IP] = { "RATE_LIMIT_IP", "50:100", 0, 0 },
+    [BUDGET_USER] = { "RATE_LIMIT_USER", "20:40", 0, 0 },
+    [BUDGET_AUTH] = { "RATE_LIMIT_AUTH", "0.2:5", 0, 0 },
+};
+
+// Routes that cost a password hash or an email each
+static const char* auth_routes[] = {
+    "/user/login",
+    "/user/newuser",
+    "/user/magicclaw",
+    "/user/recoverpassword",
+    "/user/confirmpasswordrecovery",
+};
+
+/**
+ * One word per bucket so it is updated with a single CAS: a 16 bit tag of
+ * the key, the tokens left in sixteenths and the millisecond it was last
+ * refilled. Mapped shared, so every worker takes from the same buckets.
+ */
+static _Atomic uint64_t* buckets = NULL;
+static uint64_t seed;
+
+static _Atomic int in_flight;
+static int max_in_flight = 0;
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int parse_budget(Budget* budget) {
+    const char* value = getenv(budget->env);
+    if (value == NULL) {
+        value = budget->fallback;
+    }
+    double rate = 0;
+    double burst = 0;
+    if (strcmp(value, "0") != 0 && (sscanf(value, "%lf:%lf", &rate, &burst) != 2 || rate <= 0 || burst < 1)) {
+        LOG_ERROR("%s must be rate:burst in requests per second, or 0", budget->env);
+        return -1;
+    }
+    if (burst > MAX_BURST) {
+        LOG_WARN("%s burst capped at %d", budget->env, MAX_BURST);
+        burst = MAX_BURST;
+    }
+    budget->units_per_ms = rate * TOKEN_UNIT / 1000;
+    budget->burst_units = (uint32_t)(burst * TOKEN_UNIT);
+    return 0;
+}
+
+int admission_init(unsigned int threads) {
+    for (int i = 0; i < BUDGET_COUNT; i++) {
+        if (parse_budget(&budgets[i]) != 0) {
+            return -1;
+        }
+    }
+
+    buckets = mmap(NULL, BUCKET_SLOTS * sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (buckets == MAP_FAILED) {
+        buckets = NULL;
+        return -1;
+    }
+    // Keys come from clients, a secret seed keeps them from choosing collisions
+    if (getrandom(&seed, sizeof(seed), 0) != sizeof(seed)) {
+        seed = metrics_now();
+    }
+    seed ^= 14695981039346656037ULL;
+
+    const char* env = getenv("GATEWAY_MAX_IN_FLIGHT");
+    max_in_flight = env ? atoi(env) : (int)(threads - threads / 4);
+    if (max_in_flight < 1) {
+        max_in_flight = 1;
+    }
+
+    LOG_INFO("Rate limits ip %s, user %s, auth %s, %d requests in flight per worker",
+        getenv("RATE_LIMIT_IP") ? getenv("RATE_LIMIT_IP") : budgets[BUDGET_IP].fallback,
+        getenv("RATE_LIMIT_USER") ? getenv("RATE_LIMIT_USER") : budgets[BUDGET_USER].fallback,
+        getenv("RATE_LIMIT_AUTH") ? getenv("RATE_LIMIT_AUTH") : budgets[BUDGET_AUTH].fallback,
+        max_in_flight);
+    return 0;
+}
+
+// 0 when a token was taken, otherwise milliseconds until one is available
+static uint32_t take_token(uint64_t hash, const Budget* budget, uint32_t now) {
+    if (budget->burst_units == 0) {
+        return 0;
+    }
+    _Atomic uint64_t* slot = &buckets[hash % BUCKET_SLOTS];
+    uint64_t tag = (hash >> 48) | 1;    // 0 marks an unused slot
+    uint64_t old = atomic_load_explicit(slot, memory_order_relaxed);
+    for (;;) {
+        uint32_t units = budget->burst_units;
+        uint32_t stamp = now;
+        // A key that collides keeps the level it finds, so evicting a bucket never refills one
+        if (old != 0) {
+            units = (old >> 32) & 0xffff;
+            if (units > budget->burst_units) {
+                units = budget->burst_units;
+            }
+            stamp = (uint32_t)old;
+            // Only whole sixteenths are added, the clock is left alone until there is one to add
+            double refill = (uint32_t)(now - stamp) * budget->units_per_ms;
+            if (refill >= 1) {
+                units = refill >= budget->burst_units - units ? budget->burst_units : units + (uint32_t)refill;
+                stamp = now;
+            }
+        }
+        if (units < TOKEN_UNIT) {
+            return (uint32_t)((TOKEN_UNIT - units) / budget->units_per_ms) + 1;
+        }
+        uint64_t next = tag << 48 | (uint64_t)(units - TOKEN_UNIT) << 32 | stamp;
+        if (atomic_compare_exchange_weak_explicit(slot, &old, next, memory_order_relaxed, memory_order_relaxed)) {
+            return 0;
+        }
+    }
+}
+
+// Gives back a token take_token took, unless the slot has since gone to another key
+static void refund_token(uint64_t hash, const Budget* budget) {
+    if (budget->burst_units == 0) {
+        return;
+    }
+    _Atomic uint64_t* slot = &buckets[hash % BUCKET_SLOTS];
+    uint64_t tag = (hash >> 48) | 1;
+    uint64_t old = atomic_load_explicit(slot, memory_order_relaxed);
+    for (;;) {
+        if (old >> 48 != tag) {
+            return;
+        }
+        uint32_t units = (old >> 32) & 0xffff;
+        units = units + TOKEN_UNIT > budget->burst_units ? budget->burst_units : units + TOKEN_UNIT;
+        uint64_t next = tag << 48 | (uint64_t)units << 32 | (uint32_t)old;
+        if (atomic_compare_exchange_weak_explicit(slot, &old, next, memory_order_relaxed, memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+static void count(const char* reason) {
+    metrics_add(metrics_series(METRIC_REJECTED_REQUESTS, reason), 1);
+}
+
+unsigned int admission_rate_check(struct MHD_Connection* connection, const char* url, const Identity* identity) {
+    if (buckets == NULL) {
+        return 0;
+    }
+    uint32_t now = (uint32_t)(metrics_now() / 1000);
+
+    // IPv6 clients are given a /64, so they are limited by prefix
+    uint64_t address = seed;
+    const union MHD_ConnectionInfo* info = MHD_get_connection_info(connection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+    if (info && info->client_addr) {
+        const struct sockaddr* sa = info->client_addr;
+        if (sa->sa_family == AF_INET) {
+            address = hash_bytes(address, &((const struct sockaddr_in*)sa)->sin_addr, 4);
+        }
+        else if (sa->sa_family == AF_INET6) {
+            address = hash_bytes(address, &((const struct sockaddr_in6*)sa)->sin6_addr, 8);
+        }
+    }
+
+    // Every bucket the request falls in, the auth one first as it is the likeliest to be empty
+    uint64_t keys[BUDGET_COUNT];
+    const Budget* charged[BUDGET_COUNT];
+    int count_charged = 0;
+    for (size_t i = 0; i < sizeof(auth_routes) / sizeof(auth_routes[0]); i++) {
+        if (strcmp(url, auth_routes[i]) == 0) {
+            keys[count_charged] = hash_bytes(address, auth_routes[i], strlen(auth_routes[i]));
+            charged[count_charged++] = &budgets[BUDGET_AUTH];
+            break;
+        }
+    }
+    keys[count_charged] = hash_bytes(address, "ip", 2);
+    charged[count_charged++] = &budgets[BUDGET_IP];
+    // Keyed on who the token was issued to, so rotating tokens does not get a fresh bucket.
+    // A token that does not verify is charged to the client address instead
+    if (identity) {
+        keys[count_charged] = hash_bytes(hash_bytes(seed, "user", 4), identity->user_id, strlen(identity->user_id));
+        charged[count_charged++] = &budgets[BUDGET_USER];
+    }
+    else if (MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Authorization")) {
+        keys[count_charged] = hash_bytes(address, "user", 4);
+        charged[count_charged++] = &budgets[BUDGET_USER];
+    }
+
+    for (int i = 0; i < count_charged; i++) {
+        uint32_t wait_ms = take_token(keys[i], charged[i], now);
+        if (wait_ms != 0) {
+            // A rejected request costs nothing, the tokens already taken go back
+            while (i-- > 0) {
+                refund_token(keys[i], charged[i]);
+            }
+            count("rate_limited");
+            return (wait_ms + 999) / 1000;
+        }
+    }
+    return 0;
+}
+
+int admission_enter(void) {
+    if (atomic_fetch_add(&in_flight, 1) >= max_in_flight) {
+        atomic_fetch_sub(&in_flight, 1);
+        count("shed");
+        return -1;
+    }
+    return 0;
+}
+
+void admission_exit(void) {
+    atomic_fetch_sub(&in_flight, 1);
+}
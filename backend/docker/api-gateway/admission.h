@@ -0,0 +1,43 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <microhttpd.h>
+#include "identity.h"
+
+/**
+ * Reads the limits from the environment, before the workers are forked so
+ * they all share one set of token buckets. Budgets are "rate:burst" in
+ * requests per second, 0 turns that limit off:
+ *
+ *   RATE_LIMIT_IP          every request, per client address (default 50:100)
+ *   RATE_LIMIT_USER        every request with a bearer token, per verified user,
+ *                          or per client address when the token does not verify
+ *                          (default 20:40)
+ *   RATE_LIMIT_AUTH        login, sign-up and recovery, which hash passwords or
+ *                          send mail, per client address and route (default 0.2:5)
+ *   GATEWAY_MAX_IN_FLIGHT  requests each worker proxies at once, the rest are
+ *                          shed (default three quarters of threads)
+ *
+ * Returns -1 when a setting cannot be used.
+ */
+int admission_init(unsigned int threads);
+
+/**
+ * Takes a token from every bucket the request falls in. 0 when it may go
+ * ahead, otherwise the seconds until the empty bucket has a token again and
+ * nothing is taken from the others. identity is the request's verified
+ * token, NULL when it has none or it did not verify.
+ */
+unsigned int admission_rate_check(struct MHD_Connection* connection, const char* url, const Identity* identity);
+
+/**
+ * Counts the request as in flight, -1 when the worker is already at its
+ * limit. The threads beyond the limit then only answer 503, so a backlog
+ * drains quickly instead of every request waiting behind it.
+ */
+int admission_enter(void);
+
+// Ends a request admission_enter let through
+void admission_exit(void);
+
+#endif
@@ -0,0 +1,167 @@
+#include "compression.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+#include "logger.h"
+
+#define DEFAULT_LEVEL 6
+#define DEFAULT_MIN_SIZE 1024
+#define GZIP_WINDOW_BITS (15 + 16)     // Largest window, with a gzip header and trailer
+#define STREAM_BLOCK_SIZE 16384
+
+static int level = DEFAULT_LEVEL;
+static size_t min_size = DEFAULT_MIN_SIZE;
+
+void compression_init(void) {
+    const char* env = getenv("COMPRESS_LEVEL");
+    if (env) {
+        level = atoi(env);
+        if (level < 0 || level > 9) {
+            level = DEFAULT_LEVEL;
+        }
+    }
+    env = getenv("COMPRESS_MIN_SIZE");
+    if (env) {
+        min_size = (size_t)atol(env);
+    }
+    LOG_INFO("Compression level %d, minimum size %zu", level, min_size);
+}
+
+// q-value of one Accept-Encoding element, params points just past the coding name
+static double quality(const char* params, size_t length) {
+    for (size_t i = 0; i + 1 < length; i++) {
+        if ((params[i] == 'q' || params[i] == 'Q') && params[i + 1] == '=') {
+            return atof(params + i + 2);
+        }
+    }
+    return 1.0;
+}
+
+int compression_accepted(struct MHD_Connection* connection) {
+    if (level == 0) {
+        return 0;
+    }
+    const char* header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Accept-Encoding");
+    if (header == NULL) {
+        return 0;
+    }
+
+    double gzip = -1;
+    double any = -1;
+    const char* p = header;
+    while (*p) {
+        p += strspn(p, " \t,");
+        size_t length = strcspn(p, ",");
+        size_t name_length = strcspn(p, " \t;,");
+        double q = quality(p + name_length, length - name_length);
+        if ((name_length == 4 && strncasecmp(p, "gzip", 4) == 0) ||
+            (name_length == 6 && strncasecmp(p, "x-gzip", 6) == 0)) {
+            gzip = q;
+        }
+        else if (name_length == 1 && *p == '*') {
+            any = q;
+        }
+        p += length;
+    }
+    // An explicit gzip;q=0 wins over *
+    return gzip >= 0 ? gzip > 0 : any > 0;
+}
+
+char* compression_gzip(const char* data, size_t size, size_t* compressed_size) {
+    if (level == 0 || size < min_size) {
+        return NULL;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+    // Sized for the worst case, so a single deflate call finishes the stream
+    uLong capacity = deflateBound(&stream, size);
+    char* out = malloc(capacity);
+    if (out == NULL) {
+        deflateEnd(&stream);
+        return NULL;
+    }
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = size;
+    stream.next_out = (Bytef*)out;
+    stream.avail_out = capacity;
+
+    int result = deflate(&stream, Z_FINISH);
+    size_t produced = stream.total_out;
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END || produced >= size) {
+        free(out);
+        return NULL;
+    }
+    *compressed_size = produced;
+    return out;
+}
+
+typedef struct {
+    z_stream stream;
+    int finished;
+    void (*done)(void*);
+    void* done_cls;
+} GzipStream;
+
+static ssize_t read_gzip(void* cls, uint64_t pos, char* buf, size_t max) {
+    GzipStream* gzip = (GzipStream*)cls;
+    if (gzip->finished) {
+        return MHD_CONTENT_READER_END_OF_STREAM;
+    }
+    // The whole input is there, so every call fills MHD's block or ends the stream
+    gzip->stream.next_out = (Bytef*)buf;
+    gzip->stream.avail_out = max;
+    int result = deflate(&gzip->stream, Z_FINISH);
+    if (result == Z_STREAM_END) {
+        gzip->finished = 1;
+    }
+    else if (result != Z_OK) {
+        return MHD_CONTENT_READER_END_WITH_ERROR;
+    }
+    size_t produced = max - gzip->stream.avail_out;
+    if (produced == 0) {
+        return gzip->finished ? MHD_CONTENT_READER_END_OF_STREAM : MHD_CONTENT_READER_END_WITH_ERROR;
+    }
+    return produced;
+}
+
+static void free_gzip(void* cls) {
+    GzipStream* gzip = (GzipStream*)cls;
+    deflateEnd(&gzip->stream);
+    gzip->done(gzip->done_cls);
+    free(gzip);
+}
+
+struct MHD_Response* compression_gzip_response(const char* data, size_t size, void (*done)(void*), void* done_cls) {
+    if (level == 0 || size < min_size) {
+        return NULL;
+    }
+
+    GzipStream* gzip = calloc(1, sizeof(GzipStream));
+    if (gzip == NULL) {
+        return NULL;
+    }
+    if (deflateInit2(&gzip->stream, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(gzip);
+        return NULL;
+    }
+    gzip->stream.next_in = (Bytef*)data;
+    gzip->stream.avail_in = size;
+    gzip->done = done;
+    gzip->done_cls = done_cls;
+
+    // Length unknown until the last block, so MHD sends it chunked
+    struct MHD_Response* response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, STREAM_BLOCK_SIZE,
+        read_gzip, gzip, free_gzip);
+    if (response == NULL) {
+        deflateEnd(&gzip->stream);
+        free(gzip);
+    }
+    return response;
+}
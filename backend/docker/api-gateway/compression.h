@@ -0,0 +1,32 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stddef.h>
+#include <microhttpd.h>
+
+/**
+ * Reads COMPRESS_LEVEL, the zlib level from 1 to 9 (default 6, 0 turns
+ * compression off), and COMPRESS_MIN_SIZE, the smallest body worth
+ * compressing in bytes (default 1024).
+ */
+void compression_init(void);
+
+// 1 when the request's Accept-Encoding takes gzip, explicitly or through *
+int compression_accepted(struct MHD_Connection* connection);
+
+/**
+ * gzip of data, NULL when compression is off, data is below the minimum
+ * size or does not shrink. The result is released with free.
+ */
+char* compression_gzip(const char* data, size_t size, size_t* compressed_size);
+
+/**
+ * Response that gzips data a block at a time as MHD sends it, so no
+ * compressed copy is built and the first bytes go out before the rest is
+ * deflated. data must stay valid until done is called with done_cls, when
+ * MHD releases the response. NULL when compression is off or data is below
+ * the minimum size, done is not called then.
+ */
+struct MHD_Response* compression_gzip_response(const char* data, size_t size, void (*done)(void*), void* done_cls);
+
+#endif
@@ -0,0 +1,112 @@
+#include "cors.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logger.h"
+
+#define DEFAULT_MAX_AGE 86400
+
+typedef struct {
+    const char* pattern;  // Gateway path, a {name} segment matches any one segment
+    const char* methods;
+    const char* headers;
+    struct MHD_Response* response;  // Queued for every matching preflight, never destroyed
+} CorsRule;
+
+#define USER_HEADERS "Content-Type, Authorization"
+#define PROJECT_HEADERS "Content-Type, Accept, Authorization"
+#define TASK_HEADERS "Content-Type, Authorization"
+
+// Mirrors the route tables in the services' main.c, keep them in step. The last rule covers every other path
+static CorsRule rules[] = {
+    { "/user/metrics", "GET, OPTIONS", USER_HEADERS, NULL },
+    { "/user/newuser", "POST, OPTIONS", USER_HEADERS, NULL },
+    { "/user/profile", "GET, OPTIONS", USER_HEADERS, NULL },
+    { "/user/admin/users", "GET, OPTIONS", USER_HEADERS, NULL },
+    { "/user/auth/verify", "GET, OPTIONS", USER_HEADERS, NULL },
+    { "/user/activate", "GET, POST, PUT, PATCH, DELETE, OPTIONS", USER_HEADERS, NULL },
+    { "/user/login", "POST, OPTIONS", USER_HEADERS, NULL },
+    { "/user/finduser", "GET, OPTIONS", USER_HEADERS, NULL },
+    { "/user/changepassword", "POST, OPTIONS", USER_HEADERS, NULL },
+    { "/user/magicclaw", "POST, OPTIONS", USER_HEADERS, NULL },
+    { "/user/magiclogin", "GET, OPTIONS", USER_HEADERS, NULL },
+    { "/user/recoverpassword", "POST, OPTIONS", USER_HEADERS, NULL },
+    { "/user/confirmrecovercode", "GET, OPTIONS", USER_HEADERS, NULL },
+    { "/user/confirmpasswordrecovery", "POST, OPTIONS", USER_HEADERS, NULL },
+
+    { "/project/metrics", "GET, OPTIONS", PROJECT_HEADERS, NULL },
+    { "/project/newproject", "POST, OPTIONS", PROJECT_HEADERS, NULL },
+    { "/project/projects", "GET, OPTIONS", PROJECT_HEADERS, NULL },
+    { "/project/projects/batch", "POST, OPTIONS", PROJECT_HEADERS, NULL },
+    { "/project/projects/{project_id}", "GET, OPTIONS", PROJECT_HEADERS, NULL },
+    { "/project/projects/{project_id}/summary", "GET, OPTIONS", PROJECT_HEADERS, NULL },
+    { "/project/updateproject/{project_id}", "PATCH, OPTIONS", PROJECT_HEADERS, NULL },
+    { "/project/deleteproject/{project_id}", "DELETE, OPTIONS", PROJECT_HEADERS, NULL },
+
+    { "/task/metrics", "GET, OPTIONS", TASK_HEADERS, NULL },
+    { "/task/tasks", "POST, OPTIONS", TASK_HEADERS, NULL },
+    { "/task/tasks/batch", "POST, OPTIONS", TASK_HEADERS, NULL },
+    { "/task/tasks/mine", "GET, OPTIONS", TASK_HEADERS, NULL },
+    { "/task/tasks/project/{project_id}", "GET, OPTIONS", TASK_HEADERS, NULL },
+    { "/task/tasks/project/{project_id}/events", "GET, OPTIONS", TASK_HEADERS, NULL },
+    { "/task/tasks/status/{task_id}", "PATCH, OPTIONS", TASK_HEADERS, NULL },
+    { "/task/tasks/members/{task_id}", "PATCH, OPTIONS", TASK_HEADERS, NULL },
+    { "/task/tasks/{task_id}/add-member", "POST, OPTIONS", TASK_HEADERS, NULL },
+    { "/task/tasks/{task_id}/remove-member", "POST, OPTIONS", TASK_HEADERS, NULL },
+
+    { NULL, "OPTIONS", "Content-Type, Authorization", NULL },
+};
+
+#define RULE_COUNT (sizeof(rules) / sizeof(rules[0]))
+
+int cors_init(void) {
+    const char* env = getenv("CORS_MAX_AGE");
+    int max_age = env ? atoi(env) : DEFAULT_MAX_AGE;
+    if (max_age < 0) {
+        max_age = 0;
+    }
+    char max_age_value[16];
+    snprintf(max_age_value, sizeof(max_age_value), "%d", max_age);
+
+    for (size_t i = 0; i < RULE_COUNT; i++) {
+        struct MHD_Response* response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
+        if (response == NULL) {
+            return -1;
+        }
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Access-Control-Allow-Methods", rules[i].methods);
+        MHD_add_response_header(response, "Access-Control-Allow-Headers", rules[i].headers);
+        MHD_add_response_header(response, "Access-Control-Max-Age", max_age_value);
+        rules[i].response = response;
+    }
+    LOG_INFO("CORS preflights cached for %ds", max_age);
+    return 0;
+}
+
+// Same segment rules as the services' router, so a preflight matches the route its request will hit
+static int path_matches(const char* pattern, const char* path) {
+    while (*pattern && *path) {
+        if (*pattern == '{') {
+            const char* close = strchr(pattern, '}');
+            size_t length = strcspn(path, "/");
+            if (close == NULL || length == 0) {
+                return 0;
+            }
+            pattern = close + 1;
+            path += length;
+        } else if (*pattern++ != *path++) {
+            return 0;
+        }
+    }
+    return *pattern == '\0' && *path == '\0';
+}
+
+enum MHD_Result cors_preflight(struct MHD_Connection* connection, const char* url) {
+    for (size_t i = 0; i < RULE_COUNT; i++) {
+        if (rules[i].pattern == NULL || path_matches(rules[i].pattern, url)) {
+            // MHD counts the references, so one response can be queued on any number of connections
+            return MHD_queue_response(connection, MHD_HTTP_NO_CONTENT, rules[i].response);
+        }
+    }
+    return MHD_NO;
+}
@@ -0,0 +1,17 @@
+#ifndef CORS_H
+#define CORS_H
+
+#include <microhttpd.h>
+
+/**
+ * Builds the preflight responses once, one per service route. CORS_MAX_AGE sets
+ * how many seconds browsers may cache a preflight (default 86400, Chromium
+ * caps it at 7200). Returns -1 when a response cannot be created.
+ */
+int cors_init(void);
+
+// Answers an OPTIONS request for url with its route's shared preflight response, which
+// only allows the methods that route accepts
+enum MHD_Result cors_preflight(struct MHD_Connection* connection, const char* url);
+
+#endif
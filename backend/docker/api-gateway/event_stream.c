@@ -0,0 +1,271 @@
+#include "event_stream.h"
+#include <curl/curl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "logger.h"
+#include "proxy.h"
+
+#define BLOCK_SIZE 4096
+#define PENDING_LIMIT (64 * 1024)   // A client this far behind is dropped, it reconnects and refetches
+#define HEADERS_TIMEOUT_S 5
+#define CONNECT_TIMEOUT_MS 1000
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready_changed;
+    struct MHD_Connection* connection;
+    char url[1512];
+    char socket_path[108];
+    HeaderArena request_headers;
+    HeaderBlock headers;            // What the service answered with, less the hop-by-hop headers
+    long status;                    // 0 when the transfer failed before the headers
+    int ready;                      // Headers are in, or the transfer is over
+    int done;
+    int closed;                     // The client went away, the connection must not be touched
+    int suspended;
+    int references;                 // One for the transfer thread, one for the MHD response
+    char* pending;
+    size_t pending_size;
+    size_t pending_capacity;
+} EventStream;
+
+static void stream_release(EventStream* stream) {
+    pthread_mutex_lock(&stream->lock);
+    int last = --stream->references == 0;
+    pthread_mutex_unlock(&stream->lock);
+    if (!last) {
+        return;
+    }
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->ready_changed);
+    header_block_free(&stream->headers);
+    free(stream->pending);
+    free(stream);
+}
+
+// Called with the lock held
+static void wake(EventStream* stream) {
+    if (stream->suspended && !stream->closed) {
+        stream->suspended = 0;
+        MHD_resume_connection(stream->connection);
+    }
+}
+
+static size_t on_header(char* buffer, size_t size, size_t nitems, void* userdata) {
+    size_t realsize = size * nitems;
+    EventStream* stream = (EventStream*)userdata;
+    if (stream->ready) {
+        // Trailers, the headers were already handed to MHD
+        return realsize;
+    }
+    if (realsize <= 2 && (buffer[0] == '\r' || buffer[0] == '\n')) {
+        if (stream->status < 200) {
+            // End of an interim response, the real one follows
+            return realsize;
+        }
+        // The headers are complete and the client can be answered
+        pthread_mutex_lock(&stream->lock);
+        stream->ready = 1;
+        pthread_cond_signal(&stream->ready_changed);
+        pthread_mutex_unlock(&stream->lock);
+        return realsize;
+    }
+    if (strncmp(buffer, "HTTP/", 5) == 0) {
+        // Status line, a later one replaces an interim 1xx response
+        header_block_free(&stream->headers);
+        stream->status = strtol(buffer + strcspn(buffer, " "), NULL, 10);
+        return realsize;
+    }
+    return header_block_add_line(&stream->headers, buffer, realsize) == 0 ? realsize : 0;
+}
+
+static size_t on_data(void* contents, size_t size, size_t nmemb, void* userp) {
+    size_t realsize = size * nmemb;
+    EventStream* stream = (EventStream*)userp;
+
+    pthread_mutex_lock(&stream->lock);
+    if (stream->closed || stream->pending_size + realsize > PENDING_LIMIT) {
+        pthread_mutex_unlock(&stream->lock);
+        return 0;
+    }
+    if (stream->pending_size + realsize > stream->pending_capacity) {
+        size_t capacity = stream->pending_capacity ? stream->pending_capacity : BLOCK_SIZE;
+        while (capacity < stream->pending_size + realsize) {
+            capacity *= 2;
+        }
+        char* pending = realloc(stream->pending, capacity);
+        if (pending == NULL) {
+            pthread_mutex_unlock(&stream->lock);
+            return 0;
+        }
+        stream->pending = pending;
+        stream->pending_capacity = capacity;
+    }
+    memcpy(stream->pending + stream->pending_size, contents, realsize);
+    stream->pending_size += realsize;
+    wake(stream);
+    pthread_mutex_unlock(&stream->lock);
+    return realsize;
+}
+
+// Ends a quiet transfer soon after the client leaves, curl calls it about once a second
+static int on_progress(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+    EventStream* stream = (EventStream*)clientp;
+    pthread_mutex_lock(&stream->lock);
+    int closed = stream->closed;
+    pthread_mutex_unlock(&stream->lock);
+    return closed;
+}
+
+static void* transfer(void* arg) {
+    EventStream* stream = (EventStream*)arg;
+    // One thread per stream, it logs at most a line when the transfer fails
+    log_thread_ring_size(4);
+
+    CURL* curl = curl_easy_init();
+    CURLcode res = CURLE_FAILED_INIT;
+    if (curl) {
+        curl_easy_setopt(curl, CURLOPT_URL, stream->url);
+        if (stream->socket_path[0]) {
+            curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, stream->socket_path);
+        }
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, stream->request_headers.head);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, on_header);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, stream);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, on_data);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, stream);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, on_progress);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, stream);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        // No overall timeout, the stream lasts as long as the client watches
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, (long)CONNECT_TIMEOUT_MS);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        res = curl_easy_perform(curl);
+        curl_easy_cleanup(curl);
+    }
+    if (res != CURLE_OK && res != CURLE_WRITE_ERROR && res != CURLE_ABORTED_BY_CALLBACK) {
+        LOG_WARN("Event stream from %s failed: %s", stream->url, curl_easy_strerror(res));
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    if (!stream->ready) {
+        stream->status = 0;
+    }
+    stream->ready = 1;
+    stream->done = 1;
+    pthread_cond_signal(&stream->ready_changed);
+    wake(stream);
+    pthread_mutex_unlock(&stream->lock);
+
+    stream_release(stream);
+    return NULL;
+}
+
+static ssize_t read_stream(void* cls, uint64_t pos, char* buf, size_t max) {
+    EventStream* stream = (EventStream*)cls;
+
+    pthread_mutex_lock(&stream->lock);
+    if (stream->pending_size == 0) {
+        if (stream->done) {
+            pthread_mutex_unlock(&stream->lock);
+            return MHD_CONTENT_READER_END_OF_STREAM;
+        }
+        // Parked until the service writes or closes, returning 0 is only safe while suspended
+        stream->suspended = 1;
+        MHD_suspend_connection(stream->connection);
+        pthread_mutex_unlock(&stream->lock);
+        return 0;
+    }
+    size_t size = stream->pending_size < max ? stream->pending_size : max;
+    memcpy(buf, stream->pending, size);
+    memmove(stream->pending, stream->pending + size, stream->pending_size - size);
+    stream->pending_size -= size;
+    pthread_mutex_unlock(&stream->lock);
+    return size;
+}
+
+static void close_stream(void* cls) {
+    EventStream* stream = (EventStream*)cls;
+    pthread_mutex_lock(&stream->lock);
+    stream->closed = 1;
+    pthread_mutex_unlock(&stream->lock);
+    stream_release(stream);
+}
+
+int event_stream_requested(struct MHD_Connection* connection, const char* method) {
+    const char* accept = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Accept");
+    return strcmp(method, "GET") == 0 && accept && strstr(accept, "text/event-stream");
+}
+
+static enum MHD_Result send_bad_gateway(struct MHD_Connection* connection) {
+    const char* error_response = "{\"error\": \"Bad Gateway\"}";
+    struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+        (void*)error_response, MHD_RESPMEM_PERSISTENT);
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_GATEWAY, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+enum MHD_Result event_stream_forward(struct MHD_Connection* connection, const char* url, const char* socket_path) {
+    EventStream* stream = calloc(1, sizeof(EventStream));
+    if (stream == NULL) {
+        return MHD_NO;
+    }
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->ready_changed, NULL);
+    stream->connection = connection;
+    snprintf(stream->url, sizeof(stream->url), "%s", url);
+    snprintf(stream->socket_path, sizeof(stream->socket_path), "%s", socket_path ? socket_path : "");
+    header_arena_init(&stream->request_headers);
+    MHD_get_connection_values(connection, MHD_HEADER_KIND, forward_header, &stream->request_headers);
+    stream->references = 2;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, transfer, stream) != 0) {
+        stream->references = 1;
+        stream_release(stream);
+        return send_bad_gateway(connection);
+    }
+    pthread_detach(thread);
+
+    // The headers come right after the service accepts the stream, before any event
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += HEADERS_TIMEOUT_S;
+    pthread_mutex_lock(&stream->lock);
+    int waited = 0;
+    while (!stream->ready && waited != ETIMEDOUT) {
+        waited = pthread_cond_timedwait(&stream->ready_changed, &stream->lock, &deadline);
+    }
+    long status = stream->ready ? stream->status : 0;
+    if (status == 0) {
+        stream->closed = 1;
+    }
+    pthread_mutex_unlock(&stream->lock);
+
+    if (status == 0) {
+        stream_release(stream);
+        return send_bad_gateway(connection);
+    }
+
+    struct MHD_Response* response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, BLOCK_SIZE,
+        read_stream, stream, close_stream);
+    if (response == NULL) {
+        close_stream(stream);
+        return MHD_NO;
+    }
+    // Complete once ready is set, the transfer thread only adds to it before that
+    const char* value;
+    for (const char* name = header_block_next(&stream->headers, NULL, &value); name;
+         name = header_block_next(&stream->headers, name, &value)) {
+        MHD_add_response_header(response, name, value);
+    }
+    enum MHD_Result ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
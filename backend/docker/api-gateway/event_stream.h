@@ -0,0 +1,18 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <microhttpd.h>
+
+// GETs accepting text/event-stream, which skip coalescing, hedging and the read timeout
+int event_stream_requested(struct MHD_Connection* connection, const char* method);
+
+/**
+ * Relays url, over socket_path when it is set, to the client as the service
+ * writes it. The transfer runs on a thread of its own and the connection is
+ * suspended while the service is quiet, so a stream holds no pool thread.
+ * Waits for the service's status and headers so they can be passed on. The
+ * daemon must run with MHD_ALLOW_SUSPEND_RESUME.
+ */
+enum MHD_Result event_stream_forward(struct MHD_Connection* connection, const char* url, const char* socket_path);
+
+#endif
@@ -1,17 +1,57 @@
+#define _GNU_SOURCE
 #include <microhttpd.h>
 #include <curl/curl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "admission.h"
+#include "logger.h"
+#include "metrics.h"
+#include "compression.h"
+#include "cors.h"
+#include "event_stream.h"
+#include "hedge.h"
+#include "identity.h"
+#include "proxy.h"
+#include "single_flight.h"
+#include "tls.h"
+#include "upstream.h"
 
 #define TARGET_HOST "http://localhost"
 #define PORT 8443
+#define MAX_WORKERS 64
+#define MAX_THREADS 64
+#define DEFAULT_THREADS 8
+#define RESTART_BACKOFF 1
+#define MAX_RETRIES 1
+#define RETRY_BACKOFF_US 20000
+#define MAX_INSTANCES 4
 
 int SERVICE_COUNT;
 
+struct ServiceInstance {
+    int port;
+    const char *socket_path;    // Set for unix: upstreams, port is unused then
+};
+
 struct ServiceAddressKeyValue {
     char *service;
-    int address;
+    char *instance_list;        // Owns the socket paths
+    struct ServiceInstance instances[MAX_INSTANCES];
+    int instance_count;
+    _Atomic unsigned int next_instance;
+    Upstream *upstream;
 };
 
 struct MemoryStruct {
@@ -22,12 +62,14 @@ struct MemoryStruct {
 // Struct to hold both body and headers of the response
 struct ResponseData {
     struct MemoryStruct body;
-    struct curl_slist *headers;
+    HeaderBlock headers;
 };
 
 struct ConnectionInfo {
     char* json_data;
     size_t json_size;
+    int route_series;
+    uint64_t start;
 };
 
 // Write callback for the body
@@ -43,31 +85,288 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
     return realsize;
 }
 
-// Write callback for headers
+// Write callback for headers, splits each one into the block as curl hands it over
 static size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
     size_t realsize = nitems * size;
     struct ResponseData *resp = (struct ResponseData *)userdata;
+    return header_block_add_line(&resp->headers, buffer, realsize) == 0 ? realsize : 0;
+}
 
-    // Skip the HTTP status line (e.g., HTTP/1.1 200 OK)
-    char *colon = memchr(buffer, ':', realsize);
-    if (colon) {
-        char header_line[1024];
-        snprintf(header_line, sizeof(header_line), "%.*s", (int)(realsize - 2), buffer); // remove \r\n
-        resp->headers = curl_slist_append(resp->headers, header_line);
+// JSON and text the service left unencoded, streams are forwarded as they are
+static int compressible(const HeaderBlock *headers) {
+    const char *type = header_block_get(headers, "Content-Type");
+    if (type == NULL || header_block_get(headers, "Content-Encoding")) {
+        return 0;
     }
-    return realsize;
+    if (strncasecmp(type, "text/event-stream", 17) == 0) {
+        return 0;
+    }
+    return strstr(type, "json") != NULL || strncasecmp(type, "text/", 5) == 0;
 }
 
-// Collect headers from MHD and forward them to libcurl
-static int header_iterator(void *cls, enum MHD_ValueKind kind, const char *key, const char *value) {
-    struct curl_slist **headers = (struct curl_slist **)cls;
-    char header[1024];
-    snprintf(header, sizeof(header), "%s: %s", key, value);
-    *headers = curl_slist_append(*headers, header);
-    return MHD_YES;
+// Same host over a unix socket skips the TCP stack, the host name then only ends up in the Host header
+static void format_target_url(char *buffer, size_t size, const char *service, const struct ServiceInstance *instance,
+                              const char *endpoint, const char *query) {
+    if (instance->socket_path) {
+        snprintf(buffer, size, "%s-service%s%s", service, endpoint, query);
+    } else {
+        snprintf(buffer, size, "%s-service:%d%s%s", service, instance->port, endpoint, query);
+    }
+}
+
+struct UpstreamRequest {
+    const char *url;
+    const char *socket_path;
+    const char *hedge_url;          // The next instance, NULL when there is only one
+    const char *hedge_socket_path;
+    int route;
+    const char *method;
+    const char *service;
+    struct curl_slist *headers;
+    const char *body;
+    size_t body_size;
+    Upstream *breaker;
+    long timeout_ms;
+    uint64_t slow_micros;
+};
+
+// Answer for a service whose breaker is open, shared like any upstream response
+static SharedResponse *unavailable_response(unsigned int retry_after) {
+    char *body = strdup("{\"error\": \"Service Unavailable\"}");
+    if (!body) return NULL;
+    char seconds[16];
+    int seconds_length = snprintf(seconds, sizeof(seconds), "%u", retry_after > 0 ? retry_after : 1);
+    HeaderBlock headers = { NULL, 0, 0 };
+    header_block_add(&headers, "Access-Control-Allow-Origin", 27, "*", 1);
+    header_block_add(&headers, "Content-Type", 12, "application/json", 16);
+    header_block_add(&headers, "Retry-After", 11, seconds, seconds_length);
+    return shared_response_create(MHD_HTTP_SERVICE_UNAVAILABLE, body, strlen(body), headers);
+}
+
+static int idempotent(const char *method) {
+    return strcmp(method, "GET") == 0 || strcmp(method, "HEAD") == 0 || strcmp(method, "PUT") == 0 ||
+           strcmp(method, "DELETE") == 0;
+}
+
+// Failures where the service never handled the request, or said it could not right now
+static int retryable(CURLcode res, long http_code) {
+    if (res != CURLE_OK) {
+        return res == CURLE_COULDNT_CONNECT || res == CURLE_SEND_ERROR || res == CURLE_GOT_NOTHING;
+    }
+    return http_code == MHD_HTTP_BAD_GATEWAY || http_code == MHD_HTTP_SERVICE_UNAVAILABLE ||
+           http_code == MHD_HTTP_GATEWAY_TIMEOUT;
+}
+
+/**
+ * Runs curl, and once delay has passed without an answer also a copy aimed
+ * at the hedge instance. The first good answer is left in resp and the
+ * other call is cancelled. Without a hedge left in the budget by then it
+ * just waits for curl.
+ */
+static CURLcode perform_hedged(CURL *curl, struct UpstreamRequest *upstream, struct ResponseData *resp,
+                               uint64_t delay, long *http_code) {
+    CURLM *multi = curl_multi_init();
+    if (!multi) {
+        CURLcode res = curl_easy_perform(curl);
+        if (res == CURLE_OK) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, http_code);
+        return res;
+    }
+    curl_multi_add_handle(multi, curl);
+
+    struct ResponseData hedge_resp = { { NULL, 0 }, { NULL, 0, 0 } };
+    CURL *hedge = NULL;
+    CURL *winner = NULL;
+    CURLcode res = CURLE_OK;
+    int waiting_to_hedge = 1;
+    int pending = 1;
+    uint64_t start = metrics_now();
+    while (!winner) {
+        int running;
+        curl_multi_perform(multi, &running);
+        CURLMsg *msg;
+        int queued;
+        while (!winner && (msg = curl_multi_info_read(multi, &queued))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            pending--;
+            long code = 500;
+            if (msg->data.result == CURLE_OK) curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &code);
+            // A failure only wins when there is nothing left to wait for
+            if ((msg->data.result == CURLE_OK && code < 500) || pending == 0) {
+                winner = msg->easy_handle;
+                res = msg->data.result;
+                *http_code = code;
+            }
+        }
+        if (winner) break;
+
+        int timeout_ms = 1000;
+        if (waiting_to_hedge) {
+            uint64_t elapsed = metrics_now() - start;
+            if (elapsed >= delay) {
+                waiting_to_hedge = 0;
+                if (hedge_take() && (hedge = curl_easy_duphandle(curl))) {
+                    hedge_resp.body.memory = malloc(1);
+                    curl_easy_setopt(hedge, CURLOPT_WRITEDATA, (void *)&hedge_resp.body);
+                    curl_easy_setopt(hedge, CURLOPT_HEADERDATA, (void *)&hedge_resp);
+                    curl_easy_setopt(hedge, CURLOPT_URL, upstream->hedge_url);
+                    curl_easy_setopt(hedge, CURLOPT_UNIX_SOCKET_PATH, upstream->hedge_socket_path);
+                    curl_multi_add_handle(multi, hedge);
+                    pending++;
+                    continue;
+                }
+            } else {
+                timeout_ms = (int)((delay - elapsed) / 1000) + 1;
+            }
+        }
+        curl_multi_poll(multi, NULL, 0, timeout_ms, NULL);
+    }
+
+    // Removing a handle that is still running cancels its transfer
+    curl_multi_remove_handle(multi, curl);
+    if (hedge) {
+        curl_multi_remove_handle(multi, hedge);
+        metrics_add(metrics_series(METRIC_HEDGED_REQUESTS, winner == hedge ? "won" : "lost"), 1);
+        if (winner == hedge) {
+            free(resp->body.memory);
+            header_block_free(&resp->headers);
+            *resp = hedge_resp;
+        } else {
+            free(hedge_resp.body.memory);
+            header_block_free(&hedge_resp.headers);
+        }
+        curl_easy_cleanup(hedge);
+    }
+    curl_multi_cleanup(multi);
+    return res;
 }
 
-int parse_parameters(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
+/**
+ * FlightFunction doing one proxied call, failures become a 500 with an
+ * empty body. Fails at once while the service's breaker is open, and
+ * retries an idempotent call once when the retry budget allows. A GET
+ * slower than its route's p95 is hedged.
+ */
+static SharedResponse *fetch_upstream(void *arg) {
+    struct UpstreamRequest *upstream = (struct UpstreamRequest *)arg;
+    unsigned int retry_after = 0;
+    UpstreamPermit permit = upstream_permit(upstream->breaker, &retry_after);
+    if (permit == UPSTREAM_REJECTED) {
+        return unavailable_response(retry_after);
+    }
+
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        upstream_release(upstream->breaker, permit);
+        return NULL;
+    }
+
+    if (upstream->socket_path) {
+        curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, upstream->socket_path);
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, upstream->url);
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, upstream->method);
+    if (upstream->headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, upstream->headers);
+
+    // Capture response body and headers
+    struct ResponseData resp;
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&resp.body);
+
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)&resp);
+
+    // PATCH and DELETE carry bodies too, CURLOPT_CUSTOMREQUEST keeps their method
+    if (upstream->body_size > 0) {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, upstream->body);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, upstream->body_size);
+    }
+    // A service that is down refuses the connection, one that hangs is cut off at its route's timeout
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, upstream->timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, upstream->timeout_ms < 1000 ? upstream->timeout_ms : 1000L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    CURLcode res;
+    long http_code;
+    for (int attempt = 0;; ++attempt) {
+        resp.body.memory = malloc(1);
+        resp.body.size = 0;
+        resp.headers = (HeaderBlock){ NULL, 0, 0 };
+
+        // Perform the request, a breaker probe is never hedged so it tests one call
+        int get = strcmp(upstream->method, "GET") == 0;
+        uint64_t hedge_after = get && upstream->hedge_url && permit == UPSTREAM_ALLOWED ? hedge_delay(upstream->route) : 0;
+        uint64_t upstream_start = metrics_now();
+        http_code = 500;
+        if (hedge_after > 0) {
+            res = perform_hedged(curl, upstream, &resp, hedge_after, &http_code);
+        } else {
+            res = curl_easy_perform(curl);
+            if (res == CURLE_OK) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        }
+        uint64_t elapsed = metrics_now() - upstream_start;
+        metrics_observe(metrics_series(METRIC_UPSTREAM_DURATION, upstream->service), elapsed);
+
+        int failed = res != CURLE_OK || http_code >= 500;
+        upstream_record(upstream->breaker, permit, failed, elapsed, upstream->slow_micros);
+        if (get && !failed) {
+            hedge_observe(upstream->route, elapsed);
+        }
+
+        if (!failed || attempt >= MAX_RETRIES || permit == UPSTREAM_PROBE || !idempotent(upstream->method) ||
+            !retryable(res, http_code) || !upstream_take_retry(upstream->breaker)) {
+            break;
+        }
+        free(resp.body.memory);
+        header_block_free(&resp.headers);
+        // Spread out the retries of requests that failed together
+        usleep(RETRY_BACKOFF_US / 2 + rand() % RETRY_BACKOFF_US);
+    }
+    curl_easy_cleanup(curl);
+
+    return shared_response_create(http_code, resp.body.memory, resp.body.size, resp.headers);
+}
+
+/**
+ * Key under which identical concurrent GETs share one upstream call, NULL
+ * for requests that must go upstream on their own. Covers everything the
+ * services answer differently on: the path and query, the verified user and
+ * role, the ETag they hold and whether they take gzip. A user's tabs and
+ * devices share calls whatever token each holds. Different users never do,
+ * as the services check access and filter per user. identity is NULL when
+ * the token did not verify, such a request goes up alone. Caller frees.
+ */
+static char *coalescing_key(struct MHD_Connection *connection, const char *method, const char *url, const char *query,
+                            const Identity *identity) {
+    if (strcmp(method, "GET") != 0) return NULL;
+    const char *authorization = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Authorization");
+    if (authorization && !identity) return NULL;
+    const char *if_none_match = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "If-None-Match");
+    char *key;
+    if (asprintf(&key, "%s%s\n%s\n%s\n%s\n%d", url, query, identity ? identity->user_id : "",
+                 identity ? identity->role : "", if_none_match ? if_none_match : "",
+                 compression_accepted(connection)) < 0) {
+        return NULL;
+    }
+    return key;
+}
+
+// 429 or 503 telling the client when to come back
+static enum MHD_Result send_rejection(struct MHD_Connection *connection, unsigned int status, unsigned int retry_after) {
+    const char *error_response = status == MHD_HTTP_TOO_MANY_REQUESTS
+        ? "{\"error\": \"Too Many Requests\"}"
+        : "{\"error\": \"Service Unavailable\"}";
+    struct MHD_Response *response = MHD_create_response_from_buffer(strlen(error_response), (void *)error_response, MHD_RESPMEM_PERSISTENT);
+    char seconds[16];
+    snprintf(seconds, sizeof(seconds), "%u", retry_after);
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    MHD_add_response_header(response, "Retry-After", seconds);
+    enum MHD_Result ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+enum MHD_Result parse_parameters(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
 
     char* query = (char*)cls;
     int i = strlen(query);
@@ -108,14 +407,9 @@ static enum MHD_Result handle_request(void *cls,
                                       size_t *upload_data_size,
                                       void **con_cls) {
 
+    // Preflights never reach the services
     if (strcmp(method, "OPTIONS") == 0) {
-        struct MHD_Response* response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
-        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-        MHD_add_response_header(response, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
-        MHD_add_response_header(response, "Access-Control-Allow-Headers", "Content-Type, Authorization");
-        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-        MHD_destroy_response(response);
-        return ret;
+        return cors_preflight(connection, url);
     }
 
     if (strcmp(url, "/demonstracija") == 0 && strcmp(method, "GET") == 0) {
@@ -126,13 +420,27 @@ static enum MHD_Result handle_request(void *cls,
         return ret;
     }
     
+    if (strcmp(url, "/metrics") == 0 && strcmp(method, "GET") == 0) {
+        char *metrics = metrics_render();
+        if (!metrics) return MHD_NO;
+        struct MHD_Response *response = MHD_create_response_from_buffer(strlen(metrics), (void *)metrics, MHD_RESPMEM_MUST_FREE);
+        MHD_add_response_header(response, "Content-Type", "text/plain; version=0.0.4");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+    
     if (*con_cls == NULL) {
         struct ConnectionInfo* conn_info = calloc(1, sizeof(struct ConnectionInfo));
+        if (!conn_info) return MHD_NO;
+        conn_info->route_series = metrics_route_series(method, NULL);  // Until the service answers
+        conn_info->start = metrics_now();
+        metrics_add(metrics_series(METRIC_HTTP_IN_FLIGHT, NULL), 1);
         *con_cls = (void*)conn_info;
         return MHD_YES;
     }
 
-    printf("processing data.\n");
+    LOG_DEBUG("processing data.");
 
     struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
     // If there's upload data, accumulate it
@@ -143,31 +451,29 @@ static enum MHD_Result handle_request(void *cls,
         conn_info->json_size += *upload_data_size;
         conn_info->json_data[conn_info->json_size] = '\0';  // Null-terminate
         *upload_data_size = 0;  // Signal that we've processed this data
-        printf("KRKAAAAAAN.\n");
         return MHD_YES;
     }
     
-    printf("data processed\n");
+    LOG_DEBUG("data processed");
+
+    // Checked once here, the services verify the token again
+    Identity identity;
+    int verified = identity_verify(connection, &identity) == 0;
+
+    unsigned int retry_after = admission_rate_check(connection, url, verified ? &identity : NULL);
+    if (retry_after > 0) {
+        return send_rejection(connection, MHD_HTTP_TOO_MANY_REQUESTS, retry_after);
+    }
     
     char query[1024] = {};
     query[0] = '?';
     MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_parameters, query);
 
-    CURL *curl = curl_easy_init();
-    printf("zlaja piskimic\n");
-    if (!curl) return MHD_NO;
-
     // Build target URL
     char target_url[1512];
-    int url_len = strlen(url);
-    int service_name_len = 0;
-    for (int i = 1; i < url_len; ++i) {
-        if (url[i] == '/') {
-            break;
-        }
-        ++service_name_len;
-    }
-    if (service_name_len == 0) {
+    char service_name[256];
+    const char *endpoint;
+    if (split_service_url(url, service_name, sizeof(service_name), &endpoint) == 0) {
         const char* not_found = "404 - Not Found";
         struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found), (void*)not_found, MHD_RESPMEM_PERSISTENT);
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
@@ -175,32 +481,16 @@ static enum MHD_Result handle_request(void *cls,
         MHD_destroy_response(response);
         return ret;
     }
-    char service_name[service_name_len + 1];
-    for (int i = 0; i < service_name_len; ++i) {
-        service_name[i] = url[i + 1];
-    }
-    service_name[service_name_len] = '\0';
-    printf("pls %s\n", service_name);
 
     struct ServiceAddressKeyValue **routing_table = (struct ServiceAddressKeyValue **)cls;
+    struct ServiceAddressKeyValue *route = NULL;
     for (int i = 0; i < SERVICE_COUNT; ++i) {
-        if (routing_table[i]->service) {
-	        printf("kakam bukvalno: %sdzaja\n", routing_table[i]->service);
-        }
-        if (routing_table[i]->address) {
-            printf("kakam bukvalno: %ddzaja\n", routing_table[i]->address);
-        }
-	}
-    int port = -1;
-    char *service_first_char;
-    for (int i = 0; i < SERVICE_COUNT; ++i) {
-        if (strcmp(routing_table[i]->service, service_name) == 0) {
-            port = routing_table[i]->address;
-            service_first_char = &routing_table[i]->service[0];
+        if (routing_table[i] && strcmp(routing_table[i]->service, service_name) == 0) {
+            route = routing_table[i];
             break;
         }
     }
-    if (port == -1) {
+    if (!route) {
         const char* not_found = "404 - Not Found";
         struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found), (void*)not_found, MHD_RESPMEM_PERSISTENT);
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
@@ -208,89 +498,342 @@ static enum MHD_Result handle_request(void *cls,
         MHD_destroy_response(response);
         return ret;
     }
-    printf("target service port pls: %d\n", port);
-    char endpoint[url_len - service_name_len + 1];
-    for (int i = 0; i < url_len - service_name_len; ++i) {
-        endpoint[i] = url[1 + service_name_len + i];
+
+    // Only paths a service has answered get a series, junk paths stay in "unmatched"
+    char route_label[METRICS_LABEL_SIZE];
+    metrics_route_label(route_label, sizeof(route_label), method, url);
+    int route_series = metrics_find_series(METRIC_HTTP_DURATION, route_label);
+
+    if (admission_enter() != 0) {
+        return send_rejection(connection, MHD_HTTP_SERVICE_UNAVAILABLE, 1);
     }
-    endpoint[url_len - service_name_len] = '\0';
-    printf("endpointovic %s\n", endpoint);
 
-    snprintf(target_url, sizeof(target_url), "%s-service:%d%s%s", service_first_char, port, endpoint, query);
-    printf("query tew zene: %s\n", query);
-    printf("nigger url: %s\n", target_url);
-    printf("zlaja kakimic\n");
-    curl_easy_setopt(curl, CURLOPT_URL, target_url);
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
-    printf("le kokan\n");
+    // Instances take turns, a hedge goes to the one after. A lone instance is never hedged,
+    // the copy would only add load to the instance that is already slow
+    unsigned int primary = 0;
+    if (route->instance_count > 1) {
+        primary = atomic_fetch_add(&route->next_instance, 1) % route->instance_count;
+    }
+    const struct ServiceInstance *instance = &route->instances[primary];
+    const struct ServiceInstance *alternate = &route->instances[(primary + 1) % route->instance_count];
+    char hedge_url[sizeof(target_url)];
+    format_target_url(target_url, sizeof(target_url), route->service, instance, endpoint, query);
+    if (route->instance_count > 1) {
+        format_target_url(hedge_url, sizeof(hedge_url), route->service, alternate, endpoint, query);
+    }
 
-    // Forward incoming headers
-    struct curl_slist *headers = NULL;
-    MHD_get_connection_values(connection, MHD_HEADER_KIND, header_iterator, &headers);
-    if (headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    printf("le unjan\n");
+    if (event_stream_requested(connection, method)) {
+        // Open for as long as the client watches, so no in-flight slot and no latency sample
+        admission_exit();
+        conn_info->route_series = -1;
+        return event_stream_forward(connection, target_url, instance->socket_path);
+    }
 
-    // Capture response body and headers
-    struct ResponseData resp;
-    resp.body.memory = malloc(1);
-    resp.body.size = 0;
-    resp.headers = NULL;
+    struct UpstreamRequest upstream = {
+        .url = target_url,
+        .socket_path = instance->socket_path,
+        .hedge_url = route->instance_count > 1 ? hedge_url : NULL,
+        .hedge_socket_path = alternate->socket_path,
+        .route = route_series,
+        .method = method,
+        .service = service_name,
+        .headers = NULL,
+        .body = conn_info->json_data,
+        .body_size = conn_info->json_size,
+        .breaker = route->upstream,
+        .timeout_ms = upstream_timeout_ms(method, url),
+        .slow_micros = upstream_slow_micros(url),
+    };
+
+    // Forward incoming headers, the list lives in the arena so it is never freed
+    HeaderArena header_arena;
+    header_arena_init(&header_arena);
+    MHD_get_connection_values(connection, MHD_HEADER_KIND, forward_header, &header_arena);
+    upstream.headers = header_arena.head;
+
+    SharedResponse *shared;
+    char *flight_key = coalescing_key(connection, method, url, query, verified ? &identity : NULL);
+    if (flight_key) {
+        shared = single_flight_do(flight_key, fetch_upstream, &upstream);
+        free(flight_key);
+    } else {
+        shared = fetch_upstream(&upstream);
+    }
+    if (!shared) {
+        admission_exit();
+        return MHD_NO;
+    }
 
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&resp.body);
+    // Compress here unless the service already did, e.g. from its response cache
+    int negotiated = compressible(&shared->headers);
+    struct MHD_Response *response = NULL;
+    if (negotiated && compression_accepted(connection)) {
+        // Deflated block by block as MHD sends it, the shared body is held until then
+        atomic_fetch_add(&shared->references, 1);
+        response = compression_gzip_response(shared->body, shared->size, shared_response_free_callback, shared);
+        if (!response) {
+            shared_response_release(shared);
+        }
+    }
+    int compressed = response != NULL;
 
-    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)&resp);
+    // Otherwise the forwarded body as it is, a shared body is released with the response
+    if (!compressed) {
+        atomic_fetch_add(&shared->references, 1);
+        response = MHD_create_response_from_buffer_with_free_callback_cls(shared->size, shared->body,
+                                                                         shared_response_free_callback, shared);
+    }
 
-    if (strcmp(method, "POST") == 0) {
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, conn_info->json_data);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, conn_info->json_size);
-        printf("AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA%s\n", conn_info->json_data);
-    }
-    printf("le preform request pls\n");
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
-
-    // Perform the request
-    CURLcode res = curl_easy_perform(curl);
-    printf("beszarom a gatyaim\n");
-
-    long http_code = 500;
-    if (res == CURLE_OK) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-
-    // Build MHD response with the forwarded body
-    struct MHD_Response *response = MHD_create_response_from_buffer(resp.body.size,
-                                                                    resp.body.memory,
-                                                                    MHD_RESPMEM_MUST_FREE);
-
-    // Forward headers back to client
-    struct curl_slist *h = resp.headers;
-    while (h) {
-        char *colon = strchr(h->data, ':');
-        if (colon) {
-            *colon = '\0';
-            const char *header_name = h->data;
-            const char *header_value = colon + 2; // skip ":"
+    // Forward headers back to client, straight from the shared block
+    const char *header_value;
+    for (const char *header_name = header_block_next(&shared->headers, NULL, &header_value); header_name;
+         header_name = header_block_next(&shared->headers, header_name, &header_value)) {
+        if (compressed && strcasecmp(header_name, "ETag") == 0 && strncmp(header_value, "W/", 2) != 0) {
+            // Another representation of the same content, so no longer byte-for-byte what the ETag names
+            char weak_etag[256];
+            snprintf(weak_etag, sizeof(weak_etag), "W/%s", header_value);
+            MHD_add_response_header(response, header_name, weak_etag);
+        } else {
             MHD_add_response_header(response, header_name, header_value);
         }
-        h = h->next;
+    }
+    if (compressed) {
+        MHD_add_response_header(response, "Content-Encoding", "gzip");
+    }
+    if (negotiated && !header_block_get(&shared->headers, "Vary")) {
+        MHD_add_response_header(response, "Vary", "Accept-Encoding");
     }
 
-    // Cleanup
-    curl_slist_free_all(headers);
-    curl_slist_free_all(resp.headers);
-    curl_easy_cleanup(curl);
+    long http_code = shared->status;
+    if (http_code != MHD_HTTP_NOT_FOUND) {
+        conn_info->route_series = route_series >= 0 ? route_series : metrics_series(METRIC_HTTP_DURATION, route_label);
+    }
+    shared_response_release(shared);
+    admission_exit();
 
     enum MHD_Result ret = MHD_queue_response(connection, http_code, response);
     MHD_destroy_response(response);
     return ret;
 }
 
+// Records the request's latency and frees its ConnectionInfo
+static void request_completed(void *cls, struct MHD_Connection *connection,
+                              void **con_cls, enum MHD_RequestTerminationCode toe) {
+    struct ConnectionInfo *conn_info = (struct ConnectionInfo *)(*con_cls);
+    if (!conn_info) return;
+    metrics_observe(conn_info->route_series, metrics_now() - conn_info->start);
+    metrics_add(metrics_series(METRIC_HTTP_IN_FLIGHT, NULL), -1);
+    free(conn_info->json_data);
+    free(conn_info);
+    *con_cls = NULL;
+}
+
+// Listening socket for one process, shared with the other workers through SO_REUSEPORT
+static int open_listen_socket(int port, int reuse_port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * GATEWAY_THREADS, the MHD threads in each process (default 8). A thread
+ * is held for the whole upstream call, so this also bounds how many
+ * requests one process has in flight and how many can share one.
+ */
+static unsigned int thread_count(void) {
+    const char *env = getenv("GATEWAY_THREADS");
+    int threads = env ? atoi(env) : DEFAULT_THREADS;
+    return threads < 1 ? 1 : threads > MAX_THREADS ? MAX_THREADS : threads;
+}
+
+// Runs the proxy on this process until it is killed, returns only when the daemon cannot start
+static int serve(int port, int reuse_port, struct ServiceAddressKeyValue **routing_table, char *cert, char *key) {
+    int listen_fd = open_listen_socket(port, reuse_port);
+    if (listen_fd < 0) {
+        LOG_ERROR("Cannot listen on port %d", port);
+        return 3;
+    }
+
+    unsigned int threads = thread_count();
+    struct MHD_Daemon *daemon = MHD_start_daemon(
+        MHD_USE_SELECT_INTERNALLY | MHD_USE_TLS | MHD_ALLOW_SUSPEND_RESUME,
+        port,
+        NULL, NULL,
+        &handle_request, routing_table,
+        MHD_OPTION_LISTEN_SOCKET, listen_fd,
+        MHD_OPTION_HTTPS_MEM_CERT, cert,
+        MHD_OPTION_HTTPS_MEM_KEY, key,
+        MHD_OPTION_HTTPS_PRIORITIES, tls_priorities(),
+        MHD_OPTION_NOTIFY_CONNECTION, tls_notify_connection, NULL,
+        MHD_OPTION_CONNECTION_TIMEOUT, (unsigned int)30,
+        MHD_OPTION_THREAD_POOL_SIZE, threads,
+        MHD_OPTION_NOTIFY_COMPLETED, request_completed, NULL,
+        MHD_OPTION_END);
+
+    if (!daemon) {
+        perror("MHD_start_daemon");
+        close(listen_fd);
+        return 3;
+    }
+
+    LOG_INFO("Transparent API Gateway listening on port %d with %u threads...", port, threads);
+    pause();
+
+    MHD_stop_daemon(daemon);
+    close(listen_fd);
+    return 0;
+}
+
+// GATEWAY_WORKERS processes, "auto" or 0 for one per usable core, 1 when unset
+static int worker_count(void) {
+    const char *env = getenv("GATEWAY_WORKERS");
+    if (!env) {
+        return 1;
+    }
+    int workers = atoi(env);
+    if (strcmp(env, "auto") == 0 || workers == 0) {
+        cpu_set_t cpus;
+        workers = sched_getaffinity(0, sizeof(cpus), &cpus) == 0 ? CPU_COUNT(&cpus) : 1;
+    }
+    return workers < 1 ? 1 : workers > MAX_WORKERS ? MAX_WORKERS : workers;
+}
+
+// Pins the calling process to the index-th core it may run on, wrapping around
+static void pin_to_core(int index) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return;
+    }
+    int target = index % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+            cpu_set_t pinned;
+            CPU_ZERO(&pinned);
+            CPU_SET(cpu, &pinned);
+            if (sched_setaffinity(0, sizeof(pinned), &pinned) != 0) {
+                LOG_WARN("Cannot pin worker %d to core %d", index, cpu);
+            }
+            return;
+        }
+    }
+}
+
+static volatile sig_atomic_t stopping = 0;
+
+static void handle_stop(int signal_number) {
+    stopping = 1;
+}
+
+static pid_t spawn_worker(int index, int port, struct ServiceAddressKeyValue **routing_table, char *cert, char *key) {
+    pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+
+    log_after_fork();
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    // Workers go down with the master instead of holding the port
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() == 1) {
+        exit(0);
+    }
+    pin_to_core(index);
+    exit(serve(port, 1, routing_table, cert, key));
+}
+
+/**
+ * Pre-fork mode: each worker binds the port itself with SO_REUSEPORT, so the
+ * kernel spreads new connections over their accept queues. Workers that
+ * exit are started again, a worker that dies right after starting only
+ * after a pause. SIGTERM or SIGINT stops every worker.
+ */
+static int supervise(int workers, int port, struct ServiceAddressKeyValue **routing_table, char *cert, char *key) {
+    pid_t pids[workers];
+    time_t started[workers];
+
+    struct sigaction stop;
+    memset(&stop, 0, sizeof(stop));
+    stop.sa_handler = handle_stop;
+    sigaction(SIGTERM, &stop, NULL);
+    sigaction(SIGINT, &stop, NULL);
+
+    LOG_INFO("Starting %d gateway workers", workers);
+    for (int i = 0; i < workers; ++i) {
+        pids[i] = spawn_worker(i, port, routing_table, cert, key);
+        started[i] = time(NULL);
+        if (pids[i] < 0) {
+            LOG_ERROR("Cannot start worker %d", i);
+        }
+    }
+
+    while (!stopping) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (int i = 0; i < workers; ++i) {
+            if (pids[i] != pid) {
+                continue;
+            }
+            if (WIFSIGNALED(status)) {
+                LOG_WARN("Worker %d (pid %d) killed by signal %d", i, (int)pid, WTERMSIG(status));
+            } else {
+                LOG_WARN("Worker %d (pid %d) exited with status %d", i, (int)pid, WEXITSTATUS(status));
+            }
+            if (time(NULL) - started[i] < RESTART_BACKOFF) {
+                sleep(RESTART_BACKOFF);
+            }
+            if (stopping) {
+                pids[i] = -1;
+                break;
+            }
+            pids[i] = spawn_worker(i, port, routing_table, cert, key);
+            started[i] = time(NULL);
+            break;
+        }
+    }
+
+    LOG_INFO("Stopping gateway workers");
+    for (int i = 0; i < workers; ++i) {
+        if (pids[i] > 0) {
+            kill(pids[i], SIGTERM);
+        }
+    }
+    while (waitpid(-1, NULL, 0) > 0 || errno == EINTR) {
+    }
+    return 0;
+}
+
 int main() {
+    log_init("api-gateway");
 
     const char *var_name = "SERVICES";
     char *services_env = getenv(var_name);
     if (!services_env) {
-        fprintf(stderr, "Cannot find services\n");
+        LOG_ERROR("Cannot find services");
         return 1;
     }
 	char *services = malloc(strlen(services_env) + 1);
@@ -298,7 +841,7 @@ int main() {
 	    return -1;
 	}
 	strcpy(services, services_env);
-	printf("Services: %s\n", services);
+	LOG_INFO("Services: %s", services);
 	
 	int service_count = 1;
 	for (int i = 0; i < strlen(services); ++i) {
@@ -315,7 +858,6 @@ int main() {
 	int list_char_count = 0;
 	for (int i = 0; i < service_count; ++i) {
 	    while (fill_count < strlen(services)) {
-            printf("%c\n", services[fill_count]);
             if (services[fill_count] == ':') {
                 ++fill_count;
                 list_char_count = 0;
@@ -326,9 +868,6 @@ int main() {
             ++list_char_count;
 	    }
 	}
-	for (int i = 0; i < service_count; ++i) {
-	    printf("kesten pire: %szlaja\n", service_list[i]);
-	}
     free(services);
 
     struct ServiceAddressKeyValue *routing_table[service_count];
@@ -336,45 +875,82 @@ int main() {
         int service_name_len = strlen(service_list[i]);
         char suiseiseki[service_name_len + 6];
         snprintf(suiseiseki, service_name_len + 6, "%s%s", service_list[i], "_PORT");
-        printf("sui: %s\n", suiseiseki);
 
+        routing_table[i] = NULL;
         char *service = getenv(suiseiseki);
         if (!service) {
             continue;
         }
-        printf("%s\n", service);
-        int number;
-        int result = sscanf(service, "%d", &number);
-        if (result != 1) {
+        LOG_DEBUG("%s=%s", suiseiseki, service);
+        // A TCP port or unix:/path/to/service.sock, several instances separated by commas
+        char *instance_list = strdup(service);
+        if (!instance_list) {
+            return -1;
+        }
+        struct ServiceInstance instances[MAX_INSTANCES];
+        int instance_count = 0;
+        char *saveptr = NULL;
+        for (char *part = strtok_r(instance_list, ",", &saveptr); part && instance_count < MAX_INSTANCES;
+             part = strtok_r(NULL, ",", &saveptr)) {
+            instances[instance_count].port = 0;
+            instances[instance_count].socket_path = NULL;
+            if (strncmp(part, "unix:", 5) == 0 && part[5] != '\0') {
+                instances[instance_count].socket_path = part + 5;
+            } else if (sscanf(part, "%d", &instances[instance_count].port) != 1) {
+                LOG_WARN("Ignoring %s instance \"%s\"", suiseiseki, part);
+                continue;
+            }
+            ++instance_count;
+        }
+        if (instance_count == 0) {
+            free(instance_list);
             continue;
         }
 
-	    routing_table[i] = malloc(sizeof(struct ServiceAddressKeyValue));
+	    routing_table[i] = calloc(1, sizeof(struct ServiceAddressKeyValue));
         for (int j = 0; service_list[i][j] != '\0'; j++) {
             if (service_list[i][j] >= 'A' && service_list[i][j] <= 'Z') {
                 service_list[i][j] = service_list[i][j] + ('a' - 'A');
             }
         }
         routing_table[i]->service = service_list[i];
-        printf("nigerski krek:%s\n", service_list[i]);
-        routing_table[i]->address = number;
-        printf("nigerski krek:%d\n", number);
-	}
-	for (int i = 0; i < service_count; ++i) {
-        if (routing_table[i]->service) {
-	        printf("krompir pire: %szlaja\n", routing_table[i]->service);
-        }
-        if (routing_table[i]->address) {
-            printf("krompir pire: %dzlaja\n", routing_table[i]->address);
+        routing_table[i]->instance_list = instance_list;
+        memcpy(routing_table[i]->instances, instances, sizeof(instances));
+        routing_table[i]->instance_count = instance_count;
+        routing_table[i]->upstream = upstream_create(service_list[i]);
+        if (!routing_table[i]->upstream) {
+            LOG_ERROR("Out of memory");
+            return -1;
         }
 	}
     SERVICE_COUNT = service_count;
 
-    char *cert = load_file("cert.pem");
-    char *key  = load_file("key.pem");
+    // RSA or ECDSA, GnuTLS takes either key type
+    const char *cert_path = getenv("TLS_CERT_FILE") ? getenv("TLS_CERT_FILE") : "cert.pem";
+    const char *key_path = getenv("TLS_KEY_FILE") ? getenv("TLS_KEY_FILE") : "key.pem";
+    char *cert = load_file(cert_path);
+    char *key  = load_file(key_path);
 
     if (!cert || !key) {
-        fprintf(stderr, "Failed to load cert.pem or key.pem\n");
+        LOG_ERROR("Failed to load %s or %s", cert_path, key_path);
+        return 2;
+    }
+
+    if (tls_init() != 0) {
+        LOG_ERROR("Invalid TLS configuration");
+        return 2;
+    }
+    compression_init();
+    if (cors_init() != 0) {
+        LOG_ERROR("Cannot create the CORS responses");
+        return 2;
+    }
+    hedge_init();
+    upstream_init();
+    single_flight_init();
+    identity_init();
+    if (admission_init(thread_count()) != 0) {
+        LOG_ERROR("Invalid rate limits");
         return 2;
     }
 
@@ -383,40 +959,21 @@ int main() {
     char* port_env = getenv("PORT");
     int gateway_port;
     if (!port_env) {
-        fprintf(stderr, "No port given\n");
+        LOG_ERROR("No port given");
         gateway_port = PORT;
     } else {
         int result = sscanf(port_env, "%d", &gateway_port);
     }
 
-    struct MHD_Daemon *daemon = MHD_start_daemon(
-        MHD_USE_SELECT_INTERNALLY | MHD_USE_TLS,
-        gateway_port,
-        NULL, NULL,
-        &handle_request, routing_table,
-        MHD_OPTION_HTTPS_MEM_CERT, cert,
-        MHD_OPTION_HTTPS_MEM_KEY, key,
-        MHD_OPTION_CONNECTION_TIMEOUT, (unsigned int)30,
-        MHD_OPTION_END);
-    
-    if (!daemon) {
-        perror("MHD_start_daemon");
-        curl_global_cleanup();
-        free(cert);
-        free(key);
-        for (int i = 0; i < SERVICE_COUNT; ++i) {
-            free(service_list[i]);
-        }
-        for (int i = 0; i < SERVICE_COUNT; ++i) {
-            free(routing_table[i]);
-        }
-        return 3;
+    int workers = worker_count();
+    int status;
+    if (workers <= 1) {
+        status = serve(gateway_port, 0, routing_table, cert, key);
+    } else {
+        // The ticket key is already generated, so every worker accepts the others' tickets
+        status = supervise(workers, gateway_port, routing_table, cert, key);
     }
 
-    printf("Transparent API Gateway listening on port %d...\n", gateway_port);
-    pause();
-
-    MHD_stop_daemon(daemon);
     curl_global_cleanup();
     free(cert);
     free(key);
@@ -424,7 +981,12 @@ int main() {
         free(service_list[i]);
     }
     for (int i = 0; i < SERVICE_COUNT; ++i) {
+        if (routing_table[i]) {
+            upstream_destroy(routing_table[i]->upstream);
+            free(routing_table[i]->instance_list);
+        }
         free(routing_table[i]);
     }
-    return 0;
+    log_shutdown();
+    return status;
 }
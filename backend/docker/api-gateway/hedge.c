@@ -0,0 +1,116 @@
+#include "hedge.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "logger.h"
+#include "metrics.h"
+
+#define LATENCY_BUCKETS 48          // 2^e and 1.5 * 2^e microseconds, up to about 16 s
+#define RECOMPUTE_EVERY 32
+#define DECAY_EVERY 1024            // Counts are halved so the estimate follows the last few thousand calls
+#define MIN_SAMPLES 50
+#define BUDGET_CAP 10000            // In thousandths of a hedge
+
+/**
+ * Recent latencies of one route. Updates are relaxed and a decay can race
+ * with an increment, which only costs the estimate a sample.
+ */
+typedef struct {
+    _Atomic uint32_t counts[LATENCY_BUCKETS];
+    _Atomic uint32_t observed;
+    _Atomic uint64_t p95;
+} RouteLatency;
+
+static RouteLatency routes[METRICS_MAX_SERIES];
+static int hedge_percent = 0;
+static uint64_t min_delay = 5000;
+static _Atomic int64_t budget = BUDGET_CAP;
+
+void hedge_init(void) {
+    const char* env = getenv("HEDGE_PERCENT");
+    hedge_percent = env ? atoi(env) : 0;
+    if (hedge_percent < 0) {
+        hedge_percent = 0;
+    }
+    env = getenv("HEDGE_MIN_DELAY_MS");
+    if (env && atoi(env) > 0) {
+        min_delay = (uint64_t)atoi(env) * 1000;
+    }
+    if (hedge_percent > 0) {
+        LOG_INFO("Hedging GETs after their p95, up to %d%% extra calls", hedge_percent);
+    }
+}
+
+static int bucket_of(uint64_t micros) {
+    if (micros < 2) {
+        return 0;
+    }
+    int exponent = 63 - __builtin_clzll(micros);
+    int index = exponent * 2 + (int)((micros >> (exponent - 1)) & 1);
+    return index < LATENCY_BUCKETS ? index : LATENCY_BUCKETS - 1;
+}
+
+static uint64_t bucket_upper(int index) {
+    uint64_t base = 1ULL << (index / 2);
+    return index % 2 ? base * 2 - 1 : base + base / 2 - 1;
+}
+
+static void recompute(RouteLatency* latency, int decay) {
+    uint32_t counts[LATENCY_BUCKETS];
+    uint64_t total = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        counts[i] = atomic_load_explicit(&latency->counts[i], memory_order_relaxed);
+        total += counts[i];
+        if (decay) {
+            atomic_store_explicit(&latency->counts[i], counts[i] / 2, memory_order_relaxed);
+        }
+    }
+    if (total < MIN_SAMPLES) {
+        return;
+    }
+    uint64_t target = total - total / 20;
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= target) {
+            atomic_store_explicit(&latency->p95, bucket_upper(i), memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+void hedge_observe(int route, uint64_t micros) {
+    if (hedge_percent == 0 || route < 0 || route >= METRICS_MAX_SERIES) {
+        return;
+    }
+    RouteLatency* latency = &routes[route];
+    atomic_fetch_add_explicit(&latency->counts[bucket_of(micros)], 1, memory_order_relaxed);
+    uint32_t observed = atomic_fetch_add_explicit(&latency->observed, 1, memory_order_relaxed) + 1;
+    if (observed % RECOMPUTE_EVERY == 0) {
+        recompute(latency, observed % DECAY_EVERY == 0);
+    }
+}
+
+uint64_t hedge_delay(int route) {
+    if (hedge_percent == 0 || route < 0 || route >= METRICS_MAX_SERIES) {
+        return 0;
+    }
+    // Every GET earns a fraction of a hedge
+    if (atomic_fetch_add(&budget, hedge_percent * 10) > BUDGET_CAP) {
+        atomic_store(&budget, BUDGET_CAP);
+    }
+    uint64_t p95 = atomic_load_explicit(&routes[route].p95, memory_order_relaxed);
+    if (p95 == 0) {
+        return 0;
+    }
+    return p95 > min_delay ? p95 : min_delay;
+}
+
+int hedge_take(void) {
+    int64_t available = atomic_load(&budget);
+    while (available >= 1000) {
+        if (atomic_compare_exchange_weak(&budget, &available, available - 1000)) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef HEDGE_H
+#define HEDGE_H
+
+#include <stdint.h>
+
+/**
+ * Reads HEDGE_PERCENT, the extra upstream calls hedging may add as a share
+ * of GETs (default 0, hedging off), and HEDGE_MIN_DELAY_MS, the earliest a
+ * hedge is sent however fast the route usually is (default 5).
+ */
+void hedge_init(void);
+
+// Records how long an upstream GET took, route being its series, -1 until the path has one
+void hedge_observe(int route, uint64_t micros);
+
+/**
+ * Microseconds after which a GET on route should be hedged, the route's
+ * recent p95. 0 when hedging is off or the route has too few samples yet.
+ */
+uint64_t hedge_delay(int route);
+
+// Takes a hedge from the budget, 0 when it is spent
+int hedge_take(void);
+
+#endif
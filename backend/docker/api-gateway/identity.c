@@ -0,0 +1,59 @@
+#include "identity.h"
+#include <stdlib.h>
+#include <string.h>
+#include "decode.h"
+#include "logger.h"
+
+static const char* hmac_key = NULL;
+
+void identity_init(void) {
+    hmac_key = getenv("HMAC_KEY");
+    if (hmac_key == NULL || hmac_key[0] == '\0') {
+        hmac_key = NULL;
+        LOG_WARN("No HMAC_KEY, requests are limited and coalesced without their user");
+    }
+}
+
+int identity_verify(struct MHD_Connection* connection, Identity* identity) {
+    const char* authorization = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Authorization");
+    if (hmac_key == NULL || authorization == NULL || strncmp(authorization, "Bearer ", 7) != 0) {
+        return -1;
+    }
+    const char* token = authorization + 7;
+
+    struct l8w8jwt_decoding_params params;
+    l8w8jwt_decoding_params_init(&params);
+    params.alg = L8W8JWT_ALG_HS512;
+    params.jwt = (char*)token;
+    params.jwt_length = strlen(token);
+    params.verification_key = (unsigned char*)hmac_key;
+    params.verification_key_length = strlen(hmac_key);
+    params.validate_iat = 1;
+    params.validate_exp = 1;
+    params.iat_tolerance_seconds = 10;
+
+    enum l8w8jwt_validation_result validation_result;
+    struct l8w8jwt_claim* claims = NULL;
+    size_t claims_length = 0;
+    int result = l8w8jwt_decode(&params, &validation_result, &claims, &claims_length);
+
+    identity->user_id[0] = '\0';
+    identity->role[0] = '\0';
+    if (result == L8W8JWT_SUCCESS && validation_result == L8W8JWT_VALID) {
+        // A claim that does not fit is not cut short, two users must never end up with one key
+        for (size_t i = 0; i < claims_length; i++) {
+            if (strcmp(claims[i].key, "sub") == 0 && claims[i].value_length < sizeof(identity->user_id)) {
+                memcpy(identity->user_id, claims[i].value, claims[i].value_length);
+                identity->user_id[claims[i].value_length] = '\0';
+            }
+            else if (strcmp(claims[i].key, "aud") == 0 && claims[i].value_length < sizeof(identity->role)) {
+                memcpy(identity->role, claims[i].value, claims[i].value_length);
+                identity->role[claims[i].value_length] = '\0';
+            }
+        }
+    }
+    if (claims) {
+        l8w8jwt_free_claims(claims, claims_length);
+    }
+    return identity->user_id[0] && identity->role[0] ? 0 : -1;
+}
@@ -0,0 +1,25 @@
+#ifndef IDENTITY_H
+#define IDENTITY_H
+
+#include <microhttpd.h>
+
+// Who a request's bearer token was issued to, as the services read it
+typedef struct {
+    char user_id[50];
+    char role[20];
+} Identity;
+
+/**
+ * Reads HMAC_KEY, the key the user service signs tokens with. Without it
+ * no token verifies at the gateway and the services still check each one.
+ */
+void identity_init(void);
+
+/**
+ * Verifies the request's bearer token the way the services do. 0 with the
+ * token's user and role filled in, -1 when there is no token, it does not
+ * verify or the gateway has no key.
+ */
+int identity_verify(struct MHD_Connection* connection, Identity* identity);
+
+#endif
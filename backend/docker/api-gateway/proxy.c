@@ -0,0 +1,158 @@
+#include "proxy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "logger.h"
+
+#define HEADER_BLOCK_INITIAL 1024
+
+// RFC 9110 section 7.6.1, plus the framing headers each hop computes itself
+static const char* not_forwarded[] = {
+    "Connection",
+    "Keep-Alive",
+    "Proxy-Connection",
+    "Proxy-Authenticate",
+    "Proxy-Authorization",
+    "TE",
+    "Trailer",
+    "Transfer-Encoding",
+    "Upgrade",
+    "Host",
+    "Content-Length",
+};
+
+size_t split_service_url(const char* url, char* service, size_t service_size, const char** endpoint) {
+    if (url[0] != '/') {
+        return 0;
+    }
+    const char* name = url + 1;
+    size_t length = strcspn(name, "/");
+    if (length == 0 || length >= service_size) {
+        return 0;
+    }
+    memcpy(service, name, length);
+    service[length] = '\0';
+    *endpoint = name + length;
+    return length;
+}
+
+int forwardable_header(const char* name, size_t length) {
+    for (size_t i = 0; i < sizeof(not_forwarded) / sizeof(not_forwarded[0]); i++) {
+        if (strlen(not_forwarded[i]) == length && strncasecmp(name, not_forwarded[i], length) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void header_arena_init(HeaderArena* arena) {
+    arena->used = 0;
+    arena->node_count = 0;
+    arena->head = NULL;
+    arena->tail = NULL;
+}
+
+enum MHD_Result forward_header(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
+    HeaderArena* arena = (HeaderArena*)cls;
+    size_t key_length = strlen(key);
+    if (!forwardable_header(key, key_length)) {
+        return MHD_YES;
+    }
+
+    size_t value_length = strlen(value);
+    size_t needed = key_length + 2 + value_length + 1;
+    if (arena->node_count == HEADER_ARENA_NODES || arena->used + needed > HEADER_ARENA_SIZE) {
+        LOG_WARN("Header arena full, not forwarding %s", key);
+        return MHD_YES;
+    }
+
+    char* line = arena->text + arena->used;
+    memcpy(line, key, key_length);
+    memcpy(line + key_length, ": ", 2);
+    memcpy(line + key_length + 2, value, value_length + 1);
+    arena->used += needed;
+
+    // Appended, repeated headers keep the order the client sent them in
+    struct curl_slist* node = &arena->nodes[arena->node_count++];
+    node->data = line;
+    node->next = NULL;
+    if (arena->tail) {
+        arena->tail->next = node;
+    }
+    else {
+        arena->head = node;
+    }
+    arena->tail = node;
+    return MHD_YES;
+}
+
+int header_block_add(HeaderBlock* block, const char* name, size_t name_length, const char* value, size_t value_length) {
+    size_t needed = name_length + value_length + 2;
+    if (block->size + needed > block->capacity) {
+        size_t capacity = block->capacity ? block->capacity * 2 : HEADER_BLOCK_INITIAL;
+        while (capacity < block->size + needed) {
+            capacity *= 2;
+        }
+        char* data = realloc(block->data, capacity);
+        if (data == NULL) {
+            return -1;
+        }
+        block->data = data;
+        block->capacity = capacity;
+    }
+    char* p = block->data + block->size;
+    memcpy(p, name, name_length);
+    p[name_length] = '\0';
+    memcpy(p + name_length + 1, value, value_length);
+    p[name_length + 1 + value_length] = '\0';
+    block->size += needed;
+    return 0;
+}
+
+int header_block_add_line(HeaderBlock* block, const char* line, size_t length) {
+    const char* colon = memchr(line, ':', length);
+    if (colon == NULL || !forwardable_header(line, colon - line)) {
+        return 0;
+    }
+    const char* value = colon + 1;
+    const char* end = line + length;
+    while (value < end && (*value == ' ' || *value == '\t')) {
+        value++;
+    }
+    while (end > value && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ' || end[-1] == '\t')) {
+        end--;
+    }
+    return header_block_add(block, line, colon - line, value, end - value);
+}
+
+const char* header_block_next(const HeaderBlock* block, const char* name, const char** value) {
+    const char* next = block->data;
+    if (name) {
+        const char* previous_value = name + strlen(name) + 1;
+        next = previous_value + strlen(previous_value) + 1;
+    }
+    if (next == NULL || next >= block->data + block->size) {
+        return NULL;
+    }
+    *value = next + strlen(next) + 1;
+    return next;
+}
+
+const char* header_block_get(const HeaderBlock* block, const char* name) {
+    const char* value;
+    for (const char* header = header_block_next(block, NULL, &value); header;
+         header = header_block_next(block, header, &value)) {
+        if (strcasecmp(header, name) == 0) {
+            return value;
+        }
+    }
+    return NULL;
+}
+
+void header_block_free(HeaderBlock* block) {
+    free(block->data);
+    block->data = NULL;
+    block->size = 0;
+    block->capacity = 0;
+}
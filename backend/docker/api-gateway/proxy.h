@@ -0,0 +1,74 @@
+#ifndef PROXY_H
+#define PROXY_H
+
+#include <microhttpd.h>
+#include <stddef.h>
+#include <curl/curl.h>
+
+#define HEADER_ARENA_SIZE 8192
+#define HEADER_ARENA_NODES 64
+
+/**
+ * Fixed storage for the headers one request forwards. The curl_slist nodes
+ * handed to CURLOPT_HTTPHEADER live in it as well, so building the list
+ * allocates nothing. It goes away with the arena, never curl_slist_free_all it.
+ */
+typedef struct {
+    char text[HEADER_ARENA_SIZE];
+    size_t used;
+    struct curl_slist nodes[HEADER_ARENA_NODES];
+    size_t node_count;
+    struct curl_slist* head;
+    struct curl_slist* tail;
+} HeaderArena;
+
+/**
+ * Response headers as "name\0value\0" pairs in one buffer, split once as
+ * curl delivers them so nothing has to parse them again.
+ */
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} HeaderBlock;
+
+/**
+ * Splits "/service/rest/of/path" into the service name and the endpoint
+ * forwarded to it. The endpoint points into url. Returns the length of the
+ * service name, 0 when the URL has none or it does not fit in service.
+ */
+size_t split_service_url(const char* url, char* service, size_t service_size, const char** endpoint);
+
+/**
+ * 0 for hop-by-hop headers, which only describe one connection, and for
+ * Host and Content-Length, which curl and MHD set for the hop they make.
+ */
+int forwardable_header(const char* name, size_t length);
+
+void header_arena_init(HeaderArena* arena);
+
+// MHD header iterator that adds "key: value" to the HeaderArena in cls, skipping what is not forwardable
+enum MHD_Result forward_header(void* cls, enum MHD_ValueKind kind, const char* key, const char* value);
+
+// Returns -1 when the block cannot grow
+int header_block_add(HeaderBlock* block, const char* name, size_t name_length, const char* value, size_t value_length);
+
+/**
+ * Adds a "Name: value" line the way curl's header callback delivers it, line
+ * ending included. Lines without a colon, e.g. the status line, and headers
+ * that are not forwardable are skipped. -1 when the block cannot grow.
+ */
+int header_block_add_line(HeaderBlock* block, const char* line, size_t length);
+
+// Value of the first header called name, case-insensitively, NULL when there is none
+const char* header_block_get(const HeaderBlock* block, const char* name);
+
+/**
+ * Steps through the block: pass NULL to start, then the name returned last.
+ * Returns the next name and sets *value, NULL after the last header.
+ */
+const char* header_block_next(const HeaderBlock* block, const char* name, const char** value);
+
+void header_block_free(HeaderBlock* block);
+
+#endif
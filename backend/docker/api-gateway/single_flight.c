@@ -0,0 +1,142 @@
+#include "single_flight.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logger.h"
+#include "metrics.h"
+
+#define FLIGHT_BUCKETS 64
+
+// A request in progress, unlinked from its bucket once the response is published
+typedef struct Flight {
+    struct Flight* next;
+    char* key;
+    int done;
+    int waiters;
+    SharedResponse* response;
+    pthread_cond_t finished;
+} Flight;
+
+static Flight* flights[FLIGHT_BUCKETS];
+static pthread_mutex_t flights_lock = PTHREAD_MUTEX_INITIALIZER;
+static int enabled = 1;
+
+static size_t bucket_of(const char* key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *key; key++) {
+        hash ^= (unsigned char)*key;
+        hash *= 1099511628211ULL;
+    }
+    return hash % FLIGHT_BUCKETS;
+}
+
+static void count(const char* result) {
+    metrics_add(metrics_series(METRIC_COALESCED_REQUESTS, result), 1);
+}
+
+static void flight_destroy(Flight* flight) {
+    pthread_cond_destroy(&flight->finished);
+    free(flight->key);
+    free(flight);
+}
+
+void single_flight_init(void) {
+    const char* env = getenv("COALESCE_REQUESTS");
+    enabled = env == NULL || strcmp(env, "0") != 0;
+    LOG_INFO("Request coalescing %s", enabled ? "on" : "off");
+}
+
+SharedResponse* single_flight_do(const char* key, FlightFunction fetch, void* arg) {
+    if (!enabled) {
+        return fetch(arg);
+    }
+
+    size_t bucket = bucket_of(key);
+    pthread_mutex_lock(&flights_lock);
+    for (Flight* flight = flights[bucket]; flight; flight = flight->next) {
+        if (strcmp(flight->key, key) != 0) {
+            continue;
+        }
+        flight->waiters++;
+        while (!flight->done) {
+            pthread_cond_wait(&flight->finished, &flights_lock);
+        }
+        // The leader already counted this waiter's reference
+        SharedResponse* response = flight->response;
+        int last = --flight->waiters == 0;
+        pthread_mutex_unlock(&flights_lock);
+
+        if (last) {
+            flight_destroy(flight);
+        }
+        count("shared");
+        return response;
+    }
+
+    Flight* flight = calloc(1, sizeof(Flight));
+    if (flight) {
+        flight->key = strdup(key);
+    }
+    if (flight == NULL || flight->key == NULL) {
+        pthread_mutex_unlock(&flights_lock);
+        free(flight);
+        return fetch(arg);
+    }
+    pthread_cond_init(&flight->finished, NULL);
+    flight->next = flights[bucket];
+    flights[bucket] = flight;
+    pthread_mutex_unlock(&flights_lock);
+
+    SharedResponse* response = fetch(arg);
+
+    pthread_mutex_lock(&flights_lock);
+    Flight** link = &flights[bucket];
+    while (*link != flight) {
+        link = &(*link)->next;
+    }
+    *link = flight->next;
+    // Unlinked, so the waiter count is final and every reference is handed out here
+    flight->done = 1;
+    flight->response = response;
+    if (response) {
+        atomic_store(&response->references, 1 + flight->waiters);
+    }
+    int alone = flight->waiters == 0;
+    pthread_cond_broadcast(&flight->finished);
+    pthread_mutex_unlock(&flights_lock);
+
+    if (alone) {
+        flight_destroy(flight);
+    }
+    count("upstream");
+    return response;
+}
+
+SharedResponse* shared_response_create(long status, char* body, size_t size, HeaderBlock headers) {
+    SharedResponse* response = malloc(sizeof(SharedResponse));
+    if (response == NULL) {
+        free(body);
+        header_block_free(&headers);
+        return NULL;
+    }
+    response->status = status;
+    response->body = body;
+    response->size = size;
+    response->headers = headers;
+    atomic_init(&response->references, 1);
+    return response;
+}
+
+void shared_response_release(SharedResponse* response) {
+    if (response == NULL || atomic_fetch_sub(&response->references, 1) != 1) {
+        return;
+    }
+    free(response->body);
+    header_block_free(&response->headers);
+    free(response);
+}
+
+void shared_response_free_callback(void* cls) {
+    shared_response_release((SharedResponse*)cls);
+}
@@ -0,0 +1,43 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "proxy.h"
+
+/**
+ * An upstream response handed to every request that waited on it. Nothing
+ * in it changes once it is published, a request that needs another body,
+ * e.g. a compressed one, makes its own copy.
+ */
+typedef struct {
+    long status;
+    char* body;
+    size_t size;
+    HeaderBlock headers;            // What the service sent, less the hop-by-hop headers
+    _Atomic int references;
+} SharedResponse;
+
+// Produces the response for the first request of a flight
+typedef SharedResponse* (*FlightFunction)(void* arg);
+
+// Reads COALESCE_REQUESTS, 0 sends every request upstream on its own (default on)
+void single_flight_init(void);
+
+/**
+ * Runs fetch for the first request with this key. Requests arriving with
+ * the same key while it runs wait for it and get the same response. Every
+ * caller owns one reference to the result. NULL when fetch failed, the
+ * waiters then get NULL as well.
+ */
+SharedResponse* single_flight_do(const char* key, FlightFunction fetch, void* arg);
+
+// Takes ownership of body and headers, the caller holds the only reference
+SharedResponse* shared_response_create(long status, char* body, size_t size, HeaderBlock headers);
+
+void shared_response_release(SharedResponse* response);
+
+// MHD free callback for a body served straight from a SharedResponse, drops the reference in cls
+void shared_response_free_callback(void* cls);
+
+#endif
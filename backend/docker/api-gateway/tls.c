@@ -0,0 +1,204 @@
+#include "tls.h"
+#include <gnutls/gnutls.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "logger.h"
+
+// Servers pick the suite, AES-GCM first since it is hardware accelerated, ChaCha20 for clients without AES-NI
+#define DEFAULT_PRIORITIES "NORMAL:%SERVER_PRECEDENCE:-VERS-ALL:+VERS-TLS1.3:+VERS-TLS1.2:" \
+    "-CIPHER-ALL:+AES-128-GCM:+CHACHA20-POLY1305:+AES-256-GCM:-MAC-ALL:+AEAD:" \
+    "-KX-ALL:+ECDHE-ECDSA:+ECDHE-RSA"
+#define DEFAULT_CACHE_SLOTS 4096
+#define DEFAULT_LIFETIME 3600
+#define TICKET_KEY_SIZE 64
+#define SESSION_ID_MAX 32
+
+// Direct-mapped, a colliding session id evicts the older session
+typedef struct {
+    unsigned char id[SESSION_ID_MAX];
+    unsigned int id_size;
+    time_t stored;
+    unsigned char* data;
+    unsigned int size;
+} CachedSession;
+
+static const char* priorities = DEFAULT_PRIORITIES;
+static int tickets_enabled = 1;
+static gnutls_datum_t ticket_key;
+static unsigned int lifetime = DEFAULT_LIFETIME;
+
+static CachedSession* sessions = NULL;
+static size_t session_slots = 0;
+static pthread_mutex_t sessions_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t slot_of(const gnutls_datum_t* id) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned int i = 0; i < id->size; i++) {
+        hash ^= id->data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash % session_slots;
+}
+
+static int cache_store(void* ptr, gnutls_datum_t id, gnutls_datum_t data) {
+    if (id.size > SESSION_ID_MAX) {
+        return -1;
+    }
+    unsigned char* copy = malloc(data.size);
+    if (copy == NULL) {
+        return -1;
+    }
+    memcpy(copy, data.data, data.size);
+
+    CachedSession* entry = &sessions[slot_of(&id)];
+    pthread_mutex_lock(&sessions_lock);
+    unsigned char* old = entry->data;
+    memcpy(entry->id, id.data, id.size);
+    entry->id_size = id.size;
+    entry->stored = time(NULL);
+    entry->data = copy;
+    entry->size = data.size;
+    pthread_mutex_unlock(&sessions_lock);
+
+    free(old);
+    return 0;
+}
+
+static gnutls_datum_t cache_retrieve(void* ptr, gnutls_datum_t id) {
+    gnutls_datum_t result = { NULL, 0 };
+    if (id.size > SESSION_ID_MAX) {
+        return result;
+    }
+
+    CachedSession* entry = &sessions[slot_of(&id)];
+    pthread_mutex_lock(&sessions_lock);
+    if (entry->data && entry->id_size == id.size && memcmp(entry->id, id.data, id.size) == 0 &&
+        time(NULL) - entry->stored < (time_t)lifetime) {
+        // GnuTLS frees what it is handed with gnutls_free
+        result.data = gnutls_malloc(entry->size);
+        if (result.data) {
+            memcpy(result.data, entry->data, entry->size);
+            result.size = entry->size;
+        }
+    }
+    pthread_mutex_unlock(&sessions_lock);
+    return result;
+}
+
+static int cache_remove(void* ptr, gnutls_datum_t id) {
+    if (id.size > SESSION_ID_MAX) {
+        return -1;
+    }
+
+    unsigned char* old = NULL;
+    CachedSession* entry = &sessions[slot_of(&id)];
+    pthread_mutex_lock(&sessions_lock);
+    if (entry->data && entry->id_size == id.size && memcmp(entry->id, id.data, id.size) == 0) {
+        old = entry->data;
+        entry->data = NULL;
+        entry->size = 0;
+    }
+    pthread_mutex_unlock(&sessions_lock);
+
+    free(old);
+    return old ? 0 : -1;
+}
+
+static int load_ticket_key(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        LOG_ERROR("Cannot open ticket key %s", path);
+        return -1;
+    }
+    ticket_key.data = gnutls_malloc(TICKET_KEY_SIZE);
+    size_t size = ticket_key.data ? fread(ticket_key.data, 1, TICKET_KEY_SIZE, f) : 0;
+    fclose(f);
+    if (size != TICKET_KEY_SIZE) {
+        LOG_ERROR("Ticket key %s must hold %d bytes", path, TICKET_KEY_SIZE);
+        gnutls_free(ticket_key.data);
+        ticket_key.data = NULL;
+        return -1;
+    }
+    ticket_key.size = TICKET_KEY_SIZE;
+    return 0;
+}
+
+int tls_init(void) {
+    const char* env = getenv("TLS_PRIORITIES");
+    if (env && *env) {
+        priorities = env;
+    }
+    // MHD would only report a bad string as a failed start, check it here to say why
+    gnutls_priority_t cache;
+    const char* error_position = NULL;
+    if (gnutls_priority_init(&cache, priorities, &error_position) != GNUTLS_E_SUCCESS) {
+        LOG_ERROR("Invalid TLS_PRIORITIES near \"%s\"", error_position ? error_position : priorities);
+        return -1;
+    }
+    gnutls_priority_deinit(cache);
+
+    env = getenv("TLS_SESSION_LIFETIME");
+    if (env) {
+        int value = atoi(env);
+        lifetime = value > 0 ? (unsigned int)value : DEFAULT_LIFETIME;
+    }
+
+    env = getenv("TLS_SESSION_TICKETS");
+    tickets_enabled = env == NULL || strcmp(env, "0") != 0;
+    if (tickets_enabled) {
+        const char* key_path = getenv("TLS_TICKET_KEY_FILE");
+        if (key_path && *key_path) {
+            if (load_ticket_key(key_path) != 0) {
+                return -1;
+            }
+        }
+        else if (gnutls_session_ticket_key_generate(&ticket_key) != GNUTLS_E_SUCCESS) {
+            LOG_ERROR("Failed to generate session ticket key");
+            return -1;
+        }
+    }
+
+    env = getenv("TLS_SESSION_CACHE");
+    session_slots = env ? (size_t)atoi(env) : DEFAULT_CACHE_SLOTS;
+    if (session_slots > 0) {
+        sessions = calloc(session_slots, sizeof(CachedSession));
+        if (sessions == NULL) {
+            return -1;
+        }
+    }
+
+    LOG_INFO("TLS session tickets %s, session cache %zu slots, lifetime %us",
+        tickets_enabled ? "on" : "off", session_slots, lifetime);
+    return 0;
+}
+
+const char* tls_priorities(void) {
+    return priorities;
+}
+
+void tls_notify_connection(void* cls, struct MHD_Connection* connection, void** socket_context,
+    enum MHD_ConnectionNotificationCode toe) {
+
+    if (toe != MHD_CONNECTION_NOTIFY_STARTED) {
+        return;
+    }
+    const union MHD_ConnectionInfo* info = MHD_get_connection_info(connection, MHD_CONNECTION_INFO_GNUTLS_SESSION);
+    if (info == NULL || info->tls_session == NULL) {
+        return;
+    }
+    gnutls_session_t session = (gnutls_session_t)info->tls_session;
+
+    if (tickets_enabled && gnutls_session_ticket_enable_server(session, &ticket_key) != GNUTLS_E_SUCCESS) {
+        LOG_WARN("Failed to enable session tickets");
+    }
+    if (sessions) {
+        gnutls_db_set_cache_expiration(session, lifetime);
+        gnutls_db_set_retrieve_function(session, cache_retrieve);
+        gnutls_db_set_store_function(session, cache_store);
+        gnutls_db_set_remove_function(session, cache_remove);
+    }
+}
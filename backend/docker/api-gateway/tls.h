@@ -0,0 +1,32 @@
+#ifndef TLS_H
+#define TLS_H
+
+#include <microhttpd.h>
+
+/**
+ * Reads the TLS settings from the environment:
+ *
+ *   TLS_PRIORITIES       GnuTLS priority string, defaults to TLS 1.2/1.3 with
+ *                        AEAD suites only, AES-GCM first
+ *   TLS_SESSION_TICKETS  0 disables session tickets (default on)
+ *   TLS_TICKET_KEY_FILE  64 byte ticket key shared by every gateway process,
+ *                        a random key per process when unset
+ *   TLS_SESSION_CACHE    Slots in the TLS 1.2 session id cache, 0 disables
+ *                        it (default 4096)
+ *   TLS_SESSION_LIFETIME Seconds a session may be resumed (default 3600)
+ *
+ * Returns -1 when a setting cannot be used.
+ */
+int tls_init(void);
+
+// Priority string for MHD_OPTION_HTTPS_PRIORITIES
+const char* tls_priorities(void);
+
+/**
+ * MHD_OPTION_NOTIFY_CONNECTION callback. Enables tickets and the session
+ * cache on each new TLS session before its handshake starts.
+ */
+void tls_notify_connection(void* cls, struct MHD_Connection* connection, void** socket_context,
+    enum MHD_ConnectionNotificationCode toe);
+
+#endif
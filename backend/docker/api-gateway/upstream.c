@@ -0,0 +1,241 @@
+#include "upstream.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logger.h"
+#include "metrics.h"
+
+#define WINDOW_SECONDS 10
+#define RETRY_BUDGET_CAP 10.0       // Retries that can be saved up while calls succeed
+
+typedef enum {
+    BREAKER_CLOSED,
+    BREAKER_OPEN,
+    BREAKER_HALF_OPEN
+} BreakerState;
+
+static const char* state_names[] = { "closed", "open", "half-open" };
+
+// One second of the rolling window, stale once its second is WINDOW_SECONDS old
+typedef struct {
+    uint64_t second;
+    uint32_t calls;
+    uint32_t failures;
+} WindowSlot;
+
+struct Upstream {
+    char* name;
+    pthread_mutex_t lock;
+    BreakerState state;
+    uint64_t opened;                // Second the breaker last opened
+    int probing;
+    WindowSlot window[WINDOW_SECONDS];
+    double retry_tokens;
+};
+
+typedef struct {
+    const char* url;
+    long timeout_ms;
+    long slow_ms;                   // 0 for BREAKER_SLOW_MS
+} RouteTimeout;
+
+// Sign-up and recovery wait on the mail server before they answer, only their timeout counts as failed
+static const RouteTimeout route_timeouts[] = {
+    { "/user/newuser", 10000, 10000 },
+    { "/user/magicclaw", 10000, 10000 },
+    { "/user/recoverpassword", 10000, 10000 },
+};
+
+static int failure_percent = 50;
+static int min_requests = 20;
+static int open_seconds = 5;
+static uint64_t slow_micros = 1000000;
+static double retry_ratio = 0.1;
+static long read_timeout_ms = 3000;
+static long write_timeout_ms = 5000;
+
+static int env_int(const char* name, int fallback) {
+    const char* value = getenv(name);
+    if (value == NULL) {
+        return fallback;
+    }
+    int number = atoi(value);
+    return number > 0 ? number : fallback;
+}
+
+static uint64_t now_seconds(void) {
+    return metrics_now() / 1000000;
+}
+
+void upstream_init(void) {
+    failure_percent = env_int("BREAKER_FAILURE_PERCENT", failure_percent);
+    min_requests = env_int("BREAKER_MIN_REQUESTS", min_requests);
+    open_seconds = env_int("BREAKER_OPEN_SECONDS", open_seconds);
+    slow_micros = (uint64_t)env_int("BREAKER_SLOW_MS", 1000) * 1000;
+    retry_ratio = env_int("RETRY_BUDGET_PERCENT", 10) / 100.0;
+    read_timeout_ms = env_int("UPSTREAM_READ_TIMEOUT_MS", read_timeout_ms);
+    write_timeout_ms = env_int("UPSTREAM_WRITE_TIMEOUT_MS", write_timeout_ms);
+    LOG_INFO("Breakers open at %d%% of %d calls for %ds, timeouts %ldms/%ldms",
+        failure_percent, min_requests, open_seconds, read_timeout_ms, write_timeout_ms);
+}
+
+Upstream* upstream_create(const char* name) {
+    Upstream* upstream = calloc(1, sizeof(Upstream));
+    if (upstream == NULL) {
+        return NULL;
+    }
+    upstream->name = strdup(name);
+    if (upstream->name == NULL) {
+        free(upstream);
+        return NULL;
+    }
+    pthread_mutex_init(&upstream->lock, NULL);
+    upstream->state = BREAKER_CLOSED;
+    upstream->retry_tokens = RETRY_BUDGET_CAP;
+    return upstream;
+}
+
+void upstream_destroy(Upstream* upstream) {
+    if (upstream == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&upstream->lock);
+    free(upstream->name);
+    free(upstream);
+}
+
+// Called with the lock held
+static void transition(Upstream* upstream, BreakerState state, uint64_t now) {
+    if (upstream->state == state) {
+        return;
+    }
+    if (state == BREAKER_OPEN) {
+        LOG_WARN("Breaker for %s %s -> open", upstream->name, state_names[upstream->state]);
+        upstream->opened = now;
+    }
+    else {
+        LOG_INFO("Breaker for %s %s -> %s", upstream->name, state_names[upstream->state], state_names[state]);
+    }
+    if (state == BREAKER_CLOSED) {
+        memset(upstream->window, 0, sizeof(upstream->window));
+    }
+    upstream->state = state;
+}
+
+UpstreamPermit upstream_permit(Upstream* upstream, unsigned int* retry_after) {
+    UpstreamPermit permit = UPSTREAM_ALLOWED;
+    uint64_t now = now_seconds();
+
+    pthread_mutex_lock(&upstream->lock);
+    if (upstream->state == BREAKER_OPEN && now - upstream->opened >= (uint64_t)open_seconds) {
+        transition(upstream, BREAKER_HALF_OPEN, now);
+    }
+    if (upstream->state == BREAKER_OPEN) {
+        permit = UPSTREAM_REJECTED;
+        *retry_after = (unsigned int)(upstream->opened + open_seconds - now);
+    }
+    else if (upstream->state == BREAKER_HALF_OPEN) {
+        // One probe at a time, the rest fail fast until it comes back
+        if (upstream->probing) {
+            permit = UPSTREAM_REJECTED;
+            *retry_after = 1;
+        }
+        else {
+            upstream->probing = 1;
+            permit = UPSTREAM_PROBE;
+        }
+    }
+    pthread_mutex_unlock(&upstream->lock);
+
+    if (permit == UPSTREAM_REJECTED) {
+        metrics_add(metrics_series(METRIC_REJECTED_REQUESTS, "circuit_open"), 1);
+    }
+    return permit;
+}
+
+void upstream_record(Upstream* upstream, UpstreamPermit permit, int failed, uint64_t micros, uint64_t slow) {
+    if (micros > slow) {
+        failed = 1;
+    }
+    uint64_t now = now_seconds();
+
+    pthread_mutex_lock(&upstream->lock);
+    WindowSlot* slot = &upstream->window[now % WINDOW_SECONDS];
+    if (slot->second != now) {
+        slot->second = now;
+        slot->calls = 0;
+        slot->failures = 0;
+    }
+    slot->calls++;
+    slot->failures += failed;
+
+    upstream->retry_tokens += retry_ratio;
+    if (upstream->retry_tokens > RETRY_BUDGET_CAP) {
+        upstream->retry_tokens = RETRY_BUDGET_CAP;
+    }
+
+    if (permit == UPSTREAM_PROBE) {
+        upstream->probing = 0;
+        transition(upstream, failed ? BREAKER_OPEN : BREAKER_CLOSED, now);
+    }
+    else if (failed && upstream->state == BREAKER_CLOSED) {
+        uint32_t calls = 0;
+        uint32_t failures = 0;
+        for (int i = 0; i < WINDOW_SECONDS; i++) {
+            if (now - upstream->window[i].second < WINDOW_SECONDS) {
+                calls += upstream->window[i].calls;
+                failures += upstream->window[i].failures;
+            }
+        }
+        if (calls >= (uint32_t)min_requests && failures * 100 >= calls * (uint32_t)failure_percent) {
+            transition(upstream, BREAKER_OPEN, now);
+        }
+    }
+    pthread_mutex_unlock(&upstream->lock);
+}
+
+void upstream_release(Upstream* upstream, UpstreamPermit permit) {
+    if (permit != UPSTREAM_PROBE) {
+        return;
+    }
+    pthread_mutex_lock(&upstream->lock);
+    upstream->probing = 0;
+    pthread_mutex_unlock(&upstream->lock);
+}
+
+int upstream_take_retry(Upstream* upstream) {
+    int allowed = 0;
+    pthread_mutex_lock(&upstream->lock);
+    if (upstream->state == BREAKER_CLOSED && upstream->retry_tokens >= 1) {
+        upstream->retry_tokens -= 1;
+        allowed = 1;
+    }
+    pthread_mutex_unlock(&upstream->lock);
+
+    if (allowed) {
+        metrics_add(metrics_series(METRIC_UPSTREAM_RETRIES, upstream->name), 1);
+    }
+    return allowed;
+}
+
+static const RouteTimeout* find_route(const char* url) {
+    for (size_t i = 0; i < sizeof(route_timeouts) / sizeof(route_timeouts[0]); i++) {
+        if (strcmp(url, route_timeouts[i].url) == 0) {
+            return &route_timeouts[i];
+        }
+    }
+    return NULL;
+}
+
+long upstream_timeout_ms(const char* method, const char* url) {
+    const RouteTimeout* route = find_route(url);
+    if (route) {
+        return route->timeout_ms;
+    }
+    return strcmp(method, "GET") == 0 ? read_timeout_ms : write_timeout_ms;
+}
+
+uint64_t upstream_slow_micros(const char* url) {
+    const RouteTimeout* route = find_route(url);
+    return route && route->slow_ms ? (uint64_t)route->slow_ms * 1000 : slow_micros;
+}
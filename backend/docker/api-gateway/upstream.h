@@ -0,0 +1,58 @@
+#ifndef UPSTREAM_H
+#define UPSTREAM_H
+
+#include <stdint.h>
+
+typedef struct Upstream Upstream;
+
+typedef enum {
+    UPSTREAM_REJECTED,      // Breaker open, fail without calling the service
+    UPSTREAM_ALLOWED,
+    UPSTREAM_PROBE          // Half-open, this call decides whether the breaker closes
+} UpstreamPermit;
+
+/**
+ * Reads the breaker and timeout settings from the environment:
+ *
+ *   BREAKER_FAILURE_PERCENT    failed calls over the last 10 seconds that open
+ *                              the breaker (default 50)
+ *   BREAKER_MIN_REQUESTS       calls in that window before it may open (default 20)
+ *   BREAKER_OPEN_SECONDS       time before a probe is let through (default 5)
+ *   BREAKER_SLOW_MS            calls slower than this count as failed, unless
+ *                              their route has a threshold of its own (default 1000)
+ *   RETRY_BUDGET_PERCENT       retries allowed as a share of calls (default 10)
+ *   UPSTREAM_READ_TIMEOUT_MS   timeout for GETs (default 3000)
+ *   UPSTREAM_WRITE_TIMEOUT_MS  timeout for everything else (default 5000)
+ */
+void upstream_init(void);
+
+// Breaker and retry budget for one service, kept per worker process
+Upstream* upstream_create(const char* name);
+
+void upstream_destroy(Upstream* upstream);
+
+/**
+ * Whether a call may go to the service now. When it may not, *retry_after
+ * is the seconds until the breaker lets a probe through.
+ */
+UpstreamPermit upstream_permit(Upstream* upstream, unsigned int* retry_after);
+
+/**
+ * Outcome of a call upstream_permit allowed, failed meaning a transport
+ * error or a 5xx. A call that took longer than slow counts as failed too.
+ */
+void upstream_record(Upstream* upstream, UpstreamPermit permit, int failed, uint64_t micros, uint64_t slow);
+
+// Gives up a permit without calling the service, a probe is left to the next call
+void upstream_release(Upstream* upstream, UpstreamPermit permit);
+
+// Takes a retry from the budget, 0 when it is spent
+int upstream_take_retry(Upstream* upstream);
+
+// Milliseconds a call to url may take, longer for the routes that send mail
+long upstream_timeout_ms(const char* method, const char* url);
+
+// Microseconds after which a call to url counts as failed, for the mail routes only their timeout
+uint64_t upstream_slow_micros(const char* url);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Size of the first block and of every block added when an arena runs out
+#define ARENA_BLOCK_SIZE 16384
+
+typedef struct ArenaBlock ArenaBlock;
+
+/**
+ * Bump allocator owned by a single request. Everything allocated from it
+ * is released at once by arena_destroy, individual frees are no-ops.
+ */
+typedef struct Arena {
+    ArenaBlock* head;
+    size_t block_size;
+} Arena;
+
+Arena* arena_create(size_t block_size);
+void arena_destroy(Arena* arena);
+
+void* arena_alloc(Arena* arena, size_t size);
+void* arena_realloc(Arena* arena, void* ptr, size_t old_size, size_t new_size);
+char* arena_strdup(Arena* arena, const char* str);
+int arena_owns(const Arena* arena, const void* ptr);
+
+/**
+ * The active arena is the one belonging to the request currently being
+ * handled on this thread. The request_* functions below allocate from it,
+ * and fall back to the C library when no request is active.
+ */
+void arena_activate(Arena* arena);
+Arena* arena_active(void);
+
+void* request_malloc(size_t size);
+/**
+ * No-op while a request is active, its arena releases everything at once,
+ * free() otherwise. Memory has to be freed where it was allocated, inside
+ * or outside a request, as nothing records which arena owns a pointer.
+ */
+void request_free(void* ptr);
+char* request_strdup(const char* str);
+
+#endif
@@ -0,0 +1,69 @@
+#include "cache_watcher.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "logger.h"
+#include "repo.h"
+#include "response_cache.h"
+
+#define MAX_BACKOFF 60
+
+typedef struct {
+    const char* db_name;
+    const char* collection_name;
+    const char* project_field;
+    ChangeListener listener;
+} WatchTarget;
+
+static void on_change(void* cls, const char* project_id, const bson_t* event) {
+    WatchTarget* target = (WatchTarget*)cls;
+    if (project_id) {
+        LOG_DEBUG("Change stream: project %s changed", project_id);
+        response_cache_invalidate(project_id);
+    }
+    else {
+        response_cache_invalidate_all();
+    }
+    if (target->listener) {
+        target->listener(project_id, event);
+    }
+}
+
+static void* watch_loop(void* arg) {
+    WatchTarget* target = (WatchTarget*)arg;
+    unsigned int backoff = 1;
+
+    for (;;) {
+        time_t opened = time(NULL);
+        watch_collection(target->db_name, target->collection_name, target->project_field, on_change, target);
+
+        // A stream that stayed up for a while failed on its own, start over quickly
+        if (time(NULL) - opened > MAX_BACKOFF) {
+            backoff = 1;
+        }
+        sleep(backoff);
+        backoff = backoff * 2 > MAX_BACKOFF ? MAX_BACKOFF : backoff * 2;
+    }
+    return NULL;
+}
+
+int cache_watcher_start(const char* db_name, const char* collection_name, const char* project_field,
+    ChangeListener listener) {
+    WatchTarget* target = malloc(sizeof(WatchTarget));
+    if (target == NULL) {
+        return -1;
+    }
+    target->db_name = db_name;
+    target->collection_name = collection_name;
+    target->project_field = project_field;
+    target->listener = listener;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, watch_loop, target) != 0) {
+        free(target);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
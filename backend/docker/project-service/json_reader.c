@@ -0,0 +1,384 @@
+#include "json_reader.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define JSON_MAX_DEPTH 64
+#define JSON_MAX_NUMBER_LENGTH 64
+
+void json_reader_init(JsonReader* reader, const char* data, size_t size) {
+    reader->pos = data;
+    reader->end = data ? data + size : data;
+    reader->container_start = 0;
+}
+
+static void skip_whitespace(JsonReader* reader) {
+    while (reader->pos < reader->end) {
+        char c = *reader->pos;
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            return;
+        }
+        reader->pos++;
+    }
+}
+
+/**
+ * Finds the next byte inside a string that needs attention: the closing
+ * quote, a backslash or a raw control character. Plain text in between is
+ * skipped sixteen bytes at a time where SSE2 is available.
+ */
+static const char* scan_string(const char* p, const char* end) {
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+        // Unsigned chunk <= 0x1F, i.e. max(chunk, 0x1F) == 0x1F
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        int mask = _mm_movemask_epi8(special);
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\' || c < 0x20) {
+            return p;
+        }
+        p++;
+    }
+    return end;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int read_hex4(const char* p, const char* end, unsigned int* out) {
+    if (end - p < 4) {
+        return -1;
+    }
+    unsigned int value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_value(p[i]);
+        if (digit < 0) {
+            return -1;
+        }
+        value = (value << 4) | (unsigned int)digit;
+    }
+    *out = value;
+    return 0;
+}
+
+static size_t encode_utf8(unsigned int codepoint, char* out) {
+    if (codepoint < 0x80) {
+        out[0] = (char)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800) {
+        out[0] = (char)(0xC0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint < 0x10000) {
+        out[0] = (char)(0xE0 | (codepoint >> 12));
+        out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (codepoint >> 18));
+    out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+// Appends to out while there is room, always counts the full length
+static void emit(char* out, size_t out_size, size_t* length, const char* data, size_t size) {
+    if (out && *length + 1 < out_size) {
+        size_t room = out_size - 1 - *length;
+        memcpy(out + *length, data, size < room ? size : room);
+    }
+    *length += size;
+}
+
+/**
+ * Decodes the string at the reader position. out may be NULL to only
+ * validate and skip it.
+ */
+static int read_string(JsonReader* reader, char* out, size_t out_size, size_t* length) {
+    const char* p = reader->pos + 1;
+    const char* end = reader->end;
+    *length = 0;
+
+    for (;;) {
+        const char* special = scan_string(p, end);
+        emit(out, out_size, length, p, (size_t)(special - p));
+        p = special;
+
+        if (p >= end || (unsigned char)*p < 0x20) {
+            return JSON_INVALID;
+        }
+        if (*p == '"') {
+            p++;
+            break;
+        }
+
+        // Escape sequence
+        if (end - p < 2) {
+            return JSON_INVALID;
+        }
+        char escaped;
+        switch (p[1]) {
+        case '"': escaped = '"'; break;
+        case '\\': escaped = '\\'; break;
+        case '/': escaped = '/'; break;
+        case 'b': escaped = '\b'; break;
+        case 'f': escaped = '\f'; break;
+        case 'n': escaped = '\n'; break;
+        case 'r': escaped = '\r'; break;
+        case 't': escaped = '\t'; break;
+        case 'u': {
+            unsigned int codepoint;
+            if (read_hex4(p + 2, end, &codepoint) != 0) {
+                return JSON_INVALID;
+            }
+            p += 6;
+            if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                unsigned int low;
+                if (end - p < 6 || p[0] != '\\' || p[1] != 'u' ||
+                    read_hex4(p + 2, end, &low) != 0 || low < 0xDC00 || low > 0xDFFF) {
+                    return JSON_INVALID;
+                }
+                codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                p += 6;
+            }
+            else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+                return JSON_INVALID;
+            }
+            char utf8[4];
+            emit(out, out_size, length, utf8, encode_utf8(codepoint, utf8));
+            continue;
+        }
+        default:
+            return JSON_INVALID;
+        }
+        emit(out, out_size, length, &escaped, 1);
+        p += 2;
+    }
+
+    if (out && out_size > 0) {
+        out[*length < out_size ? *length : out_size - 1] = '\0';
+    }
+    reader->pos = p;
+    return 0;
+}
+
+char json_reader_peek(JsonReader* reader) {
+    skip_whitespace(reader);
+    return reader->pos < reader->end ? *reader->pos : 0;
+}
+
+int json_reader_begin_object(JsonReader* reader) {
+    if (json_reader_peek(reader) != '{') {
+        return JSON_INVALID;
+    }
+    reader->pos++;
+    reader->container_start = 1;
+    return 0;
+}
+
+int json_reader_begin_array(JsonReader* reader) {
+    if (json_reader_peek(reader) != '[') {
+        return JSON_INVALID;
+    }
+    reader->pos++;
+    reader->container_start = 1;
+    return 0;
+}
+
+int json_reader_next_key(JsonReader* reader, const char** key, size_t* key_size) {
+    char c = json_reader_peek(reader);
+    if (c == '}') {
+        reader->container_start = 0;
+        reader->pos++;
+        return 0;
+    }
+    int first = reader->container_start;
+    reader->container_start = 0;
+    if (!first) {
+        if (c != ',') {
+            return JSON_INVALID;
+        }
+        reader->pos++;
+        c = json_reader_peek(reader);
+    }
+    if (c != '"') {
+        return JSON_INVALID;
+    }
+
+    const char* start = reader->pos + 1;
+    size_t length;
+    if (read_string(reader, NULL, 0, &length) != 0) {
+        return JSON_INVALID;
+    }
+    // Raw bytes between the quotes, escapes are left as they are
+    *key = start;
+    *key_size = (size_t)(reader->pos - 1 - start);
+
+    if (json_reader_peek(reader) != ':') {
+        return JSON_INVALID;
+    }
+    reader->pos++;
+    return 1;
+}
+
+int json_reader_next_item(JsonReader* reader) {
+    char c = json_reader_peek(reader);
+    if (c == ']') {
+        reader->container_start = 0;
+        reader->pos++;
+        return 0;
+    }
+    int first = reader->container_start;
+    reader->container_start = 0;
+    if (!first) {
+        if (c != ',') {
+            return JSON_INVALID;
+        }
+        reader->pos++;
+        c = json_reader_peek(reader);
+    }
+    if (c == 0 || c == ']') {
+        return JSON_INVALID;
+    }
+    return 1;
+}
+
+int json_reader_string(JsonReader* reader, char* out, size_t out_size) {
+    if (json_reader_peek(reader) != '"') {
+        return JSON_WRONG_TYPE;
+    }
+    size_t length;
+    if (read_string(reader, out, out_size, &length) != 0) {
+        return JSON_INVALID;
+    }
+    return length > INT_MAX ? INT_MAX : (int)length;
+}
+
+static int number_length(const JsonReader* reader) {
+    const char* p = reader->pos;
+    while (p < reader->end && *p != '\0' && (strchr("+-.eE", *p) || (*p >= '0' && *p <= '9'))) {
+        p++;
+    }
+    return (int)(p - reader->pos);
+}
+
+int json_reader_int(JsonReader* reader, int* out) {
+    char c = json_reader_peek(reader);
+    if (c != '-' && (c < '0' || c > '9')) {
+        return JSON_WRONG_TYPE;
+    }
+
+    int length = number_length(reader);
+    if (length >= JSON_MAX_NUMBER_LENGTH) {
+        return JSON_INVALID;
+    }
+    char number[JSON_MAX_NUMBER_LENGTH];
+    memcpy(number, reader->pos, (size_t)length);
+    number[length] = '\0';
+
+    char* parse_end;
+    double value = strtod(number, &parse_end);
+    if (parse_end != number + length) {
+        return JSON_INVALID;
+    }
+    reader->pos += length;
+
+    if (value >= INT_MAX) {
+        *out = INT_MAX;
+    }
+    else if (value <= (double)INT_MIN) {
+        *out = INT_MIN;
+    }
+    else {
+        *out = (int)value;
+    }
+    return 0;
+}
+
+static int match_literal(JsonReader* reader, const char* literal) {
+    size_t length = strlen(literal);
+    if ((size_t)(reader->end - reader->pos) < length || memcmp(reader->pos, literal, length) != 0) {
+        return JSON_INVALID;
+    }
+    reader->pos += length;
+    return 0;
+}
+
+static int skip_value(JsonReader* reader, int depth) {
+    if (depth > JSON_MAX_DEPTH) {
+        return JSON_INVALID;
+    }
+
+    char c = json_reader_peek(reader);
+    switch (c) {
+    case '"': {
+        size_t length;
+        return read_string(reader, NULL, 0, &length);
+    }
+    case '{': {
+        const char* key;
+        size_t key_size;
+        int next;
+        json_reader_begin_object(reader);
+        while ((next = json_reader_next_key(reader, &key, &key_size)) == 1) {
+            if (skip_value(reader, depth + 1) != 0) {
+                return JSON_INVALID;
+            }
+        }
+        return next;
+    }
+    case '[': {
+        int next;
+        json_reader_begin_array(reader);
+        while ((next = json_reader_next_item(reader)) == 1) {
+            if (skip_value(reader, depth + 1) != 0) {
+                return JSON_INVALID;
+            }
+        }
+        return next;
+    }
+    case 't':
+        return match_literal(reader, "true");
+    case 'f':
+        return match_literal(reader, "false");
+    case 'n':
+        return match_literal(reader, "null");
+    default: {
+        int ignored;
+        return json_reader_int(reader, &ignored) == 0 ? 0 : JSON_INVALID;
+    }
+    }
+}
+
+int json_reader_skip(JsonReader* reader) {
+    return skip_value(reader, 0);
+}
+
+int json_reader_finish(JsonReader* reader) {
+    skip_whitespace(reader);
+    return reader->pos == reader->end ? 0 : JSON_INVALID;
+}
@@ -0,0 +1,86 @@
+#include "listener.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "logger.h"
+
+static int listen_unix(const char* path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        LOG_ERROR("Unix socket path %s is too long", path);
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    // A socket file left behind by a previous run would make bind fail
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        LOG_ERROR("Cannot listen on %s", path);
+        close(fd);
+        return -1;
+    }
+    // The gateway runs in another container, as another user
+    chmod(path, 0660);
+    return fd;
+}
+
+int listeners_start(Listeners* listeners, unsigned int flags, uint16_t port,
+    MHD_AccessHandlerCallback handler, MHD_RequestCompletedCallback completed) {
+
+    listeners->tcp = NULL;
+    listeners->unix_socket = NULL;
+
+    const char* path = getenv("UNIX_SOCKET");
+    const char* only = getenv("UNIX_SOCKET_ONLY");
+    int tcp = path == NULL || only == NULL || strcmp(only, "1") != 0;
+
+    if (tcp) {
+        listeners->tcp = MHD_start_daemon(flags, port, NULL, NULL, handler, NULL,
+            MHD_OPTION_NOTIFY_COMPLETED, completed, NULL,
+            MHD_OPTION_END);
+        if (listeners->tcp == NULL) {
+            return -1;
+        }
+        LOG_INFO("Server running on port %d", port);
+    }
+
+    if (path) {
+        int fd = listen_unix(path);
+        if (fd >= 0) {
+            listeners->unix_socket = MHD_start_daemon(flags, 0, NULL, NULL, handler, NULL,
+                MHD_OPTION_LISTEN_SOCKET, fd,
+                MHD_OPTION_NOTIFY_COMPLETED, completed, NULL,
+                MHD_OPTION_END);
+            if (listeners->unix_socket == NULL) {
+                close(fd);
+            }
+        }
+        if (listeners->unix_socket == NULL) {
+            listeners_stop(listeners);
+            return -1;
+        }
+        LOG_INFO("Listening on %s", path);
+    }
+    return 0;
+}
+
+void listeners_stop(Listeners* listeners) {
+    if (listeners->tcp) {
+        MHD_stop_daemon(listeners->tcp);
+        listeners->tcp = NULL;
+    }
+    if (listeners->unix_socket) {
+        MHD_stop_daemon(listeners->unix_socket);
+        listeners->unix_socket = NULL;
+        unlink(getenv("UNIX_SOCKET"));
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+typedef enum {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+} LogLevel;
+
+// Levels below this are compiled out entirely, e.g. -DLOG_COMPILE_LEVEL=LOG_LEVEL_INFO
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Runtime threshold, set from LOG_LEVEL by log_init
+extern LogLevel log_level;
+
+/**
+ * Starts the background flusher. Messages are formatted on the calling
+ * thread into a per-thread ring buffer and written out by the flusher, so
+ * the request path never blocks on I/O or takes a lock. Output goes to
+ * stderr, or is appended to LOG_FILE when that is set. log_shutdown is
+ * registered with atexit.
+ */
+int log_init(const char* service_name);
+
+// Drains every ring buffer and stops the flusher
+void log_shutdown(void);
+
+/**
+ * Call in the child right after fork. The flusher thread does not survive
+ * fork, so a new one is started, and messages the parent had not written
+ * out yet are left to the parent.
+ */
+void log_after_fork(void);
+
+/**
+ * Gives the calling thread a ring of slots messages instead of the default
+ * 1024, rounded up to a power of two. For threads that log a line or two
+ * and exit, call before their first message.
+ */
+void log_thread_ring_size(size_t slots);
+
+void log_write(LogLevel level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+// Arguments are not evaluated when the level is disabled
+#define LOG_AT(level, ...) \
+    do { \
+        if ((level) >= LOG_COMPILE_LEVEL && (level) >= log_level) { \
+            log_write((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif
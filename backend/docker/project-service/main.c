@@ -4,634 +4,674 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <cjson/cJSON.h>
+#include <mongoc/mongoc.h>
 #include "model.h"
 #include "repo.h"
 #include "algs.h"
 #include "decode.h"
 #include "jwt_middleware.h"
+#include "request.h"
+#include "logger.h"
+#include "router.h"
+#include "listener.h"
+#include "compression.h"
+#include "response_cache.h"
+#include "cache_watcher.h"
 
 #define PORT 8081
 
-// Structure to store incoming JSON data
-struct ConnectionInfo {
-    char* json_data;
-    size_t json_size;
-};
+// Decodes a project from the request body, JSON_INVALID when it is not valid JSON
+static int decode_project_body(struct ConnectionInfo* conn_info, Project* project) {
+#ifdef FAST_JSON
+    size_t body_size;
+    const char* body = request_body(conn_info, &body_size);
+    return parse_project_from_body(body, body_size, project);
+#else
+    cJSON* json = request_body_json(conn_info);
+    if (json == NULL) {
+        return JSON_INVALID;
+    }
+    int result = parse_project_from_json(json, project);
+    cJSON_Delete(json);
+    return result;
+#endif
+}
 
-int answer_to_connection(void* cls, struct MHD_Connection* connection,
-    const char* url, const char* method, const char* version,
-    const char* upload_data, size_t* upload_data_size, void** con_cls) {
+static int handle_metrics(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    char* metrics = metrics_render();
+    if (metrics == NULL) {
+        return MHD_NO;
+    }
+    struct MHD_Response* response = create_request_response(metrics);
+    MHD_add_response_header(response, "Content-Type", "text/plain; version=0.0.4");
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
+}
 
-    if (strcmp(method, "OPTIONS") == 0) {
-        struct MHD_Response* response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
+// Handle "/newproject" POST request
+static int handle_create_project(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    LOG_DEBUG("Handling POST request for /newproject");
+    
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to create projects (only MANAGER allowed)
+    if (check_permission(&auth, PERM_CREATE_PROJECTS) != 0) {
+        return send_forbidden_response(connection, "Only managers can create projects");
+    }
+
+    Project project;
+    int parse_result = decode_project_body(conn_info, &project);
+    if (parse_result == JSON_INVALID) {
+        const char* error_response = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+            (void*)error_response, MHD_RESPMEM_PERSISTENT);
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-        MHD_add_response_header(response, "Access-Control-Allow-Methods", "GET, POST, PATCH, DELETE, OPTIONS");
-        MHD_add_response_header(response, "Access-Control-Allow-Headers", "Content-Type, Accept, Authorization");
-        MHD_add_response_header(response, "Access-Control-Max-Age", "86400");
-        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
         MHD_destroy_response(response);
-        return ret;
+        return MHD_YES;
     }
 
-    // Handle "/newproject" POST request
-    if (strcmp(url, "/newproject") == 0 && strcmp(method, "POST") == 0) {
-        printf("Handling POST request for /newproject\n");
-        
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // Check permission to create projects (only MANAGER allowed)
-        if (check_permission(&auth, PERM_CREATE_PROJECTS) != 0) {
-            return send_forbidden_response(connection, "Only managers can create projects");
-        }
+    if (parse_result == 0) {
+        const char *auth = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_AUTHORIZATION);
 
-        if (*con_cls == NULL) {
-            struct ConnectionInfo* conn_info = calloc(1, sizeof(struct ConnectionInfo));
-            *con_cls = (void*)conn_info;
-            return MHD_YES;
+        int pure_token_length = strlen(auth) - 7;
+        char pure_token[pure_token_length + 1];
+        for (int i = 0; i < pure_token_length; ++i) {
+            pure_token[i] = auth[i + 7];
         }
+        pure_token[pure_token_length] = '\0';
 
-        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
-
-        if (*upload_data_size > 0) {
-            conn_info->json_data = realloc(conn_info->json_data, conn_info->json_size + *upload_data_size + 1);
-            memcpy(conn_info->json_data + conn_info->json_size, upload_data, *upload_data_size);
-            conn_info->json_size += *upload_data_size;
-            conn_info->json_data[conn_info->json_size] = '\0';
-            *upload_data_size = 0;
-            return MHD_YES;
-        }
-        else {
-            cJSON* json = cJSON_Parse(conn_info->json_data);
-            if (json == NULL) {
-                const char* error_response = "Invalid JSON format";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                cJSON_Delete(json);
-                return MHD_YES;
-            }
+        const char *var_name = "HMAC_KEY";
+        char *hmac_key = getenv(var_name);
 
-            Project project;
-            if (parse_project_from_json(json, &project) == 0) {
-                const char *auth = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_AUTHORIZATION);
-                fprintf(stderr, "token %s\n", auth);
+        struct l8w8jwt_decoding_params params;
+        l8w8jwt_decoding_params_init(&params);
 
-                int pure_token_length = strlen(auth) - 7;
-                char pure_token[pure_token_length + 1];
-                for (int i = 0; i < pure_token_length; ++i) {
-                    pure_token[i] = auth[i + 7];
-                }
-                pure_token[pure_token_length] = '\0';
-                fprintf(stderr, "pure token %s\n", pure_token);
+        params.alg = L8W8JWT_ALG_HS512;
 
-                const char *var_name = "HMAC_KEY";
-                char *hmac_key = getenv(var_name);
-                fprintf(stderr, "key %s\n", hmac_key);
+        params.jwt = pure_token;
+        params.jwt_length = pure_token_length;
 
-                struct l8w8jwt_decoding_params params;
-                l8w8jwt_decoding_params_init(&params);
+        params.verification_key = (unsigned char*)hmac_key;
+        params.verification_key_length = strlen(hmac_key);
 
-                params.alg = L8W8JWT_ALG_HS512;
+        params.validate_iss = "Trello Clone"; 
 
-                params.jwt = pure_token;
-                params.jwt_length = pure_token_length;
+        params.validate_exp = 1; 
+        params.exp_tolerance_seconds = 60;
 
-                params.verification_key = (unsigned char*)hmac_key;
-                params.verification_key_length = strlen(hmac_key);
+        params.validate_iat = 1;
+        params.iat_tolerance_seconds = 60;
 
-                params.validate_iss = "Trello Clone"; 
-                printf("KREK CAMUSKI\n");
+        enum l8w8jwt_validation_result validation_result;
 
-                params.validate_exp = 1; 
-                params.exp_tolerance_seconds = 60;
+        struct l8w8jwt_claim* claims = NULL;
+        size_t claims_len = 0;
 
-                params.validate_iat = 1;
-                params.iat_tolerance_seconds = 60;
+        int decode_result = l8w8jwt_decode(&params, &validation_result, &claims, &claims_len);
+        LOG_DEBUG("decode_result=%d, validation_result=%d, claims_len=%zu", decode_result, validation_result, claims_len);
 
-                enum l8w8jwt_validation_result validation_result;
+        const char *claim_ptr;
+        if (decode_result == L8W8JWT_SUCCESS && validation_result == L8W8JWT_VALID) {
 
-                struct l8w8jwt_claim* claims = NULL;
-                size_t claims_len = 0;
+            for (size_t i = 0; i < claims_len; ++i) {
+                if (strcmp(claims[i].key, "sub") == 0) {
+                    claim_ptr = claims[i].value;
+                }
+            }
 
-                int decode_result = l8w8jwt_decode(&params, &validation_result, &claims, &claims_len);
-                printf("decode_result=%d, validation_result=%d, claims_len=%zu\n", decode_result, validation_result, claims_len);
-                printf("KREK CRNI\n");
+        }
+        else {
+            const char* error_response = "Bad token";
+            struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+                (void*)error_response, MHD_RESPMEM_PERSISTENT);
+            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+            MHD_destroy_response(response);
+            return ret;
+        }
 
-                const char *claim_ptr;
-                if (decode_result == L8W8JWT_SUCCESS && validation_result == L8W8JWT_VALID) {
+        project.moderator[0] = '\0';
+        snprintf(project.moderator, sizeof(project.moderator), "%s", claim_ptr);
 
-                    for (size_t i = 0; i < claims_len; ++i) {
-                        if (strcmp(claims[i].key, "sub") == 0) {
-                            claim_ptr = claims[i].value;
-                        }
-                    }
+        if (addproject(&project) == 0) {
+            response_cache_invalidate(NULL);
+            cJSON* response_json = cJSON_CreateObject();
+            cJSON_AddStringToObject(response_json, "moderator", project.moderator);
+            cJSON_AddStringToObject(response_json, "project", project.project);
 
-                }
-                else {
-                    const char* error_response = "Bad token";
-                    struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                        (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                    int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                    MHD_destroy_response(response);
-                    return ret;
-                }
+            cJSON* members_array = cJSON_CreateArray();
+            for (int i = 0; project.members[i][0] != '\0' && i < 50; i++) {
+                cJSON_AddItemToArray(members_array, cJSON_CreateString(project.members[i]));
+            }
+            cJSON_AddItemToObject(response_json, "members", members_array);
 
-                project.moderator[0] = '\0';
-                snprintf(project.moderator, sizeof(project.moderator), "%s", claim_ptr);
-                fprintf(stderr, "niger: %s\n", project.moderator);
+            char* response_str = cJSON_PrintUnformatted(response_json);
 
-                if (addproject(&project) == 0) {
-                    cJSON* response_json = cJSON_CreateObject();
-                    cJSON_AddStringToObject(response_json, "moderator", project.moderator);
-                    cJSON_AddStringToObject(response_json, "project", project.project);
+            struct MHD_Response* response = create_request_response(response_str);
 
-                    cJSON* members_array = cJSON_CreateArray();
-                    for (int i = 0; project.members[i][0] != '\0' && i < 50; i++) {
-                        cJSON_AddItemToArray(members_array, cJSON_CreateString(project.members[i]));
-                    }
-                    cJSON_AddItemToObject(response_json, "members", members_array);
+            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+            MHD_add_response_header(response, "Content-Type", "application/json");
 
-                    char* response_str = cJSON_PrintUnformatted(response_json);
+            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+            MHD_destroy_response(response);
+            cJSON_Delete(response_json);
+            return ret;
+        }
+    }
+    else {
+        const char* error_response = "Invalid project data";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+            (void*)error_response, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+    }
 
-                    struct MHD_Response* response = MHD_create_response_from_buffer(
-                        strlen(response_str),
-                        (void*)response_str,
-                        MHD_RESPMEM_MUST_FREE
-                    );
+    return MHD_YES;
+}
 
-                    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                    MHD_add_response_header(response, "Content-Type", "application/json");
+// Handle GET request for projects
+static int handle_get_projects(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    LOG_DEBUG("Handling GET request for /projects");
+    
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to read projects
+    if (check_permission(&auth, PERM_READ_PROJECTS) != 0) {
+        return send_forbidden_response(connection, "Cannot access projects");
+    }
 
-                    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-                    MHD_destroy_response(response);
-                    cJSON_Delete(response_json);
-                    return ret;
-                }
-            }
-            else {
-                const char* error_response = "Invalid project data";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-            }
+    char cache_key[RESPONSE_CACHE_KEY_SIZE];
+    snprintf(cache_key, sizeof(cache_key), "projects|%s|%s", auth.user_id, auth.role);
+    uint64_t version = response_cache_version(NULL);
+    unsigned int status;
+    struct MHD_Response* response = response_cache_lookup(connection, cache_key, version, &status);
+    if (response) {
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, status, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-            cJSON_Delete(json);
-            free(conn_info->json_data);
-            free(conn_info);
-            *con_cls = NULL;
-            return MHD_YES;
-        }
+    // Get projects based on user role and ID
+    char* response_data = get_projects_by_user_role(auth.user_id, auth.role);
+    if (response_data == NULL) {
+        const char* error_response = "Error fetching projects from database";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "text/plain");
+        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        MHD_destroy_response(response);
+        return ret;
     }
 
-    // Handle GET request for projects
-    if (strcmp(url, "/projects") == 0 && strcmp(method, "GET") == 0) {
-        printf("Handling GET request for /projects\n");
-        
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // Check permission to read projects
-        if (check_permission(&auth, PERM_READ_PROJECTS) != 0) {
-            return send_forbidden_response(connection, "Cannot access projects");
-        }
+    LOG_DEBUG("Raw response data: %s", response_data);
+    LOG_DEBUG("Response length: %zu", strlen(response_data));
 
-        // Get projects based on user role and ID
-        char* response_data = get_projects_by_user_role(auth.user_id, auth.role);
-        if (response_data == NULL) {
-            const char* error_response = "Error fetching projects from database";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "text/plain");
-            int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    response = response_cache_store(connection, cache_key, version, response_data, &status);
+
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
 
-        printf("Raw response data: %s\n", response_data);
-        printf("Response length: %zu\n", strlen(response_data));
+    int ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
 
+// Handle GET request for a single project
+static int handle_get_project(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    LOG_DEBUG("Handling GET request for single project");
+    
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to read projects
+    if (check_permission(&auth, PERM_READ_PROJECTS) != 0) {
+        return send_forbidden_response(connection, "Cannot access project");
+    }
+
+    const char* project_id = route_param(params, "project_id");
+
+    LOG_DEBUG("Attempting to fetch project with ID: %s", project_id);
+
+    if (strlen(project_id) != 24) {
+        const char* error_response = "{\"error\": \"Invalid project ID format\"}";
         struct MHD_Response* response = MHD_create_response_from_buffer(
-            strlen(response_data),
-            (void*)response_data,
-            MHD_RESPMEM_MUST_FREE
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
         );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
+    // Entries are per user, so a hit also stands in for the access check
+    char cache_key[RESPONSE_CACHE_KEY_SIZE];
+    snprintf(cache_key, sizeof(cache_key), "project|%s|%s|%s", project_id, auth.user_id, auth.role);
+    uint64_t version = response_cache_version(project_id);
+    unsigned int status;
+    struct MHD_Response* response = response_cache_lookup(connection, cache_key, version, &status);
+    if (response) {
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
         MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, status, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    // Check if user has access to this specific project
+    if (check_user_project_access(auth.user_id, auth.role, project_id) != 0) {
+        const char* error_response = "{\"error\": \"Access denied to this project\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_FORBIDDEN, response);
         MHD_destroy_response(response);
         return ret;
     }
-    // In your answer_to_connection function, update the single project handler:
-    if (strncmp(url, "/projects/", 10) == 0 && strcmp(method, "GET") == 0) {
-        printf("Handling GET request for single project\n");
-        
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // Check permission to read projects
-        if (check_permission(&auth, PERM_READ_PROJECTS) != 0) {
-            return send_forbidden_response(connection, "Cannot access project");
-        }
 
-        const char* project_id = url + 10;
-        while (*project_id == '/') {
-            project_id++;
-        }
+    char* project_data = get_project_by_id(project_id);
+    if (project_data == NULL) {
+        const char* error_response = "{\"error\": \"Project not found\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_NOT_FOUND, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-        printf("Attempting to fetch project with ID: %s\n", project_id);
+    response = response_cache_store(connection, cache_key, version, project_data, &status);
 
-        if (strlen(project_id) != 24) {
-            const char* error_response = "{\"error\": \"Invalid project ID format\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    if (response == NULL) {
+        request_free(project_data);
+        return MHD_NO;
+    }
 
-        // Check if user has access to this specific project
-        if (check_user_project_access(auth.user_id, auth.role, project_id) != 0) {
-            const char* error_response = "{\"error\": \"Access denied to this project\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_FORBIDDEN, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
 
-        char* project_data = get_project_by_id(project_id);
-        if (project_data == NULL) {
-            const char* error_response = "{\"error\": \"Project not found\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_NOT_FOUND, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    int ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Task counts for drawing a board without fetching every task
+static int handle_get_project_summary(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+
+    if (check_permission(&auth, PERM_READ_PROJECTS) != 0) {
+        return send_forbidden_response(connection, "Cannot access project");
+    }
+
+    const char* project_id = route_param(params, "project_id");
+    LOG_DEBUG("Fetching summary for project %s", project_id);
 
-        size_t response_len = strlen(project_data);
+    if (strlen(project_id) != 24) {
+        const char* error_response = "{\"error\": \"Invalid project ID format\"}";
         struct MHD_Response* response = MHD_create_response_from_buffer(
-            response_len,
-            (void*)project_data,
-            MHD_RESPMEM_MUST_FREE
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
         );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-        if (response == NULL) {
-            free(project_data);
-            return MHD_NO;
-        }
+    // Task writes reach this cache through the tasks change stream
+    char cache_key[RESPONSE_CACHE_KEY_SIZE];
+    snprintf(cache_key, sizeof(cache_key), "summary|%s|%s|%s", project_id, auth.user_id, auth.role);
+    uint64_t version = response_cache_version(project_id);
+    unsigned int status;
+    struct MHD_Response* response = response_cache_lookup(connection, cache_key, version, &status);
+    if (response) {
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, status, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
+    if (check_user_project_access(auth.user_id, auth.role, project_id) != 0) {
+        const char* error_response = "{\"error\": \"Access denied to this project\"}";
+        response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
         MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_FORBIDDEN, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    char* summary = get_project_summary(project_id);
+    if (summary == NULL) {
+        const char* error_response = "{\"error\": \"Failed to summarize project\"}";
+        response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
         MHD_destroy_response(response);
         return ret;
     }
 
-    // In the PATCH handler
-    if (strncmp(url, "/updateproject/", 14) == 0 && strcmp(method, "PATCH") == 0) {
-        printf("Handling PATCH request for project update\n");
-        printf("URL: %s\n", url);
-        
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // Check permission to update projects (only MANAGER allowed)
-        if (check_permission(&auth, PERM_UPDATE_PROJECTS) != 0) {
-            return send_forbidden_response(connection, "Only managers can update projects");
-        }
+    response = response_cache_store(connection, cache_key, version, summary, &status);
+    if (response == NULL) {
+        request_free(summary);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    int ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
 
-        // Skip the "/updateproject/" prefix and any leading slash
-        const char* project_id = url + 14;
-        while (*project_id == '/') {
-            project_id++;
-        }
+#define BATCH_MAX_PROJECTS 100
 
-        printf("Project ID after cleanup: %s\n", project_id);
+// Fetch several projects in one query for the dashboard
+static int handle_get_projects_batch(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    LOG_DEBUG("Handling POST request for /projects/batch");
 
-        if (strlen(project_id) != 24) {
-            printf("Invalid project ID length: %zu\n", strlen(project_id));
-            const char* error_response = "Invalid project ID length";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
 
-        if (*con_cls == NULL) {
-            struct ConnectionInfo* conn_info = calloc(1, sizeof(struct ConnectionInfo));
-            if (conn_info == NULL) {
-                printf("Failed to allocate connection info\n");
-                return MHD_NO;
-            }
-            *con_cls = (void*)conn_info;
-            return MHD_YES;
-        }
+    // Check permission to read projects
+    if (check_permission(&auth, PERM_READ_PROJECTS) != 0) {
+        return send_forbidden_response(connection, "Cannot access projects");
+    }
 
-        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
+    const char* error_response = NULL;
+    cJSON* json = request_body_json(conn_info);
+    cJSON* ids_json = json ? cJSON_GetObjectItem(json, "ids") : NULL;
+    int count = cJSON_IsArray(ids_json) ? cJSON_GetArraySize(ids_json) : 0;
+    const char** ids = NULL;
 
-        if (*upload_data_size > 0) {
-            printf("Receiving data chunk of size: %zu\n", *upload_data_size);
-            conn_info->json_data = realloc(conn_info->json_data,
-                conn_info->json_size + *upload_data_size + 1);
-            if (conn_info->json_data == NULL) {
-                printf("Failed to allocate memory for JSON data\n");
-                return MHD_NO;
+    if (json == NULL) {
+        error_response = "{\"error\": \"Invalid JSON format\"}";
+    }
+    else if (count == 0 || count > BATCH_MAX_PROJECTS) {
+        error_response = "{\"error\": \"ids must hold 1 to 100 project IDs\"}";
+    }
+    else {
+        ids = request_malloc(count * sizeof(char*));
+        int i = 0;
+        cJSON* id;
+        cJSON_ArrayForEach(id, ids_json) {
+            if (!cJSON_IsString(id) || strlen(id->valuestring) != 24 || !bson_oid_is_valid(id->valuestring, 24)) {
+                error_response = "{\"error\": \"Invalid project ID format\"}";
+                break;
             }
-            memcpy(conn_info->json_data + conn_info->json_size, upload_data, *upload_data_size);
-            conn_info->json_size += *upload_data_size;
-            conn_info->json_data[conn_info->json_size] = '\0';
-            *upload_data_size = 0;
-            return MHD_YES;
+            ids[i++] = id->valuestring;
         }
+    }
 
-        if (conn_info->json_data == NULL) {
-            printf("No JSON data received\n");
-            const char* error_response = "No data received";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            free(conn_info->json_data);
-            free(conn_info);
-            *con_cls = NULL;
-            return ret;
-        }
+    if (error_response) {
+        cJSON_Delete(json);
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-        printf("Received JSON data: %s\n", conn_info->json_data);
+    char* projects = get_projects_by_ids(ids, count, auth.user_id, auth.role);
+    cJSON_Delete(json);
+    if (projects == NULL) {
+        const char* error_response = "{\"error\": \"Error fetching projects from database\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
+    struct MHD_Response* response = create_request_response(projects);
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
+}
 
-        if (*upload_data_size > 0) {
-            conn_info->json_data = realloc(conn_info->json_data,
-                conn_info->json_size + *upload_data_size + 1);
-            memcpy(conn_info->json_data + conn_info->json_size, upload_data, *upload_data_size);
-            conn_info->json_size += *upload_data_size;
-            conn_info->json_data[conn_info->json_size] = '\0';
-            *upload_data_size = 0;
-            return MHD_YES;
-        }
+// Handle PATCH request for project update
+static int handle_update_project(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    LOG_DEBUG("Handling PATCH request for project update");
+    
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to update projects (only MANAGER allowed)
+    if (check_permission(&auth, PERM_UPDATE_PROJECTS) != 0) {
+        return send_forbidden_response(connection, "Only managers can update projects");
+    }
 
-        cJSON* json = cJSON_Parse(conn_info->json_data);
-        if (json == NULL) {
-            const char* error_response = "Invalid JSON format";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    const char* project_id = route_param(params, "project_id");
 
-        cJSON* members = cJSON_GetObjectItem(json, "members");
-        if (!members || !cJSON_IsArray(members)) {
-            const char* error_response = "Invalid members array";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
-        }
+    LOG_DEBUG("Project ID after cleanup: %s", project_id);
 
-        // Get current project to compare members
-        char* current_project_json = get_project_by_id(project_id);
-        if (current_project_json == NULL) {
-            const char* error_response = "{\"status\":\"error\",\"message\":\"Project not found\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_NOT_FOUND, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
-        }
+    if (strlen(project_id) != 24) {
+        LOG_WARN("Invalid project ID length: %zu", strlen(project_id));
+        const char* error_response = "Invalid project ID length";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-        cJSON* current_project = cJSON_Parse(current_project_json);
-        if (current_project == NULL) {
-            const char* error_response = "{\"status\":\"error\",\"message\":\"Failed to parse current project\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            free(current_project_json);
-            return ret;
-        }
+    if (conn_info->json_size == 0) {
+        LOG_DEBUG("No JSON data received");
+        const char* error_response = "No data received";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-        // Get current members
-        cJSON* current_members = cJSON_GetObjectItem(current_project, "members");
-        if (!current_members || !cJSON_IsArray(current_members)) {
-            const char* error_response = "{\"status\":\"error\",\"message\":\"Invalid current project members\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            cJSON_Delete(current_project);
-            free(current_project_json);
-            return ret;
-        }
+    LOG_DEBUG("Received %zu bytes of JSON data", conn_info->json_size);
 
-        // Prepare new member list
-        int new_member_count = cJSON_GetArraySize(members);
-        const char** new_member_strings = malloc(new_member_count * sizeof(char*));
-        for (int i = 0; i < new_member_count; i++) {
-            cJSON* member = cJSON_GetArrayItem(members, i);
-            new_member_strings[i] = member->valuestring;
-        }
 
-        // Find removed members by comparing current vs new member lists
-        int current_member_count = cJSON_GetArraySize(current_members);
-        const char** removed_members = malloc(current_member_count * sizeof(char*));
-        int removed_count = 0;
+    cJSON* json = request_body_json(conn_info);
+    if (json == NULL) {
+        const char* error_response = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-        for (int i = 0; i < current_member_count; i++) {
-            cJSON* current_member = cJSON_GetArrayItem(current_members, i);
-            if (!cJSON_IsString(current_member)) continue;
-            
-            const char* current_username = current_member->valuestring;
-            bool found_in_new = false;
-            
-            // Check if this current member is still in the new member list
-            for (int j = 0; j < new_member_count; j++) {
-                if (strcmp(current_username, new_member_strings[j]) == 0) {
-                    found_in_new = true;
-                    break;
-                }
-            }
-            
-            // If not found in new list, this member is being removed
-            if (!found_in_new) {
-                removed_members[removed_count] = current_username;
-                removed_count++;
-                printf("Member being removed: %s\n", current_username);
-            }
-        }
+    cJSON* members = cJSON_GetObjectItem(json, "members");
+    if (!members || !cJSON_IsArray(members)) {
+        const char* error_response = "Invalid members array";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
 
-        // Check if any removed members have unfinished tasks
-        if (removed_count > 0) {
-            printf("Checking %d removed members for unfinished tasks...\n", removed_count);
-            int has_unfinished = check_members_unfinished_tasks(project_id, removed_members, removed_count);
-            
-            if (has_unfinished) {
-                const char* error_response = "{\"status\":\"error\",\"message\":\"Cannot remove members who have unfinished tasks\"}";
-                struct MHD_Response* response = MHD_create_response_from_buffer(
-                    strlen(error_response),
-                    (void*)error_response,
-                    MHD_RESPMEM_PERSISTENT
-                );
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                MHD_add_response_header(response, "Content-Type", "application/json");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                
-                // Cleanup
-                free(new_member_strings);
-                free(removed_members);
-                cJSON_Delete(json);
-                cJSON_Delete(current_project);
-                free(current_project_json);
-                return ret;
-            }
-        }
+    // Get current project to compare members
+    char* current_project_json = get_project_by_id(project_id);
+    if (current_project_json == NULL) {
+        const char* error_response = "{\"status\":\"error\",\"message\":\"Project not found\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_NOT_FOUND, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
 
-        // Proceed with the update if validation passed
-        int update_result = update_project_members(project_id, new_member_strings, new_member_count);
-        
-        // Cleanup
-        free(new_member_strings);
-        free(removed_members);
-        cJSON_Delete(current_project);
-        free(current_project_json);
+    cJSON* current_project = cJSON_Parse(current_project_json);
+    if (current_project == NULL) {
+        const char* error_response = "{\"status\":\"error\",\"message\":\"Failed to parse current project\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        MHD_destroy_response(response);
         cJSON_Delete(json);
+        request_free(current_project_json);
+        return ret;
+    }
 
-        if (update_result == 0) {
-            const char* success_response = "{\"status\":\"success\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(success_response),
-                (void*)success_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
-        else {
-            const char* error_response = "{\"status\":\"error\",\"message\":\"Failed to update project\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    // Get current members
+    cJSON* current_members = cJSON_GetObjectItem(current_project, "members");
+    if (!current_members || !cJSON_IsArray(current_members)) {
+        const char* error_response = "{\"status\":\"error\",\"message\":\"Invalid current project members\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        cJSON_Delete(current_project);
+        request_free(current_project_json);
+        return ret;
     }
 
-    // Handle DELETE request for project deletion
-    if (strncmp(url, "/deleteproject/", 14) == 0 && strcmp(method, "DELETE") == 0) {
-        printf("Handling DELETE request for project deletion\n");
-        printf("URL: %s\n", url);
+    // Prepare new member list
+    int new_member_count = cJSON_GetArraySize(members);
+    const char** new_member_strings = request_malloc(new_member_count * sizeof(char*));
+    for (int i = 0; i < new_member_count; i++) {
+        cJSON* member = cJSON_GetArrayItem(members, i);
+        new_member_strings[i] = member->valuestring;
+    }
+
+    // Find removed members by comparing current vs new member lists
+    int current_member_count = cJSON_GetArraySize(current_members);
+    const char** removed_members = request_malloc(current_member_count * sizeof(char*));
+    int removed_count = 0;
+
+    for (int i = 0; i < current_member_count; i++) {
+        cJSON* current_member = cJSON_GetArrayItem(current_members, i);
+        if (!cJSON_IsString(current_member)) continue;
         
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
+        const char* current_username = current_member->valuestring;
+        bool found_in_new = false;
         
-        // Check permission to delete projects (only MANAGER allowed)
-        if (check_permission(&auth, PERM_DELETE_PROJECTS) != 0) {
-            return send_forbidden_response(connection, "Only managers can delete projects");
+        // Check if this current member is still in the new member list
+        for (int j = 0; j < new_member_count; j++) {
+            if (strcmp(current_username, new_member_strings[j]) == 0) {
+                found_in_new = true;
+                break;
+            }
         }
-
-        // Skip the "/deleteproject/" prefix and any leading slash
-        const char* project_id = url + 14;
-        while (*project_id == '/') {
-            project_id++;
+        
+        // If not found in new list, this member is being removed
+        if (!found_in_new) {
+            removed_members[removed_count] = current_username;
+            removed_count++;
+            LOG_DEBUG("Member being removed: %s", current_username);
         }
+    }
 
-        printf("Project ID to delete: %s\n", project_id);
-
-        if (strlen(project_id) != 24) {
-            printf("Invalid project ID length: %zu\n", strlen(project_id));
-            const char* error_response = "{\"status\":\"error\",\"message\":\"Invalid project ID length\"}";
+    // Check if any removed members have unfinished tasks
+    if (removed_count > 0) {
+        LOG_DEBUG("Checking %d removed members for unfinished tasks...", removed_count);
+        int has_unfinished = check_members_unfinished_tasks(project_id, removed_members, removed_count);
+        
+        if (has_unfinished) {
+            const char* error_response = "{\"status\":\"error\",\"message\":\"Cannot remove members who have unfinished tasks\"}";
             struct MHD_Response* response = MHD_create_response_from_buffer(
                 strlen(error_response),
                 (void*)error_response,
@@ -641,43 +681,164 @@ int answer_to_connection(void* cls, struct MHD_Connection* connection,
             MHD_add_response_header(response, "Content-Type", "application/json");
             int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
             MHD_destroy_response(response);
+            
+            // Cleanup
+            request_free(new_member_strings);
+            request_free(removed_members);
+            cJSON_Delete(json);
+            cJSON_Delete(current_project);
+            request_free(current_project_json);
             return ret;
         }
+    }
 
-        // Verify user has access to this specific project
-        if (check_user_project_access(auth.user_id, auth.role, project_id) != 0) {
-            return send_forbidden_response(connection, "Access denied to this project");
-        }
+    // Proceed with the update if validation passed
+    int update_result = update_project_members(project_id, new_member_strings, new_member_count);
+    if (update_result == 0) {
+        response_cache_invalidate(project_id);
+    }
+    
+    // Cleanup
+    request_free(new_member_strings);
+    request_free(removed_members);
+    cJSON_Delete(current_project);
+    request_free(current_project_json);
+    cJSON_Delete(json);
+
+    if (update_result == 0) {
+        const char* success_response = "{\"status\":\"success\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(success_response),
+            (void*)success_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+    else {
+        const char* error_response = "{\"status\":\"error\",\"message\":\"Failed to update project\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+}
 
-        // Attempt to delete the project (includes task completion validation)
-        int delete_result = delete_project(project_id);
-        
-        if (delete_result == 0) {
-            const char* success_response = "{\"status\":\"success\",\"message\":\"Project deleted successfully\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(success_response),
-                (void*)success_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
-        else {
-            const char* error_response = "{\"status\":\"error\",\"message\":\"Cannot delete project - it has unfinished tasks or an error occurred\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+// Handle DELETE request for project deletion
+static int handle_delete_project(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    LOG_DEBUG("Handling DELETE request for project deletion");
+    
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to delete projects (only MANAGER allowed)
+    if (check_permission(&auth, PERM_DELETE_PROJECTS) != 0) {
+        return send_forbidden_response(connection, "Only managers can delete projects");
+    }
+
+    const char* project_id = route_param(params, "project_id");
+
+    LOG_DEBUG("Project ID to delete: %s", project_id);
+
+    if (strlen(project_id) != 24) {
+        LOG_WARN("Invalid project ID length: %zu", strlen(project_id));
+        const char* error_response = "{\"status\":\"error\",\"message\":\"Invalid project ID length\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+
+    // Verify user has access to this specific project
+    if (check_user_project_access(auth.user_id, auth.role, project_id) != 0) {
+        return send_forbidden_response(connection, "Access denied to this project");
+    }
+
+    // Attempt to delete the project (includes task completion validation)
+    int delete_result = delete_project(project_id);
+    
+    if (delete_result == 0) {
+        response_cache_invalidate(project_id);
+        const char* success_response = "{\"status\":\"success\",\"message\":\"Project deleted successfully\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(success_response),
+            (void*)success_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+    else {
+        const char* error_response = "{\"status\":\"error\",\"message\":\"Cannot delete project - it has unfinished tasks or an error occurred\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+}
+
+static const Route routes[] = {
+    { ROUTE_GET, "/metrics", handle_metrics },
+    { ROUTE_POST, "/newproject", handle_create_project },
+    { ROUTE_GET, "/projects", handle_get_projects },
+    { ROUTE_GET, "/projects/{project_id}", handle_get_project },
+    { ROUTE_GET, "/projects/{project_id}/summary", handle_get_project_summary },
+    { ROUTE_POST, "/projects/batch", handle_get_projects_batch },
+    { ROUTE_PATCH, "/updateproject/{project_id}", handle_update_project },
+    { ROUTE_DELETE, "/deleteproject/{project_id}", handle_delete_project },
+};
+
+static Router router;
+
+static int route_request(void* cls, struct MHD_Connection* connection,
+    const char* url, const char* method, const char* version,
+    const char* upload_data, size_t* upload_data_size, void** con_cls) {
+
+    if (strcmp(method, "OPTIONS") == 0) {
+        struct MHD_Response* response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Access-Control-Allow-Methods", "GET, POST, PATCH, DELETE, OPTIONS");
+        MHD_add_response_header(response, "Access-Control-Allow-Headers", "Content-Type, Accept, Authorization");
+        MHD_add_response_header(response, "Access-Control-Max-Age", "86400");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+
+    RouteParams params;
+    const Route* route = router_match(&router, method, url, &params);
+    if (route != NULL) {
+        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
+        conn_info->route_series = metrics_route_series(method, route->pattern);
+        return route->handler(connection, conn_info, &params);
     }
 
     // Handle 404 for unmatched routes
@@ -690,33 +851,68 @@ int answer_to_connection(void* cls, struct MHD_Connection* connection,
     return ret;
 }
 
+static enum MHD_Result answer_to_connection(void* cls, struct MHD_Connection* connection,
+    const char* url, const char* method, const char* version,
+    const char* upload_data, size_t* upload_data_size, void** con_cls) {
+
+    struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
+
+    if (conn_info == NULL) {
+        return request_begin(connection, url, method, con_cls);
+    }
+    if (*upload_data_size > 0 || conn_info->rejected) {
+        return request_append(connection, conn_info, upload_data, upload_data_size);
+    }
+
+    arena_activate(conn_info->arena);
+    enum MHD_Result ret = route_request(cls, connection, url, method, version, upload_data, upload_data_size, con_cls);
+    arena_activate(NULL);
+    return ret;
+}
+
 int main() {
+    log_init("project-service");
 
     const char *var_name = "HMAC_KEY";
     char *hmac_key = getenv(var_name);
     if (!hmac_key) {
-        fprintf(stderr, "Cannot find HMAC key\n");
+        LOG_ERROR("Cannot find HMAC key");
         return 1;
     }
 
-    struct MHD_Daemon* daemon;
+    Listeners listeners;
 
     char* port_env = getenv("PORT");
     int port = port_env ? atoi(port_env) : PORT;
 
-    daemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY, port, NULL, NULL,
-        &answer_to_connection, NULL, MHD_OPTION_END);
+    request_init();
+    response_cache_init();
+    compression_init();
 
-    if (NULL == daemon) {
-        printf("Failed to start server\n");
+    if (router_init(&router, routes, sizeof(routes) / sizeof(routes[0])) != 0) {
+        LOG_ERROR("Failed to build route table");
         return 1;
     }
 
-    printf("Server running on port %d\n", port);
+    if (listeners_start(&listeners, MHD_USE_SELECT_INTERNALLY, port,
+        &answer_to_connection, &request_completed) != 0) {
+        LOG_ERROR("Failed to start server");
+        return 1;
+    }
     repo();
 
+    if (cache_watcher_start("trello", "projects", NULL, NULL) != 0) {
+        LOG_WARN("Failed to start change stream watcher");
+    }
+
+    // Summaries are computed from tasks, which the task service writes
+    if (cache_watcher_start("tasks", "tasks", "project_id", NULL) != 0) {
+        LOG_WARN("Failed to start task change stream watcher");
+    }
+
     pause();
 
-    MHD_stop_daemon(daemon);
+    listeners_stop(&listeners);
+    log_shutdown();
     return 0;
 }
\ No newline at end of file
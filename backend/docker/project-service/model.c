@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <cjson/cJSON.h>
+#include "logger.h"
 
 int parse_project_from_json(const cJSON* json, Project* project) {
     // Clear the entire structure first
@@ -16,15 +17,15 @@ int parse_project_from_json(const cJSON* json, Project* project) {
     cJSON* max_members = cJSON_GetObjectItem(json, "max_members");
 
     // Debug print the received values
-    printf("Received JSON:\n");
-    printf("Moderator: %s (length: %zu)\n", moderator ? moderator->valuestring : "NULL",
+    LOG_DEBUG("Received JSON:");
+    LOG_DEBUG("Moderator: %s (length: %zu)", moderator ? moderator->valuestring : "NULL",
         moderator ? strlen(moderator->valuestring) : 0);
-    printf("Project: %s (length: %zu)\n", project_name ? project_name->valuestring : "NULL",
+    LOG_DEBUG("Project: %s (length: %zu)", project_name ? project_name->valuestring : "NULL",
         project_name ? strlen(project_name->valuestring) : 0);
-    printf("Completion Date: %s (length: %zu)\n", completion_date ? completion_date->valuestring : "NULL",
+    LOG_DEBUG("Completion Date: %s (length: %zu)", completion_date ? completion_date->valuestring : "NULL",
         completion_date ? strlen(completion_date->valuestring) : 0);
-    printf("Min Members: %d\n", min_members ? min_members->valueint : -1);
-    printf("Max Members: %d\n", max_members ? max_members->valueint : -1);
+    LOG_DEBUG("Min Members: %d", min_members ? min_members->valueint : -1);
+    LOG_DEBUG("Max Members: %d", max_members ? max_members->valueint : -1);
 
     // Validate required fields
     if (!moderator || !project_name || !members || !completion_date ||
@@ -32,30 +33,30 @@ int parse_project_from_json(const cJSON* json, Project* project) {
         !cJSON_IsString(moderator) || !cJSON_IsString(project_name) ||
         !cJSON_IsArray(members) || !cJSON_IsString(completion_date) ||
         !cJSON_IsNumber(min_members) || !cJSON_IsNumber(max_members)) {
-        printf("Missing or invalid required fields\n");
-        if (!moderator) printf("moderator is NULL\n");
-        if (!project_name) printf("project_name is NULL\n");
-        if (!members) printf("members is NULL\n");
-        if (!completion_date) printf("completion_date is NULL\n");
-        if (!min_members) printf("min_members is NULL\n");
-        if (!max_members) printf("max_members is NULL\n");
+        LOG_WARN("Missing or invalid required fields");
+        if (!moderator) LOG_DEBUG("moderator is NULL");
+        if (!project_name) LOG_DEBUG("project_name is NULL");
+        if (!members) LOG_DEBUG("members is NULL");
+        if (!completion_date) LOG_DEBUG("completion_date is NULL");
+        if (!min_members) LOG_DEBUG("min_members is NULL");
+        if (!max_members) LOG_DEBUG("max_members is NULL");
         return 1;
     }
 
     // Validate string lengths with detailed output
     if (strlen(moderator->valuestring) >= MAX_STRING_LENGTH) {
-        printf("Moderator string too long: %zu chars (max: %d)\n",
+        LOG_WARN("Moderator string too long: %zu chars (max: %d)",
             strlen(moderator->valuestring), MAX_STRING_LENGTH);
         return 1;
     }
     if (strlen(project_name->valuestring) >= MAX_STRING_LENGTH) {
-        printf("Project name string too long: %zu chars (max: %d)\n",
+        LOG_WARN("Project name string too long: %zu chars (max: %d)",
             strlen(project_name->valuestring), MAX_STRING_LENGTH);
         return 1;
     }
     // Changed >= to > for date length check
     if (strlen(completion_date->valuestring) > MAX_DATE_LENGTH) {
-        printf("Completion date string too long: %zu chars (max: %d)\n",
+        LOG_WARN("Completion date string too long: %zu chars (max: %d)",
             strlen(completion_date->valuestring), MAX_DATE_LENGTH);
         return 1;
     }
@@ -66,7 +67,7 @@ int parse_project_from_json(const cJSON* json, Project* project) {
     int min = min_members->valueint;
     int max = max_members->valueint;
     if (min < 1 || max > MAX_MEMBERS || min > max) {
-        printf("Invalid member limits (min: %d, max: %d)\n", min, max);
+        LOG_WARN("Invalid member limits (min: %d, max: %d)", min, max);
         return 1;
     }
 
@@ -84,12 +85,12 @@ int parse_project_from_json(const cJSON* json, Project* project) {
     for (int i = 0; i < member_count && i < MAX_MEMBERS; i++) {
         cJSON* member = cJSON_GetArrayItem(members, i);
         if (!cJSON_IsString(member)) {
-            printf("Member %d is not a string\n", i);
+            LOG_DEBUG("Member %d is not a string", i);
             continue;
         }
 
         if (strlen(member->valuestring) >= MAX_STRING_LENGTH) {
-            printf("Member name too long at index %d\n", i);
+            LOG_WARN("Member name too long at index %d", i);
             continue;
         }
 
@@ -103,10 +104,131 @@ int parse_project_from_json(const cJSON* json, Project* project) {
 
     // Validate member count against limits
     if (project->current_member_count < project->min_members) {
-        printf("Not enough members (current: %d, minimum: %d)\n",
+        LOG_WARN("Not enough members (current: %d, minimum: %d)",
             project->current_member_count, project->min_members);
         return 1;
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+int parse_project_from_body(const char* body, size_t size, Project* project) {
+    memset(project, 0, sizeof(Project));
+
+    JsonReader reader;
+    json_reader_init(&reader, body, size);
+    if (json_reader_begin_object(&reader) != 0) {
+        return JSON_INVALID;
+    }
+
+    // Required fields that were present and of the right type
+    int has_moderator = 0, has_project = 0, has_date = 0, has_members = 0, has_min = 0, has_max = 0;
+    int too_long = 0;
+
+    const char* key;
+    size_t key_size;
+    int next;
+    while ((next = json_reader_next_key(&reader, &key, &key_size)) == 1) {
+        char* target = NULL;
+        size_t target_size = 0;
+        int* seen = NULL;
+        int* number = NULL;
+
+        if (JSON_KEY_IS(key, key_size, "moderator")) {
+            target = project->moderator; target_size = sizeof(project->moderator); seen = &has_moderator;
+        }
+        else if (JSON_KEY_IS(key, key_size, "project")) {
+            target = project->project; target_size = sizeof(project->project); seen = &has_project;
+        }
+        else if (JSON_KEY_IS(key, key_size, "estimated_completion_date")) {
+            target = project->estimated_completion_date; target_size = sizeof(project->estimated_completion_date); seen = &has_date;
+        }
+        else if (JSON_KEY_IS(key, key_size, "min_members")) {
+            number = &project->min_members; seen = &has_min;
+        }
+        else if (JSON_KEY_IS(key, key_size, "max_members")) {
+            number = &project->max_members; seen = &has_max;
+        }
+        else if (JSON_KEY_IS(key, key_size, "members") && json_reader_peek(&reader) == '[') {
+            has_members = 1;
+            json_reader_begin_array(&reader);
+            int item;
+            while ((item = json_reader_next_item(&reader)) == 1) {
+                if (project->current_member_count >= MAX_MEMBERS || json_reader_peek(&reader) != '"') {
+                    if (json_reader_skip(&reader) != 0) {
+                        return JSON_INVALID;
+                    }
+                    continue;
+                }
+                char* member = project->members[project->current_member_count];
+                int length = json_reader_string(&reader, member, MAX_STRING_LENGTH);
+                if (length < 0) {
+                    return JSON_INVALID;
+                }
+                if (length >= MAX_STRING_LENGTH || length == 0) {
+                    // Too long or empty, dropped like in parse_project_from_json
+                    member[0] = '\0';
+                    continue;
+                }
+                project->current_member_count++;
+            }
+            if (item != 0) {
+                return JSON_INVALID;
+            }
+            continue;
+        }
+
+        if (number) {
+            int result = json_reader_int(&reader, number);
+            if (result == JSON_INVALID) {
+                return JSON_INVALID;
+            }
+            if (result == 0) {
+                *seen = 1;
+                continue;
+            }
+        }
+        else if (target && json_reader_peek(&reader) == '"') {
+            int length = json_reader_string(&reader, target, target_size);
+            if (length < 0) {
+                return JSON_INVALID;
+            }
+            if ((size_t)length >= target_size) {
+                too_long = 1;
+            }
+            *seen = 1;
+            continue;
+        }
+
+        if (json_reader_skip(&reader) != 0) {
+            return JSON_INVALID;
+        }
+    }
+    if (next != 0 || json_reader_finish(&reader) != 0) {
+        return JSON_INVALID;
+    }
+
+    if (!has_moderator || !has_project || !has_date || !has_members || !has_min || !has_max) {
+        LOG_WARN("Missing or invalid required fields");
+        return 1;
+    }
+    if (too_long) {
+        LOG_WARN("Project field too long");
+        return 1;
+    }
+
+    // Validate member limits
+    if (project->min_members < 1 || project->max_members > MAX_MEMBERS || project->min_members > project->max_members) {
+        LOG_WARN("Invalid member limits (min: %d, max: %d)", project->min_members, project->max_members);
+        return 1;
+    }
+
+    // Validate member count against limits
+    if (project->current_member_count < project->min_members) {
+        LOG_WARN("Not enough members (current: %d, minimum: %d)",
+            project->current_member_count, project->min_members);
+        return 1;
+    }
+
+    return 0;
+}
@@ -2,6 +2,7 @@
 #define MODEL_H
 
 #include <cjson/cJSON.h>
+#include "json_reader.h"
 
 #define MAX_STRING_LENGTH 100  // Increased from 20 to 100
 #define MAX_MEMBERS 50
@@ -25,4 +26,8 @@ typedef struct {
 
 int parse_project_from_json(const cJSON* json, Project* project);
 
+// Same rules as parse_project_from_json, decoded from the raw body without a cJSON tree.
+// Returns JSON_INVALID when the body is not well-formed JSON.
+int parse_project_from_body(const char* body, size_t size, Project* project);
+
 #endif
\ No newline at end of file
@@ -4,61 +4,59 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <strings.h>
 #include "model.h"
 #include "repo.h"
+#include "arena.h"
+#include "logger.h"
+#include "metrics.h"
 
 typedef struct {
     mongoc_client_t* client;
     mongoc_collection_t* collection;
-    FILE* logger;
 } Repository;
 
-Repository* New(FILE* logger) {
+Repository* New(void) {
     
     const char *var_name = "DBURI";
     char *dburi = getenv(var_name);
-    printf("Bruhimic moram priznati\n");
 
     if (dburi == NULL) {
-        fprintf(logger, "Error: MONGO_DB_URI environment variable is not set\n");
+        LOG_ERROR("Error: MONGO_DB_URI environment variable is not set");
         return NULL;
     }
 
     // Create MongoDB client
     mongoc_client_t* client = mongoc_client_new(dburi);
     if (!client) {
-        fprintf(logger, "Error: Failed to create MongoDB client\n");
-        printf("Error: Failed to create MongoDB client\n");
+        LOG_ERROR("Error: Failed to create MongoDB client");
         mongoc_cleanup();
         return NULL;
     }
-    printf("MongoDB client created successfully.\n");
+    LOG_DEBUG("MongoDB client created successfully.");
 
     // Test connection
     bson_error_t error;
     if (!mongoc_client_get_server_status(client, NULL, NULL, &error)) {
-        fprintf(logger, "Error: Failed to connect to MongoDB: %s\n", error.message);
-        printf("Error: Failed to connect to MongoDB: %s\n", error.message);
+        LOG_ERROR("Error: Failed to connect to MongoDB: %s", error.message);
         mongoc_client_destroy(client);
         mongoc_cleanup();
         return NULL;
     }
-    printf("Connected to MongoDB server successfully.\n");
+    LOG_DEBUG("Connected to MongoDB server successfully.");
 
     // Allocate memory for the Repository struct
     Repository* repo = (Repository*)malloc(sizeof(Repository));
     if (repo == NULL) {
-        fprintf(logger, "Error: Failed to allocate memory for repository\n");
-        printf("Error: Failed to allocate memory for repository\n");
+        LOG_ERROR("Error: Failed to allocate memory for repository");
         mongoc_client_destroy(client);
         mongoc_cleanup();
         return NULL;
     }
-    printf("Repository struct allocated successfully.\n");
+    LOG_DEBUG("Repository struct allocated successfully.");
 
     // Set up the Repository struct fields
     repo->client = client;
-    repo->logger = logger;
 
     return repo;
 }
@@ -66,25 +64,20 @@ Repository* New(FILE* logger) {
 // Cleanup function to release resources
 void Cleanup(Repository* repo) {
     if (repo) {
-        printf("Cleaning up MongoDB client and repository...\n");
+        LOG_DEBUG("Cleaning up MongoDB client and repository...");
         mongoc_client_destroy(repo->client);
         free(repo);
-        printf("Cleanup completed.\n");
+        LOG_DEBUG("Cleanup completed.");
     }
 }
 
 int addproject(Project* project) {
-    printf("Adding project to MongoDB...\n");
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1;
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("Adding project to MongoDB...");
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        printf("Error initializing repository.\n");
-        fclose(log);
+        LOG_ERROR("Error initializing repository.");
         return 1;
     }
 
@@ -92,8 +85,7 @@ int addproject(Project* project) {
     const char* collection_name = "projects";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
     if (repo->collection == NULL) {
-        printf("Error: Could not get collection from database.\n");
-        fclose(log);
+        LOG_ERROR("Error: Could not get collection from database.");
         Cleanup(repo);
         return 1;
     }
@@ -123,35 +115,27 @@ int addproject(Project* project) {
 
     // Print the BSON document for debugging
     char* json_str = bson_as_json(doc, NULL);
-    printf("Document to be inserted: %s\n", json_str);
+    LOG_DEBUG("Document to be inserted: %s", json_str);
     bson_free(json_str);
 
     bson_error_t error;
     if (!mongoc_collection_insert_one(repo->collection, doc, NULL, NULL, &error)) {
-        fprintf(repo->logger, "Error: Insert failed: %s\n", error.message);
-        printf("Error: Insert failed: %s\n", error.message);
+        LOG_ERROR("Error: Insert failed: %s", error.message);
     }
     else {
-        fprintf(repo->logger, "Document inserted successfully.\n");
-        printf("Document inserted successfully.\n");
+        LOG_DEBUG("Document inserted successfully.");
     }
 
     bson_destroy(doc);
     Cleanup(repo);
-    fclose(log);
     return 0;
 }
 char* get_all_projects() {
-    printf("Fetching all projects from MongoDB...\n");
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return NULL;
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("Fetching all projects from MongoDB...");
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return NULL;
     }
 
@@ -160,8 +144,7 @@ char* get_all_projects() {
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
 
     if (repo->collection == NULL) {
-        printf("Error: Could not get collection from database.\n");
-        fclose(log);
+        LOG_ERROR("Error: Could not get collection from database.");
         Cleanup(repo);
         return NULL;
     }
@@ -173,9 +156,8 @@ char* get_all_projects() {
     cJSON* projects_array = cJSON_CreateArray();
 
     if (!projects_array) {
-        printf("Error: Failed to create JSON array\n");
+        LOG_ERROR("Error: Failed to create JSON array");
         bson_destroy(query);
-        fclose(log);
         Cleanup(repo);
         return NULL;
     }
@@ -185,15 +167,15 @@ char* get_all_projects() {
     while (mongoc_cursor_next(cursor, &doc)) {
         char* doc_str = bson_as_json(doc, NULL);
         if (!doc_str) {
-            printf("Error: Failed to convert BSON to JSON string\n");
+            LOG_ERROR("Error: Failed to convert BSON to JSON string");
             continue;
         }
 
-        printf("Raw document: %s\n", doc_str); // Debug print
+        LOG_DEBUG("Raw document: %s", doc_str); // Debug print
 
         cJSON* project_json = cJSON_Parse(doc_str);
         if (!project_json) {
-            printf("Error: Failed to parse document JSON\n");
+            LOG_ERROR("Error: Failed to parse document JSON");
             bson_free(doc_str);
             continue;
         }
@@ -204,22 +186,21 @@ char* get_all_projects() {
     }
 
     if (mongoc_cursor_error(cursor, &error)) {
-        printf("Cursor error: %s\n", error.message);
+        LOG_ERROR("Cursor error: %s", error.message);
         cJSON_Delete(projects_array);
         mongoc_cursor_destroy(cursor);
         bson_destroy(query);
         Cleanup(repo);
-        fclose(log);
         return NULL;
     }
 
     // Convert the final array to string
     char* result = cJSON_PrintUnformatted(projects_array);
     if (!result) {
-        printf("Error: Failed to convert final JSON to string\n");
+        LOG_ERROR("Error: Failed to convert final JSON to string");
     }
     else {
-        printf("Final JSON result: %s\n", result); // Debug print
+        LOG_DEBUG("Final JSON result: %s", result); // Debug print
     }
 
     // Cleanup
@@ -227,23 +208,16 @@ char* get_all_projects() {
     mongoc_cursor_destroy(cursor);
     bson_destroy(query);
     Cleanup(repo);
-    fclose(log);
 
     return result;
 }
 char* get_project_by_id(const char* project_id) {
-    printf("Fetching project by ID from MongoDB...\n");
-    printf("Project ID received: %s\n", project_id);
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("Fetching project by ID from MongoDB...");
+    LOG_DEBUG("Project ID received: %s", project_id);
 
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return NULL;
-    }
-
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return NULL;
     }
 
@@ -252,8 +226,7 @@ char* get_project_by_id(const char* project_id) {
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
 
     if (repo->collection == NULL) {
-        printf("Error: Could not get collection from database.\n");
-        fclose(log);
+        LOG_ERROR("Error: Could not get collection from database.");
         Cleanup(repo);
         return NULL;
     }
@@ -263,10 +236,9 @@ char* get_project_by_id(const char* project_id) {
     bson_error_t error;
 
     if (!bson_oid_is_valid(project_id, strlen(project_id))) {
-        printf("Error: Invalid ObjectId format: %s\n", project_id);
+        LOG_WARN("Error: Invalid ObjectId format: %s", project_id);
         bson_destroy(query);
         Cleanup(repo);
-        fclose(log);
         return NULL;
     }
 
@@ -280,13 +252,13 @@ char* get_project_by_id(const char* project_id) {
     if (mongoc_cursor_next(cursor, &doc)) {
         char* temp = bson_as_json(doc, NULL);
         if (temp) {
-            result = strdup(temp);  // Create a copy of the JSON string
+            result = request_strdup(temp);  // Copy into the request arena
             bson_free(temp);
-            printf("Found project: %s\n", result);
+            LOG_DEBUG("Found project: %s", result);
         }
     }
     else {
-        printf("No project found with ID: %s\n", project_id);
+        LOG_DEBUG("No project found with ID: %s", project_id);
     }
 
     // Cleanup
@@ -294,21 +266,141 @@ char* get_project_by_id(const char* project_id) {
     mongoc_collection_destroy(repo->collection);
     bson_destroy(query);
     Cleanup(repo);
-    fclose(log);
 
     return result;
 }
-int update_project_members(const char* project_id, const char** members, int member_count) {
-    printf("Updating project members in MongoDB...\n");
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1;
+char* get_projects_by_ids(const char** project_ids, int count, const char* user_id, const char* role) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("Fetching %d projects by ID from MongoDB...", count);
+
+    Repository* repo = New();
+    if (repo == NULL) {
+        return NULL;
+    }
+
+    const char* db_name = "trello";
+    const char* collection_name = "projects";
+    repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
+
+    bson_t* query = bson_new();
+    bson_t id_filter;
+    bson_t ids;
+    BSON_APPEND_DOCUMENT_BEGIN(query, "_id", &id_filter);
+    BSON_APPEND_ARRAY_BEGIN(&id_filter, "$in", &ids);
+    for (int i = 0; i < count; i++) {
+        bson_oid_t oid;
+        char str_idx[16];
+        snprintf(str_idx, sizeof(str_idx), "%d", i);
+        bson_oid_init_from_string(&oid, project_ids[i]);
+        BSON_APPEND_OID(&ids, str_idx, &oid);
+    }
+    bson_append_array_end(&id_filter, &ids);
+    bson_append_document_end(query, &id_filter);
+
+    // Same rule as check_user_project_access, applied in the query instead of per project
+    if (strcmp(role, "MANAGER") != 0) {
+        BSON_APPEND_UTF8(query, "members", user_id);
+    }
+
+    bson_t* opts = BCON_NEW("projection", "{",
+        "moderator", BCON_INT32(1),
+        "project", BCON_INT32(1),
+        "members", BCON_INT32(1),
+        "estimated_completion_date", BCON_INT32(1),
+        "min_members", BCON_INT32(1),
+        "max_members", BCON_INT32(1),
+        "current_member_count", BCON_INT32(1),
+        "status", BCON_INT32(1),
+    "}");
+
+    mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, opts, NULL);
+    const bson_t* doc;
+
+    // Documents arrive in whatever order the server picks, slot them by request position
+    char** docs = request_malloc(count * sizeof(char*));
+    size_t* lengths = request_malloc(count * sizeof(size_t));
+    char** found = request_malloc(count * sizeof(char*));
+    int found_count = 0;
+    for (int i = 0; i < count; i++) {
+        docs[i] = NULL;
+    }
+
+    while (mongoc_cursor_next(cursor, &doc)) {
+        bson_iter_t iter;
+        char project_id[25];
+        if (!bson_iter_init_find(&iter, doc, "_id") || !BSON_ITER_HOLDS_OID(&iter)) {
+            continue;
+        }
+        bson_oid_to_string(bson_iter_oid(&iter), project_id);
+
+        size_t length;
+        char* json = bson_as_json(doc, &length);
+        if (json == NULL) {
+            continue;
+        }
+        found[found_count++] = json;
+        for (int i = 0; i < count; i++) {
+            if (docs[i] == NULL && strcasecmp(project_ids[i], project_id) == 0) {
+                docs[i] = json;
+                lengths[i] = length;
+            }
+        }
+    }
+
+    bson_error_t error;
+    char* result = NULL;
+    if (mongoc_cursor_error(cursor, &error)) {
+        LOG_ERROR("Error fetching projects: %s", error.message);
+    }
+    else {
+        // Written straight into one buffer sized up front, no cJSON tree in between
+        size_t total = 2 + count * sizeof("null,");
+        for (int i = 0; i < count; i++) {
+            if (docs[i]) {
+                total += lengths[i];
+            }
+        }
+        result = request_malloc(total);
+        char* out = result;
+        *out++ = '[';
+        for (int i = 0; i < count; i++) {
+            if (i > 0) {
+                *out++ = ',';
+            }
+            if (docs[i]) {
+                memcpy(out, docs[i], lengths[i]);
+                out += lengths[i];
+            }
+            else {
+                memcpy(out, "null", 4);
+                out += 4;
+            }
+        }
+        *out++ = ']';
+        *out = '\0';
+        LOG_DEBUG("Found %d of %d projects", found_count, count);
     }
 
-    Repository* repo = New(log);
+    for (int i = 0; i < found_count; i++) {
+        bson_free(found[i]);
+    }
+    request_free(found);
+    request_free(lengths);
+    request_free(docs);
+    mongoc_cursor_destroy(cursor);
+    bson_destroy(opts);
+    bson_destroy(query);
+    Cleanup(repo);
+
+    return result;
+}
+
+int update_project_members(const char* project_id, const char** members, int member_count) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("Updating project members in MongoDB...");
+
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1;
     }
 
@@ -345,23 +437,21 @@ int update_project_members(const char* project_id, const char** members, int mem
 
     // Print the update document for debugging
     char* json_str = bson_as_json(update, NULL);
-    printf("Update document: %s\n", json_str);
+    LOG_DEBUG("Update document: %s", json_str);
     bson_free(json_str);
 
     // Perform the update
     if (!mongoc_collection_update_one(repo->collection, query, update, NULL, NULL, &error)) {
-        printf("Error updating project: %s\n", error.message);
+        LOG_ERROR("Error updating project: %s", error.message);
         bson_destroy(query);
         bson_destroy(update);
         Cleanup(repo);
-        fclose(log);
         return 1;
     }
 
     bson_destroy(query);
     bson_destroy(update);
     Cleanup(repo);
-    fclose(log);
     return 0;
 }
 
@@ -371,7 +461,8 @@ int update_project_members(const char* project_id, const char** members, int mem
  * USER: Gets only projects they are members of
  */
 char* get_projects_by_user_role(const char* user_id, const char* role) {
-    printf("Filtering projects for user: %s with role: %s\n", user_id, role);
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("Filtering projects for user: %s with role: %s", user_id, role);
     
     // For now, MANAGERs get all projects, USERs get filtered projects
     if (strcmp(role, "MANAGER") == 0) {
@@ -380,7 +471,7 @@ char* get_projects_by_user_role(const char* user_id, const char* role) {
     } else if (strcmp(role, "USER") == 0) {
         // SAFE FALLBACK: Get all projects and filter in code
         // This avoids the MongoDB cursor crash while still providing filtering
-        printf("Getting all projects and filtering for user: %s\n", user_id);
+        LOG_DEBUG("Getting all projects and filtering for user: %s", user_id);
         
         char* all_projects = get_all_projects();
         if (all_projects == NULL) {
@@ -390,8 +481,8 @@ char* get_projects_by_user_role(const char* user_id, const char* role) {
         // Parse JSON and filter projects where user is a member
         cJSON* json_array = cJSON_Parse(all_projects);
         if (json_array == NULL) {
-            printf("Error: Failed to parse projects JSON\n");
-            free(all_projects);
+            LOG_ERROR("Error: Failed to parse projects JSON");
+            cJSON_free(all_projects);
             return NULL;
         }
         
@@ -399,7 +490,7 @@ char* get_projects_by_user_role(const char* user_id, const char* role) {
         int array_size = cJSON_GetArraySize(json_array);
         int found_count = 0;
         
-        printf("Checking %d projects for user membership\n", array_size);
+        LOG_DEBUG("Checking %d projects for user membership", array_size);
         
         for (int i = 0; i < array_size; i++) {
             cJSON* project = cJSON_GetArrayItem(json_array, i);
@@ -413,7 +504,7 @@ char* get_projects_by_user_role(const char* user_id, const char* role) {
                     cJSON* member = cJSON_GetArrayItem(members, j);
                     if (cJSON_IsString(member) && strcmp(member->valuestring, user_id) == 0) {
                         user_is_member = true;
-                        printf("User %s found in project %d\n", user_id, i);
+                        LOG_DEBUG("User %s found in project %d", user_id, i);
                         break;
                     }
                 }
@@ -426,13 +517,13 @@ char* get_projects_by_user_role(const char* user_id, const char* role) {
             }
         }
         
-        char* filtered_json = cJSON_Print(filtered_array);
-        printf("Found %d projects where user %s is a member\n", found_count, user_id);
+        char* filtered_json = cJSON_PrintUnformatted(filtered_array);
+        LOG_DEBUG("Found %d projects where user %s is a member", found_count, user_id);
         
         // Cleanup
         cJSON_Delete(json_array);
         cJSON_Delete(filtered_array);
-        free(all_projects);
+        cJSON_free(all_projects);
         
         return filtered_json;
     }
@@ -447,7 +538,8 @@ char* get_projects_by_user_role(const char* user_id, const char* role) {
  * USER: Access only to projects they're members of
  */
 int check_user_project_access(const char* user_id, const char* role, const char* project_id) {
-    printf("Checking access for user: %s (role: %s) to project: %s\n", user_id, role, project_id);
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("Checking access for user: %s (role: %s) to project: %s", user_id, role, project_id);
     
     // Managers have access to all projects
     if (strcmp(role, "MANAGER") == 0) {
@@ -456,29 +548,29 @@ int check_user_project_access(const char* user_id, const char* role, const char*
     
     // For users, check if they're members of the specific project
     if (strcmp(role, "USER") == 0) {
-        printf("Checking if user %s is a member of project %s\n", user_id, project_id);
+        LOG_DEBUG("Checking if user %s is a member of project %s", user_id, project_id);
         
         // Use the existing get_project_by_id function to fetch the project
         char* project_json = get_project_by_id(project_id);
         if (project_json == NULL) {
-            printf("Project not found or error fetching project\n");
+            LOG_ERROR("Project not found or error fetching project");
             return -1;
         }
         
         // Parse the project JSON
         cJSON* project = cJSON_Parse(project_json);
         if (project == NULL) {
-            printf("Error parsing project JSON\n");
-            free(project_json);
+            LOG_ERROR("Error parsing project JSON");
+            request_free(project_json);
             return -1;
         }
         
         // Get the members array
         cJSON* members = cJSON_GetObjectItem(project, "members");
         if (!cJSON_IsArray(members)) {
-            printf("No members array found in project\n");
+            LOG_DEBUG("No members array found in project");
             cJSON_Delete(project);
-            free(project_json);
+            request_free(project_json);
             return -1;
         }
         
@@ -490,18 +582,18 @@ int check_user_project_access(const char* user_id, const char* role, const char*
             cJSON* member = cJSON_GetArrayItem(members, i);
             if (cJSON_IsString(member) && strcmp(member->valuestring, user_id) == 0) {
                 user_is_member = true;
-                printf("Access granted: User %s is a member of project %s\n", user_id, project_id);
+                LOG_DEBUG("Access granted: User %s is a member of project %s", user_id, project_id);
                 break;
             }
         }
         
         if (!user_is_member) {
-            printf("Access denied: User %s is not a member of project %s\n", user_id, project_id);
+            LOG_WARN("Access denied: User %s is not a member of project %s", user_id, project_id);
         }
         
         // Cleanup
         cJSON_Delete(project);
-        free(project_json);
+        request_free(project_json);
         
         return user_is_member ? 0 : -1;
     }
@@ -510,18 +602,12 @@ int check_user_project_access(const char* user_id, const char* role, const char*
 }
 
 int check_members_unfinished_tasks(const char* project_id, const char** removed_members, int removed_count) {
-    printf("\n=== Starting check_members_unfinished_tasks ===\n");
-    printf("Checking %d removed members for unfinished tasks in project %s\n", removed_count, project_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1; // Return error - assume there are unfinished tasks
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting check_members_unfinished_tasks ===");
+    LOG_DEBUG("Checking %d removed members for unfinished tasks in project %s", removed_count, project_id);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1; // Return error - assume there are unfinished tasks
     }
 
@@ -532,7 +618,7 @@ int check_members_unfinished_tasks(const char* project_id, const char** removed_
 
     for (int i = 0; i < removed_count; i++) {
         const char* user_id = removed_members[i];
-        printf("Checking user: %s\n", user_id);
+        LOG_DEBUG("Checking user: %s", user_id);
         
         // Create query to find tasks where:
         // 1. project_id matches AND
@@ -567,48 +653,163 @@ int check_members_unfinished_tasks(const char* project_id, const char** removed_
 
         // Print the query for debugging
         char* query_str = bson_as_json(query, NULL);
-        printf("MongoDB Query for user %s: %s\n", user_id, query_str);
+        LOG_DEBUG("MongoDB Query for user %s: %s", user_id, query_str);
         bson_free(query_str);
 
         // Count documents matching the query
         bson_error_t error;
         int64_t count = mongoc_collection_count_documents(tasks_collection, query, NULL, NULL, NULL, &error);
-        printf("Number of unfinished tasks for user %s: %lld\n", user_id, (long long)count);
+        LOG_DEBUG("Number of unfinished tasks for user %s: %lld", user_id, (long long)count);
 
         bson_destroy(query);
 
         if (count > 0) {
-            printf("User %s has %lld unfinished tasks - cannot remove from project\n", user_id, (long long)count);
+            LOG_WARN("User %s has %lld unfinished tasks - cannot remove from project", user_id, (long long)count);
             mongoc_collection_destroy(tasks_collection);
             Cleanup(repo);
-            fclose(log);
-            printf("=== Finished check_members_unfinished_tasks (BLOCKED) ===\n\n");
+            LOG_DEBUG("=== Finished check_members_unfinished_tasks (BLOCKED) ===");
             return 1; // Return 1 if any user has unfinished tasks
         }
     }
 
-    printf("All removed members have no unfinished tasks - removal allowed\n");
+    LOG_DEBUG("All removed members have no unfinished tasks - removal allowed");
     mongoc_collection_destroy(tasks_collection);
     Cleanup(repo);
-    fclose(log);
-    printf("=== Finished check_members_unfinished_tasks (ALLOWED) ===\n\n");
+    LOG_DEBUG("=== Finished check_members_unfinished_tasks (ALLOWED) ===");
     
     return 0; // Return 0 if all users can be safely removed
 }
 
-int check_project_tasks_completion(const char* project_id) {
-    printf("\n=== Starting check_project_tasks_completion ===\n");
-    printf("Checking completion status for project %s\n", project_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return PROJECT_ACTIVE; // Return active if error - safer default
+// Task statuses as the task service stores them, indexed by value
+static const char* const task_status_names[] = { "pending", "in_progress", "completed" };
+#define TASK_STATUS_COMPLETED 2
+
+char* get_project_summary(const char* project_id) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting get_project_summary ===");
+
+    Repository* repo = New();
+    if (repo == NULL) {
+        return NULL;
     }
+    mongoc_collection_t* tasks_collection = mongoc_client_get_collection(repo->client, "tasks", "tasks");
+
+    // One pass over the project's tasks: counts per status, and open tasks per member
+    bson_t* pipeline = BCON_NEW("pipeline", "[",
+        "{", "$match", "{", "project_id", BCON_UTF8(project_id), "}", "}",
+        "{", "$facet", "{",
+            "by_status", "[",
+                "{", "$group", "{", "_id", BCON_UTF8("$status"), "count", "{", "$sum", BCON_INT32(1), "}", "}", "}",
+            "]",
+            "by_member", "[",
+                "{", "$match", "{", "status", "{", "$ne", BCON_INT32(TASK_STATUS_COMPLETED), "}", "}", "}",
+                "{", "$unwind", BCON_UTF8("$members"), "}",
+                "{", "$group", "{", "_id", BCON_UTF8("$members"), "open", "{", "$sum", BCON_INT32(1), "}", "}", "}",
+                "{", "$sort", "{", "open", BCON_INT32(-1), "_id", BCON_INT32(1), "}", "}",
+            "]",
+        "}", "}",
+        "]");
+
+    mongoc_cursor_t* cursor = mongoc_collection_aggregate(tasks_collection, MONGOC_QUERY_NONE, pipeline, NULL, NULL);
+    const bson_t* doc;
+    bson_error_t error;
+    char* result = NULL;
+
+    int64_t status_counts[sizeof(task_status_names) / sizeof(task_status_names[0])] = { 0 };
+    int64_t total = 0;
+    cJSON* summary = cJSON_CreateObject();
+    cJSON_AddStringToObject(summary, "project_id", project_id);
+    cJSON* members = cJSON_CreateArray();
+
+    // $facet always yields exactly one document
+    if (mongoc_cursor_next(cursor, &doc)) {
+        bson_iter_t iter;
+        bson_iter_t groups;
+        bson_iter_t group;
+
+        if (bson_iter_init_find(&iter, doc, "by_status") && BSON_ITER_HOLDS_ARRAY(&iter) &&
+            bson_iter_recurse(&iter, &groups)) {
+            while (bson_iter_next(&groups)) {
+                if (!BSON_ITER_HOLDS_DOCUMENT(&groups) || !bson_iter_recurse(&groups, &group)) {
+                    continue;
+                }
+                int64_t status = -1;
+                int64_t count = 0;
+                while (bson_iter_next(&group)) {
+                    if (strcmp(bson_iter_key(&group), "_id") == 0 && BSON_ITER_HOLDS_INT32(&group)) {
+                        status = bson_iter_as_int64(&group);
+                    }
+                    else if (strcmp(bson_iter_key(&group), "count") == 0) {
+                        count = bson_iter_as_int64(&group);
+                    }
+                }
+                total += count;
+                if (status >= 0 && status < (int64_t)(sizeof(status_counts) / sizeof(status_counts[0]))) {
+                    status_counts[status] = count;
+                }
+            }
+        }
 
-    Repository* repo = New(log);
+        if (bson_iter_init_find(&iter, doc, "by_member") && BSON_ITER_HOLDS_ARRAY(&iter) &&
+            bson_iter_recurse(&iter, &groups)) {
+            while (bson_iter_next(&groups)) {
+                if (!BSON_ITER_HOLDS_DOCUMENT(&groups) || !bson_iter_recurse(&groups, &group)) {
+                    continue;
+                }
+                const char* member_id = NULL;
+                int64_t open = 0;
+                while (bson_iter_next(&group)) {
+                    if (strcmp(bson_iter_key(&group), "_id") == 0 && BSON_ITER_HOLDS_UTF8(&group)) {
+                        member_id = bson_iter_utf8(&group, NULL);
+                    }
+                    else if (strcmp(bson_iter_key(&group), "open") == 0) {
+                        open = bson_iter_as_int64(&group);
+                    }
+                }
+                if (member_id) {
+                    cJSON* member = cJSON_CreateObject();
+                    cJSON_AddStringToObject(member, "user_id", member_id);
+                    cJSON_AddNumberToObject(member, "open_tasks", (double)open);
+                    cJSON_AddItemToArray(members, member);
+                }
+            }
+        }
+    }
+
+    if (mongoc_cursor_error(cursor, &error)) {
+        LOG_ERROR("Summary aggregation failed: %s", error.message);
+        cJSON_Delete(members);
+    }
+    else {
+        cJSON_AddNumberToObject(summary, "total", (double)total);
+        cJSON* statuses = cJSON_AddObjectToObject(summary, "status");
+        for (size_t i = 0; i < sizeof(status_counts) / sizeof(status_counts[0]); i++) {
+            cJSON_AddNumberToObject(statuses, task_status_names[i], (double)status_counts[i]);
+        }
+        // A project without tasks has nothing left to do, as in check_project_tasks_completion
+        double completion = total > 0 ? 100.0 * status_counts[TASK_STATUS_COMPLETED] / total : 100.0;
+        cJSON_AddNumberToObject(summary, "completion", completion);
+        cJSON_AddItemToObject(summary, "members", members);
+        result = cJSON_PrintUnformatted(summary);
+    }
+
+    LOG_DEBUG("Project %s has %lld tasks", project_id, (long long)total);
+    cJSON_Delete(summary);
+    mongoc_cursor_destroy(cursor);
+    bson_destroy(pipeline);
+    mongoc_collection_destroy(tasks_collection);
+    Cleanup(repo);
+    LOG_DEBUG("=== Finished get_project_summary ===");
+    return result;
+}
+
+int check_project_tasks_completion(const char* project_id) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting check_project_tasks_completion ===");
+    LOG_DEBUG("Checking completion status for project %s", project_id);
+
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return PROJECT_ACTIVE; // Return active if error - safer default
     }
 
@@ -623,15 +824,14 @@ int check_project_tasks_completion(const char* project_id) {
     
     bson_error_t error;
     int64_t total_tasks = mongoc_collection_count_documents(tasks_collection, all_tasks_query, NULL, NULL, NULL, &error);
-    printf("Total tasks in project: %lld\n", (long long)total_tasks);
+    LOG_DEBUG("Total tasks in project: %lld", (long long)total_tasks);
     
     if (total_tasks == 0) {
-        printf("Project has no tasks - can be deleted\n");
+        LOG_DEBUG("Project has no tasks - can be deleted");
         bson_destroy(all_tasks_query);
         mongoc_collection_destroy(tasks_collection);
         Cleanup(repo);
-        fclose(log);
-        printf("=== Finished check_project_tasks_completion (NO TASKS) ===\n\n");
+        LOG_DEBUG("=== Finished check_project_tasks_completion (NO TASKS) ===");
         return PROJECT_COMPLETED; // No tasks means project can be considered complete
     }
 
@@ -645,38 +845,31 @@ int check_project_tasks_completion(const char* project_id) {
     bson_append_document_end(unfinished_query, &ne_condition);
 
     int64_t unfinished_tasks = mongoc_collection_count_documents(tasks_collection, unfinished_query, NULL, NULL, NULL, &error);
-    printf("Unfinished tasks in project: %lld\n", (long long)unfinished_tasks);
+    LOG_DEBUG("Unfinished tasks in project: %lld", (long long)unfinished_tasks);
 
     bson_destroy(all_tasks_query);
     bson_destroy(unfinished_query);
     mongoc_collection_destroy(tasks_collection);
     Cleanup(repo);
-    fclose(log);
 
     if (unfinished_tasks > 0) {
-        printf("Project has %lld unfinished tasks - cannot be deleted\n", (long long)unfinished_tasks);
-        printf("=== Finished check_project_tasks_completion (ACTIVE) ===\n\n");
+        LOG_WARN("Project has %lld unfinished tasks - cannot be deleted", (long long)unfinished_tasks);
+        LOG_DEBUG("=== Finished check_project_tasks_completion (ACTIVE) ===");
         return PROJECT_ACTIVE;
     } else {
-        printf("All tasks are completed - project can be deleted\n");
-        printf("=== Finished check_project_tasks_completion (COMPLETED) ===\n\n");
+        LOG_DEBUG("All tasks are completed - project can be deleted");
+        LOG_DEBUG("=== Finished check_project_tasks_completion (COMPLETED) ===");
         return PROJECT_COMPLETED;
     }
 }
 
 int update_project_status(const char* project_id, ProjectStatus status) {
-    printf("\n=== Starting update_project_status ===\n");
-    printf("Updating project %s status to %d\n", project_id, status);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1;
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting update_project_status ===");
+    LOG_DEBUG("Updating project %s status to %d", project_id, status);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1;
     }
 
@@ -699,44 +892,36 @@ int update_project_status(const char* project_id, ProjectStatus status) {
 
     bson_error_t error;
     if (!mongoc_collection_update_one(repo->collection, query, update, NULL, NULL, &error)) {
-        printf("Error updating project status: %s\n", error.message);
+        LOG_ERROR("Error updating project status: %s", error.message);
         bson_destroy(query);
         bson_destroy(update);
         Cleanup(repo);
-        fclose(log);
         return 1;
     }
 
-    printf("Project status updated successfully\n");
+    LOG_DEBUG("Project status updated successfully");
     bson_destroy(query);
     bson_destroy(update);
     Cleanup(repo);
-    fclose(log);
-    printf("=== Finished update_project_status ===\n\n");
+    LOG_DEBUG("=== Finished update_project_status ===");
     return 0;
 }
 
 int delete_project(const char* project_id) {
-    printf("\n=== Starting delete_project ===\n");
-    printf("Attempting to delete project %s\n", project_id);
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting delete_project ===");
+    LOG_DEBUG("Attempting to delete project %s", project_id);
     
     // First check if project can be deleted
     int completion_status = check_project_tasks_completion(project_id);
     if (completion_status != PROJECT_COMPLETED) {
-        printf("Project cannot be deleted - has unfinished tasks\n");
-        printf("=== Finished delete_project (BLOCKED) ===\n\n");
+        LOG_WARN("Project cannot be deleted - has unfinished tasks");
+        LOG_DEBUG("=== Finished delete_project (BLOCKED) ===");
         return 1; // Cannot delete
     }
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1;
-    }
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1;
     }
 
@@ -753,29 +938,104 @@ int delete_project(const char* project_id) {
     bson_error_t error;
     bool delete_result = mongoc_collection_delete_one(repo->collection, query, NULL, NULL, &error);
     if (!delete_result) {
-        printf("Error deleting project: %s\n", error.message);
+        LOG_ERROR("Error deleting project: %s", error.message);
         bson_destroy(query);
         Cleanup(repo);
-        fclose(log);
         return 1;
     }
 
-    printf("Project deleted successfully\n");
+    LOG_DEBUG("Project deleted successfully");
     bson_destroy(query);
     Cleanup(repo);
-    fclose(log);
-    printf("=== Finished delete_project (SUCCESS) ===\n\n");
+    LOG_DEBUG("=== Finished delete_project (SUCCESS) ===");
     return 0;
 }
 
 int repo() {
-    printf("Initializing MongoDB...\n");
+    LOG_DEBUG("Initializing MongoDB...");
     mongoc_init();
-    printf("MongoDB initialized.\n");
+    LOG_DEBUG("MongoDB initialized.");
 
     getchar();
     mongoc_cleanup();
-    printf("MongoDB cleanup completed.\n");
+    LOG_DEBUG("MongoDB cleanup completed.");
 
     return 0;
 }
+
+// Reports the project a change event touches, NULL when it cannot be told from the event
+static void dispatch_change(const bson_t* event, const char* project_field, ChangeCallback on_change, void* cls) {
+    bson_iter_t iter;
+    bson_iter_t field;
+    char project_id[25];
+
+    if (project_field == NULL) {
+        // Documents are projects, the document key is the project id
+        if (bson_iter_init(&iter, event) && bson_iter_find_descendant(&iter, "documentKey._id", &field) &&
+            BSON_ITER_HOLDS_OID(&field)) {
+            bson_oid_to_string(bson_iter_oid(&field), project_id);
+            on_change(cls, project_id, event);
+            return;
+        }
+    }
+    else {
+        // Deletes carry no fullDocument, so the project is unknown for them
+        char path[64];
+        snprintf(path, sizeof(path), "fullDocument.%s", project_field);
+        if (bson_iter_init(&iter, event) && bson_iter_find_descendant(&iter, path, &field) &&
+            BSON_ITER_HOLDS_UTF8(&field)) {
+            on_change(cls, bson_iter_utf8(&field, NULL), event);
+            return;
+        }
+    }
+    on_change(cls, NULL, event);
+}
+
+int watch_collection(const char* db_name, const char* collection_name, const char* project_field,
+    ChangeCallback on_change, void* cls) {
+
+    Repository* repo = New();
+    if (repo == NULL) {
+        return 1;
+    }
+    repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
+
+    bson_t* pipeline = bson_new();
+    bson_t* opts = BCON_NEW("fullDocument", BCON_UTF8("updateLookup"), "maxAwaitTimeMS", BCON_INT64(10000));
+    mongoc_change_stream_t* stream = mongoc_collection_watch(repo->collection, pipeline, opts);
+
+    bson_error_t error;
+    const bson_t* event;
+    if (mongoc_change_stream_error_document(stream, &error, NULL)) {
+        LOG_WARN("Cannot watch %s.%s: %s", db_name, collection_name, error.message);
+    }
+    else {
+        LOG_INFO("Watching %s.%s for changes", db_name, collection_name);
+        // The stream only sees changes from here on, anything earlier is unknown
+        on_change(cls, NULL, NULL);
+
+        for (;;) {
+            while (mongoc_change_stream_next(stream, &event)) {
+                bson_iter_t iter;
+                if (bson_iter_init_find(&iter, event, "operationType") && BSON_ITER_HOLDS_UTF8(&iter) &&
+                    strcmp(bson_iter_utf8(&iter, NULL), "invalidate") == 0) {
+                    // The collection was dropped or renamed, the stream is closed after this
+                    on_change(cls, NULL, NULL);
+                    goto cleanup;
+                }
+                dispatch_change(event, project_field, on_change, cls);
+            }
+            if (mongoc_change_stream_error_document(stream, &error, NULL)) {
+                LOG_WARN("Change stream on %s.%s failed: %s", db_name, collection_name, error.message);
+                break;
+            }
+        }
+    }
+
+cleanup:
+    mongoc_change_stream_destroy(stream);
+    bson_destroy(opts);
+    bson_destroy(pipeline);
+    Cleanup(repo);
+    return 1;
+}
@@ -1,6 +1,7 @@
 #ifndef REPO_H
 #define REPO_H
 
+#include <mongoc/mongoc.h>
 #include "model.h"
 
 int addproject(Project* project);
@@ -9,10 +10,40 @@ char* get_all_projects(void);
 char* get_projects_by_user_role(const char* user_id, const char* role);
 int update_project_members(const char* project_id, const char** members, int member_count);
 char* get_project_by_id(const char* project_id);
+
+/**
+ * Fetches several projects with one $in query. Returns a JSON array in the
+ * order of project_ids, with null where a project does not exist or is not
+ * visible to a USER who is not a member. Ids must be valid ObjectIds.
+ */
+char* get_projects_by_ids(const char** project_ids, int count, const char* user_id, const char* role);
 int check_user_project_access(const char* user_id, const char* role, const char* project_id);
 int check_members_unfinished_tasks(const char* project_id, const char** removed_members, int removed_count);
 int check_project_tasks_completion(const char* project_id);
+
+/**
+ * Task counts for a project from a single $facet aggregation: per status,
+ * open tasks per member, and the completed share in percent. Returns NULL
+ * when the aggregation fails.
+ */
+char* get_project_summary(const char* project_id);
 int update_project_status(const char* project_id, ProjectStatus status);
 int delete_project(const char* project_id);
 
+/**
+ * Called with the id of a project whose documents changed, NULL when any
+ * project may have. event is the change stream document, NULL when the
+ * stream has just opened or ended and changes may have been missed.
+ */
+typedef void (*ChangeCallback)(void* cls, const char* project_id, const bson_t* event);
+
+/**
+ * Follows a collection's change stream and reports every change to on_change.
+ * project_field names the string field holding the project id, NULL when the
+ * collection holds the projects themselves. Blocks until the stream fails,
+ * so run it on its own thread. Needs a replica set.
+ */
+int watch_collection(const char* db_name, const char* collection_name, const char* project_field,
+    ChangeCallback on_change, void* cls);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <stddef.h>
+#include <microhttpd.h>
+
+#define ROUTE_MAX_PARAMS 4
+#define ROUTE_PARAM_SIZE 128
+
+typedef enum {
+    ROUTE_GET = 1 << 0,
+    ROUTE_POST = 1 << 1,
+    ROUTE_PUT = 1 << 2,
+    ROUTE_PATCH = 1 << 3,
+    ROUTE_DELETE = 1 << 4,
+    ROUTE_ANY = (1 << 5) - 1
+} RouteMethod;
+
+// Path segments captured by {name} placeholders, in pattern order
+typedef struct {
+    int count;
+    const char* names[ROUTE_MAX_PARAMS];
+    char values[ROUTE_MAX_PARAMS][ROUTE_PARAM_SIZE];
+} RouteParams;
+
+struct ConnectionInfo;
+
+typedef int (*RouteHandler)(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params);
+
+/**
+ * One entry of a service's route table. pattern is a path such as
+ * "/tasks/{id}/add-member", a placeholder matches one non-empty segment.
+ */
+typedef struct {
+    int methods;
+    const char* pattern;
+    RouteHandler handler;
+} Route;
+
+typedef struct RouteNode RouteNode;
+
+typedef struct {
+    RouteNode* root;
+} Router;
+
+/**
+ * Compiles the table into a radix trie. Literal segments win over
+ * placeholders at the same position. Returns -1 when two entries overlap
+ * or memory runs out. The table must outlive the router.
+ */
+int router_init(Router* router, const Route* routes, size_t count);
+
+/**
+ * Finds the route for a request in time proportional to the path length,
+ * filling params with the captured segments. NULL when nothing matches the
+ * path and method.
+ */
+const Route* router_match(const Router* router, const char* method, const char* url, RouteParams* params);
+
+// Captured value by placeholder name, NULL when the route has no such parameter
+const char* route_param(const RouteParams* params, const char* name);
+
+#endif
@@ -0,0 +1,184 @@
+#include "board_events.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "logger.h"
+
+#define PROJECT_ID_SIZE 64
+#define BLOCK_SIZE 4096
+#define PENDING_LIMIT (64 * 1024)   // A client this far behind is told to reload instead
+#define HEARTBEAT_SECONDS 15        // Also how soon a vanished client is noticed
+
+typedef struct Subscriber {
+    struct Subscriber* next;
+    struct MHD_Connection* connection;
+    char project_id[PROJECT_ID_SIZE];
+    int full_deltas;
+    int suspended;
+    char* pending;                  // Event text not yet handed to MHD
+    size_t pending_size;
+    size_t pending_capacity;
+} Subscriber;
+
+// Guards the list and every subscriber's pending buffer and suspended flag
+static pthread_mutex_t subscribers_lock = PTHREAD_MUTEX_INITIALIZER;
+static Subscriber* subscribers = NULL;
+
+static const char reset_event[] = "event: reset\ndata: {}\n\n";
+static const char changed_event[] = "event: changed\ndata: {}\n\n";
+static const char heartbeat[] = ": ping\n\n";
+
+static void append(Subscriber* sub, const char* text, size_t size) {
+    if (sub->pending_size + size > PENDING_LIMIT) {
+        // Deltas were lost, the board has to be fetched again
+        sub->pending_size = 0;
+        text = reset_event;
+        size = sizeof(reset_event) - 1;
+    }
+    if (sub->pending_size + size > sub->pending_capacity) {
+        size_t capacity = sub->pending_capacity ? sub->pending_capacity : 256;
+        while (capacity < sub->pending_size + size) {
+            capacity *= 2;
+        }
+        char* pending = realloc(sub->pending, capacity);
+        if (pending == NULL) {
+            LOG_WARN("Dropping event for project %s", sub->project_id);
+            return;
+        }
+        sub->pending = pending;
+        sub->pending_capacity = capacity;
+    }
+    memcpy(sub->pending + sub->pending_size, text, size);
+    sub->pending_size += size;
+}
+
+static void wake(Subscriber* sub) {
+    if (sub->suspended) {
+        sub->suspended = 0;
+        MHD_resume_connection(sub->connection);
+    }
+}
+
+static ssize_t read_events(void* cls, uint64_t pos, char* buf, size_t max) {
+    Subscriber* sub = (Subscriber*)cls;
+
+    pthread_mutex_lock(&subscribers_lock);
+    if (sub->pending_size == 0) {
+        // Parked until a publish or the heartbeat resumes it, returning 0 is only safe while suspended
+        sub->suspended = 1;
+        MHD_suspend_connection(sub->connection);
+        pthread_mutex_unlock(&subscribers_lock);
+        return 0;
+    }
+    size_t size = sub->pending_size < max ? sub->pending_size : max;
+    memcpy(buf, sub->pending, size);
+    memmove(sub->pending, sub->pending + size, sub->pending_size - size);
+    sub->pending_size -= size;
+    pthread_mutex_unlock(&subscribers_lock);
+    return size;
+}
+
+static void release(void* cls) {
+    Subscriber* sub = (Subscriber*)cls;
+
+    pthread_mutex_lock(&subscribers_lock);
+    for (Subscriber** link = &subscribers; *link; link = &(*link)->next) {
+        if (*link == sub) {
+            *link = sub->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&subscribers_lock);
+
+    LOG_DEBUG("Event stream for project %s closed", sub->project_id);
+    free(sub->pending);
+    free(sub);
+}
+
+static void* heartbeat_loop(void* arg) {
+    for (;;) {
+        sleep(HEARTBEAT_SECONDS);
+        pthread_mutex_lock(&subscribers_lock);
+        for (Subscriber* sub = subscribers; sub; sub = sub->next) {
+            if (sub->pending_size == 0) {
+                append(sub, heartbeat, sizeof(heartbeat) - 1);
+            }
+            wake(sub);
+        }
+        pthread_mutex_unlock(&subscribers_lock);
+    }
+    return NULL;
+}
+
+int board_events_init(void) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, heartbeat_loop, NULL) != 0) {
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+struct MHD_Response* board_events_subscribe(struct MHD_Connection* connection, const char* project_id,
+    int full_deltas) {
+
+    Subscriber* sub = calloc(1, sizeof(Subscriber));
+    if (sub == NULL) {
+        return NULL;
+    }
+    sub->connection = connection;
+    snprintf(sub->project_id, sizeof(sub->project_id), "%s", project_id);
+    sub->full_deltas = full_deltas;
+
+    // Reconnect hint, and a first chunk so the client knows the stream is open
+    static const char opening[] = "retry: 3000\n: connected\n\n";
+    append(sub, opening, sizeof(opening) - 1);
+
+    struct MHD_Response* response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, BLOCK_SIZE,
+        read_events, sub, release);
+    if (response == NULL) {
+        free(sub->pending);
+        free(sub);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&subscribers_lock);
+    sub->next = subscribers;
+    subscribers = sub;
+    pthread_mutex_unlock(&subscribers_lock);
+
+    LOG_DEBUG("Event stream for project %s opened", project_id);
+    return response;
+}
+
+void board_events_publish(const char* project_id, const char* delta_json) {
+    char* event = NULL;
+    int length = 0;
+    if (delta_json) {
+        size_t size = strlen(delta_json) + sizeof("event: task\ndata: \n\n");
+        event = malloc(size);
+        if (event == NULL) {
+            return;
+        }
+        length = snprintf(event, size, "event: task\ndata: %s\n\n", delta_json);
+    }
+
+    pthread_mutex_lock(&subscribers_lock);
+    for (Subscriber* sub = subscribers; sub; sub = sub->next) {
+        if (project_id && strcmp(sub->project_id, project_id) != 0) {
+            continue;
+        }
+        if (event && sub->full_deltas) {
+            append(sub, event, length);
+        }
+        else {
+            append(sub, changed_event, sizeof(changed_event) - 1);
+        }
+        wake(sub);
+    }
+    pthread_mutex_unlock(&subscribers_lock);
+
+    free(event);
+}
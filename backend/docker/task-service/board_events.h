@@ -0,0 +1,28 @@
+#ifndef BOARD_EVENTS_H
+#define BOARD_EVENTS_H
+
+#include <microhttpd.h>
+
+/**
+ * Starts the heartbeat thread. The daemon must run with
+ * MHD_ALLOW_SUSPEND_RESUME, idle streams stay suspended between events.
+ */
+int board_events_init(void);
+
+/**
+ * Builds a text/event-stream response that delivers the project's task
+ * changes to this connection until the client goes away. Without
+ * full_deltas every change arrives as a bare "changed" event, for users who
+ * may not see every task on the board.
+ */
+struct MHD_Response* board_events_subscribe(struct MHD_Connection* connection, const char* project_id,
+    int full_deltas);
+
+/**
+ * Sends a task change, one line of JSON, to every stream open on the
+ * project. A NULL delta_json sends a bare "changed" so clients refetch, a
+ * NULL project_id reaches every stream.
+ */
+void board_events_publish(const char* project_id, const char* delta_json);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef CACHE_WATCHER_H
+#define CACHE_WATCHER_H
+
+#include "repo.h"
+
+// Told of every change after the cache has been invalidated, arguments as for ChangeCallback
+typedef void (*ChangeListener)(const char* project_id, const bson_t* event);
+
+/**
+ * Starts a thread that follows db_name.collection_name through a change
+ * stream and invalidates cached responses for every project it touches,
+ * including writes made by other services. A failed stream is reopened with
+ * backoff, the whole cache being dropped each time since changes in between
+ * were missed. Until a stream is open the cache TTL is the only bound.
+ * listener may be NULL.
+ */
+int cache_watcher_start(const char* db_name, const char* collection_name, const char* project_field,
+    ChangeListener listener);
+
+#endif
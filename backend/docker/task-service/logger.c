@@ -0,0 +1,265 @@
+#include "logger.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define LOG_RING_SLOTS 1024     // Per thread unless it asks for fewer, must be a power of two
+#define LOG_MESSAGE_SIZE 512
+#define LOG_FLUSH_INTERVAL_NS 10000000L
+
+typedef struct {
+    LogLevel level;
+    struct timespec time;
+    char message[LOG_MESSAGE_SIZE];
+} LogEntry;
+
+/**
+ * Single-producer single-consumer ring. The owning thread only advances
+ * head, the flusher only advances tail. Once the owner exits the ring is
+ * retired, and the flusher drains it, unlinks it and frees it.
+ */
+typedef struct LogRing {
+    struct LogRing* next;
+    _Atomic size_t head;
+    _Atomic size_t tail;
+    _Atomic size_t dropped;
+    atomic_int retired;
+    size_t slots;
+    LogEntry entries[];
+} LogRing;
+
+LogLevel log_level = LOG_LEVEL_INFO;
+
+static _Atomic(LogRing*) rings = NULL;
+static __thread LogRing* thread_ring = NULL;
+static __thread size_t thread_ring_slots = LOG_RING_SLOTS;
+static pthread_key_t ring_key;
+
+static const char* service = "service";
+static FILE* output = NULL;
+static pthread_t flusher;
+static atomic_int running = 0;
+
+static const char* level_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+static LogLevel parse_level(const char* value, LogLevel fallback) {
+    if (value == NULL) return fallback;
+    if (strcasecmp(value, "debug") == 0) return LOG_LEVEL_DEBUG;
+    if (strcasecmp(value, "info") == 0) return LOG_LEVEL_INFO;
+    if (strcasecmp(value, "warn") == 0 || strcasecmp(value, "warning") == 0) return LOG_LEVEL_WARN;
+    if (strcasecmp(value, "error") == 0) return LOG_LEVEL_ERROR;
+    if (strcasecmp(value, "off") == 0) return LOG_LEVEL_OFF;
+    return fallback;
+}
+
+static void write_entry(const LogEntry* entry) {
+    struct tm tm;
+    char timestamp[32];
+    gmtime_r(&entry->time.tv_sec, &tm);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &tm);
+    fprintf(output, "%s.%03ldZ %-5s [%s] %s\n", timestamp, entry->time.tv_nsec / 1000000,
+        level_names[entry->level], service, entry->message);
+}
+
+// Registers the calling thread's ring on first use, a lock-free push onto the list
+static LogRing* get_thread_ring(void) {
+    if (thread_ring) {
+        return thread_ring;
+    }
+    LogRing* ring = calloc(1, sizeof(LogRing) + thread_ring_slots * sizeof(LogEntry));
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->slots = thread_ring_slots;
+    LogRing* head = atomic_load(&rings);
+    do {
+        ring->next = head;
+    } while (!atomic_compare_exchange_weak(&rings, &head, ring));
+    thread_ring = ring;
+    pthread_setspecific(ring_key, ring);
+    return ring;
+}
+
+// Runs as the owning thread exits, a message it logs after this gets a new ring
+static void retire_ring(void* value) {
+    LogRing* ring = (LogRing*)value;
+    thread_ring = NULL;
+    atomic_store_explicit(&ring->retired, 1, memory_order_release);
+}
+
+/**
+ * Only the flusher unlinks. Threads only push at the list head, so a ring
+ * further down is unlinked through its predecessor, and the first one with
+ * a CAS that fails when a push got in first.
+ */
+static void unlink_ring(LogRing* ring, LogRing* prev) {
+    if (prev) {
+        prev->next = ring->next;
+        return;
+    }
+    LogRing* expected = ring;
+    if (atomic_compare_exchange_strong(&rings, &expected, ring->next)) {
+        return;
+    }
+    for (prev = expected; prev->next != ring; prev = prev->next) {
+    }
+    prev->next = ring->next;
+}
+
+static int drain_rings(void) {
+    int written = 0;
+    LogRing* prev = NULL;
+    LogRing* ring = atomic_load(&rings);
+    while (ring) {
+        // Read first, so nothing the owner wrote before exiting is left behind
+        int retired = atomic_load_explicit(&ring->retired, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        while (tail != head) {
+            write_entry(&ring->entries[tail & (ring->slots - 1)]);
+            tail++;
+            written++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+        size_t dropped = atomic_exchange(&ring->dropped, 0);
+        if (dropped) {
+            fprintf(output, "%-5s [%s] %zu log messages dropped, ring buffer full\n", "WARN", service, dropped);
+        }
+
+        LogRing* next = ring->next;
+        if (retired) {
+            unlink_ring(ring, prev);
+            free(ring);
+        }
+        else {
+            prev = ring;
+        }
+        ring = next;
+    }
+    if (written) {
+        fflush(output);
+    }
+    return written;
+}
+
+static void* flush_loop(void* arg) {
+    (void)arg;
+    struct timespec interval = { 0, LOG_FLUSH_INTERVAL_NS };
+    while (atomic_load(&running)) {
+        if (drain_rings() == 0) {
+            nanosleep(&interval, NULL);
+        }
+    }
+    drain_rings();
+    return NULL;
+}
+
+int log_init(const char* service_name) {
+    if (service_name) {
+        service = service_name;
+    }
+    log_level = parse_level(getenv("LOG_LEVEL"), LOG_LEVEL_INFO);
+    if (pthread_key_create(&ring_key, retire_ring) != 0) {
+        return 1;
+    }
+
+    output = stderr;
+    const char* path = getenv("LOG_FILE");
+    if (path && path[0] != '\0') {
+        FILE* file = fopen(path, "a");
+        if (file) {
+            output = file;
+        }
+        else {
+            fprintf(stderr, "Could not open LOG_FILE %s, logging to stderr\n", path);
+        }
+    }
+
+    atomic_store(&running, 1);
+    if (pthread_create(&flusher, NULL, flush_loop, NULL) != 0) {
+        atomic_store(&running, 0);
+        return 1;
+    }
+    // Early returns from main still get their last messages out
+    atexit(log_shutdown);
+    return 0;
+}
+
+void log_shutdown(void) {
+    if (atomic_exchange(&running, 0)) {
+        pthread_join(flusher, NULL);
+    }
+    if (output && output != stderr) {
+        fclose(output);
+        output = NULL;
+    }
+}
+
+void log_after_fork(void) {
+    for (LogRing* ring = atomic_load(&rings); ring; ring = ring->next) {
+        atomic_store(&ring->tail, atomic_load(&ring->head));
+        atomic_store(&ring->dropped, 0);
+    }
+    if (atomic_load(&running) && pthread_create(&flusher, NULL, flush_loop, NULL) != 0) {
+        atomic_store(&running, 0);
+    }
+}
+
+void log_thread_ring_size(size_t slots) {
+    size_t size = 1;
+    while (size < slots && size < LOG_RING_SLOTS) {
+        size *= 2;
+    }
+    thread_ring_slots = size;
+}
+
+void log_write(LogLevel level, const char* format, ...) {
+    LogEntry local;
+    LogEntry* entry = &local;
+    LogRing* ring = atomic_load(&running) ? get_thread_ring() : NULL;
+    size_t head = 0;
+
+    if (ring) {
+        head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - tail >= ring->slots) {
+            // Never wait for the flusher on the request path
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return;
+        }
+        entry = &ring->entries[head & (ring->slots - 1)];
+    }
+
+    entry->level = level;
+    clock_gettime(CLOCK_REALTIME, &entry->time);
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(entry->message, sizeof(entry->message), format, args);
+    va_end(args);
+
+    // Call sites carried over from printf may still end in a newline
+    if (length > 0) {
+        size_t end = (size_t)length < sizeof(entry->message) ? (size_t)length : sizeof(entry->message) - 1;
+        if (entry->message[end - 1] == '\n') {
+            entry->message[end - 1] = '\0';
+        }
+    }
+
+    if (ring) {
+        atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    }
+    else {
+        // Before log_init or after log_shutdown, write straight through
+        if (output == NULL) {
+            output = stderr;
+        }
+        write_entry(entry);
+        fflush(output);
+    }
+}
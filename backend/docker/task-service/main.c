@@ -6,120 +6,192 @@
 #include "model.h"
 #include "repo.h"
 #include "jwt_middleware.h"
+#include "request.h"
+#include "logger.h"
+#include "router.h"
+#include "listener.h"
+#include "compression.h"
+#include "response_cache.h"
+#include "cache_watcher.h"
+#include "board_events.h"
 
 #define PORT 8082
 
-// Structure to store incoming JSON data
-struct ConnectionInfo {
-    char* json_data;
-    size_t json_size;
+// Decodes a task from the request body, JSON_INVALID when it is not valid JSON
+static int decode_task_body(struct ConnectionInfo* conn_info, Task* task) {
+#ifdef FAST_JSON
+    size_t body_size;
+    const char* body = request_body(conn_info, &body_size);
+    return parse_task_from_body(body, body_size, task);
+#else
+    cJSON* json = request_body_json(conn_info);
+    if (json == NULL) {
+        return JSON_INVALID;
+    }
+    int result = parse_task_from_json(json, task);
+    cJSON_Delete(json);
+    return result;
+#endif
+}
+
+#define BATCH_MAX_OPERATIONS 100
+#define MY_TASKS_DEFAULT_LIMIT 50
+#define MY_TASKS_MAX_LIMIT 200
+
+static const char* const status_names[] = {
+    [STATUS_PENDING] = "pending",
+    [STATUS_IN_PROGRESS] = "in_progress",
+    [STATUS_COMPLETED] = "completed",
 };
 
-static enum MHD_Result answer_to_connection(void* cls, struct MHD_Connection* connection,
-    const char* url, const char* method, const char* version,
-    const char* upload_data, size_t* upload_data_size, void** con_cls) {
+static int parse_task_status(const char* value, TaskStatus* status) {
+    for (int i = 0; i < (int)(sizeof(status_names) / sizeof(status_names[0])); i++) {
+        if (strcmp(value, status_names[i]) == 0) {
+            *status = i;
+            return 0;
+        }
+    }
+    return -1;
+}
 
-    printf("Incoming request: %s %s\n", method, url);
+// Task writes only carry the task id, so its project is looked up to drop that board from the cache
+static void invalidate_task_project(const char* task_id) {
+    char project_id[MAX_STRING_LENGTH];
+    if (get_task_project_id(task_id, project_id) == 0) {
+        response_cache_invalidate(project_id);
+    }
+}
 
-    if (strcmp(method, "OPTIONS") == 0) {
-        struct MHD_Response* response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
-        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-        MHD_add_response_header(response, "Access-Control-Allow-Methods", "GET, POST, PATCH, OPTIONS");
-        MHD_add_response_header(response, "Access-Control-Allow-Headers", "Content-Type, Authorization");
-        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-        MHD_destroy_response(response);
-        return ret;
+// Sends one delta to the project's event streams
+static void publish_delta(const char* project_id, cJSON* delta) {
+    char* json = cJSON_PrintUnformatted(delta);
+    if (json) {
+        board_events_publish(project_id, json);
+        cJSON_free(json);
     }
+    cJSON_Delete(delta);
+}
 
-    if (*con_cls == NULL) {
-        struct ConnectionInfo* conn_info = calloc(1, sizeof(struct ConnectionInfo));
-        if (!conn_info) return MHD_NO;
-        *con_cls = (void*)conn_info;
-        return MHD_YES;
+static cJSON* event_delta(const char* type, const bson_t* event) {
+    cJSON* delta = cJSON_CreateObject();
+    cJSON_AddStringToObject(delta, "type", type);
+    bson_iter_t iter;
+    bson_iter_t field;
+    if (bson_iter_init(&iter, event) && bson_iter_find_descendant(&iter, "documentKey._id", &field) &&
+        BSON_ITER_HOLDS_OID(&field)) {
+        char task_id[25];
+        bson_oid_to_string(bson_iter_oid(&field), task_id);
+        cJSON_AddStringToObject(delta, "task_id", task_id);
     }
+    return delta;
+}
 
-    struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
+/**
+ * ChangeListener for tasks.tasks. Deltas come from the change stream so
+ * streams see writes made through every task-service instance and by other
+ * services alike. Deletes and gaps in the stream carry no project, so every
+ * stream is told to refetch.
+ */
+static void board_task_change(const char* project_id, const bson_t* event) {
+    bson_iter_t iter;
+    const char* operation = NULL;
+    if (event && bson_iter_init_find(&iter, event, "operationType") && BSON_ITER_HOLDS_UTF8(&iter)) {
+        operation = bson_iter_utf8(&iter, NULL);
+    }
+    if (project_id == NULL || operation == NULL) {
+        board_events_publish(NULL, NULL);
+        return;
+    }
 
-    if (*upload_data_size > 0) {
-        char* new_data = realloc(conn_info->json_data, conn_info->json_size + *upload_data_size + 1);
-        if (!new_data) {
-            free(conn_info->json_data);
-            free(conn_info);
-            return MHD_NO;
-        }
-        conn_info->json_data = new_data;
-        if (conn_info->json_data) {
-            memcpy(conn_info->json_data + conn_info->json_size, upload_data, *upload_data_size);
-            conn_info->json_size += *upload_data_size;
-            conn_info->json_data[conn_info->json_size] = '\0';
+    bson_iter_t field;
+    if (strcmp(operation, "insert") == 0) {
+        cJSON* delta = event_delta("created", event);
+        if (bson_iter_init(&iter, event) && bson_iter_find_descendant(&iter, "fullDocument.name", &field) &&
+            BSON_ITER_HOLDS_UTF8(&field)) {
+            cJSON_AddStringToObject(delta, "name", bson_iter_utf8(&field, NULL));
         }
-        *upload_data_size = 0;
-        return MHD_YES;
-    }
-
-    // Handle task creation
-    if (strcmp(url, "/tasks") == 0 && strcmp(method, "POST") == 0) {
-        printf("Handling POST request for /tasks\n");
-        
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
+        publish_delta(project_id, delta);
+        return;
+    }
+
+    int published = 0;
+    bson_iter_t updated;
+    if (strcmp(operation, "update") == 0 && bson_iter_init(&iter, event) &&
+        bson_iter_find_descendant(&iter, "updateDescription.updatedFields", &field) &&
+        BSON_ITER_HOLDS_DOCUMENT(&field) && bson_iter_recurse(&field, &updated)) {
+        int members_changed = 0;
+        while (bson_iter_next(&updated)) {
+            const char* key = bson_iter_key(&updated);
+            if (strcmp(key, "status") == 0 && BSON_ITER_HOLDS_INT32(&updated)) {
+                int32_t status = bson_iter_int32(&updated);
+                if (status >= 0 && status < (int32_t)(sizeof(status_names) / sizeof(status_names[0]))) {
+                    cJSON* delta = event_delta("status", event);
+                    cJSON_AddStringToObject(delta, "status", status_names[status]);
+                    publish_delta(project_id, delta);
+                    published = 1;
+                }
+            }
+            else if (strcmp(key, "members") == 0 || strncmp(key, "members.", 8) == 0) {
+                members_changed = 1;
+            }
         }
-        
-        // Check permission to create tasks (only MANAGER allowed)
-        if (check_permission(&auth, PERM_CREATE_TASKS) != 0) {
-            return send_forbidden_response(connection, "Only managers can create tasks");
+        // Adds and removals show up as array paths, the lookup has the whole list
+        bson_iter_t members;
+        if (members_changed && bson_iter_init(&iter, event) &&
+            bson_iter_find_descendant(&iter, "fullDocument.members", &field) &&
+            BSON_ITER_HOLDS_ARRAY(&field) && bson_iter_recurse(&field, &members)) {
+            cJSON* delta = event_delta("members", event);
+            cJSON* list = cJSON_AddArrayToObject(delta, "members");
+            while (bson_iter_next(&members)) {
+                if (BSON_ITER_HOLDS_UTF8(&members)) {
+                    cJSON_AddItemToArray(list, cJSON_CreateString(bson_iter_utf8(&members, NULL)));
+                }
+            }
+            publish_delta(project_id, delta);
+            published = 1;
         }
+    }
+    if (!published) {
+        board_events_publish(project_id, NULL);
+    }
+}
 
-        if (!conn_info->json_data) {
-            const char* error_response = "{\"error\": \"No data received\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+// ChangeListener for trello.projects, membership or status changes send the board's streams to refetch
+static void board_project_change(const char* project_id, const bson_t* event) {
+    board_events_publish(project_id, NULL);
+}
 
-        cJSON* json = cJSON_Parse(conn_info->json_data);
-        if (!json) {
-            const char* error_response = "{\"error\": \"Invalid JSON format\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+static int handle_metrics(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    char* metrics = metrics_render();
+    if (metrics == NULL) {
+        return MHD_NO;
+    }
+    struct MHD_Response* response = create_request_response(metrics);
+    MHD_add_response_header(response, "Content-Type", "text/plain; version=0.0.4");
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
+}
 
-        Task task;
-        if (parse_task_from_json(json, &task) == 0) {
-            if (add_task(&task) == 0) {
-                const char* success_response = "{\"status\": \"success\"}";
-                struct MHD_Response* response = MHD_create_response_from_buffer(
-                    strlen(success_response),
-                    (void*)success_response,
-                    MHD_RESPMEM_PERSISTENT
-                );
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                MHD_add_response_header(response, "Content-Type", "application/json");
-                int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-                MHD_destroy_response(response);
-                cJSON_Delete(json);
-                return ret;
-            }
-        }
+// Handle task creation
+static int handle_create_task(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    LOG_DEBUG("Handling POST request for /tasks");
+    
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to create tasks (only MANAGER allowed)
+    if (check_permission(&auth, PERM_CREATE_TASKS) != 0) {
+        return send_forbidden_response(connection, "Only managers can create tasks");
+    }
 
-        const char* error_response = "{\"error\": \"Failed to create task\"}";
+    if (conn_info->json_size == 0) {
+        const char* error_response = "{\"error\": \"No data received\"}";
         struct MHD_Response* response = MHD_create_response_from_buffer(
             strlen(error_response),
             (void*)error_response,
@@ -129,67 +201,13 @@ static enum MHD_Result answer_to_connection(void* cls, struct MHD_Connection* co
         MHD_add_response_header(response, "Content-Type", "application/json");
         int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
         MHD_destroy_response(response);
-        cJSON_Delete(json);
         return ret;
     }
 
-    // Get tasks by project
-    printf("DEBUG: Checking generic handler for URL: %s\n", url);
-    if (strncmp(url, "/tasks/project/", 14) == 0 && strcmp(method, "GET") == 0 && strstr(url, "/member/") == NULL) {
-        printf("Matched: /tasks/project/{project_id}\n");
-        
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // Check permission to read tasks
-        if (check_permission(&auth, PERM_READ_TASKS) != 0) {
-            return send_forbidden_response(connection, "Cannot access tasks");
-        }
-        
-        const char* project_id = url + 14;  // Skip "/tasks/project/"
-        
-        // Skip any leading forward slash
-        while (*project_id == '/') {
-            project_id++;
-        }
-        
-        printf("Extracted project_id: %s\n", project_id);
-        printf("Authenticated user: %s with role: %s\n", auth.user_id, auth.role);
-        
-        char* tasks = NULL;
-        
-        // Role-based access control
-        if (strcmp(auth.role, "MANAGER") == 0) {
-            // Managers can see all tasks in the project
-            printf("Manager access: fetching all tasks for project\n");
-            tasks = get_tasks_by_project(project_id);
-        } else if (strcmp(auth.role, "USER") == 0) {
-            // Users can only see tasks they're involved in (creator or member)
-            // For now, let's simplify and just get user-specific tasks without project validation
-            // since the project validation is causing crashes
-            printf("User access: fetching user-specific tasks without project validation\n");
-            tasks = get_user_tasks_by_project(project_id, auth.user_id);
-        } else {
-            return send_forbidden_response(connection, "Invalid role for task access");
-        }
-        
-        if (tasks) {
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(tasks),
-                (void*)tasks,
-                MHD_RESPMEM_MUST_FREE
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
-        
-        const char* error_response = "{\"error\": \"Failed to fetch tasks\"}";
+    Task task;
+    int parse_result = decode_task_body(conn_info, &task);
+    if (parse_result == JSON_INVALID) {
+        const char* error_response = "{\"error\": \"Invalid JSON format\"}";
         struct MHD_Response* response = MHD_create_response_from_buffer(
             strlen(error_response),
             (void*)error_response,
@@ -197,108 +215,14 @@ static enum MHD_Result answer_to_connection(void* cls, struct MHD_Connection* co
         );
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
         MHD_add_response_header(response, "Content-Type", "application/json");
-        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
         MHD_destroy_response(response);
         return ret;
     }
 
-    // Update task status
-    if (strncmp(url, "/tasks/status/", 13) == 0 && strcmp(method, "PATCH") == 0) {
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // For task status updates, we need to check if user can update this specific task
-        // We'll validate this after we extract the task_id and check task membership
-        
-        const char* task_id = url + 13;  // Skip "/tasks/status/"
-        // Skip any leading forward slash
-        while (*task_id == '/') {
-            task_id++;
-        }
-        printf("Processing status update for task ID: %s\n", task_id);
-
-        // Check if user can update this specific task
-        // MANAGERS can update any task, USERs can only update tasks they're involved in
-        if (strcmp(auth.role, "MANAGER") != 0) {
-            if (can_user_update_task(task_id, auth.user_id) != 0) {
-                return send_forbidden_response(connection, "You can only update status of tasks you're assigned to or created");
-            }
-        }
-
-        if (!conn_info->json_data) {
-            const char* error_response = "{\"error\": \"No data received\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
-
-        cJSON* json = cJSON_Parse(conn_info->json_data);
-        if (!json) {
-            const char* error_response = "{\"error\": \"Invalid JSON format\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
-
-        cJSON* status_json = cJSON_GetObjectItem(json, "status");
-        if (!status_json || !cJSON_IsString(status_json)) {
-            const char* error_response = "{\"error\": \"Invalid status value\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
-        }
-
-        TaskStatus new_status;
-        if (strcmp(status_json->valuestring, "pending") == 0) {
-            new_status = STATUS_PENDING;
-        }
-        else if (strcmp(status_json->valuestring, "in_progress") == 0) {
-            new_status = STATUS_IN_PROGRESS;
-        }
-        else if (strcmp(status_json->valuestring, "completed") == 0) {
-            new_status = STATUS_COMPLETED;
-        }
-        else {
-            const char* error_response = "{\"error\": \"Invalid status value\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
-        }
-
-        if (update_task_status(task_id, new_status) == 0) {
+    if (parse_result == 0) {
+        if (add_task(&task) == 0) {
+            response_cache_invalidate(task.project_id);
             const char* success_response = "{\"status\": \"success\"}";
             struct MHD_Response* response = MHD_create_response_from_buffer(
                 strlen(success_response),
@@ -309,116 +233,208 @@ static enum MHD_Result answer_to_connection(void* cls, struct MHD_Connection* co
             MHD_add_response_header(response, "Content-Type", "application/json");
             int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
             MHD_destroy_response(response);
-            cJSON_Delete(json);
             return ret;
         }
+    }
 
-        const char* error_response = "{\"error\": \"Failed to update task status\"}";
-        struct MHD_Response* response = MHD_create_response_from_buffer(
-            strlen(error_response),
-            (void*)error_response,
-            MHD_RESPMEM_PERSISTENT
-        );
+    const char* error_response = "{\"error\": \"Failed to create task\"}";
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        strlen(error_response),
+        (void*)error_response,
+        MHD_RESPMEM_PERSISTENT
+    );
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Get tasks by project
+static int handle_get_project_tasks(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    LOG_DEBUG("Matched: /tasks/project/{project_id}");
+    
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to read tasks
+    if (check_permission(&auth, PERM_READ_TASKS) != 0) {
+        return send_forbidden_response(connection, "Cannot access tasks");
+    }
+    
+    const char* project_id = route_param(params, "project_id");
+    
+    LOG_DEBUG("Extracted project_id: %s", project_id);
+    LOG_DEBUG("Authenticated user: %s with role: %s", auth.user_id, auth.role);
+    
+    char cache_key[RESPONSE_CACHE_KEY_SIZE];
+    snprintf(cache_key, sizeof(cache_key), "tasks|%s|%s|%s", project_id, auth.user_id, auth.role);
+    uint64_t version = response_cache_version(project_id);
+    unsigned int status;
+    struct MHD_Response* response = response_cache_lookup(connection, cache_key, version, &status);
+    if (response) {
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
         MHD_add_response_header(response, "Content-Type", "application/json");
-        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        int ret = MHD_queue_response(connection, status, response);
         MHD_destroy_response(response);
-        cJSON_Delete(json);
         return ret;
     }
 
-    // Update task members
-    if (strncmp(url, "/tasks/members/", 14) == 0 && strcmp(method, "PATCH") == 0) {
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // Check permission to assign tasks (only MANAGER allowed)
-        if (check_permission(&auth, PERM_ASSIGN_TASKS) != 0) {
-            return send_forbidden_response(connection, "Only managers can assign tasks to members");
-        }
-        
-        const char* task_id = url + 14;  // Skip "/tasks/members/"
-        // Skip any leading forward slash
-        while (*task_id == '/') {
-            task_id++;
-        }
-        printf("Processing members update for task ID: %s\n", task_id);
+    char* tasks = NULL;
+    
+    // Role-based access control
+    if (strcmp(auth.role, "MANAGER") == 0) {
+        // Managers can see all tasks in the project
+        LOG_DEBUG("Manager access: fetching all tasks for project");
+        tasks = get_tasks_by_project(project_id);
+    } else if (strcmp(auth.role, "USER") == 0) {
+        // Users can only see tasks they're involved in (creator or member)
+        // For now, let's simplify and just get user-specific tasks without project validation
+        // since the project validation is causing crashes
+        LOG_DEBUG("User access: fetching user-specific tasks without project validation");
+        tasks = get_user_tasks_by_project(project_id, auth.user_id);
+    } else {
+        return send_forbidden_response(connection, "Invalid role for task access");
+    }
+    
+    if (tasks) {
+        response = response_cache_store(connection, cache_key, version, tasks, &status);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, status, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+    
+    const char* error_response = "{\"error\": \"Failed to fetch tasks\"}";
+    response = MHD_create_response_from_buffer(
+        strlen(error_response),
+        (void*)error_response,
+        MHD_RESPMEM_PERSISTENT
+    );
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+    MHD_destroy_response(response);
+    return ret;
+}
 
-        if (!conn_info->json_data) {
-            const char* error_response = "{\"error\": \"No data received\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+// Stream task changes on a project as server-sent events
+static int handle_project_events(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // Only the Authorization header is read, a token in the query string would end up in access logs.
+    // Browsers open the stream with fetch, EventSource cannot set headers.
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
 
-        cJSON* json = cJSON_Parse(conn_info->json_data);
-        if (!json) {
-            const char* error_response = "{\"error\": \"Invalid JSON format\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    if (check_permission(&auth, PERM_READ_TASKS) != 0) {
+        return send_forbidden_response(connection, "Cannot access tasks");
+    }
 
-        cJSON* members_array = cJSON_GetObjectItem(json, "members");
-        if (!members_array || !cJSON_IsArray(members_array)) {
-            const char* error_response = "{\"error\": \"Invalid members array\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
-        }
+    // Deltas name tasks, statuses and members, so only the project's own people may follow them
+    const char* project_id = route_param(params, "project_id");
+    if (validate_project_member(project_id, auth.user_id) != 0) {
+        return send_forbidden_response(connection, "Not a member of this project");
+    }
+    LOG_DEBUG("Opening event stream for project %s", project_id);
 
-        int member_count = cJSON_GetArraySize(members_array);
-        const char** members = malloc(member_count * sizeof(char*));
-        for (int i = 0; i < member_count; i++) {
-            cJSON* member = cJSON_GetArrayItem(members_array, i);
-            if (cJSON_IsString(member)) {
-                members[i] = member->valuestring;
-            }
+    // Users only see their own tasks, so they are just told when to refetch
+    struct MHD_Response* response = board_events_subscribe(connection, project_id, strcmp(auth.role, "MANAGER") == 0);
+    if (response == NULL) {
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "text/event-stream");
+    MHD_add_response_header(response, "Cache-Control", "no-cache");
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Open tasks the user is a member of, across every project
+static int handle_get_my_tasks(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+
+    if (check_permission(&auth, PERM_READ_TASKS) != 0) {
+        return send_forbidden_response(connection, "Cannot access tasks");
+    }
+
+    const char* error_response = NULL;
+    unsigned int status = MHD_HTTP_BAD_REQUEST;
+    char* tasks = NULL;
+
+    int limit = MY_TASKS_DEFAULT_LIMIT;
+    const char* limit_param = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "limit");
+    const char* after = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "after");
+    if (limit_param) {
+        limit = atoi(limit_param);
+    }
+
+    if (limit < 1 || limit > MY_TASKS_MAX_LIMIT) {
+        error_response = "{\"error\": \"limit must be between 1 and 200\"}";
+    } else {
+        LOG_DEBUG("Fetching open tasks for user %s, limit %d, after %s", auth.user_id, limit, after ? after : "-");
+        tasks = get_user_open_tasks(auth.user_id, after, limit);
+        if (tasks == NULL) {
+            // A cursor that does not parse is the client's fault, anything else is ours
+            error_response = after ? "{\"error\": \"Invalid cursor\"}" : "{\"error\": \"Failed to fetch tasks\"}";
+            status = after ? MHD_HTTP_BAD_REQUEST : MHD_HTTP_INTERNAL_SERVER_ERROR;
         }
+    }
 
-        if (update_task_members(task_id, members, member_count) == 0) {
-            const char* success_response = "{\"status\": \"success\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(success_response),
-                (void*)success_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            free(members);
-            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
+    struct MHD_Response* response;
+    if (tasks) {
+        status = MHD_HTTP_OK;
+        response = create_request_response(tasks);
+    } else {
+        response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+    }
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    int ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Update task status
+static int handle_update_status(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // For task status updates, we need to check if user can update this specific task
+    // We'll validate this after we extract the task_id and check task membership
+    
+    const char* task_id = route_param(params, "task_id");
+    LOG_DEBUG("Processing status update for task ID: %s", task_id);
+
+    // Check if user can update this specific task
+    // MANAGERS can update any task, USERs can only update tasks they're involved in
+    if (strcmp(auth.role, "MANAGER") != 0) {
+        if (can_user_update_task(task_id, auth.user_id) != 0) {
+            return send_forbidden_response(connection, "You can only update status of tasks you're assigned to or created");
         }
+    }
 
-        free(members);
-        const char* error_response = "{\"error\": \"Failed to update task members\"}";
+    if (conn_info->json_size == 0) {
+        const char* error_response = "{\"error\": \"No data received\"}";
         struct MHD_Response* response = MHD_create_response_from_buffer(
             strlen(error_response),
             (void*)error_response,
@@ -426,268 +442,598 @@ static enum MHD_Result answer_to_connection(void* cls, struct MHD_Connection* co
         );
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
         MHD_add_response_header(response, "Content-Type", "application/json");
-        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
         MHD_destroy_response(response);
-        cJSON_Delete(json);
         return ret;
     }
 
-    // Add member to task
-    if (strncmp(url, "/tasks/", 7) == 0 && strstr(url, "/add-member") && strcmp(method, "POST") == 0) {
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // Check permission to assign tasks (only MANAGER allowed)
-        if (check_permission(&auth, PERM_ASSIGN_TASKS) != 0) {
-            return send_forbidden_response(connection, "Only managers can assign tasks to members");
-        }
-        
-        // Extract task ID from URL: /tasks/{task_id}/add-member
-        const char* task_id_start = url + 7; // Skip "/tasks/"
-        const char* add_member_pos = strstr(task_id_start, "/add-member");
-        if (!add_member_pos) {
-            const char* error_response = "{\"error\": \"Invalid URL format\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
-        
-        // Extract task ID
-        int task_id_len = add_member_pos - task_id_start;
-        char task_id[256];
-        strncpy(task_id, task_id_start, task_id_len);
-        task_id[task_id_len] = '\0';
-        
-        printf("Processing add member for task ID: %s\n", task_id);
-
-        if (!conn_info->json_data) {
-            const char* error_response = "{\"error\": \"No data received\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    cJSON* json = request_body_json(conn_info);
+    if (!json) {
+        const char* error_response = "{\"error\": \"Invalid JSON format\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-        cJSON* json = cJSON_Parse(conn_info->json_data);
-        if (!json) {
-            const char* error_response = "{\"error\": \"Invalid JSON format\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    cJSON* status_json = cJSON_GetObjectItem(json, "status");
+    if (!status_json || !cJSON_IsString(status_json)) {
+        const char* error_response = "{\"error\": \"Invalid status value\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
 
-        cJSON* member_id_json = cJSON_GetObjectItem(json, "member_id");
-        if (!member_id_json || !cJSON_IsString(member_id_json)) {
-            const char* error_response = "{\"error\": \"Missing or invalid member_id\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
-        }
+    TaskStatus new_status;
+    if (parse_task_status(status_json->valuestring, &new_status) != 0) {
+        const char* error_response = "{\"error\": \"Invalid status value\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
 
-        const char* member_id = member_id_json->valuestring;
-        int result = add_member_to_task(task_id, member_id);
-        
-        if (result == 0) {
-            const char* success_response = "{\"status\": \"success\", \"message\": \"Member added to task\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(success_response),
-                (void*)success_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
-        } else if (result == 2) {
-            const char* error_response = "{\"error\": \"User is not a member of this project\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
-        } else {
-            const char* error_response = "{\"error\": \"Failed to add member to task\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
-        }
+    if (update_task_status(task_id, new_status) == 0) {
+        invalidate_task_project(task_id);
+        const char* success_response = "{\"status\": \"success\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(success_response),
+            (void*)success_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
+
+    const char* error_response = "{\"error\": \"Failed to update task status\"}";
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        strlen(error_response),
+        (void*)error_response,
+        MHD_RESPMEM_PERSISTENT
+    );
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+    MHD_destroy_response(response);
+    cJSON_Delete(json);
+    return ret;
+}
+
+// Error for a batch request, index is the offending operation or -1 for the request as a whole
+static int send_batch_error(struct MHD_Connection* connection, unsigned int status, const char* message, int index) {
+    cJSON* error = cJSON_CreateObject();
+    cJSON_AddStringToObject(error, "error", message);
+    if (index >= 0) {
+        cJSON_AddNumberToObject(error, "index", index);
+    }
+    char* body = cJSON_PrintUnformatted(error);
+    cJSON_Delete(error);
+    if (body == NULL) {
+        return MHD_NO;
     }
+    struct MHD_Response* response = create_request_response(body);
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    int ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Reads one batch entry into op, returning the reason it is rejected or NULL
+static const char* parse_task_operation(const cJSON* item, const AuthContext* auth, TaskOperation* op,
+    unsigned int* status) {
+
+    memset(op, 0, sizeof(TaskOperation));
+    *status = MHD_HTTP_BAD_REQUEST;
+
+    cJSON* task_id = cJSON_GetObjectItem(item, "task_id");
+    if (!cJSON_IsString(task_id) || strlen(task_id->valuestring) != 24 ||
+        !bson_oid_is_valid(task_id->valuestring, 24)) {
+        return "Missing or invalid task_id";
+    }
+    op->task_id = task_id->valuestring;
 
-    // Remove member from task
-    if (strncmp(url, "/tasks/", 7) == 0 && strstr(url, "/remove-member") && strcmp(method, "POST") == 0) {
-        // Authenticate the request
-        AuthContext auth;
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
+    cJSON* status_json = cJSON_GetObjectItem(item, "status");
+    if (status_json) {
+        if (!cJSON_IsString(status_json) || parse_task_status(status_json->valuestring, &op->status) != 0) {
+            return "Invalid status value";
         }
-        
-        // Check permission to assign tasks (only MANAGER allowed)
-        if (check_permission(&auth, PERM_ASSIGN_TASKS) != 0) {
-            return send_forbidden_response(connection, "Only managers can assign tasks to members");
+        op->has_status = 1;
+    }
+
+    cJSON* members_json = cJSON_GetObjectItem(item, "members");
+    if (members_json) {
+        if (!cJSON_IsArray(members_json)) {
+            return "Invalid members array";
         }
-        
-        // Extract task ID from URL: /tasks/{task_id}/remove-member
-        const char* task_id_start = url + 7; // Skip "/tasks/"
-        const char* remove_member_pos = strstr(task_id_start, "/remove-member");
-        if (!remove_member_pos) {
-            const char* error_response = "{\"error\": \"Invalid URL format\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
+        if (check_permission(auth, PERM_ASSIGN_TASKS) != 0) {
+            *status = MHD_HTTP_FORBIDDEN;
+            return "Only managers can assign tasks to members";
         }
-        
-        // Extract task ID
-        int task_id_len = remove_member_pos - task_id_start;
-        char task_id[256];
-        strncpy(task_id, task_id_start, task_id_len);
-        task_id[task_id_len] = '\0';
-        
-        printf("Processing remove member for task ID: %s\n", task_id);
-
-        if (!conn_info->json_data) {
-            const char* error_response = "{\"error\": \"No data received\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
+        op->member_count = cJSON_GetArraySize(members_json);
+        op->members = request_malloc((op->member_count + 1) * sizeof(char*));
+        int i = 0;
+        cJSON* member;
+        cJSON_ArrayForEach(member, members_json) {
+            if (!cJSON_IsString(member)) {
+                return "Invalid members array";
+            }
+            op->members[i++] = member->valuestring;
         }
+    }
 
-        cJSON* json = cJSON_Parse(conn_info->json_data);
-        if (!json) {
-            const char* error_response = "{\"error\": \"Invalid JSON format\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
-            return ret;
-        }
+    if (!op->has_status && !op->members) {
+        return "Operation changes neither status nor members";
+    }
+    return NULL;
+}
 
-        cJSON* member_id_json = cJSON_GetObjectItem(json, "member_id");
-        if (!member_id_json || !cJSON_IsString(member_id_json)) {
-            const char* error_response = "{\"error\": \"Missing or invalid member_id\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
+// Apply status and member changes to several tasks in one bulk write
+static int handle_batch_update(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+
+    cJSON* json = request_body_json(conn_info);
+    if (!json) {
+        return send_batch_error(connection, MHD_HTTP_BAD_REQUEST, "Invalid JSON format", -1);
+    }
+
+    cJSON* operations = cJSON_GetObjectItem(json, "operations");
+    int count = cJSON_IsArray(operations) ? cJSON_GetArraySize(operations) : 0;
+    if (count == 0 || count > BATCH_MAX_OPERATIONS) {
+        cJSON_Delete(json);
+        return send_batch_error(connection, MHD_HTTP_BAD_REQUEST, "operations must hold 1 to 100 entries", -1);
+    }
+
+    // Every entry is checked before anything is written, so a rejected batch changes nothing
+    TaskOperation* ops = request_malloc(count * sizeof(TaskOperation));
+    int index = 0;
+    cJSON* item;
+    cJSON_ArrayForEach(item, operations) {
+        unsigned int status;
+        const char* error = parse_task_operation(item, &auth, &ops[index], &status);
+        if (error) {
             cJSON_Delete(json);
-            return ret;
+            return send_batch_error(connection, status, error, index);
         }
+        index++;
+    }
 
-        const char* member_id = member_id_json->valuestring;
-        int result = remove_member_from_task(task_id, member_id);
-        
-        if (result == 0) {
-            const char* success_response = "{\"status\": \"success\", \"message\": \"Member removed from task\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(success_response),
-                (void*)success_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-            MHD_destroy_response(response);
-            cJSON_Delete(json);
-            return ret;
-        } else if (result == 2) {
-            const char* error_response = "{\"error\": \"Cannot remove member from completed task\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
+    if (find_task_operations(ops, count, auth.user_id) != 0) {
+        cJSON_Delete(json);
+        return send_batch_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "Failed to look up tasks", -1);
+    }
+
+    // MANAGERS can update any task, USERs only the ones they're involved in
+    int may_update_any = check_permission(&auth, PERM_UPDATE_TASKS) == 0;
+    for (int i = 0; i < count; i++) {
+        if (ops[i].project_id[0] == '\0') {
             cJSON_Delete(json);
-            return ret;
-        } else {
-            const char* error_response = "{\"error\": \"Failed to remove member from task\"}";
-            struct MHD_Response* response = MHD_create_response_from_buffer(
-                strlen(error_response),
-                (void*)error_response,
-                MHD_RESPMEM_PERSISTENT
-            );
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            MHD_add_response_header(response, "Content-Type", "application/json");
-            int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
-            MHD_destroy_response(response);
+            return send_batch_error(connection, MHD_HTTP_NOT_FOUND, "Task not found", i);
+        }
+        if (ops[i].has_status && !may_update_any && !ops[i].involved) {
             cJSON_Delete(json);
-            return ret;
+            return send_batch_error(connection, MHD_HTTP_FORBIDDEN,
+                "You can only update status of tasks you're assigned to or created", i);
         }
     }
 
+    if (bulk_update_tasks(ops, count) != 0) {
+        cJSON_Delete(json);
+        return send_batch_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "Failed to update tasks", -1);
+    }
+
+    for (int i = 0; i < count; i++) {
+        response_cache_invalidate(ops[i].project_id);
+    }
+    cJSON_Delete(json);
+
+    char success_response[64];
+    snprintf(success_response, sizeof(success_response), "{\"status\": \"success\", \"updated\": %d}", count);
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        strlen(success_response),
+        (void*)success_response,
+        MHD_RESPMEM_MUST_COPY
+    );
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Update task members
+static int handle_update_members(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to assign tasks (only MANAGER allowed)
+    if (check_permission(&auth, PERM_ASSIGN_TASKS) != 0) {
+        return send_forbidden_response(connection, "Only managers can assign tasks to members");
+    }
+    
+    const char* task_id = route_param(params, "task_id");
+    LOG_DEBUG("Processing members update for task ID: %s", task_id);
+
+    if (conn_info->json_size == 0) {
+        const char* error_response = "{\"error\": \"No data received\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+
+    cJSON* json = request_body_json(conn_info);
+    if (!json) {
+        const char* error_response = "{\"error\": \"Invalid JSON format\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+
+    cJSON* members_array = cJSON_GetObjectItem(json, "members");
+    if (!members_array || !cJSON_IsArray(members_array)) {
+        const char* error_response = "{\"error\": \"Invalid members array\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
+
+    int member_count = cJSON_GetArraySize(members_array);
+    const char** members = request_malloc(member_count * sizeof(char*));
+    for (int i = 0; i < member_count; i++) {
+        cJSON* member = cJSON_GetArrayItem(members_array, i);
+        if (cJSON_IsString(member)) {
+            members[i] = member->valuestring;
+        }
+    }
+
+    if (update_task_members(task_id, members, member_count) == 0) {
+        invalidate_task_project(task_id);
+        const char* success_response = "{\"status\": \"success\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(success_response),
+            (void*)success_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        request_free(members);
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
+
+    request_free(members);
+    const char* error_response = "{\"error\": \"Failed to update task members\"}";
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        strlen(error_response),
+        (void*)error_response,
+        MHD_RESPMEM_PERSISTENT
+    );
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+    MHD_destroy_response(response);
+    cJSON_Delete(json);
+    return ret;
+}
+
+// Add member to task
+static int handle_add_member(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to assign tasks (only MANAGER allowed)
+    if (check_permission(&auth, PERM_ASSIGN_TASKS) != 0) {
+        return send_forbidden_response(connection, "Only managers can assign tasks to members");
+    }
+    
+    const char* task_id = route_param(params, "task_id");
+    
+    LOG_DEBUG("Processing add member for task ID: %s", task_id);
+
+    if (conn_info->json_size == 0) {
+        const char* error_response = "{\"error\": \"No data received\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+
+    cJSON* json = request_body_json(conn_info);
+    if (!json) {
+        const char* error_response = "{\"error\": \"Invalid JSON format\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+
+    cJSON* member_id_json = cJSON_GetObjectItem(json, "member_id");
+    if (!member_id_json || !cJSON_IsString(member_id_json)) {
+        const char* error_response = "{\"error\": \"Missing or invalid member_id\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
+
+    const char* member_id = member_id_json->valuestring;
+    int result = add_member_to_task(task_id, member_id);
+    if (result == 0) {
+        invalidate_task_project(task_id);
+    }
+    
+    if (result == 0) {
+        const char* success_response = "{\"status\": \"success\", \"message\": \"Member added to task\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(success_response),
+            (void*)success_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    } else if (result == 2) {
+        const char* error_response = "{\"error\": \"User is not a member of this project\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    } else {
+        const char* error_response = "{\"error\": \"Failed to add member to task\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
+}
+
+// Remove member from task
+static int handle_remove_member(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // Authenticate the request
+    AuthContext auth;
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to assign tasks (only MANAGER allowed)
+    if (check_permission(&auth, PERM_ASSIGN_TASKS) != 0) {
+        return send_forbidden_response(connection, "Only managers can assign tasks to members");
+    }
+    
+    const char* task_id = route_param(params, "task_id");
+    
+    LOG_DEBUG("Processing remove member for task ID: %s", task_id);
+
+    if (conn_info->json_size == 0) {
+        const char* error_response = "{\"error\": \"No data received\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+
+    cJSON* json = request_body_json(conn_info);
+    if (!json) {
+        const char* error_response = "{\"error\": \"Invalid JSON format\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+
+    cJSON* member_id_json = cJSON_GetObjectItem(json, "member_id");
+    if (!member_id_json || !cJSON_IsString(member_id_json)) {
+        const char* error_response = "{\"error\": \"Missing or invalid member_id\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
+
+    const char* member_id = member_id_json->valuestring;
+    int result = remove_member_from_task(task_id, member_id);
+    if (result == 0) {
+        invalidate_task_project(task_id);
+    }
+    
+    if (result == 0) {
+        const char* success_response = "{\"status\": \"success\", \"message\": \"Member removed from task\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(success_response),
+            (void*)success_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    } else if (result == 2) {
+        const char* error_response = "{\"error\": \"Cannot remove member from completed task\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    } else {
+        const char* error_response = "{\"error\": \"Failed to remove member from task\"}";
+        struct MHD_Response* response = MHD_create_response_from_buffer(
+            strlen(error_response),
+            (void*)error_response,
+            MHD_RESPMEM_PERSISTENT
+        );
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return ret;
+    }
+}
+
+static const Route routes[] = {
+    { ROUTE_GET, "/metrics", handle_metrics },
+    { ROUTE_POST, "/tasks", handle_create_task },
+    { ROUTE_POST, "/tasks/batch", handle_batch_update },
+    { ROUTE_GET, "/tasks/mine", handle_get_my_tasks },
+    { ROUTE_GET, "/tasks/project/{project_id}", handle_get_project_tasks },
+    { ROUTE_GET, "/tasks/project/{project_id}/events", handle_project_events },
+    { ROUTE_PATCH, "/tasks/status/{task_id}", handle_update_status },
+    { ROUTE_PATCH, "/tasks/members/{task_id}", handle_update_members },
+    { ROUTE_POST, "/tasks/{task_id}/add-member", handle_add_member },
+    { ROUTE_POST, "/tasks/{task_id}/remove-member", handle_remove_member },
+};
+
+static Router router;
+
+static enum MHD_Result route_request(void* cls, struct MHD_Connection* connection,
+    const char* url, const char* method, const char* version,
+    const char* upload_data, size_t* upload_data_size, void** con_cls) {
+
+    LOG_DEBUG("Incoming request: %s %s", method, url);
+
+    if (strcmp(method, "OPTIONS") == 0) {
+        struct MHD_Response* response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Access-Control-Allow-Methods", "GET, POST, PATCH, OPTIONS");
+        MHD_add_response_header(response, "Access-Control-Allow-Headers", "Content-Type, Authorization");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+
+    RouteParams params;
+    const Route* route = router_match(&router, method, url, &params);
+    if (route != NULL) {
+        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
+        conn_info->route_series = metrics_route_series(method, route->pattern);
+        return route->handler(connection, conn_info, &params);
+    }
+
     // Handle 404 for unmatched routes
     const char* not_found = "404 - Not Found";
     struct MHD_Response* response = MHD_create_response_from_buffer(
@@ -701,44 +1047,78 @@ static enum MHD_Result answer_to_connection(void* cls, struct MHD_Connection* co
     return ret;
 }
 
+static enum MHD_Result answer_to_connection(void* cls, struct MHD_Connection* connection,
+    const char* url, const char* method, const char* version,
+    const char* upload_data, size_t* upload_data_size, void** con_cls) {
+
+    struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
+
+    if (conn_info == NULL) {
+        return request_begin(connection, url, method, con_cls);
+    }
+    if (*upload_data_size > 0 || conn_info->rejected) {
+        return request_append(connection, conn_info, upload_data, upload_data_size);
+    }
+
+    arena_activate(conn_info->arena);
+    enum MHD_Result ret = route_request(cls, connection, url, method, version, upload_data, upload_data_size, con_cls);
+    arena_activate(NULL);
+    return ret;
+}
+
 int main() {
+    log_init("task-service");
 
     const char *var_name = "HMAC_KEY";
     char *hmac_key = getenv(var_name);
     if (!hmac_key) {
-        fprintf(stderr, "Cannot find HMAC key\n");
+        LOG_ERROR("Cannot find HMAC key");
         return 1;
     }
 
-    struct MHD_Daemon* daemon;
+    Listeners listeners;
     
     char* port_env = getenv("PORT");
     int port = port_env ? atoi(port_env) : PORT;
 
     if (repo() != 0) {
-        printf("Failed to initialize repository\n");
+        LOG_ERROR("Failed to initialize repository");
         return 1;
     }
 
-    daemon = MHD_start_daemon(
-        MHD_USE_SELECT_INTERNALLY,
-        port,
-        NULL,
-        NULL,
-        &answer_to_connection,
-        NULL,
-        MHD_OPTION_END
-    );
+    if (ensure_task_indexes() != 0) {
+        LOG_WARN("Failed to create task indexes");
+    }
+
+    request_init();
+    response_cache_init();
+    compression_init();
 
-    if (NULL == daemon) {
-        printf("Failed to start server\n");
+    // Event streams are fed from these, so they also see writes made elsewhere
+    if (cache_watcher_start("tasks", "tasks", "project_id", board_task_change) != 0 ||
+        cache_watcher_start("trello", "projects", NULL, board_project_change) != 0) {
+        LOG_WARN("Failed to start change stream watcher");
+    }
+
+    if (board_events_init() != 0) {
+        LOG_ERROR("Failed to start event stream heartbeat");
         return 1;
     }
 
-    printf("Server running on port %d\n", port);
-    printf("Press Enter to stop the server...\n");
+    if (router_init(&router, routes, sizeof(routes) / sizeof(routes[0])) != 0) {
+        LOG_ERROR("Failed to build route table");
+        return 1;
+    }
+
+    if (listeners_start(&listeners, MHD_USE_SELECT_INTERNALLY | MHD_ALLOW_SUSPEND_RESUME, port,
+        &answer_to_connection, &request_completed) != 0) {
+        LOG_ERROR("Failed to start server");
+        return 1;
+    }
+    LOG_INFO("Press Enter to stop the server...");
     pause();  // Explicitly ignore return value
 
-    MHD_stop_daemon(daemon);
+    listeners_stop(&listeners);
+    log_shutdown();
     return 0;
 }
\ No newline at end of file
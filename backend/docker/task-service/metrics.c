@@ -0,0 +1,450 @@
+#include "metrics.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SERIES_INDEX_SIZE 256     // Open addressing, power of two above 2 * METRICS_MAX_SERIES
+
+// 16 linear sub-buckets per power of two keeps every bucket within ~6%
+#define SUB_BUCKET_BITS 4
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define HISTOGRAM_MAX_EXPONENT 32 // Values are clamped below 2^32 us, about 71 minutes
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS)
+
+typedef struct {
+    const char* name;
+    const char* help;
+    const char* type;
+    const char* label_name;
+    const char* quantile_name;  // Histograms only
+} FamilyInfo;
+
+static const FamilyInfo families[METRIC_FAMILY_COUNT] = {
+    [METRIC_HTTP_IN_FLIGHT] = { "http_requests_in_flight", "Requests currently being handled.", "gauge", NULL, NULL },
+    [METRIC_HTTP_DURATION] = { "http_request_duration_seconds", "Time from the first byte of a request to the end of its response.", "histogram", "route", "http_request_duration_quantile_seconds" },
+    [METRIC_MONGO_DURATION] = { "mongo_operation_duration_seconds", "Time spent in each repository function.", "histogram", "operation", "mongo_operation_duration_quantile_seconds" },
+    [METRIC_UPSTREAM_DURATION] = { "upstream_request_duration_seconds", "Time spent waiting on a proxied service.", "histogram", "service", "upstream_request_duration_quantile_seconds" },
+    [METRIC_JWT_VERIFICATIONS] = { "jwt_verifications_total", "Bearer tokens checked, by outcome.", "counter", "result", NULL },
+    [METRIC_CACHE_REQUESTS] = { "response_cache_requests_total", "Cacheable reads, by whether they were served from the response cache.", "counter", "result", NULL },
+    [METRIC_COALESCED_REQUESTS] = { "coalesced_requests_total", "Identical concurrent GETs, by whether they went upstream or shared another's response.", "counter", "result", NULL },
+    [METRIC_REJECTED_REQUESTS] = { "rejected_requests_total", "Requests turned away by the rate limits, shed under load or failed by an open breaker.", "counter", "reason", NULL },
+    [METRIC_UPSTREAM_RETRIES] = { "upstream_retries_total", "Proxied calls repeated after a failure, within the retry budget.", "counter", "service", NULL },
+    [METRIC_HEDGED_REQUESTS] = { "hedged_requests_total", "Slow GETs sent to a second instance, by whether the hedge answered first.", "counter", "result", NULL },
+};
+
+// Bucket bounds exported to Prometheus, in seconds
+static const double export_bounds[] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+};
+
+static const double export_quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+typedef struct {
+    MetricFamily family;
+    char label[METRICS_LABEL_SIZE];
+} Series;
+
+/**
+ * Written only by the thread that owns the shard, so plain load and store
+ * is enough to increment and a scrape never sees a torn value.
+ */
+typedef struct {
+    _Atomic uint64_t sum;
+    _Atomic uint64_t buckets[HISTOGRAM_BUCKETS];
+} Histogram;
+
+// Per-thread histograms, allocated on first use and never freed
+typedef struct MetricsShard {
+    struct MetricsShard* next;
+    _Atomic(Histogram*) histograms[METRICS_MAX_SERIES];
+} MetricsShard;
+
+static Series series_table[METRICS_MAX_SERIES];
+static atomic_int series_count = 0;
+static atomic_int series_index[SERIES_INDEX_SIZE];     // Series id + 1, 0 when empty
+static pthread_mutex_t register_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Atomic int64_t values[METRICS_MAX_SERIES];     // Counters and gauges
+
+static _Atomic(MetricsShard*) shards = NULL;
+static __thread MetricsShard* thread_shard = NULL;
+
+static uint32_t hash_series(MetricFamily family, const char* label) {
+    uint32_t hash = 2166136261u ^ (uint32_t)family;
+    for (const char* p = label; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    return hash;
+}
+
+static int find_series(MetricFamily family, const char* label, uint32_t hash) {
+    for (uint32_t i = 0; i < SERIES_INDEX_SIZE; i++) {
+        int slot = atomic_load_explicit(&series_index[(hash + i) & (SERIES_INDEX_SIZE - 1)], memory_order_acquire);
+        if (slot == 0) {
+            return -1;
+        }
+        Series* series = &series_table[slot - 1];
+        if (series->family == family && strcmp(series->label, label) == 0) {
+            return slot - 1;
+        }
+    }
+    return -1;
+}
+
+static int register_series(MetricFamily family, const char* label, uint32_t hash) {
+    pthread_mutex_lock(&register_lock);
+    int id = find_series(family, label, hash);
+    if (id < 0) {
+        // Keep room for one "other" series per family
+        int count = atomic_load(&series_count);
+        if (count >= METRICS_MAX_SERIES - METRIC_FAMILY_COUNT && strcmp(label, "other") != 0) {
+            pthread_mutex_unlock(&register_lock);
+            return metrics_series(family, "other");
+        }
+        id = count;
+        series_table[id].family = family;
+        snprintf(series_table[id].label, sizeof(series_table[id].label), "%s", label);
+        atomic_store(&series_count, count + 1);
+
+        uint32_t i = hash;
+        while (atomic_load(&series_index[i & (SERIES_INDEX_SIZE - 1)]) != 0) {
+            i++;
+        }
+        // Publishing the slot last makes the entry visible to lock-free readers
+        atomic_store_explicit(&series_index[i & (SERIES_INDEX_SIZE - 1)], id + 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&register_lock);
+    return id;
+}
+
+int metrics_find_series(MetricFamily family, const char* label) {
+    char key[METRICS_LABEL_SIZE];
+    snprintf(key, sizeof(key), "%s", label ? label : "");
+    return find_series(family, key, hash_series(family, key));
+}
+
+int metrics_series(MetricFamily family, const char* label) {
+    char key[METRICS_LABEL_SIZE];
+    snprintf(key, sizeof(key), "%s", label ? label : "");
+
+    uint32_t hash = hash_series(family, key);
+    int id = find_series(family, key, hash);
+    return id >= 0 ? id : register_series(family, key, hash);
+}
+
+static int is_id_segment(const char* segment, size_t length) {
+    if (length == 0) {
+        return 0;
+    }
+    int all_digits = 1;
+    int all_hex = 1;
+    for (size_t i = 0; i < length; i++) {
+        char c = segment[i];
+        if (c < '0' || c > '9') {
+            all_digits = 0;
+            if (!((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
+                all_hex = 0;
+            }
+        }
+    }
+    return all_digits || (all_hex && length == 24);
+}
+
+void metrics_route_label(char* label, size_t size, const char* method, const char* url) {
+    int length = snprintf(label, size, "%s ", method);
+
+    const char* p = url;
+    while (*p && length < (int)size - 1) {
+        if (*p == '/') {
+            label[length++] = *p++;
+            continue;
+        }
+        const char* end = strchr(p, '/');
+        size_t segment_length = end ? (size_t)(end - p) : strlen(p);
+        if (is_id_segment(p, segment_length)) {
+            length += snprintf(label + length, size - length, "{id}");
+        }
+        else {
+            length += snprintf(label + length, size - length, "%.*s", (int)segment_length, p);
+        }
+        p += segment_length;
+    }
+    if (length > (int)size - 1) {
+        length = size - 1;
+    }
+    label[length] = '\0';
+}
+
+int metrics_route_series(const char* method, const char* route) {
+    if (route == NULL) {
+        return metrics_series(METRIC_HTTP_DURATION, "unmatched");
+    }
+    char label[METRICS_LABEL_SIZE];
+    snprintf(label, sizeof(label), "%s %s", method, route);
+    return metrics_series(METRIC_HTTP_DURATION, label);
+}
+
+uint64_t metrics_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int bucket_index(uint64_t value) {
+    if (value >= (1ULL << HISTOGRAM_MAX_EXPONENT)) {
+        value = (1ULL << HISTOGRAM_MAX_EXPONENT) - 1;
+    }
+    if (value < SUB_BUCKETS) {
+        return (int)value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int sub_bucket = (int)(value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+// Largest value that lands in the bucket
+static uint64_t bucket_upper(int index) {
+    if (index < SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint64_t width = 1ULL << (exponent - SUB_BUCKET_BITS);
+    return ((uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << (exponent - SUB_BUCKET_BITS)) + width - 1;
+}
+
+static MetricsShard* get_thread_shard(void) {
+    if (thread_shard) {
+        return thread_shard;
+    }
+    MetricsShard* shard = calloc(1, sizeof(MetricsShard));
+    if (shard == NULL) {
+        return NULL;
+    }
+    MetricsShard* head = atomic_load(&shards);
+    do {
+        shard->next = head;
+    } while (!atomic_compare_exchange_weak(&shards, &head, shard));
+    thread_shard = shard;
+    return shard;
+}
+
+static inline void bump(_Atomic uint64_t* counter, uint64_t delta) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + delta, memory_order_relaxed);
+}
+
+void metrics_observe(int series, uint64_t micros) {
+    if (series < 0 || series >= METRICS_MAX_SERIES) {
+        return;
+    }
+    MetricsShard* shard = get_thread_shard();
+    if (shard == NULL) {
+        return;
+    }
+    Histogram* histogram = atomic_load_explicit(&shard->histograms[series], memory_order_relaxed);
+    if (histogram == NULL) {
+        histogram = calloc(1, sizeof(Histogram));
+        if (histogram == NULL) {
+            return;
+        }
+        atomic_store_explicit(&shard->histograms[series], histogram, memory_order_release);
+    }
+    bump(&histogram->buckets[bucket_index(micros)], 1);
+    bump(&histogram->sum, micros);
+}
+
+void metrics_add(int series, int64_t delta) {
+    if (series < 0 || series >= METRICS_MAX_SERIES) {
+        return;
+    }
+    atomic_fetch_add_explicit(&values[series], delta, memory_order_relaxed);
+}
+
+void metrics_timer_stop(MetricsTimer* timer) {
+    metrics_observe(timer->series, metrics_now() - timer->start);
+}
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+static void append(Buffer* buffer, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static void append(Buffer* buffer, const char* format, ...) {
+    if (buffer->data == NULL) {
+        return;
+    }
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer->data + buffer->size, buffer->capacity - buffer->size, format, args);
+        va_end(args);
+        if (length < 0) {
+            return;
+        }
+        if (buffer->size + length < buffer->capacity) {
+            buffer->size += length;
+            return;
+        }
+        char* data = realloc(buffer->data, buffer->capacity * 2 + length);
+        if (data == NULL) {
+            free(buffer->data);
+            buffer->data = NULL;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = buffer->capacity * 2 + length;
+    }
+}
+
+// Label values come from request URLs, so quote them properly
+static void append_label(Buffer* buffer, const FamilyInfo* family, const char* value, const char* extra) {
+    if (family->label_name == NULL && extra == NULL) {
+        return;
+    }
+    append(buffer, "{");
+    if (family->label_name) {
+        append(buffer, "%s=\"", family->label_name);
+        for (const char* p = value; *p; p++) {
+            if (*p == '"' || *p == '\\') {
+                append(buffer, "\\%c", *p);
+            }
+            else if (*p == '\n') {
+                append(buffer, "\\n");
+            }
+            else {
+                append(buffer, "%c", *p);
+            }
+        }
+        append(buffer, "\"%s", extra ? "," : "");
+    }
+    append(buffer, "%s}", extra ? extra : "");
+}
+
+// Sums every thread's copy of a histogram, returns the total count
+static uint64_t merge_histogram(int series, uint64_t* buckets, uint64_t* sum) {
+    uint64_t count = 0;
+    memset(buckets, 0, sizeof(uint64_t) * HISTOGRAM_BUCKETS);
+    *sum = 0;
+
+    for (MetricsShard* shard = atomic_load(&shards); shard; shard = shard->next) {
+        Histogram* histogram = atomic_load_explicit(&shard->histograms[series], memory_order_acquire);
+        if (histogram == NULL) {
+            continue;
+        }
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            buckets[i] += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        }
+        *sum += atomic_load_explicit(&histogram->sum, memory_order_relaxed);
+    }
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        count += buckets[i];
+    }
+    return count;
+}
+
+static void render_histogram(Buffer* buffer, const FamilyInfo* family, int series) {
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t sum;
+    uint64_t count = merge_histogram(series, buckets, &sum);
+
+    const char* label = series_table[series].label;
+    char extra[32];
+    uint64_t cumulative = 0;
+    int index = 0;
+    for (size_t b = 0; b < sizeof(export_bounds) / sizeof(export_bounds[0]); b++) {
+        uint64_t bound = (uint64_t)(export_bounds[b] * 1e6);
+        while (index < HISTOGRAM_BUCKETS && bucket_upper(index) <= bound) {
+            cumulative += buckets[index++];
+        }
+        snprintf(extra, sizeof(extra), "le=\"%g\"", export_bounds[b]);
+        append(buffer, "%s_bucket", family->name);
+        append_label(buffer, family, label, extra);
+        append(buffer, " %llu\n", (unsigned long long)cumulative);
+    }
+    append(buffer, "%s_bucket", family->name);
+    append_label(buffer, family, label, "le=\"+Inf\"");
+    append(buffer, " %llu\n", (unsigned long long)count);
+
+    append(buffer, "%s_sum", family->name);
+    append_label(buffer, family, label, NULL);
+    append(buffer, " %.6f\n", sum / 1e6);
+    append(buffer, "%s_count", family->name);
+    append_label(buffer, family, label, NULL);
+    append(buffer, " %llu\n", (unsigned long long)count);
+}
+
+// Percentiles straight from the HDR buckets, finer than the exported bounds allow
+static void render_quantiles(Buffer* buffer, const FamilyInfo* family, int series) {
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t sum;
+    uint64_t count = merge_histogram(series, buckets, &sum);
+    if (count == 0) {
+        return;
+    }
+
+    char extra[32];
+    for (size_t q = 0; q < sizeof(export_quantiles) / sizeof(export_quantiles[0]); q++) {
+        uint64_t rank = (uint64_t)(export_quantiles[q] * count + 0.5);
+        uint64_t seen = 0;
+        int i = 0;
+        while (i < HISTOGRAM_BUCKETS - 1 && seen + buckets[i] < rank) {
+            seen += buckets[i++];
+        }
+        snprintf(extra, sizeof(extra), "quantile=\"%g\"", export_quantiles[q]);
+        append(buffer, "%s", family->quantile_name);
+        append_label(buffer, family, series_table[series].label, extra);
+        append(buffer, " %.6f\n", bucket_upper(i) / 1e6);
+    }
+}
+
+char* metrics_render(void) {
+    Buffer buffer = { malloc(4096), 0, 4096 };
+    int count = atomic_load(&series_count);
+
+    for (int f = 0; f < METRIC_FAMILY_COUNT; f++) {
+        const FamilyInfo* family = &families[f];
+        int has_series = 0;
+        for (int s = 0; s < count && !has_series; s++) {
+            has_series = series_table[s].family == (MetricFamily)f;
+        }
+        if (!has_series) {
+            continue;
+        }
+
+        append(&buffer, "# HELP %s %s\n# TYPE %s %s\n", family->name, family->help, family->name, family->type);
+        for (int s = 0; s < count; s++) {
+            if (series_table[s].family != (MetricFamily)f) {
+                continue;
+            }
+            if (family->quantile_name) {
+                render_histogram(&buffer, family, s);
+            }
+            else {
+                append(&buffer, "%s", family->name);
+                append_label(&buffer, family, series_table[s].label, NULL);
+                append(&buffer, " %lld\n", (long long)atomic_load_explicit(&values[s], memory_order_relaxed));
+            }
+        }
+
+        if (family->quantile_name) {
+            append(&buffer, "# HELP %s %s\n# TYPE %s gauge\n", family->quantile_name,
+                "Percentiles of the histogram above, to within one HDR bucket.", family->quantile_name);
+            for (int s = 0; s < count; s++) {
+                if (series_table[s].family == (MetricFamily)f) {
+                    render_quantiles(&buffer, family, s);
+                }
+            }
+        }
+    }
+
+    if (buffer.data && buffer.size == 0) {
+        buffer.data[0] = '\0';
+    }
+    return buffer.data;
+}
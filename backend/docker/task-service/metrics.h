@@ -0,0 +1,78 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Upper bound on distinct label values across all families
+#define METRICS_MAX_SERIES 128
+
+// Longer labels are cut, the terminator included
+#define METRICS_LABEL_SIZE 96
+
+typedef enum {
+    METRIC_HTTP_IN_FLIGHT,      // gauge
+    METRIC_HTTP_DURATION,       // histogram, label route
+    METRIC_MONGO_DURATION,      // histogram, label operation
+    METRIC_UPSTREAM_DURATION,   // histogram, label service
+    METRIC_JWT_VERIFICATIONS,   // counter, label result
+    METRIC_CACHE_REQUESTS,      // counter, label result
+    METRIC_COALESCED_REQUESTS,  // counter, label result
+    METRIC_REJECTED_REQUESTS,   // counter, label reason
+    METRIC_UPSTREAM_RETRIES,    // counter, label service
+    METRIC_HEDGED_REQUESTS,     // counter, label result
+    METRIC_FAMILY_COUNT
+} MetricFamily;
+
+/**
+ * Returns the series for a family and label value, registering it on first
+ * use. Lookups are lock-free, only registration takes a mutex. Once
+ * METRICS_MAX_SERIES is reached new labels are folded into "other".
+ */
+int metrics_series(MetricFamily family, const char* label);
+
+/**
+ * Series for a matched route, labelled "METHOD pattern" with the pattern
+ * from the route table. A NULL route gives the one "unmatched" series, so
+ * 404s and scanned paths never take up room in the series table.
+ */
+int metrics_route_series(const char* method, const char* route);
+
+/**
+ * Route label for a raw path, with 24 character ObjectIds and numeric
+ * segments replaced by {id}, for callers without a route table.
+ */
+void metrics_route_label(char* label, size_t size, const char* method, const char* url);
+
+// Series already registered for a label, -1 when there is none yet
+int metrics_find_series(MetricFamily family, const char* label);
+
+// Monotonic clock in microseconds
+uint64_t metrics_now(void);
+
+/**
+ * Records a value in microseconds. Histograms are HDR-style log-linear
+ * buckets kept per thread, so recording never contends with other threads
+ * or with a scrape.
+ */
+void metrics_observe(int series, uint64_t micros);
+
+// Adds to a counter or gauge
+void metrics_add(int series, int64_t delta);
+
+// Prometheus text exposition of every series, caller frees
+char* metrics_render(void);
+
+typedef struct {
+    int series;
+    uint64_t start;
+} MetricsTimer;
+
+void metrics_timer_stop(MetricsTimer* timer);
+
+// Times the rest of the enclosing scope, whichever way it is left
+#define METRICS_TIME_SCOPE(family, label) \
+    MetricsTimer metrics_scope_timer __attribute__((cleanup(metrics_timer_stop))) = \
+        { metrics_series((family), (label)), metrics_now() }
+
+#endif
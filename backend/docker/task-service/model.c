@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <cjson/cJSON.h>
+#include "logger.h"
 
 int parse_task_from_json(const cJSON* json, Task* task) {
     // Clear the structure first
@@ -16,39 +17,39 @@ int parse_task_from_json(const cJSON* json, Task* task) {
     cJSON* status_str = cJSON_GetObjectItem(json, "status");
 
     // Debug print the received values
-    printf("Received JSON:\n");
-    printf("Project ID: %s\n", project_id ? project_id->valuestring : "NULL");
-    printf("Name: %s\n", name ? name->valuestring : "NULL");
-    printf("Description: %s\n", description ? description->valuestring : "NULL");
-    printf("Creator ID: %s\n", creator_id ? creator_id->valuestring : "NULL");
+    LOG_DEBUG("Received JSON:");
+    LOG_DEBUG("Project ID: %s", project_id ? project_id->valuestring : "NULL");
+    LOG_DEBUG("Name: %s", name ? name->valuestring : "NULL");
+    LOG_DEBUG("Description: %s", description ? description->valuestring : "NULL");
+    LOG_DEBUG("Creator ID: %s", creator_id ? creator_id->valuestring : "NULL");
 
     // Validate required fields
     if (!project_id || !name || !description || !members || !creator_id ||
         !cJSON_IsString(project_id) || !cJSON_IsString(name) ||
         !cJSON_IsString(description) || !cJSON_IsArray(members) ||
         !cJSON_IsString(creator_id)) {
-        printf("Missing or invalid required fields\n");
-        if (!project_id) printf("project_id is NULL\n");
-        if (!name) printf("name is NULL\n");
-        if (!description) printf("description is NULL\n");
-        if (!members) printf("members is NULL\n");
-        if (!creator_id) printf("creator_id is NULL\n");
+        LOG_WARN("Missing or invalid required fields");
+        if (!project_id) LOG_DEBUG("project_id is NULL");
+        if (!name) LOG_DEBUG("name is NULL");
+        if (!description) LOG_DEBUG("description is NULL");
+        if (!members) LOG_DEBUG("members is NULL");
+        if (!creator_id) LOG_DEBUG("creator_id is NULL");
         return 1;
     }
 
     // Validate string lengths
     if (strlen(project_id->valuestring) >= MAX_STRING_LENGTH) {
-        printf("Project ID string too long: %zu chars (max: %d)\n",
+        LOG_WARN("Project ID string too long: %zu chars (max: %d)",
             strlen(project_id->valuestring), MAX_STRING_LENGTH);
         return 1;
     }
     if (strlen(name->valuestring) >= MAX_STRING_LENGTH) {
-        printf("Name string too long: %zu chars (max: %d)\n",
+        LOG_WARN("Name string too long: %zu chars (max: %d)",
             strlen(name->valuestring), MAX_STRING_LENGTH);
         return 1;
     }
     if (strlen(description->valuestring) >= MAX_DESCRIPTION_LENGTH) {
-        printf("Description string too long: %zu chars (max: %d)\n",
+        LOG_WARN("Description string too long: %zu chars (max: %d)",
             strlen(description->valuestring), MAX_DESCRIPTION_LENGTH);
         return 1;
     }
@@ -66,17 +67,17 @@ int parse_task_from_json(const cJSON* json, Task* task) {
     int member_count = cJSON_GetArraySize(members);
     task->member_count = 0;
 
-    printf("Processing %d members\n", member_count);
+    LOG_DEBUG("Processing %d members", member_count);
 
     for (int i = 0; i < member_count && i < MAX_MEMBERS; i++) {
         cJSON* member = cJSON_GetArrayItem(members, i);
         if (!cJSON_IsString(member)) {
-            printf("Member %d is not a string\n", i);
+            LOG_DEBUG("Member %d is not a string", i);
             continue;
         }
 
         if (strlen(member->valuestring) >= MAX_STRING_LENGTH) {
-            printf("Member name too long at index %d\n", i);
+            LOG_WARN("Member name too long at index %d", i);
             continue;
         }
 
@@ -84,9 +85,104 @@ int parse_task_from_json(const cJSON* json, Task* task) {
             member->valuestring,
             MAX_STRING_LENGTH - 1);
         task->member_count++;
-        printf("Added member: %s\n", member->valuestring);
+        LOG_DEBUG("Added member: %s", member->valuestring);
     }
 
-    printf("Successfully parsed task with %d members\n", task->member_count);
+    LOG_DEBUG("Successfully parsed task with %d members", task->member_count);
     return 0;
-}
\ No newline at end of file
+}
+
+int parse_task_from_body(const char* body, size_t size, Task* task) {
+    memset(task, 0, sizeof(Task));
+
+    JsonReader reader;
+    json_reader_init(&reader, body, size);
+    if (json_reader_begin_object(&reader) != 0) {
+        return JSON_INVALID;
+    }
+
+    // Required fields that were present and of the right type
+    int has_project_id = 0, has_name = 0, has_description = 0, has_members = 0, has_creator_id = 0;
+    int too_long = 0;
+
+    const char* key;
+    size_t key_size;
+    int next;
+    while ((next = json_reader_next_key(&reader, &key, &key_size)) == 1) {
+        char* target = NULL;
+        size_t target_size = 0;
+        int* seen = NULL;
+
+        if (JSON_KEY_IS(key, key_size, "project_id")) {
+            target = task->project_id; target_size = sizeof(task->project_id); seen = &has_project_id;
+        }
+        else if (JSON_KEY_IS(key, key_size, "name")) {
+            target = task->name; target_size = sizeof(task->name); seen = &has_name;
+        }
+        else if (JSON_KEY_IS(key, key_size, "description")) {
+            target = task->description; target_size = sizeof(task->description); seen = &has_description;
+        }
+        else if (JSON_KEY_IS(key, key_size, "creator_id")) {
+            target = task->creator_id; target_size = sizeof(task->creator_id); seen = &has_creator_id;
+        }
+        else if (JSON_KEY_IS(key, key_size, "members") && json_reader_peek(&reader) == '[') {
+            has_members = 1;
+            json_reader_begin_array(&reader);
+            int item;
+            while ((item = json_reader_next_item(&reader)) == 1) {
+                if (task->member_count >= MAX_MEMBERS || json_reader_peek(&reader) != '"') {
+                    if (json_reader_skip(&reader) != 0) {
+                        return JSON_INVALID;
+                    }
+                    continue;
+                }
+                int length = json_reader_string(&reader, task->members[task->member_count], MAX_STRING_LENGTH);
+                if (length < 0) {
+                    return JSON_INVALID;
+                }
+                if (length >= MAX_STRING_LENGTH) {
+                    // Too long, dropped like in parse_task_from_json
+                    task->members[task->member_count][0] = '\0';
+                    continue;
+                }
+                task->member_count++;
+            }
+            if (item != 0) {
+                return JSON_INVALID;
+            }
+            continue;
+        }
+
+        if (target == NULL || json_reader_peek(&reader) != '"') {
+            if (json_reader_skip(&reader) != 0) {
+                return JSON_INVALID;
+            }
+            continue;
+        }
+
+        int length = json_reader_string(&reader, target, target_size);
+        if (length < 0) {
+            return JSON_INVALID;
+        }
+        if ((size_t)length >= target_size) {
+            too_long = 1;
+        }
+        *seen = 1;
+    }
+    if (next != 0 || json_reader_finish(&reader) != 0) {
+        return JSON_INVALID;
+    }
+
+    if (!has_project_id || !has_name || !has_description || !has_members || !has_creator_id) {
+        LOG_WARN("Missing or invalid required fields");
+        return 1;
+    }
+    if (too_long) {
+        LOG_WARN("Task field too long");
+        return 1;
+    }
+
+    // Set initial status to pending (regardless of what was sent)
+    task->status = STATUS_PENDING;
+    return 0;
+}
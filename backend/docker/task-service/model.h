@@ -2,6 +2,7 @@
 #define MODEL_H
 
 #include <cjson/cJSON.h>
+#include "json_reader.h"
 
 #define MAX_STRING_LENGTH 100
 #define MAX_MEMBERS 50
@@ -29,4 +30,8 @@ typedef struct Task {
 
 int parse_task_from_json(const cJSON* json, Task* task);
 
+// Same rules as parse_task_from_json, decoded from the raw body without a cJSON tree.
+// Returns JSON_INVALID when the body is not well-formed JSON.
+int parse_task_from_body(const char* body, size_t size, Task* task);
+
 #endif
\ No newline at end of file
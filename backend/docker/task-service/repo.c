@@ -3,81 +3,73 @@
 #include <stdlib.h>
 #include "model.h"
 #include "repo.h"
+#include "arena.h"
+#include "logger.h"
+#include "metrics.h"
 
 typedef struct {
     mongoc_client_t* client;
     mongoc_collection_t* collection;
-    FILE* logger;
 } Repository;
 
-Repository* New(FILE* logger) {
+Repository* New(void) {
     
     const char *var_name = "DBURI";
     char *dburi = getenv(var_name);
-    printf("Bruhimic moram priznati\n");
 
     if (dburi == NULL) {
-        fprintf(logger, "Error: MONGO_DB_URI environment variable is not set\n");
+        LOG_ERROR("Error: MONGO_DB_URI environment variable is not set");
         return NULL;
     }
 
     mongoc_client_t* client = mongoc_client_new(dburi);
     if (!client) {
-        fprintf(logger, "Error: Failed to create MongoDB client\n");
-        printf("Error: Failed to create MongoDB client\n");
+        LOG_ERROR("Error: Failed to create MongoDB client");
         mongoc_cleanup();
         return NULL;
     }
-    printf("MongoDB client created successfully.\n");
+    LOG_DEBUG("MongoDB client created successfully.");
 
     bson_error_t error;
     if (!mongoc_client_get_server_status(client, NULL, NULL, &error)) {
-        fprintf(logger, "Error: Failed to connect to MongoDB: %s\n", error.message);
-        printf("Error: Failed to connect to MongoDB: %s\n", error.message);
+        LOG_ERROR("Error: Failed to connect to MongoDB: %s", error.message);
         mongoc_client_destroy(client);
         mongoc_cleanup();
         return NULL;
     }
-    printf("Connected to MongoDB server successfully.\n");
+    LOG_DEBUG("Connected to MongoDB server successfully.");
 
     Repository* repo = (Repository*)malloc(sizeof(Repository));
     if (repo == NULL) {
-        fprintf(logger, "Error: Failed to allocate memory for repository\n");
-        printf("Error: Failed to allocate memory for repository\n");
+        LOG_ERROR("Error: Failed to allocate memory for repository");
         mongoc_client_destroy(client);
         mongoc_cleanup();
         return NULL;
     }
 
     repo->client = client;
-    repo->logger = logger;
     return repo;
 }
 
 void Cleanup(Repository* repo) {
     if (repo) {
-        printf("Cleaning up MongoDB client and repository...\n");
+        LOG_DEBUG("Cleaning up MongoDB client and repository...");
         if (repo->collection) {
             mongoc_collection_destroy(repo->collection);
         }
         mongoc_client_destroy(repo->client);
         free(repo);
-        printf("Cleanup completed.\n");
+        LOG_DEBUG("Cleanup completed.");
     }
 }
 
 int add_task(Task* task) {
-    printf("Adding task to MongoDB...\n");
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1;
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("Adding task to MongoDB...");
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        printf("Error initializing repository.\n");
-        fclose(log);
+        LOG_ERROR("Error initializing repository.");
         return 1;
     }
 
@@ -107,44 +99,49 @@ int add_task(Task* task) {
 
     // Print the BSON document for debugging
     char* json_str = bson_as_json(doc, NULL);
-    printf("Document to be inserted: %s\n", json_str);
+    LOG_DEBUG("Document to be inserted: %s", json_str);
     bson_free(json_str);
 
     bson_error_t error;
     if (!mongoc_collection_insert_one(repo->collection, doc, NULL, NULL, &error)) {
-        fprintf(repo->logger, "Error: Insert failed: %s\n", error.message);
-        printf("Error: Insert failed: %s\n", error.message);
+        LOG_ERROR("Error: Insert failed: %s", error.message);
         bson_destroy(doc);
         Cleanup(repo);
-        fclose(log);
         return 1;
     }
 
-    printf("Task inserted successfully.\n");
+    LOG_DEBUG("Task inserted successfully.");
     bson_destroy(doc);
     Cleanup(repo);
-    fclose(log);
 
     // Update project status - when a task is added, project becomes active
-    printf("Updating project status to active for project: %s\n", task->project_id);
+    LOG_DEBUG("Updating project status to active for project: %s", task->project_id);
     update_project_status_from_tasks(task->project_id);
 
     return 0;
 }
 
-char* get_tasks_by_project(const char* project_id) {
-    printf("\n=== Starting get_tasks_by_project ===\n");
-    printf("Looking for tasks with project_id: %s\n", project_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return NULL;
+int append_task_json(cJSON* tasks_array, const bson_t* doc) {
+    char* doc_str = bson_as_json(doc, NULL);
+    LOG_DEBUG("Found document: %s", doc_str);
+
+    cJSON* task_json = cJSON_Parse(doc_str);
+    bson_free(doc_str);
+    if (task_json == NULL) {
+        LOG_ERROR("Failed to parse document to JSON!");
+        return -1;
     }
+    cJSON_AddItemToArray(tasks_array, task_json);
+    return 0;
+}
+
+char* get_tasks_by_project(const char* project_id) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting get_tasks_by_project ===");
+    LOG_DEBUG("Looking for tasks with project_id: %s", project_id);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return NULL;
     }
 
@@ -158,13 +155,13 @@ char* get_tasks_by_project(const char* project_id) {
 
     // Print the query for debugging
     char* query_str = bson_as_json(query, NULL);
-    printf("MongoDB Query: %s\n", query_str);
+    LOG_DEBUG("MongoDB Query: %s", query_str);
     bson_free(query_str);
 
     // Count documents matching the query
     bson_error_t error;
     int64_t count = mongoc_collection_count_documents(repo->collection, query, NULL, NULL, NULL, &error);
-    printf("Total matching documents before cursor: %lld\n", (long long)count);
+    LOG_DEBUG("Total matching documents before cursor: %lld", (long long)count);
 
     mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, NULL, NULL);
     const bson_t* doc;
@@ -172,60 +169,45 @@ char* get_tasks_by_project(const char* project_id) {
     int found_count = 0;
 
     while (mongoc_cursor_next(cursor, &doc)) {
-        char* doc_str = bson_as_json(doc, NULL);
-        printf("\nFound document %d: %s\n", found_count + 1, doc_str);
-        
-        cJSON* task_json = cJSON_Parse(doc_str);
-        if (task_json) {
-            cJSON_AddItemToArray(tasks_array, task_json);
+        if (append_task_json(tasks_array, doc) == 0) {
             found_count++;
-        } else {
-            printf("Failed to parse document to JSON!\n");
         }
-        bson_free(doc_str);
     }
 
     // Check for cursor errors
     if (mongoc_cursor_error(cursor, &error)) {
-        printf("Cursor error: %s\n", error.message);
+        LOG_ERROR("Cursor error: %s", error.message);
     }
 
-    printf("\nFound %d tasks\n", found_count);
+    LOG_DEBUG("Found %d tasks", found_count);
 
     char* result = cJSON_PrintUnformatted(tasks_array);
-    printf("Returning JSON result: %s\n", result);
+    LOG_DEBUG("Returning JSON result: %s", result);
 
     cJSON_Delete(tasks_array);
     mongoc_cursor_destroy(cursor);
     bson_destroy(query);
     Cleanup(repo);
-    fclose(log);
 
-    printf("=== Finished get_tasks_by_project ===\n\n");
+    LOG_DEBUG("=== Finished get_tasks_by_project ===");
     return result;
 }
 
 int update_task_members(const char* task_id, const char** members, int member_count) {
-    printf("\n=== Starting update_task_members ===\n");
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting update_task_members ===");
     // Skip any leading forward slash
     while (*task_id == '/') {
         task_id++;
     }
-    printf("Updating members for task ID: %s\n", task_id);
-    printf("Number of members to update: %d\n", member_count);
+    LOG_DEBUG("Updating members for task ID: %s", task_id);
+    LOG_DEBUG("Number of members to update: %d", member_count);
     for (int i = 0; i < member_count; i++) {
-        printf("Member %d: %s\n", i, members[i]);
-    }
-
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1;
+        LOG_DEBUG("Member %d: %s", i, members[i]);
     }
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1;
     }
 
@@ -256,38 +238,30 @@ int update_task_members(const char* task_id, const char** members, int member_co
 
     bson_error_t error;
     if (!mongoc_collection_update_one(repo->collection, query, update, NULL, NULL, &error)) {
-        printf("Error updating task members: %s\n", error.message);
+        LOG_ERROR("Error updating task members: %s", error.message);
         bson_destroy(query);
         bson_destroy(update);
         Cleanup(repo);
-        fclose(log);
         return 1;
     }
 
     bson_destroy(query);
     bson_destroy(update);
     Cleanup(repo);
-    fclose(log);
     return 0;
 }
 
 int update_task_status(const char* task_id, TaskStatus status) {
-    printf("\n=== Starting update_task_status ===\n");
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting update_task_status ===");
     // Skip any leading forward slash
     while (*task_id == '/') {
         task_id++;
     }
-    printf("Updating task status for task ID: %s to status: %d\n", task_id, status);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1;
-    }
+    LOG_DEBUG("Updating task status for task ID: %s to status: %d", task_id, status);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1;
     }
 
@@ -309,8 +283,8 @@ int update_task_status(const char* task_id, TaskStatus status) {
     // Print the query and update for debugging
     char* query_str = bson_as_json(query, NULL);
     char* update_str = bson_as_json(update, NULL);
-    printf("Query: %s\n", query_str);
-    printf("Update: %s\n", update_str);
+    LOG_DEBUG("Query: %s", query_str);
+    LOG_DEBUG("Update: %s", update_str);
     bson_free(query_str);
     bson_free(update_str);
 
@@ -318,15 +292,14 @@ int update_task_status(const char* task_id, TaskStatus status) {
     bool result = mongoc_collection_update_one(repo->collection, query, update, NULL, NULL, &error);
     
     if (!result) {
-        printf("Error updating task status: %s\n", error.message);
+        LOG_ERROR("Error updating task status: %s", error.message);
         bson_destroy(query);
         bson_destroy(update);
         Cleanup(repo);
-        fclose(log);
         return 1;
     }
 
-    printf("Task status updated successfully\n");
+    LOG_DEBUG("Task status updated successfully");
 
     // Get the task to find its project_id for updating project status
     mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, NULL, NULL);
@@ -339,8 +312,8 @@ int update_task_status(const char* task_id, TaskStatus status) {
         if (task_json) {
             cJSON* project_id_json = cJSON_GetObjectItem(task_json, "project_id");
             if (project_id_json && cJSON_IsString(project_id_json)) {
-                project_id_for_update = strdup(project_id_json->valuestring);
-                printf("Found project_id for status update: %s\n", project_id_for_update);
+                project_id_for_update = request_strdup(project_id_json->valuestring);
+                LOG_DEBUG("Found project_id for status update: %s", project_id_for_update);
             }
             cJSON_Delete(task_json);
         }
@@ -351,32 +324,25 @@ int update_task_status(const char* task_id, TaskStatus status) {
     bson_destroy(query);
     bson_destroy(update);
     Cleanup(repo);
-    fclose(log);
 
     // Update project status based on tasks completion
     if (project_id_for_update) {
-        printf("Updating project status for project: %s\n", project_id_for_update);
+        LOG_DEBUG("Updating project status for project: %s", project_id_for_update);
         update_project_status_from_tasks(project_id_for_update);
-        free(project_id_for_update);
+        request_free(project_id_for_update);
     }
 
-    printf("=== Finished update_task_status ===\n\n");
+    LOG_DEBUG("=== Finished update_task_status ===");
     return 0;
 }
 
 char* get_user_tasks_by_project(const char* project_id, const char* user_id) {
-    printf("\n=== Starting get_user_tasks_by_project ===\n");
-    printf("Looking for tasks with project_id: %s for user: %s\n", project_id, user_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return NULL;
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting get_user_tasks_by_project ===");
+    LOG_DEBUG("Looking for tasks with project_id: %s for user: %s", project_id, user_id);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return NULL;
     }
 
@@ -409,13 +375,13 @@ char* get_user_tasks_by_project(const char* project_id, const char* user_id) {
 
     // Print the query for debugging
     char* query_str = bson_as_json(query, NULL);
-    printf("MongoDB Query: %s\n", query_str);
+    LOG_DEBUG("MongoDB Query: %s", query_str);
     bson_free(query_str);
 
     // Count documents matching the query
     bson_error_t error;
     int64_t count = mongoc_collection_count_documents(repo->collection, query, NULL, NULL, NULL, &error);
-    printf("Total matching documents for user: %lld\n", (long long)count);
+    LOG_DEBUG("Total matching documents for user: %lld", (long long)count);
 
     mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, NULL, NULL);
     const bson_t* doc;
@@ -423,52 +389,41 @@ char* get_user_tasks_by_project(const char* project_id, const char* user_id) {
     int found_count = 0;
 
     while (mongoc_cursor_next(cursor, &doc)) {
-        char* doc_str = bson_as_json(doc, NULL);
-        printf("\nFound user-accessible document %d: %s\n", found_count + 1, doc_str);
-        
-        cJSON* task_json = cJSON_Parse(doc_str);
-        if (task_json) {
-            cJSON_AddItemToArray(tasks_array, task_json);
+        if (append_task_json(tasks_array, doc) == 0) {
             found_count++;
-        } else {
-            printf("Failed to parse document to JSON!\n");
         }
-        bson_free(doc_str);
     }
 
     // Check for cursor errors
     if (mongoc_cursor_error(cursor, &error)) {
-        printf("Cursor error: %s\n", error.message);
+        LOG_ERROR("Cursor error: %s", error.message);
     }
 
-    printf("\nFound %d user-accessible tasks\n", found_count);
+    LOG_DEBUG("Found %d user-accessible tasks", found_count);
 
     char* result = cJSON_PrintUnformatted(tasks_array);
-    printf("Returning JSON result: %s\n", result);
+    LOG_DEBUG("Returning JSON result: %s", result);
 
     cJSON_Delete(tasks_array);
     mongoc_cursor_destroy(cursor);
     bson_destroy(query);
     Cleanup(repo);
-    fclose(log);
 
-    printf("=== Finished get_user_tasks_by_project ===\n\n");
+    LOG_DEBUG("=== Finished get_user_tasks_by_project ===");
     return result;
 }
 
 int validate_project_member(const char* project_id, const char* member_id) {
-    printf("\n=== Starting validate_project_member ===\n");
-    printf("Validating if user %s is member of project %s\n", member_id, project_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting validate_project_member ===");
+    LOG_DEBUG("Validating if user %s is member of project %s", member_id, project_id);
+
+    if (!bson_oid_is_valid(project_id, strlen(project_id))) {
         return -1;
     }
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return -1;
     }
 
@@ -485,7 +440,7 @@ int validate_project_member(const char* project_id, const char* member_id) {
 
     // Print the query for debugging
     char* query_str = bson_as_json(query, NULL);
-    printf("Project validation query: %s\n", query_str);
+    LOG_DEBUG("Project validation query: %s", query_str);
     bson_free(query_str);
 
     mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(projects_collection, query, NULL, NULL);
@@ -494,7 +449,7 @@ int validate_project_member(const char* project_id, const char* member_id) {
 
     if (mongoc_cursor_next(cursor, &doc)) {
         char* doc_str = bson_as_json(doc, NULL);
-        printf("Found project: %s\n", doc_str);
+        LOG_DEBUG("Found project: %s", doc_str);
         
         // Parse the project document to check members
         cJSON* project_json = cJSON_Parse(doc_str);
@@ -502,7 +457,7 @@ int validate_project_member(const char* project_id, const char* member_id) {
             // Check if user is the moderator (equivalent to owner)
             cJSON* moderator = cJSON_GetObjectItem(project_json, "moderator");
             if (moderator && cJSON_IsString(moderator) && strcmp(moderator->valuestring, member_id) == 0) {
-                printf("User is project moderator\n");
+                LOG_DEBUG("User is project moderator");
                 is_member = 1;
             } else {
                 // Check if user is in members array
@@ -511,7 +466,7 @@ int validate_project_member(const char* project_id, const char* member_id) {
                     cJSON* member;
                     cJSON_ArrayForEach(member, members) {
                         if (cJSON_IsString(member) && strcmp(member->valuestring, member_id) == 0) {
-                            printf("User found in project members\n");
+                            LOG_DEBUG("User found in project members");
                             is_member = 1;
                             break;
                         }
@@ -522,41 +477,34 @@ int validate_project_member(const char* project_id, const char* member_id) {
         }
         bson_free(doc_str);
     } else {
-        printf("Project not found\n");
+        LOG_DEBUG("Project not found");
     }
 
     bson_error_t error;
     if (mongoc_cursor_error(cursor, &error)) {
-        printf("Cursor error: %s\n", error.message);
+        LOG_ERROR("Cursor error: %s", error.message);
     }
 
     mongoc_cursor_destroy(cursor);
     mongoc_collection_destroy(projects_collection);
     bson_destroy(query);
     Cleanup(repo);
-    fclose(log);
 
-    printf("User %s is %s member of project %s\n", member_id, is_member ? "a" : "NOT a", project_id);
-    printf("is_member value: %d\n", is_member);
-    printf("Returning: %d\n", is_member ? 0 : -1);
-    printf("=== Finished validate_project_member ===\n\n");
+    LOG_DEBUG("User %s is %s member of project %s", member_id, is_member ? "a" : "NOT a", project_id);
+    LOG_DEBUG("is_member value: %d", is_member);
+    LOG_DEBUG("Returning: %d", is_member ? 0 : -1);
+    LOG_DEBUG("=== Finished validate_project_member ===");
     
     return is_member ? 0 : -1;
 }
 
 int can_user_update_task(const char* task_id, const char* user_id) {
-    printf("\n=== Starting can_user_update_task ===\n");
-    printf("Checking if user %s can update task %s\n", user_id, task_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return -1;
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting can_user_update_task ===");
+    LOG_DEBUG("Checking if user %s can update task %s", user_id, task_id);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return -1;
     }
 
@@ -572,7 +520,7 @@ int can_user_update_task(const char* task_id, const char* user_id) {
 
     // Print the query for debugging
     char* query_str = bson_as_json(query, NULL);
-    printf("Task query: %s\n", query_str);
+    LOG_DEBUG("Task query: %s", query_str);
     bson_free(query_str);
 
     mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, NULL, NULL);
@@ -581,7 +529,7 @@ int can_user_update_task(const char* task_id, const char* user_id) {
 
     if (mongoc_cursor_next(cursor, &doc)) {
         char* doc_str = bson_as_json(doc, NULL);
-        printf("Found task: %s\n", doc_str);
+        LOG_DEBUG("Found task: %s", doc_str);
         
         // Parse the task document to check creator and members
         cJSON* task_json = cJSON_Parse(doc_str);
@@ -589,7 +537,7 @@ int can_user_update_task(const char* task_id, const char* user_id) {
             // Check if user is the creator
             cJSON* creator = cJSON_GetObjectItem(task_json, "creator_id");
             if (creator && cJSON_IsString(creator) && strcmp(creator->valuestring, user_id) == 0) {
-                printf("User is task creator\n");
+                LOG_DEBUG("User is task creator");
                 can_update = 1;
             } else {
                 // Check if user is in members array
@@ -598,7 +546,7 @@ int can_user_update_task(const char* task_id, const char* user_id) {
                     cJSON* member;
                     cJSON_ArrayForEach(member, members) {
                         if (cJSON_IsString(member) && strcmp(member->valuestring, user_id) == 0) {
-                            printf("User found in task members\n");
+                            LOG_DEBUG("User found in task members");
                             can_update = 1;
                             break;
                         }
@@ -609,38 +557,31 @@ int can_user_update_task(const char* task_id, const char* user_id) {
         }
         bson_free(doc_str);
     } else {
-        printf("Task not found\n");
+        LOG_DEBUG("Task not found");
     }
 
     bson_error_t error;
     if (mongoc_cursor_error(cursor, &error)) {
-        printf("Cursor error: %s\n", error.message);
+        LOG_ERROR("Cursor error: %s", error.message);
     }
 
     mongoc_cursor_destroy(cursor);
     bson_destroy(query);
     Cleanup(repo);
-    fclose(log);
 
-    printf("User %s %s update task %s\n", user_id, can_update ? "CAN" : "CANNOT", task_id);
-    printf("=== Finished can_user_update_task ===\n\n");
+    LOG_DEBUG("User %s %s update task %s", user_id, can_update ? "CAN" : "CANNOT", task_id);
+    LOG_DEBUG("=== Finished can_user_update_task ===");
     
     return can_update ? 0 : -1;
 }
 
 int has_unfinished_tasks(const char* project_id, const char* user_id) {
-    printf("\n=== Starting has_unfinished_tasks ===\n");
-    printf("Checking if user %s has unfinished tasks in project %s\n", user_id, project_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1; // Return error - assume user has unfinished tasks
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting has_unfinished_tasks ===");
+    LOG_DEBUG("Checking if user %s has unfinished tasks in project %s", user_id, project_id);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1; // Return error - assume user has unfinished tasks
     }
 
@@ -681,38 +622,31 @@ int has_unfinished_tasks(const char* project_id, const char* user_id) {
 
     // Print the query for debugging
     char* query_str = bson_as_json(query, NULL);
-    printf("MongoDB Query for unfinished tasks: %s\n", query_str);
+    LOG_DEBUG("MongoDB Query for unfinished tasks: %s", query_str);
     bson_free(query_str);
 
     // Count documents matching the query
     bson_error_t error;
     int64_t count = mongoc_collection_count_documents(repo->collection, query, NULL, NULL, NULL, &error);
-    printf("Number of unfinished tasks for user: %lld\n", (long long)count);
+    LOG_DEBUG("Number of unfinished tasks for user: %lld", (long long)count);
 
     bson_destroy(query);
     Cleanup(repo);
-    fclose(log);
 
-    printf("User %s %s unfinished tasks in project %s\n", 
+    LOG_DEBUG("User %s %s unfinished tasks in project %s", 
            user_id, (count > 0) ? "HAS" : "DOES NOT HAVE", project_id);
-    printf("=== Finished has_unfinished_tasks ===\n\n");
+    LOG_DEBUG("=== Finished has_unfinished_tasks ===");
     
     return (count > 0) ? 1 : 0; // Return 1 if user has unfinished tasks, 0 if not
 }
 
 int update_project_status_from_tasks(const char* project_id) {
-    printf("\n=== Starting update_project_status_from_tasks ===\n");
-    printf("Checking and updating project status for project %s\n", project_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1;
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting update_project_status_from_tasks ===");
+    LOG_DEBUG("Checking and updating project status for project %s", project_id);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1;
     }
 
@@ -726,12 +660,12 @@ int update_project_status_from_tasks(const char* project_id) {
     
     bson_error_t error;
     int64_t total_tasks = mongoc_collection_count_documents(repo->collection, all_tasks_query, NULL, NULL, NULL, &error);
-    printf("Total tasks in project: %lld\n", (long long)total_tasks);
+    LOG_DEBUG("Total tasks in project: %lld", (long long)total_tasks);
     
     int new_project_status = 0; // 0 = PROJECT_ACTIVE, 1 = PROJECT_COMPLETED
 
     if (total_tasks == 0) {
-        printf("Project has no tasks - setting as completed\n");
+        LOG_DEBUG("Project has no tasks - setting as completed");
         new_project_status = 1; // PROJECT_COMPLETED
     } else {
         // Check for unfinished tasks (status != 2)
@@ -744,13 +678,13 @@ int update_project_status_from_tasks(const char* project_id) {
         bson_append_document_end(unfinished_query, &ne_condition);
 
         int64_t unfinished_tasks = mongoc_collection_count_documents(repo->collection, unfinished_query, NULL, NULL, NULL, &error);
-        printf("Unfinished tasks in project: %lld\n", (long long)unfinished_tasks);
+        LOG_DEBUG("Unfinished tasks in project: %lld", (long long)unfinished_tasks);
 
         if (unfinished_tasks > 0) {
-            printf("Project has unfinished tasks - setting as active\n");
+            LOG_DEBUG("Project has unfinished tasks - setting as active");
             new_project_status = 0; // PROJECT_ACTIVE
         } else {
-            printf("All tasks completed - setting project as completed\n");
+            LOG_DEBUG("All tasks completed - setting project as completed");
             new_project_status = 1; // PROJECT_COMPLETED
         }
 
@@ -776,38 +710,30 @@ int update_project_status_from_tasks(const char* project_id) {
     bson_append_document_end(update, &set);
 
     if (!mongoc_collection_update_one(projects_collection, project_query, update, NULL, NULL, &error)) {
-        printf("Error updating project status: %s\n", error.message);
+        LOG_ERROR("Error updating project status: %s", error.message);
         bson_destroy(project_query);
         bson_destroy(update);
         mongoc_collection_destroy(projects_collection);
         Cleanup(repo);
-        fclose(log);
         return 1;
     }
 
-    printf("Project status updated successfully to %d\n", new_project_status);
+    LOG_DEBUG("Project status updated successfully to %d", new_project_status);
     bson_destroy(project_query);
     bson_destroy(update);
     mongoc_collection_destroy(projects_collection);
     Cleanup(repo);
-    fclose(log);
-    printf("=== Finished update_project_status_from_tasks ===\n\n");
+    LOG_DEBUG("=== Finished update_project_status_from_tasks ===");
     return 0;
 }
 
 int get_task_project_id(const char* task_id, char* project_id_out) {
-    printf("\n=== Starting get_task_project_id ===\n");
-    printf("Getting project ID for task: %s\n", task_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1;
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting get_task_project_id ===");
+    LOG_DEBUG("Getting project ID for task: %s", task_id);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1;
     }
 
@@ -832,7 +758,7 @@ int get_task_project_id(const char* task_id, char* project_id_out) {
             if (project_id_json && cJSON_IsString(project_id_json)) {
                 strncpy(project_id_out, project_id_json->valuestring, MAX_STRING_LENGTH - 1);
                 project_id_out[MAX_STRING_LENGTH - 1] = '\0';
-                printf("Found project ID: %s\n", project_id_out);
+                LOG_DEBUG("Found project ID: %s", project_id_out);
                 found = 1;
             }
             cJSON_Delete(task_json);
@@ -843,25 +769,18 @@ int get_task_project_id(const char* task_id, char* project_id_out) {
     mongoc_cursor_destroy(cursor);
     bson_destroy(query);
     Cleanup(repo);
-    fclose(log);
-    printf("=== Finished get_task_project_id ===\n\n");
+    LOG_DEBUG("=== Finished get_task_project_id ===");
     
     return found ? 0 : 1;
 }
 
 int get_task_status(const char* task_id) {
-    printf("\n=== Starting get_task_status ===\n");
-    printf("Getting status for task: %s\n", task_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return -1;
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting get_task_status ===");
+    LOG_DEBUG("Getting status for task: %s", task_id);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return -1;
     }
 
@@ -885,7 +804,7 @@ int get_task_status(const char* task_id) {
             cJSON* status_json = cJSON_GetObjectItem(task_json, "status");
             if (status_json && cJSON_IsNumber(status_json)) {
                 status = status_json->valueint;
-                printf("Found task status: %d\n", status);
+                LOG_DEBUG("Found task status: %d", status);
             }
             cJSON_Delete(task_json);
         }
@@ -895,25 +814,18 @@ int get_task_status(const char* task_id) {
     mongoc_cursor_destroy(cursor);
     bson_destroy(query);
     Cleanup(repo);
-    fclose(log);
-    printf("=== Finished get_task_status ===\n\n");
+    LOG_DEBUG("=== Finished get_task_status ===");
     
     return status;
 }
 
 int add_member_to_task(const char* task_id, const char* member_id) {
-    printf("\n=== Starting add_member_to_task ===\n");
-    printf("Adding member %s to task %s\n", member_id, task_id);
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
-        return 1;
-    }
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting add_member_to_task ===");
+    LOG_DEBUG("Adding member %s to task %s", member_id, task_id);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1;
     }
 
@@ -942,7 +854,7 @@ int add_member_to_task(const char* task_id, const char* member_id) {
                 strncpy(project_id, project_id_json->valuestring, MAX_STRING_LENGTH - 1);
                 project_id[MAX_STRING_LENGTH - 1] = '\0';
                 found_task = 1;
-                printf("Found project ID: %s\n", project_id);
+                LOG_DEBUG("Found project ID: %s", project_id);
             }
             cJSON_Delete(task_json);
         }
@@ -952,10 +864,9 @@ int add_member_to_task(const char* task_id, const char* member_id) {
     mongoc_cursor_destroy(cursor);
 
     if (!found_task) {
-        printf("Error: Could not find task or get project ID\n");
+        LOG_ERROR("Error: Could not find task or get project ID");
         bson_destroy(query);
         Cleanup(repo);
-        fclose(log);
         return 1;
     }
 
@@ -975,14 +886,14 @@ int add_member_to_task(const char* task_id, const char* member_id) {
 
     if (mongoc_cursor_next(project_cursor, &project_doc)) {
         char* project_doc_str = bson_as_json(project_doc, NULL);
-        printf("Found project: %s\n", project_doc_str);
+        LOG_DEBUG("Found project: %s", project_doc_str);
         
         cJSON* project_json = cJSON_Parse(project_doc_str);
         if (project_json) {
             // Check if user is the moderator
             cJSON* moderator = cJSON_GetObjectItem(project_json, "moderator");
             if (moderator && cJSON_IsString(moderator) && strcmp(moderator->valuestring, member_id) == 0) {
-                printf("User is project moderator\n");
+                LOG_DEBUG("User is project moderator");
                 is_member = 1;
             } else {
                 // Check if user is in members array
@@ -991,7 +902,7 @@ int add_member_to_task(const char* task_id, const char* member_id) {
                     cJSON* member;
                     cJSON_ArrayForEach(member, members) {
                         if (cJSON_IsString(member) && strcmp(member->valuestring, member_id) == 0) {
-                            printf("User found in project members\n");
+                            LOG_DEBUG("User found in project members");
                             is_member = 1;
                             break;
                         }
@@ -1002,7 +913,7 @@ int add_member_to_task(const char* task_id, const char* member_id) {
         }
         bson_free(project_doc_str);
     } else {
-        printf("Project not found\n");
+        LOG_DEBUG("Project not found");
     }
 
     mongoc_cursor_destroy(project_cursor);
@@ -1010,10 +921,9 @@ int add_member_to_task(const char* task_id, const char* member_id) {
     bson_destroy(project_query);
 
     if (!is_member) {
-        printf("Error: User %s is not a member of project %s\n", member_id, project_id);
+        LOG_WARN("Error: User %s is not a member of project %s", member_id, project_id);
         bson_destroy(query);
         Cleanup(repo);
-        fclose(log);
         return 2; // Special error code for "not a project member"
     }
 
@@ -1028,50 +938,42 @@ int add_member_to_task(const char* task_id, const char* member_id) {
     bson_t reply;
     bool update_result = mongoc_collection_update_one(repo->collection, query, update, NULL, &reply, &error);
     if (!update_result) {
-        printf("Error adding member to task: %s\n", error.message);
+        LOG_ERROR("Error adding member to task: %s", error.message);
         bson_destroy(query);
         bson_destroy(update);
         bson_destroy(&reply);
         Cleanup(repo);
-        fclose(log);
         return 1;
     }
     bson_destroy(&reply);
 
-    printf("Member %s added to task %s successfully\n", member_id, task_id);
+    LOG_DEBUG("Member %s added to task %s successfully", member_id, task_id);
     bson_destroy(query);
     bson_destroy(update);
     Cleanup(repo);
-    fclose(log);
-    printf("=== Finished add_member_to_task ===\n\n");
+    LOG_DEBUG("=== Finished add_member_to_task ===");
     
     return 0;
 }
 
 int remove_member_from_task(const char* task_id, const char* member_id) {
-    printf("\n=== Starting remove_member_from_task ===\n");
-    printf("Removing member %s from task %s\n", member_id, task_id);
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting remove_member_from_task ===");
+    LOG_DEBUG("Removing member %s from task %s", member_id, task_id);
     
     // First, check task status - cannot remove from finished tasks
     int task_status = get_task_status(task_id);
     if (task_status == STATUS_COMPLETED) {
-        printf("Error: Cannot remove member from completed task (status: %d)\n", task_status);
+        LOG_WARN("Error: Cannot remove member from completed task (status: %d)", task_status);
         return 2; // Special error code for "task is finished"
     }
     if (task_status == -1) {
-        printf("Error: Could not get task status\n");
-        return 1;
-    }
-    
-    FILE* log = fopen("log.txt", "w");
-    if (log == NULL) {
-        printf("Error opening log file!\n");
+        LOG_ERROR("Error: Could not get task status");
         return 1;
     }
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     if (repo == NULL) {
-        fclose(log);
         return 1;
     }
 
@@ -1095,29 +997,411 @@ int remove_member_from_task(const char* task_id, const char* member_id) {
     bson_t reply;
     bool update_result = mongoc_collection_update_one(repo->collection, query, update, NULL, &reply, &error);
     if (!update_result) {
-        printf("Error removing member from task: %s\n", error.message);
+        LOG_ERROR("Error removing member from task: %s", error.message);
         bson_destroy(query);
         bson_destroy(update);
         bson_destroy(&reply);
         Cleanup(repo);
-        fclose(log);
         return 1;
     }
     bson_destroy(&reply);
 
-    printf("Member %s removed from task %s successfully\n", member_id, task_id);
+    LOG_DEBUG("Member %s removed from task %s successfully", member_id, task_id);
     bson_destroy(query);
     bson_destroy(update);
     Cleanup(repo);
-    fclose(log);
-    printf("=== Finished remove_member_from_task ===\n\n");
+    LOG_DEBUG("=== Finished remove_member_from_task ===");
     
     return 0;
 }
 
+int ensure_task_indexes(void) {
+    Repository* repo = New();
+    if (repo == NULL) {
+        return 1;
+    }
+    repo->collection = mongoc_client_get_collection(repo->client, "tasks", "tasks");
+
+    // Serves get_user_open_tasks: equality on members, then the sort order, _id breaks ties between pages
+    bson_t* keys = BCON_NEW("members", BCON_INT32(1), "status", BCON_INT32(1), "project_id", BCON_INT32(1),
+        "_id", BCON_INT32(1));
+    bson_t* opts = BCON_NEW("name", BCON_UTF8(MY_TASKS_INDEX));
+
+    bson_error_t error;
+    int result = 0;
+    // Creating an index that already exists with the same keys is a no-op
+    if (!mongoc_collection_create_index_with_opts(repo->collection, keys, opts, NULL, &error)) {
+        LOG_WARN("Failed to create index %s: %s", MY_TASKS_INDEX, error.message);
+        result = 1;
+    }
+
+    bson_destroy(keys);
+    bson_destroy(opts);
+    Cleanup(repo);
+    return result;
+}
+
+// Status, project and id of the last task on a page, the next page starts after it
+static int parse_task_cursor(const char* cursor, int* status, char* project_id, bson_oid_t* oid) {
+    char oid_str[25];
+    int consumed = 0;
+    if (sscanf(cursor, "%d:%99[^:]:%24[0-9a-f]%n", status, project_id, oid_str, &consumed) != 3 ||
+        cursor[consumed] != '\0' || !bson_oid_is_valid(oid_str, strlen(oid_str))) {
+        return 1;
+    }
+    bson_oid_init_from_string(oid, oid_str);
+    return 0;
+}
+
+static void format_task_cursor(const bson_t* doc, char* cursor, size_t size) {
+    bson_iter_t iter;
+    int status = 0;
+    const char* project_id = "";
+    char oid_str[25] = "";
+
+    if (bson_iter_init_find(&iter, doc, "status") && BSON_ITER_HOLDS_INT32(&iter)) {
+        status = bson_iter_int32(&iter);
+    }
+    if (bson_iter_init_find(&iter, doc, "project_id") && BSON_ITER_HOLDS_UTF8(&iter)) {
+        project_id = bson_iter_utf8(&iter, NULL);
+    }
+    if (bson_iter_init_find(&iter, doc, "_id") && BSON_ITER_HOLDS_OID(&iter)) {
+        bson_oid_to_string(bson_iter_oid(&iter), oid_str);
+    }
+    snprintf(cursor, size, "%d:%s:%s", status, project_id, oid_str);
+}
+
+char* get_user_open_tasks(const char* user_id, const char* after, int limit) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("=== Starting get_user_open_tasks ===");
+
+    int after_status = 0;
+    char after_project[MAX_STRING_LENGTH];
+    bson_oid_t after_oid;
+    if (after && parse_task_cursor(after, &after_status, after_project, &after_oid) != 0) {
+        LOG_DEBUG("Invalid cursor: %s", after);
+        return NULL;
+    }
+
+    Repository* repo = New();
+    if (repo == NULL) {
+        return NULL;
+    }
+    repo->collection = mongoc_client_get_collection(repo->client, "tasks", "tasks");
+
+    bson_t* query = BCON_NEW("members", BCON_UTF8(user_id),
+        "status", "{", "$in", "[", BCON_INT32(STATUS_PENDING), BCON_INT32(STATUS_IN_PROGRESS), "]", "}");
+    if (after) {
+        // Keyset pagination: strictly after the cursor in (status, project_id, _id) order
+        bson_t* page = BCON_NEW("$or", "[",
+            "{", "status", "{", "$gt", BCON_INT32(after_status), "}", "}",
+            "{", "status", BCON_INT32(after_status), "project_id", "{", "$gt", BCON_UTF8(after_project), "}", "}",
+            "{", "status", BCON_INT32(after_status), "project_id", BCON_UTF8(after_project),
+                "_id", "{", "$gt", BCON_OID(&after_oid), "}", "}",
+            "]");
+        bson_concat(query, page);
+        bson_destroy(page);
+    }
+
+    // One more than the page so the caller knows whether to ask again
+    bson_t* opts = BCON_NEW("sort", "{", "status", BCON_INT32(1), "project_id", BCON_INT32(1), "_id", BCON_INT32(1), "}",
+        "limit", BCON_INT64(limit + 1));
+
+    char* query_str = bson_as_json(query, NULL);
+    LOG_DEBUG("Query: %s", query_str);
+    bson_free(query_str);
+
+    mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, opts, NULL);
+    const bson_t* doc;
+    cJSON* result_json = cJSON_CreateObject();
+    cJSON* tasks_array = cJSON_AddArrayToObject(result_json, "tasks");
+    char next[MAX_STRING_LENGTH * 2];
+    int seen_count = 0;
+    int found_count = 0;
+    int has_more = 0;
+
+    while (mongoc_cursor_next(cursor, &doc)) {
+        if (seen_count++ == limit) {
+            has_more = 1;
+            break;
+        }
+        if (append_task_json(tasks_array, doc) == 0) {
+            found_count++;
+        }
+        format_task_cursor(doc, next, sizeof(next));
+    }
+
+    bson_error_t error;
+    char* result = NULL;
+    if (mongoc_cursor_error(cursor, &error)) {
+        LOG_ERROR("Cursor error: %s", error.message);
+    }
+    else {
+        if (has_more) {
+            cJSON_AddStringToObject(result_json, "next", next);
+        }
+        else {
+            cJSON_AddNullToObject(result_json, "next");
+        }
+        result = cJSON_PrintUnformatted(result_json);
+    }
+
+    LOG_DEBUG("Found %d open tasks for user %s", found_count, user_id);
+    cJSON_Delete(result_json);
+    mongoc_cursor_destroy(cursor);
+    bson_destroy(query);
+    bson_destroy(opts);
+    Cleanup(repo);
+    LOG_DEBUG("=== Finished get_user_open_tasks ===");
+    return result;
+}
+
 int repo() {
-    printf("Initializing MongoDB...\n");
+    LOG_DEBUG("Initializing MongoDB...");
     mongoc_init();
-    printf("MongoDB initialized.\n");
+    LOG_DEBUG("MongoDB initialized.");
+    return 0;
+}
+
+// Reports the project a change event touches, NULL when it cannot be told from the event
+static void dispatch_change(const bson_t* event, const char* project_field, ChangeCallback on_change, void* cls) {
+    bson_iter_t iter;
+    bson_iter_t field;
+    char project_id[25];
+
+    if (project_field == NULL) {
+        // Documents are projects, the document key is the project id
+        if (bson_iter_init(&iter, event) && bson_iter_find_descendant(&iter, "documentKey._id", &field) &&
+            BSON_ITER_HOLDS_OID(&field)) {
+            bson_oid_to_string(bson_iter_oid(&field), project_id);
+            on_change(cls, project_id, event);
+            return;
+        }
+    }
+    else {
+        // Deletes carry no fullDocument, so the project is unknown for them
+        char path[64];
+        snprintf(path, sizeof(path), "fullDocument.%s", project_field);
+        if (bson_iter_init(&iter, event) && bson_iter_find_descendant(&iter, path, &field) &&
+            BSON_ITER_HOLDS_UTF8(&field)) {
+            on_change(cls, bson_iter_utf8(&field, NULL), event);
+            return;
+        }
+    }
+    on_change(cls, NULL, event);
+}
+
+int watch_collection(const char* db_name, const char* collection_name, const char* project_field,
+    ChangeCallback on_change, void* cls) {
+
+    Repository* repo = New();
+    if (repo == NULL) {
+        return 1;
+    }
+    repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
+
+    bson_t* pipeline = bson_new();
+    bson_t* opts = BCON_NEW("fullDocument", BCON_UTF8("updateLookup"), "maxAwaitTimeMS", BCON_INT64(10000));
+    mongoc_change_stream_t* stream = mongoc_collection_watch(repo->collection, pipeline, opts);
+
+    bson_error_t error;
+    const bson_t* event;
+    if (mongoc_change_stream_error_document(stream, &error, NULL)) {
+        LOG_WARN("Cannot watch %s.%s: %s", db_name, collection_name, error.message);
+    }
+    else {
+        LOG_INFO("Watching %s.%s for changes", db_name, collection_name);
+        // The stream only sees changes from here on, anything earlier is unknown
+        on_change(cls, NULL, NULL);
+
+        for (;;) {
+            while (mongoc_change_stream_next(stream, &event)) {
+                bson_iter_t iter;
+                if (bson_iter_init_find(&iter, event, "operationType") && BSON_ITER_HOLDS_UTF8(&iter) &&
+                    strcmp(bson_iter_utf8(&iter, NULL), "invalidate") == 0) {
+                    // The collection was dropped or renamed, the stream is closed after this
+                    on_change(cls, NULL, NULL);
+                    goto cleanup;
+                }
+                dispatch_change(event, project_field, on_change, cls);
+            }
+            if (mongoc_change_stream_error_document(stream, &error, NULL)) {
+                LOG_WARN("Change stream on %s.%s failed: %s", db_name, collection_name, error.message);
+                break;
+            }
+        }
+    }
+
+cleanup:
+    mongoc_change_stream_destroy(stream);
+    bson_destroy(opts);
+    bson_destroy(pipeline);
+    Cleanup(repo);
+    return 1;
+}
+
+int find_task_operations(TaskOperation* ops, int count, const char* user_id) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("Looking up %d tasks for a batch update", count);
+
+    for (int i = 0; i < count; i++) {
+        ops[i].project_id[0] = '\0';
+        ops[i].involved = 0;
+    }
+
+    Repository* repo = New();
+    if (repo == NULL) {
+        return 1;
+    }
+    repo->collection = mongoc_client_get_collection(repo->client, "tasks", "tasks");
+
+    bson_t* query = bson_new();
+    bson_t id_filter;
+    bson_t ids;
+    BSON_APPEND_DOCUMENT_BEGIN(query, "_id", &id_filter);
+    BSON_APPEND_ARRAY_BEGIN(&id_filter, "$in", &ids);
+    for (int i = 0; i < count; i++) {
+        bson_oid_t oid;
+        char str_idx[16];
+        snprintf(str_idx, sizeof(str_idx), "%d", i);
+        bson_oid_init_from_string(&oid, ops[i].task_id);
+        BSON_APPEND_OID(&ids, str_idx, &oid);
+    }
+    bson_append_array_end(&id_filter, &ids);
+    bson_append_document_end(query, &id_filter);
+
+    bson_t* opts = BCON_NEW("projection", "{", "project_id", BCON_INT32(1), "creator_id", BCON_INT32(1),
+        "members", BCON_INT32(1), "}");
+    mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, opts, NULL);
+    const bson_t* doc;
+
+    while (mongoc_cursor_next(cursor, &doc)) {
+        bson_iter_t iter;
+        char task_id[25];
+        if (!bson_iter_init_find(&iter, doc, "_id") || !BSON_ITER_HOLDS_OID(&iter)) {
+            continue;
+        }
+        bson_oid_to_string(bson_iter_oid(&iter), task_id);
+
+        const char* project_id = "";
+        int involved = 0;
+        if (bson_iter_init_find(&iter, doc, "project_id") && BSON_ITER_HOLDS_UTF8(&iter)) {
+            project_id = bson_iter_utf8(&iter, NULL);
+        }
+        if (bson_iter_init_find(&iter, doc, "creator_id") && BSON_ITER_HOLDS_UTF8(&iter) &&
+            strcmp(bson_iter_utf8(&iter, NULL), user_id) == 0) {
+            involved = 1;
+        }
+        bson_iter_t member;
+        if (!involved && bson_iter_init_find(&iter, doc, "members") && BSON_ITER_HOLDS_ARRAY(&iter) &&
+            bson_iter_recurse(&iter, &member)) {
+            while (bson_iter_next(&member)) {
+                if (BSON_ITER_HOLDS_UTF8(&member) && strcmp(bson_iter_utf8(&member, NULL), user_id) == 0) {
+                    involved = 1;
+                    break;
+                }
+            }
+        }
+
+        // The same task may appear more than once in a batch
+        for (int i = 0; i < count; i++) {
+            if (strcmp(ops[i].task_id, task_id) == 0) {
+                snprintf(ops[i].project_id, sizeof(ops[i].project_id), "%s", project_id);
+                ops[i].involved = involved;
+            }
+        }
+    }
+
+    bson_error_t error;
+    int failed = mongoc_cursor_error(cursor, &error);
+    if (failed) {
+        LOG_ERROR("Error looking up batch tasks: %s", error.message);
+    }
+
+    mongoc_cursor_destroy(cursor);
+    bson_destroy(opts);
+    bson_destroy(query);
+    Cleanup(repo);
+    return failed ? 1 : 0;
+}
+
+int bulk_update_tasks(const TaskOperation* ops, int count) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
+    LOG_DEBUG("Applying %d task operations in one bulk write", count);
+
+    Repository* repo = New();
+    if (repo == NULL) {
+        return 1;
+    }
+    repo->collection = mongoc_client_get_collection(repo->client, "tasks", "tasks");
+
+    // Ordered, so a task named twice in the batch ends up as the later operation says
+    bson_t* bulk_opts = BCON_NEW("ordered", BCON_BOOL(true));
+    mongoc_bulk_operation_t* bulk = mongoc_collection_create_bulk_operation_with_opts(repo->collection, bulk_opts);
+    bson_error_t error;
+    int failed = 0;
+
+    for (int i = 0; i < count && !failed; i++) {
+        bson_t* query = bson_new();
+        bson_oid_t oid;
+        bson_oid_init_from_string(&oid, ops[i].task_id);
+        BSON_APPEND_OID(query, "_id", &oid);
+
+        bson_t* update = bson_new();
+        bson_t set;
+        BSON_APPEND_DOCUMENT_BEGIN(update, "$set", &set);
+        if (ops[i].has_status) {
+            BSON_APPEND_INT32(&set, "status", ops[i].status);
+        }
+        if (ops[i].members) {
+            bson_t members_array;
+            BSON_APPEND_ARRAY_BEGIN(&set, "members", &members_array);
+            for (int j = 0; j < ops[i].member_count; j++) {
+                char str_idx[16];
+                snprintf(str_idx, sizeof(str_idx), "%d", j);
+                BSON_APPEND_UTF8(&members_array, str_idx, ops[i].members[j]);
+            }
+            bson_append_array_end(&set, &members_array);
+        }
+        bson_append_document_end(update, &set);
+
+        if (!mongoc_bulk_operation_update_one_with_opts(bulk, query, update, NULL, &error)) {
+            LOG_ERROR("Error queueing task operation %d: %s", i, error.message);
+            failed = 1;
+        }
+        bson_destroy(update);
+        bson_destroy(query);
+    }
+
+    if (!failed) {
+        bson_t reply;
+        if (mongoc_bulk_operation_execute(bulk, &reply, &error) == 0) {
+            LOG_ERROR("Error running task bulk write: %s", error.message);
+            failed = 1;
+        }
+        bson_destroy(&reply);
+    }
+
+    mongoc_bulk_operation_destroy(bulk);
+    bson_destroy(bulk_opts);
+    Cleanup(repo);
+
+    if (failed) {
+        return 1;
+    }
+
+    // Only status changes can move a project's status, recount each project once
+    for (int i = 0; i < count; i++) {
+        if (!ops[i].has_status || ops[i].project_id[0] == '\0') {
+            continue;
+        }
+        int seen = 0;
+        for (int j = 0; j < i && !seen; j++) {
+            seen = ops[j].has_status && strcmp(ops[j].project_id, ops[i].project_id) == 0;
+        }
+        if (!seen) {
+            update_project_status_from_tasks(ops[i].project_id);
+        }
+    }
     return 0;
 }
@@ -1,6 +1,7 @@
 #ifndef REPO_H
 #define REPO_H
 
+#include <mongoc/mongoc.h>
 #include "model.h"
 
 int add_task(Task* task);
@@ -18,4 +19,62 @@ int get_task_project_id(const char* task_id, char* project_id_out);
 int get_task_status(const char* task_id);
 int repo(void);
 
+// Name of the (members, status, project_id, _id) index behind get_user_open_tasks
+#define MY_TASKS_INDEX "members_status_project"
+
+// Creates the indexes the queries below rely on, 1 when Mongo refused
+int ensure_task_indexes(void);
+
+/**
+ * One page of the pending and in-progress tasks user_id is a member of,
+ * across all projects, ordered by status, project and id. Returns
+ * {"tasks":[...],"next":cursor} where next is passed back as after to get
+ * the following page and is null on the last one. NULL when after is not a
+ * cursor or the query fails.
+ */
+char* get_user_open_tasks(const char* user_id, const char* after, int limit);
+
+// Converts one task document to JSON and adds it to the array, -1 when it does not parse
+int append_task_json(cJSON* tasks_array, const bson_t* doc);
+
+// One entry of a batch update, members is NULL when they stay as they are
+typedef struct {
+    const char* task_id;
+    int has_status;
+    TaskStatus status;
+    const char** members;
+    int member_count;
+    char project_id[MAX_STRING_LENGTH];     // Filled in by find_task_operations, empty when not found
+    int involved;                           // Set when the user created the task or is a member
+} TaskOperation;
+
+/**
+ * Looks up every task in the batch with a single query, filling in its
+ * project and whether user_id may change its status. Returns 1 on a query
+ * failure.
+ */
+int find_task_operations(TaskOperation* ops, int count, const char* user_id);
+
+/**
+ * Runs the batch as one ordered bulk write and then recounts the status
+ * of each affected project once. Expects find_task_operations to have run.
+ */
+int bulk_update_tasks(const TaskOperation* ops, int count);
+
+/**
+ * Called with the id of a project whose documents changed, NULL when any
+ * project may have. event is the change stream document, NULL when the
+ * stream has just opened or ended and changes may have been missed.
+ */
+typedef void (*ChangeCallback)(void* cls, const char* project_id, const bson_t* event);
+
+/**
+ * Follows a collection's change stream and reports every change to on_change.
+ * project_field names the string field holding the project id, NULL when the
+ * collection holds the projects themselves. Blocks until the stream fails,
+ * so run it on its own thread. Needs a replica set.
+ */
+int watch_collection(const char* db_name, const char* collection_name, const char* project_field,
+    ChangeCallback on_change, void* cls);
+
 #endif
\ No newline at end of file
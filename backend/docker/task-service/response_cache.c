@@ -0,0 +1,276 @@
+#include "response_cache.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "arena.h"
+#include "compression.h"
+#include "logger.h"
+#include "metrics.h"
+#include "request.h"
+
+#define CACHE_SLOTS 256             // Direct-mapped, a colliding key evicts the older entry
+#define VERSION_SLOTS 1024          // Projects sharing a slot only invalidate each other early
+#define CACHE_MAX_BODY (256 * 1024)
+#define ETAG_SIZE 19                // Quoted 16 hex digits
+#define DEFAULT_TTL 30
+
+// Shared by the slot and every response still sending it, so hits are built without a copy
+typedef struct {
+    _Atomic int references;
+    char* body;
+    size_t size;
+    char* gzip;                     // NULL when the body is too small or does not shrink
+    size_t gzip_size;
+} CachedBody;
+
+typedef struct {
+    char key[RESPONSE_CACHE_KEY_SIZE];
+    uint64_t version;
+    time_t stored;
+    char etag[ETAG_SIZE];
+    CachedBody* cached;
+} CacheEntry;
+
+static CacheEntry entries[CACHE_SLOTS];
+static pthread_mutex_t entries_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Atomic uint64_t project_versions[VERSION_SLOTS];
+static _Atomic uint64_t listing_version;
+static _Atomic uint64_t epoch;              // Added to every version, so bumping it stales everything
+
+static int ttl = DEFAULT_TTL;
+
+static uint64_t fnv1a(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void response_cache_init(void) {
+    const char* env = getenv("RESPONSE_CACHE_TTL");
+    if (env) {
+        ttl = atoi(env);
+        if (ttl < 0) {
+            ttl = 0;
+        }
+    }
+    LOG_INFO("Response cache TTL %ds", ttl);
+}
+
+uint64_t response_cache_version(const char* project_id) {
+    uint64_t base = atomic_load(&epoch);
+    if (project_id == NULL) {
+        return base + atomic_load(&listing_version);
+    }
+    return base + atomic_load(&project_versions[fnv1a(project_id, strlen(project_id)) % VERSION_SLOTS]);
+}
+
+void response_cache_invalidate(const char* project_id) {
+    if (project_id) {
+        atomic_fetch_add(&project_versions[fnv1a(project_id, strlen(project_id)) % VERSION_SLOTS], 1);
+    }
+    atomic_fetch_add(&listing_version, 1);
+}
+
+void response_cache_invalidate_all(void) {
+    atomic_fetch_add(&epoch, 1);
+}
+
+// If-None-Match uses the weak comparison, so W/ prefixes are ignored
+static int etag_matches(struct MHD_Connection* connection, const char* etag) {
+    const char* header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "If-None-Match");
+    if (header == NULL) {
+        return 0;
+    }
+    size_t etag_length = strlen(etag);
+    const char* p = header;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        if (*p == '*') {
+            return 1;
+        }
+        if (strncmp(p, "W/", 2) == 0) {
+            p += 2;
+        }
+        size_t length = strcspn(p, ",");
+        while (length > 0 && (p[length - 1] == ' ' || p[length - 1] == '\t')) {
+            length--;
+        }
+        if (length == etag_length && strncmp(p, etag, length) == 0) {
+            return 1;
+        }
+        p += strcspn(p, ",");
+    }
+    return 0;
+}
+
+static struct MHD_Response* not_modified_response(void) {
+    return MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
+}
+
+static void add_validators(struct MHD_Response* response, const char* etag, int compressed) {
+    if (compressed) {
+        // Same content in another encoding, so the tag is only weakly equal to the identity body's
+        char weak_etag[ETAG_SIZE + 2];
+        snprintf(weak_etag, sizeof(weak_etag), "W/%s", etag);
+        MHD_add_response_header(response, "ETag", weak_etag);
+        MHD_add_response_header(response, "Content-Encoding", "gzip");
+    }
+    else {
+        MHD_add_response_header(response, "ETag", etag);
+    }
+    MHD_add_response_header(response, "Vary", "Accept-Encoding");
+    // Let the browser keep the body but always revalidate it
+    MHD_add_response_header(response, "Cache-Control", "private, no-cache");
+}
+
+static void release_body(void* cls) {
+    CachedBody* cached = (CachedBody*)cls;
+    if (atomic_fetch_sub(&cached->references, 1) == 1) {
+        free(cached->body);
+        free(cached->gzip);
+        free(cached);
+    }
+}
+
+static void count(const char* result) {
+    metrics_add(metrics_series(METRIC_CACHE_REQUESTS, result), 1);
+}
+
+struct MHD_Response* response_cache_lookup(struct MHD_Connection* connection, const char* key,
+    uint64_t version, unsigned int* status) {
+
+    if (ttl == 0) {
+        return NULL;
+    }
+
+    char etag[ETAG_SIZE];
+    CachedBody* cached = NULL;
+    CacheEntry* entry = &entries[fnv1a(key, strlen(key)) % CACHE_SLOTS];
+
+    // Only a reference is taken under the lock, the response is built after
+    pthread_mutex_lock(&entries_lock);
+    if (entry->cached && entry->version == version && strcmp(entry->key, key) == 0 &&
+        time(NULL) - entry->stored < ttl) {
+        memcpy(etag, entry->etag, ETAG_SIZE);
+        cached = entry->cached;
+        atomic_fetch_add(&cached->references, 1);
+    }
+    pthread_mutex_unlock(&entries_lock);
+
+    if (cached == NULL) {
+        count("miss");
+        return NULL;
+    }
+
+    struct MHD_Response* response;
+    int compressed = 0;
+    if (etag_matches(connection, etag)) {
+        *status = MHD_HTTP_NOT_MODIFIED;
+        release_body(cached);
+        response = not_modified_response();
+    }
+    else {
+        *status = MHD_HTTP_OK;
+        compressed = cached->gzip && compression_accepted(connection);
+        response = compressed
+            ? MHD_create_response_from_buffer_with_free_callback_cls(cached->gzip_size, cached->gzip,
+                  release_body, cached)
+            : MHD_create_response_from_buffer_with_free_callback_cls(cached->size, cached->body,
+                  release_body, cached);
+        if (response == NULL) {
+            release_body(cached);
+        }
+    }
+    if (response == NULL) {
+        return NULL;
+    }
+    count(*status == MHD_HTTP_OK ? "hit" : "not_modified");
+    add_validators(response, etag, compressed);
+    return response;
+}
+
+struct MHD_Response* response_cache_store(struct MHD_Connection* connection, const char* key,
+    uint64_t version, char* body, unsigned int* status) {
+
+    size_t size = strlen(body);
+    char etag[ETAG_SIZE];
+    snprintf(etag, sizeof(etag), "\"%016llx\"", (unsigned long long)fnv1a(body, size));
+
+    int cacheable = ttl > 0 && size <= CACHE_MAX_BODY && strlen(key) < RESPONSE_CACHE_KEY_SIZE;
+    int not_modified = etag_matches(connection, etag);
+    int accepted = !not_modified && compression_accepted(connection);
+
+    // Compressed once when stored so later hits are served without deflating again
+    size_t gzip_size = 0;
+    char* gzip = cacheable || accepted ? compression_gzip(body, size, &gzip_size) : NULL;
+    CachedBody* cached = NULL;
+    if (cacheable) {
+        cached = malloc(sizeof(CachedBody));
+        char* copy = malloc(size);
+        if (cached && copy) {
+            memcpy(copy, body, size);
+            atomic_init(&cached->references, 1);
+            cached->body = copy;
+            cached->size = size;
+            cached->gzip = gzip;
+            cached->gzip_size = gzip_size;
+        }
+        else {
+            free(cached);
+            free(copy);
+            cached = NULL;
+        }
+    }
+
+    struct MHD_Response* response;
+    int compressed = 0;
+    if (not_modified) {
+        *status = MHD_HTTP_NOT_MODIFIED;
+        request_free(body);
+        response = not_modified_response();
+    }
+    else if (gzip && accepted) {
+        *status = MHD_HTTP_OK;
+        compressed = 1;
+        request_free(body);
+        response = MHD_create_response_from_buffer(gzip_size, gzip, MHD_RESPMEM_MUST_COPY);
+    }
+    else {
+        *status = MHD_HTTP_OK;
+        response = create_request_response(body);
+    }
+    if (response) {
+        add_validators(response, etag, compressed);
+    }
+
+    if (cached) {
+        CacheEntry* entry = &entries[fnv1a(key, strlen(key)) % CACHE_SLOTS];
+
+        pthread_mutex_lock(&entries_lock);
+        CachedBody* old = entry->cached;
+        strcpy(entry->key, key);
+        entry->version = version;
+        entry->stored = time(NULL);
+        memcpy(entry->etag, etag, ETAG_SIZE);
+        entry->cached = cached;
+        pthread_mutex_unlock(&entries_lock);
+
+        // Responses still sending the old body keep it until they are done
+        if (old) {
+            release_body(old);
+        }
+    }
+    else {
+        free(gzip);
+    }
+    return response;
+}
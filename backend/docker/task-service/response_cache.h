@@ -0,0 +1,50 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <stdint.h>
+#include <microhttpd.h>
+
+// Room for a route name, a user id and a role
+#define RESPONSE_CACHE_KEY_SIZE 160
+
+/**
+ * Reads RESPONSE_CACHE_TTL, the seconds an entry may be served without a
+ * write having been seen (default 30, 0 disables storing). Writes made by
+ * another service or process reach the cache through the change stream
+ * watcher, the TTL only bounds staleness while no stream is open.
+ */
+void response_cache_init(void);
+
+/**
+ * Current version for a project, or for the project listings when
+ * project_id is NULL. Read it before querying Mongo so a write that lands
+ * while the body is being built leaves the stored entry already stale.
+ */
+uint64_t response_cache_version(const char* project_id);
+
+// Bumps the project's version and the listings version
+void response_cache_invalidate(const char* project_id);
+
+// Makes every stored entry stale, for changes that cannot be traced to a project
+void response_cache_invalidate_all(void);
+
+/**
+ * Cached response for key if it was stored at this version and is within the
+ * TTL, NULL otherwise. *status is MHD_HTTP_NOT_MODIFIED when the request's
+ * If-None-Match already names the entry's ETag, MHD_HTTP_OK otherwise. The
+ * body is the stored gzip copy when the client accepts gzip.
+ */
+struct MHD_Response* response_cache_lookup(struct MHD_Connection* connection, const char* key,
+    uint64_t version, unsigned int* status);
+
+/**
+ * Stores a copy of body under key and builds its response with a strong
+ * ETag, taking body the way create_request_response does. Bodies above
+ * COMPRESS_MIN_SIZE are also kept gzipped, served with a weak ETag to
+ * clients that accept it. Still answers 304 when the rebuilt body hashes to
+ * the ETag the client already has.
+ */
+struct MHD_Response* response_cache_store(struct MHD_Connection* connection, const char* key,
+    uint64_t version, char* body, unsigned int* status);
+
+#endif
@@ -0,0 +1,219 @@
+#include "router.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ROUTE_MAX_PER_PATH 8
+
+/**
+ * A literal node holds a run of path bytes shared by every route below it,
+ * a parameter node matches one whole segment. Each node has at most one
+ * parameter child, tried only after the literal children.
+ */
+struct RouteNode {
+    char* text;                 // Literal bytes, or the parameter name
+    size_t length;
+    int is_param;
+    RouteNode** children;       // Literal children, no two share a first byte
+    size_t child_count;
+    RouteNode* param;
+    const Route* routes[ROUTE_MAX_PER_PATH];
+    size_t route_count;
+};
+
+static RouteNode* create_node(const char* text, size_t length, int is_param) {
+    RouteNode* node = calloc(1, sizeof(RouteNode));
+    if (node == NULL) {
+        return NULL;
+    }
+    node->text = malloc(length + 1);
+    if (node->text == NULL) {
+        free(node);
+        return NULL;
+    }
+    memcpy(node->text, text, length);
+    node->text[length] = '\0';
+    node->length = length;
+    node->is_param = is_param;
+    return node;
+}
+
+static int add_child(RouteNode* parent, RouteNode* child) {
+    RouteNode** children = realloc(parent->children, (parent->child_count + 1) * sizeof(RouteNode*));
+    if (children == NULL) {
+        return -1;
+    }
+    children[parent->child_count++] = child;
+    parent->children = children;
+    return 0;
+}
+
+static int add_route(RouteNode* node, const Route* route) {
+    for (size_t i = 0; i < node->route_count; i++) {
+        if (node->routes[i]->methods & route->methods) {
+            return -1;
+        }
+    }
+    if (node->route_count == ROUTE_MAX_PER_PATH) {
+        return -1;
+    }
+    node->routes[node->route_count++] = route;
+    return 0;
+}
+
+// Moves everything after the first split bytes of child into a new node below it
+static int split_node(RouteNode* child, size_t split) {
+    RouteNode* tail = create_node(child->text + split, child->length - split, 0);
+    if (tail == NULL) {
+        return -1;
+    }
+    tail->children = child->children;
+    tail->child_count = child->child_count;
+    tail->param = child->param;
+    memcpy(tail->routes, child->routes, sizeof(child->routes));
+    tail->route_count = child->route_count;
+
+    child->children = NULL;
+    child->child_count = 0;
+    child->param = NULL;
+    child->route_count = 0;
+    child->length = split;
+    child->text[split] = '\0';
+    return add_child(child, tail);
+}
+
+static int insert(RouteNode* node, const char* pattern, const Route* route) {
+    if (*pattern == '\0') {
+        return add_route(node, route);
+    }
+
+    if (*pattern == '{') {
+        const char* close = strchr(pattern, '}');
+        if (close == NULL || close == pattern + 1) {
+            return -1;
+        }
+        size_t name_length = close - pattern - 1;
+        if (node->param == NULL) {
+            node->param = create_node(pattern + 1, name_length, 1);
+            if (node->param == NULL) {
+                return -1;
+            }
+        }
+        else if (node->param->length != name_length || strncmp(node->param->text, pattern + 1, name_length) != 0) {
+            // Same position, different names: the handlers could not agree on what they get
+            return -1;
+        }
+        return insert(node->param, close + 1, route);
+    }
+
+    size_t literal_length = strcspn(pattern, "{");
+    for (size_t i = 0; i < node->child_count; i++) {
+        RouteNode* child = node->children[i];
+        if (child->text[0] != pattern[0]) {
+            continue;
+        }
+        size_t common = 0;
+        while (common < child->length && common < literal_length && child->text[common] == pattern[common]) {
+            common++;
+        }
+        if (common < child->length && split_node(child, common) != 0) {
+            return -1;
+        }
+        return insert(child, pattern + common, route);
+    }
+
+    RouteNode* child = create_node(pattern, literal_length, 0);
+    if (child == NULL || add_child(node, child) != 0) {
+        free(child);
+        return -1;
+    }
+    return insert(child, pattern + literal_length, route);
+}
+
+int router_init(Router* router, const Route* routes, size_t count) {
+    router->root = create_node("", 0, 0);
+    if (router->root == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (routes[i].pattern[0] != '/' || insert(router->root, routes[i].pattern, &routes[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int method_flag(const char* method) {
+    switch (method[0]) {
+        case 'G': return strcmp(method, "GET") == 0 ? ROUTE_GET : 0;
+        case 'P':
+            if (strcmp(method, "POST") == 0) return ROUTE_POST;
+            if (strcmp(method, "PUT") == 0) return ROUTE_PUT;
+            if (strcmp(method, "PATCH") == 0) return ROUTE_PATCH;
+            return 0;
+        case 'D': return strcmp(method, "DELETE") == 0 ? ROUTE_DELETE : 0;
+        default: return 0;
+    }
+}
+
+// Path bytes before node have been consumed, path is what the node and its subtree must match
+static const Route* match_node(const RouteNode* node, const char* path, int method, RouteParams* params) {
+    if (node->is_param) {
+        size_t length = strcspn(path, "/");
+        if (length == 0 || length >= ROUTE_PARAM_SIZE || params->count == ROUTE_MAX_PARAMS) {
+            return NULL;
+        }
+        int index = params->count++;
+        params->names[index] = node->text;
+        memcpy(params->values[index], path, length);
+        params->values[index][length] = '\0';
+        path += length;
+    }
+    else {
+        if (strncmp(path, node->text, node->length) != 0) {
+            return NULL;
+        }
+        path += node->length;
+    }
+
+    const Route* found = NULL;
+    if (*path == '\0') {
+        for (size_t i = 0; i < node->route_count && found == NULL; i++) {
+            if (node->routes[i]->methods & method) {
+                found = node->routes[i];
+            }
+        }
+    }
+    else {
+        for (size_t i = 0; i < node->child_count && found == NULL; i++) {
+            if (node->children[i]->text[0] == *path) {
+                found = match_node(node->children[i], path, method, params);
+            }
+        }
+        if (found == NULL && node->param) {
+            found = match_node(node->param, path, method, params);
+        }
+    }
+
+    if (found == NULL && node->is_param) {
+        params->count--;
+    }
+    return found;
+}
+
+const Route* router_match(const Router* router, const char* method, const char* url, RouteParams* params) {
+    params->count = 0;
+    int flag = method_flag(method);
+    if (flag == 0 || router->root == NULL) {
+        return NULL;
+    }
+    return match_node(router->root, url, flag, params);
+}
+
+const char* route_param(const RouteParams* params, const char* name) {
+    for (int i = 0; i < params->count; i++) {
+        if (strcmp(params->names[i], name) == 0) {
+            return params->values[i];
+        }
+    }
+    return NULL;
+}
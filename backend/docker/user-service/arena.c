@@ -0,0 +1,159 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define ARENA_ALIGNMENT (sizeof(max_align_t))
+#define ARENA_ALIGN(n) (((n) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t capacity;
+    size_t used;
+    size_t last;    // Offset of the most recent allocation, lets it grow in place
+    max_align_t data[];
+};
+
+static __thread Arena* active_arena = NULL;
+
+static ArenaBlock* arena_block_new(size_t capacity) {
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + capacity);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    block->last = 0;
+    return block;
+}
+
+Arena* arena_create(size_t block_size) {
+    Arena* arena = malloc(sizeof(Arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->block_size = block_size ? block_size : ARENA_BLOCK_SIZE;
+    arena->head = arena_block_new(arena->block_size);
+    if (arena->head == NULL) {
+        free(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+void arena_destroy(Arena* arena) {
+    if (arena == NULL) {
+        return;
+    }
+    if (active_arena == arena) {
+        active_arena = NULL;
+    }
+
+    ArenaBlock* block = arena->head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = ARENA_ALIGN(size ? size : 1);
+
+    ArenaBlock* block = arena->head;
+    if (block->capacity - block->used < size) {
+        // Oversized requests get a block of their own
+        size_t capacity = size > arena->block_size ? size : arena->block_size;
+        ArenaBlock* fresh = arena_block_new(capacity);
+        if (fresh == NULL) {
+            return NULL;
+        }
+        fresh->next = block;
+        arena->head = fresh;
+        block = fresh;
+    }
+
+    char* ptr = (char*)block->data + block->used;
+    block->last = block->used;
+    block->used += size;
+    return ptr;
+}
+
+void* arena_realloc(Arena* arena, void* ptr, size_t old_size, size_t new_size) {
+    if (ptr == NULL) {
+        return arena_alloc(arena, new_size);
+    }
+
+    // The newest allocation can simply be extended while its block has room
+    ArenaBlock* block = arena->head;
+    if ((char*)ptr == (char*)block->data + block->last) {
+        size_t aligned = ARENA_ALIGN(new_size);
+        if (block->last + aligned <= block->capacity) {
+            block->used = block->last + aligned;
+            return ptr;
+        }
+    }
+
+    void* fresh = arena_alloc(arena, new_size);
+    if (fresh == NULL) {
+        return NULL;
+    }
+    memcpy(fresh, ptr, old_size < new_size ? old_size : new_size);
+    return fresh;
+}
+
+char* arena_strdup(Arena* arena, const char* str) {
+    size_t len = strlen(str);
+    char* copy = arena_alloc(arena, len + 1);
+    if (copy) {
+        memcpy(copy, str, len + 1);
+    }
+    return copy;
+}
+
+int arena_owns(const Arena* arena, const void* ptr) {
+    if (arena == NULL || ptr == NULL) {
+        return 0;
+    }
+    for (const ArenaBlock* block = arena->head; block; block = block->next) {
+        const char* start = (const char*)block->data;
+        if ((const char*)ptr >= start && (const char*)ptr < start + block->capacity) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void arena_activate(Arena* arena) {
+    active_arena = arena;
+}
+
+Arena* arena_active(void) {
+    return active_arena;
+}
+
+void* request_malloc(size_t size) {
+    if (active_arena) {
+        return arena_alloc(active_arena, size);
+    }
+    return malloc(size);
+}
+
+void request_free(void* ptr) {
+    // Arena memory goes away with its request. Nothing is looked up, a request
+    // only ever frees what it allocated, and outside one request_malloc is malloc.
+    if (active_arena) {
+        return;
+    }
+    free(ptr);
+}
+
+char* request_strdup(const char* str) {
+    if (active_arena) {
+        return arena_strdup(active_arena, str);
+    }
+    return strdup(str);
+}
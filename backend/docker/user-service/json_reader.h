@@ -0,0 +1,57 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <stddef.h>
+
+// Result codes, shared with the parse_*_from_body decoders
+#define JSON_INVALID -100       // Body is not well-formed JSON
+#define JSON_WRONG_TYPE -101    // Value exists but has another type, nothing consumed
+
+/**
+ * Forward-only JSON reader over a raw buffer. Values are decoded straight
+ * into caller-owned storage as they are reached, no tree is built and the
+ * buffer does not need to be NUL-terminated.
+ */
+typedef struct {
+    const char* pos;
+    const char* end;
+    int container_start;    // Set right after '{' or '[', no comma expected yet
+} JsonReader;
+
+void json_reader_init(JsonReader* reader, const char* data, size_t size);
+
+// Returns the first character of the next value without consuming it, 0 at end of input
+char json_reader_peek(JsonReader* reader);
+
+int json_reader_begin_object(JsonReader* reader);
+int json_reader_begin_array(JsonReader* reader);
+
+/**
+ * Advances to the next key of the current object.
+ * Returns 1 with the raw key bytes, 0 at the closing brace, JSON_INVALID on error.
+ */
+int json_reader_next_key(JsonReader* reader, const char** key, size_t* key_size);
+
+// Returns 1 when another array item follows, 0 at the closing bracket, JSON_INVALID on error
+int json_reader_next_item(JsonReader* reader);
+
+/**
+ * Decodes a string value into out, always NUL-terminated and truncated to
+ * out_size. Like snprintf it returns the full decoded length, so a result
+ * >= out_size means the value did not fit.
+ */
+int json_reader_string(JsonReader* reader, char* out, size_t out_size);
+
+// Reads a number, saturated to the int range the same way cJSON fills valueint
+int json_reader_int(JsonReader* reader, int* out);
+
+int json_reader_skip(JsonReader* reader);
+
+// 0 when nothing but whitespace is left after the top-level value
+int json_reader_finish(JsonReader* reader);
+
+// Compares a raw key returned by json_reader_next_key against a literal
+#define JSON_KEY_IS(key, key_size, literal) \
+    ((key_size) == sizeof(literal) - 1 && memcmp((key), (literal), sizeof(literal) - 1) == 0)
+
+#endif
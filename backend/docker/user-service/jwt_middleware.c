@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include "metrics.h"
 
 /**
  * Extract JWT token from Authorization header
@@ -96,6 +97,7 @@ cleanup:
     if (claims) {
         l8w8jwt_free_claims(claims, claims_length);
     }
+    metrics_add(metrics_series(METRIC_JWT_VERIFICATIONS, auth->is_valid ? "valid" : "invalid"), 1);
     
     return auth->is_valid ? 0 : -1;
 }
@@ -147,7 +149,7 @@ int send_unauthorized_response(struct MHD_Connection* connection, const char* me
     
     int ret = MHD_queue_response(connection, MHD_HTTP_UNAUTHORIZED, response);
     MHD_destroy_response(response);
-    free(error_json);
+    cJSON_free(error_json);
     
     return ret;
 }
@@ -169,7 +171,7 @@ int send_forbidden_response(struct MHD_Connection* connection, const char* messa
     
     int ret = MHD_queue_response(connection, MHD_HTTP_FORBIDDEN, response);
     MHD_destroy_response(response);
-    free(error_json);
+    cJSON_free(error_json);
     
     return ret;
 }
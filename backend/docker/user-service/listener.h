@@ -0,0 +1,23 @@
+#ifndef LISTENER_H
+#define LISTENER_H
+
+#include <stdint.h>
+#include <microhttpd.h>
+
+typedef struct {
+    struct MHD_Daemon* tcp;
+    struct MHD_Daemon* unix_socket;
+} Listeners;
+
+/**
+ * Starts the service on TCP port, and on the Unix socket at UNIX_SOCKET as
+ * well when that is set, so a gateway on the same host can skip the TCP
+ * stack. UNIX_SOCKET_ONLY=1 leaves TCP off. Both daemons run with the same
+ * flags and callbacks. Returns -1 when a requested listener cannot start.
+ */
+int listeners_start(Listeners* listeners, unsigned int flags, uint16_t port,
+    MHD_AccessHandlerCallback handler, MHD_RequestCompletedCallback completed);
+
+void listeners_stop(Listeners* listeners);
+
+#endif
@@ -10,29 +10,28 @@
 #include "decode.h"
 #include "jwt_middleware.h"
 #include "password_validator.h"
+#include "request.h"
+#include "logger.h"
+#include "router.h"
+#include "listener.h"
 
 #define PORT 8080
 
 
-struct ConnectionInfo {
-    char* json_data;
-    size_t json_size;
-};
-
 struct Usersearch {
     User* users;
     int size;
     int* number_of_results;
 };
 
-int parse_parameters(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
+enum MHD_Result parse_parameters(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
 
     int* is_valid = (int*)cls;
 
     if (key && value) {
         if (strcmp(key, "link") == 0) {
             int activation_return = check_activation(value);
-            printf("returned: %d\n", activation_return);
+            LOG_DEBUG("returned: %d", activation_return);
             if (!activation_return) {
                 *is_valid = 1;
             }
@@ -42,33 +41,28 @@ int parse_parameters(void* cls, enum MHD_ValueKind kind, const char* key, const
     return MHD_YES;
 }
 
-int parse_magic_link(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
+enum MHD_Result parse_magic_link(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
 
     char** username = (char**)cls;
 
     if (key && value) {
         if (strcmp(key, "link") == 0) {
-            fprintf(stderr, "I love rozen maiden3\n");
             int activation_return = check_magic_link(value, username);
-            printf("returned: %d\n", activation_return);
-            fprintf(stderr, "returned: %d\n", activation_return);
-            fprintf(stderr, "I love rozen maiden4\n");
+            LOG_DEBUG("returned: %d", activation_return);
         }
     }
 
     return MHD_YES;
 }
 
-int parse_recovery_link(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
+enum MHD_Result parse_recovery_link(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
 
     int* is_valid = (int*)cls;
 
     if (key && value) {
         if (strcmp(key, "link") == 0) {
             int activation_return = check_recovery_link(value);
-            printf("returned: %d\n", activation_return);
-            fprintf(stderr, "returned: %d\n", activation_return);
-            fprintf(stderr, "Cajevi\n");
+            LOG_DEBUG("returned: %d", activation_return);
             if (!activation_return) {
                 *is_valid = 1;
             }
@@ -78,1046 +72,928 @@ int parse_recovery_link(void* cls, enum MHD_ValueKind kind, const char* key, con
     return MHD_YES;
 }
 
-int return_recovery_link(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
+enum MHD_Result return_recovery_link(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
 
     char *recovery_link = (char*)cls;
 
     if (key && value) {
         if (strcmp(key, "link") == 0) {
             snprintf(recovery_link, 41, "%s", value);
-            fprintf(stderr, "recovery link %s\n", recovery_link);
-            fprintf(stderr, "Herbal\n");
+            LOG_DEBUG("recovery link %s", recovery_link);
         }
     }
 
     return MHD_YES;
 }
 
-int parse_search_parameters(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
+enum MHD_Result parse_search_parameters(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
 
     struct Usersearch* userstruct = (struct Usersearch*)cls;
-    printf("number of prefilled results: %d\n", *userstruct->number_of_results);
+    LOG_DEBUG("number of prefilled results: %d", *userstruct->number_of_results);
 
     if (key && value) {
         if (strcmp(key, "name") == 0) {
-            printf("%s", value);
-            printf("\n");
 
             int suiseiseki = find_users(value, userstruct->users, userstruct->size, userstruct->number_of_results);
-            printf("number of results: %d\n", *userstruct->number_of_results);
-            printf("size: %d\n", userstruct->size);
+            LOG_DEBUG("number of results: %d", *userstruct->number_of_results);
+            LOG_DEBUG("size: %d", userstruct->size);
 
             if (!suiseiseki) {
                 if (*userstruct->number_of_results > 0) {
-                    printf("First name: %s\n", userstruct->users[0].first_name);
+                    LOG_DEBUG("First name: %s", userstruct->users[0].first_name);
                 }
             }
             else {
-                printf("Finding users failed\n");
+                LOG_ERROR("Finding users failed");
             }
         }
     }
     return MHD_YES;
 }
 
-int answer_to_connection(void* cls, struct MHD_Connection* connection,
-    const char* url, const char* method, const char* version,
-    const char* upload_data, size_t* upload_data_size, void** con_cls) {
+// Decodes a user from the request body, JSON_INVALID when it is not valid JSON
+static int decode_user_body(struct ConnectionInfo* conn_info, User* user) {
+#ifdef FAST_JSON
+    size_t body_size;
+    const char* body = request_body(conn_info, &body_size);
+    return parse_user_from_body(body, body_size, user);
+#else
+    cJSON* json = request_body_json(conn_info);
+    if (json == NULL) {
+        return JSON_INVALID;
+    }
+    int result = parse_user_from_json(json, user);
+    cJSON_Delete(json);
+    return result;
+#endif
+}
 
-    if (strcmp(method, "OPTIONS") == 0) {
-        struct MHD_Response* response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
+static int handle_metrics(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    char* metrics = metrics_render();
+    if (metrics == NULL) {
+        return MHD_NO;
+    }
+    struct MHD_Response* response = create_request_response(metrics);
+    MHD_add_response_header(response, "Content-Type", "text/plain; version=0.0.4");
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Handle "/newuser" POST request
+static int handle_new_user(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // All data received, process the JSON
+    User user;
+    int parse_result = decode_user_body(conn_info, &user);
+    if (parse_result == JSON_INVALID) {
+        const char* error_response = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+            (void*)error_response, MHD_RESPMEM_PERSISTENT);
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-        MHD_add_response_header(response, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
-        MHD_add_response_header(response, "Access-Control-Allow-Headers", "Content-Type");
-        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
         MHD_destroy_response(response);
-        return ret;
+        return MHD_YES;
     }
 
-    // Handle "/newuser" POST request
-    if (strcmp(url, "/newuser") == 0 && strcmp(method, "POST") == 0) {
-
-        printf("ZLAJAAAAA.\n");
-
-        if (*con_cls == NULL) {
-            struct ConnectionInfo* conn_info = calloc(1, sizeof(struct ConnectionInfo));
-            *con_cls = (void*)conn_info;
-            return MHD_YES;
+    if (parse_result == 0) {
+        if (adduser(&user) == 0) {
+            const char* response_str = "User data received";
+            struct MHD_Response* response = MHD_create_response_from_buffer(strlen(response_str),
+                (void*)response_str, MHD_RESPMEM_PERSISTENT);
+            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+            MHD_destroy_response(response);
+        } else {
+            const char* error_response = "User not added";
+            struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+                (void*)error_response, MHD_RESPMEM_PERSISTENT);
+            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+            MHD_destroy_response(response);
         }
+    } else if (parse_result == PASSWORD_TOO_SHORT || parse_result == PASSWORD_TOO_COMMON || parse_result == PASSWORD_INVALID_CHARS) {
+        // Handle password validation errors specifically
+        const char* error_message = get_password_error_message(parse_result);
+        cJSON* error_json = cJSON_CreateObject();
+        cJSON_AddStringToObject(error_json, "error", "Password validation failed");
+        cJSON_AddStringToObject(error_json, "message", error_message);
+        char* error_response = cJSON_Print(error_json);
+        
+        struct MHD_Response* response = create_request_response(error_response);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(error_json);
+        LOG_WARN("Password validation failed: %s", error_message);
+    } else {
+        const char* error_response = "Missing or invalid fields";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+            (void*)error_response, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+    }
 
-        printf("KAKIMIIIICS.\n");
+    return MHD_YES;
+}
 
-        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
-        // If there's upload data, accumulate it
-        if (*upload_data_size > 0) {
-            // Reallocate memory to store incoming data
-            conn_info->json_data = realloc(conn_info->json_data, conn_info->json_size + *upload_data_size + 1);
-            memcpy(conn_info->json_data + conn_info->json_size, upload_data, *upload_data_size);
-            conn_info->json_size += *upload_data_size;
-            conn_info->json_data[conn_info->json_size] = '\0';  // Null-terminate
-            *upload_data_size = 0;  // Signal that we've processed this data
-            printf("KRKAAAAAAN.\n");
-            return MHD_YES;
-        }
-        else {
-            // All data received, process the JSON
-            cJSON* json = cJSON_Parse(conn_info->json_data);
-            if (json == NULL) {
-                const char* error_response = "Invalid JSON format";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                cJSON_Delete(json);
-                printf("GIMBAAAAAN.\n");
-                return MHD_YES;
-            }
+static int handle_profile(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    AuthContext auth;
+    
+    // Authenticate the request
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check permission to read user data
+    if (check_permission(&auth, PERM_READ_USERS) != 0) {
+        return send_forbidden_response(connection, "Cannot access user profile");
+    }
+    
+    // Create response with user information
+    cJSON* profile = cJSON_CreateObject();
+    cJSON_AddStringToObject(profile, "user_id", auth.user_id);
+    cJSON_AddStringToObject(profile, "role", auth.role);
+    cJSON_AddStringToObject(profile, "status", "authenticated");
+    
+    char* profile_json = cJSON_Print(profile);
+    cJSON_Delete(profile);
+    
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        strlen(profile_json),
+        profile_json,
+        MHD_RESPMEM_MUST_COPY
+    );
+    
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    cJSON_free(profile_json);
+    
+    return ret;
+}
 
-            User user;
-            int parse_result = parse_user_from_json(json, &user);
-            if (parse_result == 0) {
-                if (adduser(&user) == 0) {
-                    const char* response_str = "User data received";
-                    struct MHD_Response* response = MHD_create_response_from_buffer(strlen(response_str),
-                        (void*)response_str, MHD_RESPMEM_PERSISTENT);
-                    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-                    MHD_destroy_response(response);
-                    printf("KKKKKKKKKKKKK.\n");
-                } else {
-                    const char* error_response = "User not added";
-                    struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                        (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                    int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                    MHD_destroy_response(response);
-                }
-            } else if (parse_result == PASSWORD_TOO_SHORT || parse_result == PASSWORD_TOO_COMMON || parse_result == PASSWORD_INVALID_CHARS) {
-                // Handle password validation errors specifically
-                const char* error_message = get_password_error_message(parse_result);
-                cJSON* error_json = cJSON_CreateObject();
-                cJSON_AddStringToObject(error_json, "error", "Password validation failed");
-                cJSON_AddStringToObject(error_json, "message", error_message);
-                char* error_response = cJSON_Print(error_json);
-                
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_MUST_FREE);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                MHD_add_response_header(response, "Content-Type", "application/json");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                cJSON_Delete(error_json);
-                printf("Password validation failed: %s\n", error_message);
-            } else {
-                const char* error_response = "Missing or invalid fields";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-            }
+static int handle_admin_users(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    AuthContext auth;
+    
+    // Authenticate the request
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
+    }
+    
+    // Check admin permission
+    if (check_permission(&auth, PERM_ADMIN_ONLY) != 0) {
+        return send_forbidden_response(connection, "Admin access required");
+    }
+    
+    // Create admin response
+    cJSON* admin_data = cJSON_CreateObject();
+    cJSON_AddStringToObject(admin_data, "message", "Admin access granted");
+    cJSON_AddStringToObject(admin_data, "admin_user", auth.user_id);
+    cJSON_AddStringToObject(admin_data, "role", auth.role);
+    
+    char* admin_json = cJSON_Print(admin_data);
+    cJSON_Delete(admin_data);
+    
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        strlen(admin_json),
+        admin_json,
+        MHD_RESPMEM_MUST_COPY
+    );
+    
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    cJSON_free(admin_json);
+    
+    return ret;
+}
 
-            // Clean up
-            cJSON_Delete(json);
-            free(conn_info->json_data);
-            free(conn_info);
-            *con_cls = NULL;
-            printf("LLLLLLLLLLLLL.\n");
-            return MHD_YES;
-        }
+static int handle_auth_verify(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    AuthContext auth;
+    
+    // Authenticate the request
+    if (authenticate_request(connection, &auth) != 0) {
+        return send_unauthorized_response(connection, auth.error_message);
     }
+    
+    // Create verification response
+    cJSON* verify_data = cJSON_CreateObject();
+    cJSON_AddStringToObject(verify_data, "valid", "true");
+    cJSON_AddStringToObject(verify_data, "user_id", auth.user_id);
+    cJSON_AddStringToObject(verify_data, "role", auth.role);
+    
+    char* verify_json = cJSON_Print(verify_data);
+    cJSON_Delete(verify_data);
+    
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        strlen(verify_json),
+        verify_json,
+        MHD_RESPMEM_MUST_COPY
+    );
+    
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    cJSON_free(verify_json);
+    
+    return ret;
+}
 
-    if (strcmp(url, "/profile") == 0 && strcmp(method, "GET") == 0) {
-        AuthContext auth;
-        
-        // Authenticate the request
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // Check permission to read user data
-        if (check_permission(&auth, PERM_READ_USERS) != 0) {
-            return send_forbidden_response(connection, "Cannot access user profile");
-        }
-        
-        // Create response with user information
-        cJSON* profile = cJSON_CreateObject();
-        cJSON_AddStringToObject(profile, "user_id", auth.user_id);
-        cJSON_AddStringToObject(profile, "role", auth.role);
-        cJSON_AddStringToObject(profile, "status", "authenticated");
-        
-        char* profile_json = cJSON_Print(profile);
-        cJSON_Delete(profile);
-        
-        struct MHD_Response* response = MHD_create_response_from_buffer(
-            strlen(profile_json),
-            profile_json,
-            MHD_RESPMEM_MUST_COPY
-        );
-        
+static int handle_activate(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    int is_valid = 0;
+
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_parameters, &is_valid);
+    LOG_DEBUG("is valid: %d", is_valid);
+    // Parse query string parameters and check them on the fly
+    if (is_valid) {
+        struct MHD_Response* response;
+        const char* response_text = "Account activated";
+        response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-        MHD_add_response_header(response, "Content-Type", "application/json");
-        
         int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
         MHD_destroy_response(response);
-        free(profile_json);
-        
+
         return ret;
     }
-
-    if (strcmp(url, "/admin/users") == 0 && strcmp(method, "GET") == 0) {
-        AuthContext auth;
-        
-        // Authenticate the request
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // Check admin permission
-        if (check_permission(&auth, PERM_ADMIN_ONLY) != 0) {
-            return send_forbidden_response(connection, "Admin access required");
-        }
-        
-        // Create admin response
-        cJSON* admin_data = cJSON_CreateObject();
-        cJSON_AddStringToObject(admin_data, "message", "Admin access granted");
-        cJSON_AddStringToObject(admin_data, "admin_user", auth.user_id);
-        cJSON_AddStringToObject(admin_data, "role", auth.role);
-        
-        char* admin_json = cJSON_Print(admin_data);
-        cJSON_Delete(admin_data);
-        
-        struct MHD_Response* response = MHD_create_response_from_buffer(
-            strlen(admin_json),
-            admin_json,
-            MHD_RESPMEM_MUST_COPY
-        );
-        
+    else {
+        struct MHD_Response* response;
+        const char* response_text = "Account activation failed";
+        response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-        MHD_add_response_header(response, "Content-Type", "application/json");
-        
-        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
         MHD_destroy_response(response);
-        free(admin_json);
-        
+
         return ret;
     }
+}
 
-    if (strcmp(url, "/auth/verify") == 0 && strcmp(method, "GET") == 0) {
-        AuthContext auth;
-        
-        // Authenticate the request
-        if (authenticate_request(connection, &auth) != 0) {
-            return send_unauthorized_response(connection, auth.error_message);
-        }
-        
-        // Create verification response
-        cJSON* verify_data = cJSON_CreateObject();
-        cJSON_AddStringToObject(verify_data, "valid", "true");
-        cJSON_AddStringToObject(verify_data, "user_id", auth.user_id);
-        cJSON_AddStringToObject(verify_data, "role", auth.role);
-        
-        char* verify_json = cJSON_Print(verify_data);
-        cJSON_Delete(verify_data);
-        
-        struct MHD_Response* response = MHD_create_response_from_buffer(
-            strlen(verify_json),
-            verify_json,
-            MHD_RESPMEM_MUST_COPY
-        );
-        
+// Answers 500 when a token could not be signed
+static int send_token_error(struct MHD_Connection* connection, int result) {
+    LOG_ERROR("Could not encode token, l8w8jwt error %d", result);
+    const char* error_response = "Internal server error";
+    struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+        (void*)error_response, MHD_RESPMEM_PERSISTENT);
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+static int handle_login(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // All data received, process the JSON
+    cJSON* json = request_body_json(conn_info);
+    if (json == NULL) {
+        const char* error_response = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+            (void*)error_response, MHD_RESPMEM_PERSISTENT);
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-        MHD_add_response_header(response, "Content-Type", "application/json");
-        
-        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
         MHD_destroy_response(response);
-        free(verify_json);
-        
-        return ret;
+        cJSON_Delete(json);
+        return MHD_YES;
     }
 
-    if (strcmp(url, "/activate") == 0) {
+    cJSON* username_or_email = cJSON_GetObjectItem(json, "username_or_email");
+    char role[10];
+    if (!parse_credentials_from_json(json, role)) {
 
-        printf("Received GET request for URL path: %s\n", url);
-        int is_valid = 0;
+        const char *var_name = "HMAC_KEY";
+        char *hmac_key = getenv(var_name);
 
-        MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_parameters, &is_valid);
-        printf("is valid: %d\n", is_valid);
-        // Parse query string parameters and check them on the fly
-        if (is_valid) {
-            struct MHD_Response* response;
-            const char* response_text = "Account activated";
-            response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-            MHD_destroy_response(response);
+        char* jwt;
+        size_t jwt_length;
 
-            return ret;
-        }
-        else {
-            struct MHD_Response* response;
-            const char* response_text = "Account activation failed";
-            response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
+        struct l8w8jwt_encoding_params params;
+        l8w8jwt_encoding_params_init(&params);
 
-            return ret;
-        }
-    }
+        params.alg = L8W8JWT_ALG_HS512;
+
+        params.sub = username_or_email->valuestring;
+        params.iss = "Trello Clone";
+        params.aud = role;
 
-    if (strcmp(url, "/login") == 0 && strcmp(method, "POST") == 0) {
+        params.iat = l8w8jwt_time(NULL);
+        params.exp = l8w8jwt_time(NULL) + 600; /* Set to expire after 10 minutes (600 seconds). */
 
-        printf("ZLAJAAAAA.\n");
+        params.secret_key = (unsigned char*)hmac_key;
+        params.secret_key_length = strlen(params.secret_key);
 
-        if (*con_cls == NULL) {
-            struct ConnectionInfo* conn_info = calloc(1, sizeof(struct ConnectionInfo));
-            *con_cls = (void*)conn_info;
+        params.out = &jwt;
+        params.out_length = &jwt_length;
+
+        int r = l8w8jwt_encode(&params);
+        if (r != L8W8JWT_SUCCESS) {
+            send_token_error(connection, r);
+            cJSON_Delete(json);
             return MHD_YES;
         }
 
-        printf("KAKIMIIIICS.\n");
+        // MHD sends the body after the handler returns, so it lives in the request arena
+        size_t response_size = jwt_length + strlen(role) + 64;
+        char* response_str = request_malloc(response_size);
+        snprintf(response_str, response_size, "{\"token\": \"%s\", \"role\": \"%s\", \"expires\": \"%d\"}", jwt, role, 600);
+        struct MHD_Response* response = create_request_response(response_str);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
 
-        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
-        // If there's upload data, accumulate it
-        if (*upload_data_size > 0) {
-            // Reallocate memory to store incoming data
-            conn_info->json_data = realloc(conn_info->json_data, conn_info->json_size + *upload_data_size + 1);
-            memcpy(conn_info->json_data + conn_info->json_size, upload_data, *upload_data_size);
-            conn_info->json_size += *upload_data_size;
-            conn_info->json_data[conn_info->json_size] = '\0';  // Null-terminate
-            *upload_data_size = 0;  // Signal that we've processed this data
-            printf("KRKAAAAAAN.\n");
-            return MHD_YES;
+        /* Always free the output jwt string! */
+        l8w8jwt_free(jwt);
+    }
+    else {
+        const char* error_response = "Invalid info";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+            (void*)error_response, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+    }
+
+    // Clean up
+    cJSON_Delete(json);
+    return MHD_YES;
+}
+
+static int handle_find_user(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    int size = 4;
+    int number_of_results = 0;
+    User* users = request_malloc(sizeof(User) * size);
+    struct Usersearch foundusers = {
+        .users = users,
+        .size = size,
+        .number_of_results = &number_of_results
+    };
+    LOG_DEBUG("number of prefilled results: %d", *foundusers.number_of_results);
+
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_search_parameters, &foundusers);
+    LOG_DEBUG("number of results: %d", *foundusers.number_of_results);
+
+    char* response_str = (char*)request_malloc(1024);
+    memset(response_str, 0, 1024);
+    response_str[0] = '[';
+    int len = 1;
+    for (int i = 0; i < *foundusers.number_of_results; ++i) {
+        const char* username = foundusers.users[i].username;
+        const char* first_name = foundusers.users[i].first_name;
+        const char* last_name = foundusers.users[i].last_name;
+        char user[1024];
+        snprintf(user, sizeof(user), "{\"username\": \"%s\", \"first_name\": \"%s\", \"last_name\": \"%s\"},", username, first_name, last_name);
+        int userlen = strlen(user);
+        for (int j = 0; j < userlen; ++j) {
+            response_str[len + j] = user[j];
         }
-        else {
-            // All data received, process the JSON
-            cJSON* json = cJSON_Parse(conn_info->json_data);
-            if (json == NULL) {
-                const char* error_response = "Invalid JSON format";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                cJSON_Delete(json);
-                printf("GIMBAAAAAN.\n");
-                return MHD_YES;
-            }
+        len = strlen(response_str);
+    }
+    if (strlen(response_str) == 1) {
+        response_str[len] = ']';
+    }
+    else {
+        response_str[len - 1] = ']';
+    }
+    LOG_DEBUG("%s", response_str);
 
-            cJSON* username_or_email = cJSON_GetObjectItem(json, "username_or_email");
-            char role[10];
-            if (!parse_credentials_from_json(json, role)) {
-                printf("%s", role);
+    struct MHD_Response* response = MHD_create_response_from_buffer(strlen(response_str),
+        (void*)response_str, MHD_RESPMEM_MUST_COPY);
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
 
-                const char *var_name = "HMAC_KEY";
-                char *hmac_key = getenv(var_name);
+    request_free(users);
+    request_free(response_str);
 
-                char* jwt;
-                size_t jwt_length;
+    return ret;
+}
 
-                struct l8w8jwt_encoding_params params;
-                l8w8jwt_encoding_params_init(&params);
+static int handle_change_password(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // All data received, process the JSON
+    cJSON* json = request_body_json(conn_info);
+    if (json == NULL) {
+        const char* error_response = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+            (void*)error_response, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return MHD_YES;
+    }
 
-                params.alg = L8W8JWT_ALG_HS512;
+    const char *auth = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_AUTHORIZATION);
 
-                params.sub = username_or_email->valuestring;
-                params.iss = "Trello Clone";
-                params.aud = role;
+    if (!auth) {
+        const char* not_found = "403 - Forbidden";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_FORBIDDEN, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-                params.iat = l8w8jwt_time(NULL);
-                params.exp = l8w8jwt_time(NULL) + 600; /* Set to expire after 10 minutes (600 seconds). */
+    const char *var_name = "HMAC_KEY";
+    char *hmac_key = getenv(var_name);
 
-                params.secret_key = (unsigned char*)hmac_key;
-                params.secret_key_length = strlen(params.secret_key);
+    struct l8w8jwt_decoding_params decoding_params;
+    l8w8jwt_decoding_params_init(&decoding_params);
 
-                params.out = &jwt;
-                params.out_length = &jwt_length;
+    decoding_params.alg = L8W8JWT_ALG_HS512;
 
-                int r = l8w8jwt_encode(&params);
+    decoding_params.jwt = auth;
+    decoding_params.jwt_length = strlen(auth);
 
-                printf("\n l8w8jwt example HS512 token: %s \n", r == L8W8JWT_SUCCESS ? jwt : " (encoding failure) ");
+    decoding_params.verification_key = (unsigned char*)hmac_key;
+    decoding_params.verification_key_length = strlen(hmac_key);
 
-                char response_str[512];
-                snprintf(response_str, sizeof(response_str), "{\"token\": \"%s\", \"role\": \"%s\", \"expires\": \"%d\"}", jwt, role, 600);
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(response_str),
-                    (void*)response_str, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-                MHD_destroy_response(response);
-                printf("KKKKKKKKKKKKK.\n");
+    decoding_params.validate_iss = "Trello Clone"; 
 
-                /* Always free the output jwt string! */
-                l8w8jwt_free(jwt);
-            }
-            else {
-                const char* error_response = "Invalid info";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-            }
+    decoding_params.validate_exp = 1; 
+    decoding_params.exp_tolerance_seconds = 60;
 
-            // Clean up
-            cJSON_Delete(json);
-            free(conn_info->json_data);
-            free(conn_info);
-            *con_cls = NULL;
-            printf("LLLLLLLLLLLLL.\n");
-            return MHD_YES;
-        }
-    }
+    decoding_params.validate_iat = 1;
+    decoding_params.iat_tolerance_seconds = 60;
 
-    if (strcmp(url, "/finduser") == 0 && strcmp(method, "GET") == 0) {
+    enum l8w8jwt_validation_result validation_result;
 
-        printf("oof\n");
-        int size = 4;
-        int number_of_results = 0;
-        User* users = malloc(sizeof(User) * size);
-        struct Usersearch foundusers = {
-            .users = users,
-            .size = size,
-            .number_of_results = &number_of_results
-        };
-        printf("number of prefilled results: %d\n", *foundusers.number_of_results);
+    struct l8w8jwt_claim* claims = NULL;
+    size_t claims_len = 0;
 
-        MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_search_parameters, &foundusers);
+    int decode_result = l8w8jwt_decode(&decoding_params, &validation_result, &claims, &claims_len);
+    LOG_DEBUG("decode_result=%d, validation_result=%d, claims_len=%zu", decode_result, validation_result, claims_len);
 
-        if (!foundusers.number_of_results) {
-            printf("work pls\n");
-        }
-        else {
-            printf("number of results: %d\n", *foundusers.number_of_results);
-        }
+    if (decode_result == L8W8JWT_SUCCESS && validation_result == L8W8JWT_VALID) 
+    {
 
-        char* response_str = (char*)malloc(1024);
-        memset(response_str, 0, 1024);
-        response_str[0] = '[';
-        int len = 1;
-        for (int i = 0; i < *foundusers.number_of_results; ++i) {
-            const char* username = foundusers.users[i].username;
-            const char* first_name = foundusers.users[i].first_name;
-            const char* last_name = foundusers.users[i].last_name;
-            char user[1024];
-            snprintf(user, sizeof(user), "{\"username\": \"%s\", \"first_name\": \"%s\", \"last_name\": \"%s\"},", username, first_name, last_name);
-            int userlen = strlen(user);
-            for (int j = 0; j < userlen; ++j) {
-                response_str[len + j] = user[j];
-            }
-            len = strlen(response_str);
+        for (size_t i = 0; i < claims_len; ++i) {
+            LOG_DEBUG("Claim %zu: %.*s = %.*s", i,
+            (int)claims[i].key_length, claims[i].key,
+            (int)claims[i].value_length, claims[i].value);
         }
-        if (strlen(response_str) == 1) {
-            response_str[len] = ']';
-        }
-        else {
-            response_str[len - 1] = ']';
+    }
+    else
+    {
+        for (size_t i = 0; i < claims_len; ++i) {
+            free(claims[i].key);
+            free(claims[i].value);
         }
-        printf("%s\n", response_str);
+        free(claims);
 
-        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(response_str),
-            (void*)response_str, MHD_RESPMEM_MUST_COPY);
+        const char* not_found = "403 - Forbidden";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        int ret = MHD_queue_response(connection, MHD_HTTP_FORBIDDEN, response);
         MHD_destroy_response(response);
-
-        free(users);
-        free(response_str);
-
         return ret;
     }
 
-    if (strcmp(url, "/changepassword") == 0 && strcmp(method, "POST") == 0) {
-
-        printf("ZLAJAAAAA.\n");
-
-        if (*con_cls == NULL) {
-            struct ConnectionInfo* conn_info = calloc(1, sizeof(struct ConnectionInfo));
-            *con_cls = (void*)conn_info;
-            return MHD_YES;
+    cJSON* new_password = cJSON_GetObjectItem(json, "new_password");
+    cJSON* old_password = cJSON_GetObjectItem(json, "old_password");
+    if (!cJSON_IsString(new_password) || !cJSON_IsString(old_password)) {
+        for (size_t i = 0; i < claims_len; ++i) {
+            free(claims[i].key);
+            free(claims[i].value);
         }
+        free(claims);
 
-        printf("KAKIMIIIICS.\n");
+        const char* not_found = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
-        // If there's upload data, accumulate it
-        if (*upload_data_size > 0) {
-            // Reallocate memory to store incoming data
-            conn_info->json_data = realloc(conn_info->json_data, conn_info->json_size + *upload_data_size + 1);
-            memcpy(conn_info->json_data + conn_info->json_size, upload_data, *upload_data_size);
-            conn_info->json_size += *upload_data_size;
-            conn_info->json_data[conn_info->json_size] = '\0';  // Null-terminate
-            *upload_data_size = 0;  // Signal that we've processed this data
-            printf("KRKAAAAAAN.\n");
-            return MHD_YES;
+    const char *claim_ptr;
+    int access = 0;
+    for (size_t i = 0; i < claims_len; ++i) {
+        if (strcmp(claims[i].key, "sub") == 0) {
+            claim_ptr = claims[i].value;
         }
-        else {
-            // All data received, process the JSON
-            cJSON* json = cJSON_Parse(conn_info->json_data);
-            if (json == NULL) {
-                const char* error_response = "Invalid JSON format";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                cJSON_Delete(json);
-                printf("GIMBAAAAAN.\n");
-                return MHD_YES;
+        if (strcmp(claims[i].key, "aud") == 0) {
+            if (strcmp(claims[i].value, "USER") != 0 && strcmp(claims[i].value, "MANAGER") != 0) {
+                access = 1;
             }
+        }
+    }
+    if (access == 1) {
+        for (size_t i = 0; i < claims_len; ++i) {
+            free(claims[i].key);
+            free(claims[i].value);
+        }
+        free(claims);
 
-            const char *auth = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_AUTHORIZATION);
-
-            if (!auth) {
-                const char* not_found = "403 - Forbidden";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_FORBIDDEN, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
-
-            const char *var_name = "HMAC_KEY";
-            char *hmac_key = getenv(var_name);
-
-            struct l8w8jwt_decoding_params params;
-            l8w8jwt_decoding_params_init(&params);
-
-            params.alg = L8W8JWT_ALG_HS512;
-
-            params.jwt = auth;
-            params.jwt_length = strlen(auth);
+        const char* not_found = "403 - Forbidden";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_FORBIDDEN, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-            params.verification_key = (unsigned char*)hmac_key;
-            params.verification_key_length = strlen(hmac_key);
+    int password_change_code = changepassword(claim_ptr, new_password->valuestring, old_password->valuestring);
+    if (password_change_code == 0) {
+        for (size_t i = 0; i < claims_len; ++i) {
+            free(claims[i].key);
+            free(claims[i].value);
+        }
+        free(claims);
 
-            params.validate_iss = "Trello Clone"; 
-            printf("KREK CAMUSKI\n");
+        const char* not_found = "Password changed";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+    else {
+        for (size_t i = 0; i < claims_len; ++i) {
+            free(claims[i].key);
+            free(claims[i].value);
+        }
+        free(claims);
 
-            params.validate_exp = 1; 
-            params.exp_tolerance_seconds = 60;
+        const char* not_found = "Old password doesn't match";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-            params.validate_iat = 1;
-            params.iat_tolerance_seconds = 60;
+    for (size_t i = 0; i < claims_len; ++i) {
+        free(claims[i].key);
+        free(claims[i].value);
+    }
+    free(claims);
+}
 
-            enum l8w8jwt_validation_result validation_result;
+static int handle_magic_claw(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // All data received, process the JSON
+    cJSON* json = request_body_json(conn_info);
+    if (json == NULL) {
+        const char* error_response = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+            (void*)error_response, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return MHD_YES;
+    }
 
-            struct l8w8jwt_claim* claims = NULL;
-            size_t claims_len = 0;
+    cJSON* username_or_email = cJSON_GetObjectItem(json, "username_or_email");
+    if (!cJSON_IsString(username_or_email)) {
+        const char* not_found = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-            int decode_result = l8w8jwt_decode(&params, &validation_result, &claims, &claims_len);
-            printf("decode_result=%d, validation_result=%d, claims_len=%zu\n", decode_result, validation_result, claims_len);
-            printf("KREK CRNI\n");
+    int find_user_code = find_user_and_send_magic(username_or_email->valuestring);
+    LOG_DEBUG("Magic exit code %d", find_user_code);
 
-            if (decode_result == L8W8JWT_SUCCESS && validation_result == L8W8JWT_VALID) 
-            {
-                printf("\n Example HS512 token validation successful! \n");
+    if (find_user_code != 0) {
+        const char* not_found = "Account inactive";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-                for (size_t i = 0; i < claims_len; ++i) {
-                    printf("Claim %zu: %.*s = %.*s\n", i,
-                    (int)claims[i].key_length, claims[i].key,
-                    (int)claims[i].value_length, claims[i].value);
-                }
-            }
-            else
-            {
-                printf("\n Example HS512 token validation failed! \n");
-                for (size_t i = 0; i < claims_len; ++i) {
-                    free(claims[i].key);
-                    free(claims[i].value);
-                }
-                free(claims);
+    const char* not_found = "Magic link sent";
+    struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+        (void*)not_found, MHD_RESPMEM_PERSISTENT);
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
 
-                const char* not_found = "403 - Forbidden";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_FORBIDDEN, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
+}
 
-            cJSON* new_password = cJSON_GetObjectItem(json, "new_password");
-            cJSON* old_password = cJSON_GetObjectItem(json, "old_password");
-            if (!cJSON_IsString(new_password) || !cJSON_IsString(old_password)) {
-                for (size_t i = 0; i < claims_len; ++i) {
-                    free(claims[i].key);
-                    free(claims[i].value);
-                }
-                free(claims);
+static int handle_magic_login(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    char *first_username_char = NULL;
 
-                const char* not_found = "Invalid JSON format";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_magic_link, &first_username_char);
+    LOG_DEBUG("Username: %s", first_username_char);
 
-            const char *claim_ptr;
-            int access = 0;
-            for (size_t i = 0; i < claims_len; ++i) {
-                if (strcmp(claims[i].key, "sub") == 0) {
-                    claim_ptr = claims[i].value;
-                }
-                if (strcmp(claims[i].key, "aud") == 0) {
-                    if (strcmp(claims[i].value, "USER") != 0 && strcmp(claims[i].value, "MANAGER") != 0) {
-                        access = 1;
-                    }
-                }
-            }
-            if (access == 1) {
-                for (size_t i = 0; i < claims_len; ++i) {
-                    free(claims[i].key);
-                    free(claims[i].value);
-                }
-                free(claims);
+    if (first_username_char && strcmp(first_username_char, "*") != 0) {
 
-                const char* not_found = "403 - Forbidden";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_FORBIDDEN, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
+        const char *var_name = "HMAC_KEY";
+        char *hmac_key = getenv(var_name);
 
-            int password_change_code = changepassword(claim_ptr, new_password->valuestring, old_password->valuestring);
-            if (password_change_code == 0) {
-                for (size_t i = 0; i < claims_len; ++i) {
-                    free(claims[i].key);
-                    free(claims[i].value);
-                }
-                free(claims);
+        char* jwt;
+        size_t jwt_length;
 
-                const char* not_found = "Password changed";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
-            else {
-                for (size_t i = 0; i < claims_len; ++i) {
-                    free(claims[i].key);
-                    free(claims[i].value);
-                }
-                free(claims);
+        struct l8w8jwt_encoding_params params;
+        l8w8jwt_encoding_params_init(&params);
 
-                const char* not_found = "Old password doesn't match";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
+        params.alg = L8W8JWT_ALG_HS512;
 
-            for (size_t i = 0; i < claims_len; ++i) {
-                free(claims[i].key);
-                free(claims[i].value);
-            }
-            free(claims);
-        }
-    }
+        params.sub = first_username_char;
+        params.iss = "Trello Clone";
+        char *role;
+        cheeky(first_username_char, &role);
+        params.aud = role;
 
-    if (strcmp(url, "/magicclaw") == 0 && strcmp(method, "POST") == 0) {
-        
-        printf("ZLAJAAAAA.\n");
+        params.iat = l8w8jwt_time(NULL);
+        params.exp = l8w8jwt_time(NULL) + 600; /* Set to expire after 10 minutes (600 seconds). */
 
-        if (*con_cls == NULL) {
-            struct ConnectionInfo* conn_info = calloc(1, sizeof(struct ConnectionInfo));
-            *con_cls = (void*)conn_info;
-            return MHD_YES;
-        }
+        params.secret_key = (unsigned char*)hmac_key;
+        params.secret_key_length = strlen(params.secret_key);
 
-        printf("KAKIMIIIICS.\n");
+        params.out = &jwt;
+        params.out_length = &jwt_length;
 
-        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
-        // If there's upload data, accumulate it
-        if (*upload_data_size > 0) {
-            // Reallocate memory to store incoming data
-            conn_info->json_data = realloc(conn_info->json_data, conn_info->json_size + *upload_data_size + 1);
-            memcpy(conn_info->json_data + conn_info->json_size, upload_data, *upload_data_size);
-            conn_info->json_size += *upload_data_size;
-            conn_info->json_data[conn_info->json_size] = '\0';  // Null-terminate
-            *upload_data_size = 0;  // Signal that we've processed this data
-            printf("KRKAAAAAAN.\n");
-            return MHD_YES;
+        int r = l8w8jwt_encode(&params);
+        if (r != L8W8JWT_SUCCESS) {
+            free(first_username_char);
+            return send_token_error(connection, r);
         }
-        else {
-            // All data received, process the JSON
-            cJSON* json = cJSON_Parse(conn_info->json_data);
-            if (json == NULL) {
-                const char* error_response = "Invalid JSON format";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                cJSON_Delete(json);
-                printf("GIMBAAAAAN.\n");
-                return MHD_YES;
-            }
 
-            cJSON* username_or_email = cJSON_GetObjectItem(json, "username_or_email");
-            if (!cJSON_IsString(username_or_email)) {
-                const char* not_found = "Invalid JSON format";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
-
-            int find_user_code = find_user_and_send_magic(username_or_email->valuestring);
-            fprintf(stderr, "Gonosz Magus\n");
-            fprintf(stderr, "Magic exit code %d\n", find_user_code);
-
-            if (find_user_code != 0) {
-                const char* not_found = "Account inactive";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
+        // MHD sends the body after the handler returns, so it lives in the request arena
+        size_t response_size = jwt_length + strlen(role) + 64;
+        char* response_str = request_malloc(response_size);
+        snprintf(response_str, response_size, "{\"token\": \"%s\", \"role\": \"%s\", \"expires\": \"%d\"}", jwt, role, 600);
+        struct MHD_Response* response = create_request_response(response_str);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
 
-            const char* not_found = "Magic link sent";
-            struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                (void*)not_found, MHD_RESPMEM_PERSISTENT);
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-            MHD_destroy_response(response);
-            return ret;
+        /* Always free the output jwt string! */
+        l8w8jwt_free(jwt);
+        free(first_username_char);
 
-        }
+        return ret;
     }
+    else if (first_username_char != NULL && !strcmp(first_username_char, "*")) {
+        struct MHD_Response* response;
+        const char* response_text = "Expired magic link";
+        response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
 
-    if (strcmp(url, "/magiclogin") == 0 && strcmp(method, "GET") == 0) {
-
-        printf("Received GET request for URL path: %s\n", url);
-        fprintf(stderr, "I love rozen maiden\n");
-        char *first_username_char = NULL;
-
-        MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_magic_link, &first_username_char);
-        fprintf(stderr, "I love rozen maiden1\n");
-        printf("Username: %s\n", first_username_char);
-        fprintf(stderr, "Username: %s\n", first_username_char);
-        fprintf(stderr, "I love rozen maiden77\n");
-
-        if (first_username_char && strcmp(first_username_char, "*") != 0) {
-
-            fprintf(stderr, "I love rozen maiden2\n");
-            const char *var_name = "HMAC_KEY";
-            char *hmac_key = getenv(var_name);
-
-            char* jwt;
-            size_t jwt_length;
-
-            struct l8w8jwt_encoding_params params;
-            l8w8jwt_encoding_params_init(&params);
+        free(first_username_char);
 
-            params.alg = L8W8JWT_ALG_HS512;
+        return ret;
+    }
+    else {
+        struct MHD_Response* response;
+        const char* response_text = "Bad request";
+        response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
 
-            params.sub = first_username_char;
-            params.iss = "Trello Clone";
-            char *role;
-            cheeky(first_username_char, &role);
-            params.aud = role;
-            fprintf(stderr, "I love rozen maiden88888\n");
+        return ret;
+    }
+}
 
-            params.iat = l8w8jwt_time(NULL);
-            params.exp = l8w8jwt_time(NULL) + 600; /* Set to expire after 10 minutes (600 seconds). */
+static int handle_recover_password(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // All data received, process the JSON
+    cJSON* json = request_body_json(conn_info);
+    if (json == NULL) {
+        const char* error_response = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+            (void*)error_response, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return MHD_YES;
+    }
 
-            params.secret_key = (unsigned char*)hmac_key;
-            params.secret_key_length = strlen(params.secret_key);
+    cJSON* email = cJSON_GetObjectItem(json, "email");
+    if (!cJSON_IsString(email)) {
+        const char* not_found = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-            params.out = &jwt;
-            params.out_length = &jwt_length;
+    int find_recovery_code = find_user_and_send_recovery(email->valuestring);
+    if (find_recovery_code == 1) {
+        const char* not_found = "Inactive account";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+    else if (find_recovery_code == 0) {
+        const char* not_found = "Email sent";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+    else if (find_recovery_code == 3) {
+        const char* not_found = "No such user";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+    else {
+        const char* not_found = "Internal server error";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+            (void*)not_found, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
+}
 
-            int r = l8w8jwt_encode(&params);
+static int handle_confirm_recover_code(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    int is_valid = 0;
+
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_recovery_link, &is_valid);
+    LOG_DEBUG("is valid: %d", is_valid);
+    
+    if (is_valid) {
+        struct MHD_Response* response;
+        const char* response_text = "Valid link";
+        response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
 
-            printf("\n l8w8jwt example HS512 token: %s \n", r == L8W8JWT_SUCCESS ? jwt : " (encoding failure) ");
-            fprintf(stderr, "I love rozen maiden2232323232\n");
+        return ret;
+    }
+    else {
+        struct MHD_Response* response;
+        const char* response_text = "Invalid link";
+        response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
 
-            char response_str[512];
-            snprintf(response_str, sizeof(response_str), "{\"token\": \"%s\", \"role\": \"%s\", \"expires\": \"%d\"}", jwt, role, 600);
-            struct MHD_Response* response = MHD_create_response_from_buffer(strlen(response_str),
-                (void*)response_str, MHD_RESPMEM_PERSISTENT);
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-            MHD_destroy_response(response);
-            printf("KKKKKKKKKKKKK.\n");
+        return ret;
+    }
+}
 
-            /* Always free the output jwt string! */
-            l8w8jwt_free(jwt);
-            free(first_username_char);
+static int handle_confirm_password_recovery(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const RouteParams* params) {
+    // All data received, process the JSON
+    cJSON* json = request_body_json(conn_info);
+    if (json == NULL) {
+        const char* error_response = "Invalid JSON format";
+        struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
+            (void*)error_response, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        cJSON_Delete(json);
+        return MHD_YES;
+    }
 
-            return ret;
-        }
-        else if (first_username_char != NULL && !strcmp(first_username_char, "*")) {
-            struct MHD_Response* response;
-            const char* response_text = "Expired magic link";
-            response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
-            MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-            MHD_destroy_response(response);
+    int is_valid = 0;
 
-            free(first_username_char);
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_recovery_link, &is_valid);
+    LOG_DEBUG("is valid: %d", is_valid);
+    
+    if (is_valid) {
 
-            return ret;
-        }
-        else {
-            struct MHD_Response* response;
-            const char* response_text = "Bad request";
-            response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
+        cJSON* new_password = cJSON_GetObjectItem(json, "new_password");
+        if (!cJSON_IsString(new_password)) {
+            const char* not_found = "Invalid JSON format";
+            struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
+                (void*)not_found, MHD_RESPMEM_PERSISTENT);
             MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
             int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
             MHD_destroy_response(response);
-
             return ret;
         }
-    }
 
-    if (strcmp(url, "/recoverpassword") == 0 && strcmp(method, "POST") == 0) {
-        
-        printf("ZLAJAAAAA.\n");
+        char recovery_link[41];
+        MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, return_recovery_link, recovery_link);
+        LOG_DEBUG("Recovery link: %s", recovery_link);
 
-        if (*con_cls == NULL) {
-            struct ConnectionInfo* conn_info = calloc(1, sizeof(struct ConnectionInfo));
-            *con_cls = (void*)conn_info;
-            return MHD_YES;
-        }
-
-        printf("KAKIMIIIICS.\n");
-
-        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
-        // If there's upload data, accumulate it
-        if (*upload_data_size > 0) {
-            // Reallocate memory to store incoming data
-            conn_info->json_data = realloc(conn_info->json_data, conn_info->json_size + *upload_data_size + 1);
-            memcpy(conn_info->json_data + conn_info->json_size, upload_data, *upload_data_size);
-            conn_info->json_size += *upload_data_size;
-            conn_info->json_data[conn_info->json_size] = '\0';  // Null-terminate
-            *upload_data_size = 0;  // Signal that we've processed this data
-            printf("KRKAAAAAAN.\n");
-            return MHD_YES;
-        }
-        else {
-            // All data received, process the JSON
-            cJSON* json = cJSON_Parse(conn_info->json_data);
-            if (json == NULL) {
-                const char* error_response = "Invalid JSON format";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                cJSON_Delete(json);
-                printf("GIMBAAAAAN.\n");
-                return MHD_YES;
-            }
+        if (recovery_link) {
 
-            cJSON* email = cJSON_GetObjectItem(json, "email");
-            if (!cJSON_IsString(email)) {
-                const char* not_found = "Invalid JSON format";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
+            int recover_password_code = recoverpassword(recovery_link, new_password->valuestring);
 
-            int find_recovery_code = find_user_and_send_recovery(email->valuestring);
-            if (find_recovery_code == 1) {
-                const char* not_found = "Inactive account";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
-            else if (find_recovery_code == 0) {
-                const char* not_found = "Email sent";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
+            if (!recover_password_code) {
+                struct MHD_Response* response;
+                const char* response_text = "Password changed";
+                response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
                 MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
                 int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
                 MHD_destroy_response(response);
+
                 return ret;
             }
-            else if (find_recovery_code == 3) {
-                const char* not_found = "No such user";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
-            else {
-                const char* not_found = "Internal server error";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                    (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
-                MHD_destroy_response(response);
-                return ret;
-            }
-        }
-    }
-
-    if (strcmp(url, "/confirmrecovercode") == 0 && strcmp(method, "GET") == 0) {
 
-        printf("Received GET request for URL path: %s\n", url);
-        fprintf(stderr, "I love rozen maiden\n");
-        int is_valid = 0;
-
-        MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_recovery_link, &is_valid);
-        printf("is valid: %d\n", is_valid);
-        
-        if (is_valid) {
             struct MHD_Response* response;
-            const char* response_text = "Valid link";
+            const char* response_text = "Internal server error";
             response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
             MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+            int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
             MHD_destroy_response(response);
 
             return ret;
         }
         else {
             struct MHD_Response* response;
-            const char* response_text = "Invalid link";
+            const char* response_text = "Internal server error";
             response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
             MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-            int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+            int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
             MHD_destroy_response(response);
 
             return ret;
         }
     }
+    else {
+        struct MHD_Response* response;
+        const char* response_text = "Invalid link";
+        response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
 
-    if (strcmp(url, "/confirmpasswordrecovery") == 0 && strcmp(method, "POST") == 0) {
-        
-        printf("ZLAJAAAAA.\n");
-
-        if (*con_cls == NULL) {
-            struct ConnectionInfo* conn_info = calloc(1, sizeof(struct ConnectionInfo));
-            *con_cls = (void*)conn_info;
-            return MHD_YES;
-        }
-
-        printf("KAKIMIIIICS.\n");
-
-        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
-        // If there's upload data, accumulate it
-        if (*upload_data_size > 0) {
-            // Reallocate memory to store incoming data
-            conn_info->json_data = realloc(conn_info->json_data, conn_info->json_size + *upload_data_size + 1);
-            memcpy(conn_info->json_data + conn_info->json_size, upload_data, *upload_data_size);
-            conn_info->json_size += *upload_data_size;
-            conn_info->json_data[conn_info->json_size] = '\0';  // Null-terminate
-            *upload_data_size = 0;  // Signal that we've processed this data
-            printf("KRKAAAAAAN.\n");
-            return MHD_YES;
-        }
-        else {
-            // All data received, process the JSON
-            cJSON* json = cJSON_Parse(conn_info->json_data);
-            if (json == NULL) {
-                const char* error_response = "Invalid JSON format";
-                struct MHD_Response* response = MHD_create_response_from_buffer(strlen(error_response),
-                    (void*)error_response, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
-                cJSON_Delete(json);
-                printf("GIMBAAAAAN.\n");
-                return MHD_YES;
-            }
-
-            printf("Received GET request for URL path: %s\n", url);
-            fprintf(stderr, "Received GET request for URL path: %s\n", url);
-            int is_valid = 0;
-
-            MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, parse_recovery_link, &is_valid);
-            printf("is valid: %d\n", is_valid);
-            fprintf(stderr, "is valid: %d\n", is_valid);
-            
-            if (is_valid) {
-
-                cJSON* new_password = cJSON_GetObjectItem(json, "new_password");
-                if (!cJSON_IsString(new_password)) {
-                    const char* not_found = "Invalid JSON format";
-                    struct MHD_Response* response = MHD_create_response_from_buffer(strlen(not_found),
-                        (void*)not_found, MHD_RESPMEM_PERSISTENT);
-                    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                    int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                    MHD_destroy_response(response);
-                    return ret;
-                }
-
-                char recovery_link[41];
-                MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, return_recovery_link, recovery_link);
-                fprintf(stderr, "Recovery link: %s\n", recovery_link);
-
-                if (recovery_link) {
-
-                    int recover_password_code = recoverpassword(recovery_link, new_password->valuestring);
-                    fprintf(stderr, "Recovery pls\n");
+        return ret;
+    }
+}
 
-                    if (!recover_password_code) {
-                        struct MHD_Response* response;
-                        const char* response_text = "Password changed";
-                        response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
-                        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
-                        MHD_destroy_response(response);
+static const Route routes[] = {
+    { ROUTE_GET, "/metrics", handle_metrics },
+    { ROUTE_POST, "/newuser", handle_new_user },
+    { ROUTE_GET, "/profile", handle_profile },
+    { ROUTE_GET, "/admin/users", handle_admin_users },
+    { ROUTE_GET, "/auth/verify", handle_auth_verify },
+    { ROUTE_ANY, "/activate", handle_activate },
+    { ROUTE_POST, "/login", handle_login },
+    { ROUTE_GET, "/finduser", handle_find_user },
+    { ROUTE_POST, "/changepassword", handle_change_password },
+    { ROUTE_POST, "/magicclaw", handle_magic_claw },
+    { ROUTE_GET, "/magiclogin", handle_magic_login },
+    { ROUTE_POST, "/recoverpassword", handle_recover_password },
+    { ROUTE_GET, "/confirmrecovercode", handle_confirm_recover_code },
+    { ROUTE_POST, "/confirmpasswordrecovery", handle_confirm_password_recovery },
+};
 
-                        return ret;
-                    }
+static Router router;
 
-                    struct MHD_Response* response;
-                    const char* response_text = "Internal server error";
-                    response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
-                    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                    int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
-                    MHD_destroy_response(response);
+static int route_request(void* cls, struct MHD_Connection* connection,
+    const char* url, const char* method, const char* version,
+    const char* upload_data, size_t* upload_data_size, void** con_cls) {
 
-                    return ret;
-                }
-                else {
-                    struct MHD_Response* response;
-                    const char* response_text = "Internal server error";
-                    response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
-                    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                    int ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
-                    MHD_destroy_response(response);
-
-                    return ret;
-                }
-            }
-            else {
-                struct MHD_Response* response;
-                const char* response_text = "Invalid link";
-                response = MHD_create_response_from_buffer(strlen(response_text), (void*)response_text, MHD_RESPMEM_PERSISTENT);
-                MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
-                int ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
-                MHD_destroy_response(response);
+    if (strcmp(method, "OPTIONS") == 0) {
+        struct MHD_Response* response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+        MHD_add_response_header(response, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+        MHD_add_response_header(response, "Access-Control-Allow-Headers", "Content-Type");
+        int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+        MHD_destroy_response(response);
+        return ret;
+    }
 
-                return ret;
-            }
-        }
+    RouteParams params;
+    const Route* route = router_match(&router, method, url, &params);
+    if (route != NULL) {
+        struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
+        conn_info->route_series = metrics_route_series(method, route->pattern);
+        return route->handler(connection, conn_info, &params);
     }
 
     // Handle other routes or return 404
@@ -1130,37 +1006,60 @@ int answer_to_connection(void* cls, struct MHD_Connection* connection,
     return ret;
 }
 
+static enum MHD_Result answer_to_connection(void* cls, struct MHD_Connection* connection,
+    const char* url, const char* method, const char* version,
+    const char* upload_data, size_t* upload_data_size, void** con_cls) {
+
+    struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
+
+    if (conn_info == NULL) {
+        return request_begin(connection, url, method, con_cls);
+    }
+    if (*upload_data_size > 0 || conn_info->rejected) {
+        return request_append(connection, conn_info, upload_data, upload_data_size);
+    }
+
+    arena_activate(conn_info->arena);
+    enum MHD_Result ret = route_request(cls, connection, url, method, version, upload_data, upload_data_size, con_cls);
+    arena_activate(NULL);
+    return ret;
+}
+
 int main() {
+    log_init("user-service");
 
     const char *var_name = "HMAC_KEY";
     char *hmac_key = getenv(var_name);
     if (!hmac_key) {
-        fprintf(stderr, "Cannot find HMAC key\n");
+        LOG_ERROR("Cannot find HMAC key");
         return 1;
     }
 
-    struct MHD_Daemon* daemon;
+    Listeners listeners;
 
     // Set the PORT from environment variable, fallback to default PORT 8080
     char* port_env = getenv("PORT");
     int port = port_env ? atoi(port_env) : PORT;
 
-    // Start the HTTP server
-    daemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY, port, NULL, NULL,
-        &answer_to_connection, NULL, MHD_OPTION_END);
+    request_init();
 
-    if (NULL == daemon) {
-        printf("Failed to start server\n");
+    if (router_init(&router, routes, sizeof(routes) / sizeof(routes[0])) != 0) {
+        LOG_ERROR("Failed to build route table");
         return 1;
     }
 
-    printf("Server running on port %d\n", port);
+    // Start the HTTP server
+    if (listeners_start(&listeners, MHD_USE_SELECT_INTERNALLY, port,
+        &answer_to_connection, &request_completed) != 0) {
+        LOG_ERROR("Failed to start server");
+        return 1;
+    }
 
     if (init_password_validator() != 0) {
-        printf("Warning: Password validator initialization failed. Weak password checking disabled.\n");
+        LOG_WARN("Warning: Password validator initialization failed. Weak password checking disabled.");
     } 
     else {
-        printf("Password validator initialized successfully.\n");
+        LOG_INFO("Password validator initialized successfully.");
     } 
 
     repo();
@@ -1168,6 +1067,7 @@ int main() {
     // Run indefinitely (could also add logic to handle graceful shutdowns)
     pause();
 
-    MHD_stop_daemon(daemon);
+    listeners_stop(&listeners);
+    log_shutdown();
     return 0;
 }
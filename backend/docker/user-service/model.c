@@ -47,4 +47,85 @@ int parse_user_from_json(const cJSON* json, User* user) {
     }
 
     return 1;
-}
\ No newline at end of file
+}
+
+int parse_user_from_body(const char* body, size_t size, User* user) {
+    JsonReader reader;
+    json_reader_init(&reader, body, size);
+    if (json_reader_begin_object(&reader) != 0) {
+        return JSON_INVALID;
+    }
+
+    // Decoded into scratch space first, the struct is only filled in once everything checks out
+    User parsed;
+    char password[256];
+    memset(&parsed, 0, sizeof(User));
+    int seen = 0;
+
+    const char* key;
+    size_t key_size;
+    int next;
+    while ((next = json_reader_next_key(&reader, &key, &key_size)) == 1) {
+        char* target = NULL;
+        size_t target_size = 0;
+        int field = 0;
+
+        if (JSON_KEY_IS(key, key_size, "username")) {
+            target = parsed.username; target_size = sizeof(parsed.username); field = 1;
+        }
+        else if (JSON_KEY_IS(key, key_size, "first_name")) {
+            target = parsed.first_name; target_size = sizeof(parsed.first_name); field = 2;
+        }
+        else if (JSON_KEY_IS(key, key_size, "last_name")) {
+            target = parsed.last_name; target_size = sizeof(parsed.last_name); field = 4;
+        }
+        else if (JSON_KEY_IS(key, key_size, "email")) {
+            target = parsed.email; target_size = sizeof(parsed.email); field = 8;
+        }
+        else if (JSON_KEY_IS(key, key_size, "password")) {
+            target = password; target_size = sizeof(password); field = 16;
+        }
+        else if (JSON_KEY_IS(key, key_size, "role")) {
+            target = parsed.role; target_size = sizeof(parsed.role); field = 32;
+        }
+
+        if (target && json_reader_peek(&reader) == '"') {
+            // Over-long values are truncated, as strncpy does in parse_user_from_json
+            if (json_reader_string(&reader, target, target_size) < 0) {
+                return JSON_INVALID;
+            }
+            seen |= field;
+        }
+        else if (json_reader_skip(&reader) != 0) {
+            return JSON_INVALID;
+        }
+    }
+    if (next != 0 || json_reader_finish(&reader) != 0) {
+        return JSON_INVALID;
+    }
+
+    if (seen != 63) {  // All six fields present as strings
+        return 1;
+    }
+    if (strcmp(parsed.role, "MANAGER") != 0 && strcmp(parsed.role, "USER") != 0) {
+        return 1;
+    }
+
+    // Validate password before proceeding
+    int password_validation = validate_password(password);
+    if (password_validation != PASSWORD_VALID) {
+        return password_validation; // Return specific password error code
+    }
+
+    strncpy(parsed.password, password, sizeof(parsed.password) - 1);
+    parsed.password[sizeof(parsed.password) - 1] = '\0';
+
+    memcpy(user->username, parsed.username, sizeof(user->username));
+    memcpy(user->first_name, parsed.first_name, sizeof(user->first_name));
+    memcpy(user->last_name, parsed.last_name, sizeof(user->last_name));
+    memcpy(user->email, parsed.email, sizeof(user->email));
+    memcpy(user->password, parsed.password, sizeof(user->password));
+    memcpy(user->role, parsed.role, sizeof(user->role));
+
+    return 0;
+}
@@ -2,6 +2,7 @@
 #define MODEL_H
 
 #include <cjson/cJSON.h>
+#include "json_reader.h"
 
 typedef struct {
     char username[20];
@@ -15,4 +16,8 @@ typedef struct {
 
 int parse_user_from_json(const cJSON* json, User* user);
 
+// Same rules as parse_user_from_json, decoded from the raw body without a cJSON tree.
+// Returns JSON_INVALID when the body is not well-formed JSON.
+int parse_user_from_body(const char* body, size_t size, User* user);
+
 #endif
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <ctype.h>
 #include "password_validator.h"
+#include "logger.h"
 
 // Maximum number of blacklisted passwords
 #define MAX_BLACKLISTED_PASSWORDS 200
@@ -32,7 +33,7 @@ int init_password_validator(void) {
 
     FILE* file = fopen("common_passwords.txt", "r");
     if (file == NULL) {
-    	fprintf(stderr, "Warning: Could not open common_passwords.txt. Password blacklist disabled.\n");
+    	LOG_WARN("Warning: Could not open common_passwords.txt. Password blacklist disabled.");
     	return -1;
     }
 
@@ -60,11 +61,7 @@ int init_password_validator(void) {
     fclose(file);
     validator_initialized = 1;
     
-    printf("Password validator initialized with %d blacklisted passwords.\n", blacklist_count);
-
-    for (int i = 0; i < blacklist_count; i++) {
-        fprintf(stderr, "Password %d: '%s'\n", i + 1, blacklisted_passwords[i]);
-    }
+    LOG_INFO("Password validator initialized with %d blacklisted passwords.", blacklist_count);
     
     return 0;
 }
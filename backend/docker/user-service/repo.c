@@ -6,30 +6,28 @@
 #include "model.h"
 #include "repo.h"
 #include "SHA.h"
+#include "logger.h"
+#include "metrics.h"
 
 typedef struct {
     mongoc_client_t* client;
     mongoc_collection_t* collection;
-    FILE* logger;
 } Repository;
 
-FILE* log;
-
-Repository* New(FILE* logger) {
+Repository* New(void) {
 
     const char *var_name = "DBURI";
     char *dburi = getenv(var_name);
-    printf("Bruhimic moram priznati\n");
 
     if (dburi == NULL) {
-        fprintf(logger, "Error: MONGO_DB_URI environment variable is not set\n");
+        LOG_ERROR("Error: MONGO_DB_URI environment variable is not set");
         return NULL;
     }
 
     // Create MongoDB client
     mongoc_client_t* client = mongoc_client_new(dburi);
     if (!client) {
-        fprintf(logger, "Error: Failed to create MongoDB client\n");
+        LOG_ERROR("Error: Failed to create MongoDB client");
         mongoc_cleanup();
         return NULL;
     }
@@ -37,7 +35,7 @@ Repository* New(FILE* logger) {
     // Test connection (MongoDB C driver doesn't use an explicit connect step)
     bson_error_t error;
     if (!mongoc_client_get_server_status(client, NULL, NULL, &error)) {
-        fprintf(logger, "Error: Failed to connect to MongoDB: %s\n", error.message);
+        LOG_ERROR("Error: Failed to connect to MongoDB: %s", error.message);
         mongoc_client_destroy(client);
         mongoc_cleanup();
         return NULL;
@@ -46,7 +44,7 @@ Repository* New(FILE* logger) {
     // Allocate memory for the Repository struct
     Repository* repo = (Repository*)malloc(sizeof(Repository));
     if (repo == NULL) {
-        fprintf(logger, "Error: Failed to allocate memory for repository\n");
+        LOG_ERROR("Error: Failed to allocate memory for repository");
         mongoc_client_destroy(client);
         mongoc_cleanup();
         return NULL;
@@ -54,7 +52,6 @@ Repository* New(FILE* logger) {
 
     // Set up the Repository struct fields
     repo->client = client;
-    repo->logger = logger;
 
     return repo;
 }
@@ -76,20 +73,20 @@ int password_hash(const char* password, char* password_location) {
 
     err = SHA1Reset(&sha);
     if (err) {
-        fprintf(stderr, "SHA1Reset failed with error code %d\n", err);
+        LOG_ERROR("SHA1Reset failed with error code %d", err);
         return 1;
     }
 
     err = SHA1Input(&sha, (const unsigned char*)password, strlen(password));
     if (err) {
-        fprintf(stderr, "SHA1Input failed with error code %d\n", err);
+        LOG_ERROR("SHA1Input failed with error code %d", err);
         return 2;
     }
 
     err = SHA1Result(&sha, Message_Digest);
     if (err)
     {
-        fprintf(stderr, "SHA1Result Error %d, could not compute message digest.\n", err);
+        LOG_ERROR("SHA1Result Error %d, could not compute message digest.", err);
         return 3;
     }
 
@@ -99,23 +96,18 @@ int password_hash(const char* password, char* password_location) {
     }
     hashedvalue[20 * 2] = '\0';
     (const char*)hashedvalue;
-    printf(hashedvalue);
-    printf("\n");
     strncpy(password_location, hashedvalue, 41);
-    printf((const char*)password_location);
-    printf("\n");
 
     return 0;
 }
 
 int activation_hash(const char* email, const char* username, char* activation_link) {
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "links";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    fprintf(repo->logger, "Generating hash...\n");
-    printf("Generating hash...\n");
+    LOG_DEBUG("Generating hash...");
 
     SHA1Context sha;
     int err;
@@ -123,8 +115,7 @@ int activation_hash(const char* email, const char* username, char* activation_li
 
     err = SHA1Reset(&sha);
     if (err) {
-        fprintf(repo->logger, "SHA1Reset failed with error code %d\n", err);
-        fprintf(stderr, "SHA1Reset failed with error code %d\n", err);
+        LOG_ERROR("SHA1Reset failed with error code %d", err);
         Cleanup(repo);
 
         return 1;
@@ -145,8 +136,7 @@ int activation_hash(const char* email, const char* username, char* activation_li
 
     err = SHA1Input(&sha, (const unsigned char*)forhash, strlen(forhash));
     if (err) {
-        fprintf(repo->logger, "SHA1Input failed with error code %d\n", err);
-        fprintf(stderr, "SHA1Input failed with error code %d\n", err);
+        LOG_ERROR("SHA1Input failed with error code %d", err);
         free(forhash);
         Cleanup(repo);
 
@@ -157,8 +147,7 @@ int activation_hash(const char* email, const char* username, char* activation_li
     err = SHA1Result(&sha, Message_Digest);
     if (err)
     {
-        fprintf(repo->logger, "SHA1Result Error %d, could not compute message digest.\n", err);
-        fprintf(stderr, "SHA1Result Error %d, could not compute message digest.\n", err);
+        LOG_ERROR("SHA1Result Error %d, could not compute message digest.", err);
         Cleanup(repo);
 
         return 3;
@@ -170,11 +159,8 @@ int activation_hash(const char* email, const char* username, char* activation_li
     }
     hashedvalue[20 * 2] = '\0';
     (const char*)hashedvalue;
-    printf(hashedvalue);
-    printf("\n");
     strncpy(activation_link, hashedvalue, 41);
-    printf((const char*)activation_link);
-    printf("\n");
+    LOG_DEBUG((const char*)activation_link);
 
     bson_t* doc = bson_new();
     BSON_APPEND_UTF8(doc, "username", username);
@@ -185,16 +171,14 @@ int activation_hash(const char* email, const char* username, char* activation_li
 
     bson_error_t error;
     if (!mongoc_collection_insert_one(repo->collection, doc, NULL, NULL, &error)) {
-        fprintf(repo->logger, "Error: Insert failed\n");
-        printf("Error: Insert failed\n");
+        LOG_ERROR("Error: Insert failed");
         bson_destroy(doc);
         Cleanup(repo);
 
         return 4;
     }
     else {
-        fprintf(repo->logger, "Document inserted successfully.\n");
-        printf("Document inserted successfully.\n");
+        LOG_DEBUG("Document inserted successfully.");
     }
 
     bson_destroy(doc);
@@ -205,12 +189,11 @@ int activation_hash(const char* email, const char* username, char* activation_li
 
 int magic_hash(const char* email, const char* username, char* activation_link) {
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "links";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    fprintf(repo->logger, "Generating hash...\n");
-    printf("Generating hash...\n");
+    LOG_DEBUG("Generating hash...");
 
     SHA1Context sha;
     int err;
@@ -218,8 +201,7 @@ int magic_hash(const char* email, const char* username, char* activation_link) {
 
     err = SHA1Reset(&sha);
     if (err) {
-        fprintf(repo->logger, "SHA1Reset failed with error code %d\n", err);
-        fprintf(stderr, "SHA1Reset failed with error code %d\n", err);
+        LOG_ERROR("SHA1Reset failed with error code %d", err);
         Cleanup(repo);
 
         return 1;
@@ -240,8 +222,7 @@ int magic_hash(const char* email, const char* username, char* activation_link) {
 
     err = SHA1Input(&sha, (const unsigned char*)forhash, strlen(forhash));
     if (err) {
-        fprintf(repo->logger, "SHA1Input failed with error code %d\n", err);
-        fprintf(stderr, "SHA1Input failed with error code %d\n", err);
+        LOG_ERROR("SHA1Input failed with error code %d", err);
         free(forhash);
         Cleanup(repo);
 
@@ -252,8 +233,7 @@ int magic_hash(const char* email, const char* username, char* activation_link) {
     err = SHA1Result(&sha, Message_Digest);
     if (err)
     {
-        fprintf(repo->logger, "SHA1Result Error %d, could not compute message digest.\n", err);
-        fprintf(stderr, "SHA1Result Error %d, could not compute message digest.\n", err);
+        LOG_ERROR("SHA1Result Error %d, could not compute message digest.", err);
         Cleanup(repo);
 
         return 3;
@@ -265,11 +245,8 @@ int magic_hash(const char* email, const char* username, char* activation_link) {
     }
     hashedvalue[20 * 2] = '\0';
     (const char*)hashedvalue;
-    printf(hashedvalue);
-    printf("\n");
     strncpy(activation_link, hashedvalue, 41);
-    printf((const char*)activation_link);
-    printf("\n");
+    LOG_DEBUG((const char*)activation_link);
 
     bson_t* doc = bson_new();
     BSON_APPEND_UTF8(doc, "timestamp", email);
@@ -280,16 +257,14 @@ int magic_hash(const char* email, const char* username, char* activation_link) {
 
     bson_error_t error;
     if (!mongoc_collection_insert_one(repo->collection, doc, NULL, NULL, &error)) {
-        fprintf(repo->logger, "Error: Insert failed\n");
-        printf("Error: Insert failed\n");
+        LOG_ERROR("Error: Insert failed");
         bson_destroy(doc);
         Cleanup(repo);
 
         return 4;
     }
     else {
-        fprintf(repo->logger, "Document inserted successfully.\n");
-        printf("Document inserted successfully.\n");
+        LOG_DEBUG("Document inserted successfully.");
     }
 
     bson_destroy(doc);
@@ -300,12 +275,11 @@ int magic_hash(const char* email, const char* username, char* activation_link) {
 
 int recovery_hash(const char* email, const char* username, char* activation_link) {
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "links";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    fprintf(repo->logger, "Generating hash...\n");
-    printf("Generating hash...\n");
+    LOG_DEBUG("Generating hash...");
 
     SHA1Context sha;
     int err;
@@ -313,8 +287,7 @@ int recovery_hash(const char* email, const char* username, char* activation_link
 
     err = SHA1Reset(&sha);
     if (err) {
-        fprintf(repo->logger, "SHA1Reset failed with error code %d\n", err);
-        fprintf(stderr, "SHA1Reset failed with error code %d\n", err);
+        LOG_ERROR("SHA1Reset failed with error code %d", err);
         Cleanup(repo);
 
         return 1;
@@ -335,8 +308,7 @@ int recovery_hash(const char* email, const char* username, char* activation_link
 
     err = SHA1Input(&sha, (const unsigned char*)forhash, strlen(forhash));
     if (err) {
-        fprintf(repo->logger, "SHA1Input failed with error code %d\n", err);
-        fprintf(stderr, "SHA1Input failed with error code %d\n", err);
+        LOG_ERROR("SHA1Input failed with error code %d", err);
         free(forhash);
         Cleanup(repo);
 
@@ -347,8 +319,7 @@ int recovery_hash(const char* email, const char* username, char* activation_link
     err = SHA1Result(&sha, Message_Digest);
     if (err)
     {
-        fprintf(repo->logger, "SHA1Result Error %d, could not compute message digest.\n", err);
-        fprintf(stderr, "SHA1Result Error %d, could not compute message digest.\n", err);
+        LOG_ERROR("SHA1Result Error %d, could not compute message digest.", err);
         Cleanup(repo);
 
         return 3;
@@ -360,11 +331,8 @@ int recovery_hash(const char* email, const char* username, char* activation_link
     }
     hashedvalue[20 * 2] = '\0';
     (const char*)hashedvalue;
-    printf(hashedvalue);
-    printf("\n");
     strncpy(activation_link, hashedvalue, 41);
-    printf((const char*)activation_link);
-    printf("\n");
+    LOG_DEBUG((const char*)activation_link);
 
     bson_t* doc = bson_new();
     BSON_APPEND_UTF8(doc, "timestamp", email);
@@ -375,16 +343,14 @@ int recovery_hash(const char* email, const char* username, char* activation_link
 
     bson_error_t error;
     if (!mongoc_collection_insert_one(repo->collection, doc, NULL, NULL, &error)) {
-        fprintf(repo->logger, "Error: Insert failed\n");
-        printf("Error: Insert failed\n");
+        LOG_ERROR("Error: Insert failed");
         bson_destroy(doc);
         Cleanup(repo);
 
         return 4;
     }
     else {
-        fprintf(repo->logger, "Document inserted successfully.\n");
-        printf("Document inserted successfully.\n");
+        LOG_DEBUG("Document inserted successfully.");
     }
 
     bson_destroy(doc);
@@ -396,7 +362,7 @@ int recovery_hash(const char* email, const char* username, char* activation_link
 int emailto(char email[], FILE* payload_file) {
 
     if (!payload_file) {
-        fprintf(stderr, "Failed to open payload file for reading\n");
+        LOG_ERROR("Failed to open payload file for reading");
         return 3;
     }
 
@@ -414,7 +380,7 @@ int emailto(char email[], FILE* payload_file) {
         char *passkey = getenv(var_name1);
 
         if(!mail_from || !passkey) {
-            printf("Failed to find mailing credentials");
+            LOG_ERROR("Failed to find mailing credentials");
             return 3;
         }
 
@@ -422,7 +388,6 @@ int emailto(char email[], FILE* payload_file) {
         curl_easy_setopt(curl, CURLOPT_PASSWORD, passkey);
         curl_easy_setopt(curl, CURLOPT_MAIL_FROM, mail_from);
 
-        printf("nagy a pusztulas.\n");
 
         struct curl_slist* recipients = NULL;
         recipients = curl_slist_append(recipients, email);
@@ -432,12 +397,10 @@ int emailto(char email[], FILE* payload_file) {
         curl_easy_setopt(curl, CURLOPT_READDATA, payload_file);
         curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
 
-        printf("csarda mellet akasztofa.\n");
 
         res = curl_easy_perform(curl);
-        printf("bazmeg.\n");
         if (res != CURLE_OK) {
-            fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+            LOG_ERROR("curl_easy_perform() failed: %s", curl_easy_strerror(res));
 
             curl_slist_free_all(recipients);
             curl_easy_cleanup(curl);
@@ -445,12 +408,10 @@ int emailto(char email[], FILE* payload_file) {
             return 1;
         }
 
-        printf("curl ok?.\n");
 
         curl_slist_free_all(recipients);
         curl_easy_cleanup(curl);
 
-        printf("curl ok????????????.\n");
 
         return 0;
     }
@@ -459,12 +420,13 @@ int emailto(char email[], FILE* payload_file) {
 }
 
 int adduser(User *user) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
 
-    Repository *repo = New(log); 
+    Repository *repo = New(); 
     const char *db_name = "users";
     const char *collection_name = "users";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Dodavanje korisnika.\n");
+    LOG_DEBUG("Dodavanje korisnika.");
 
     bson_t* query = BCON_NEW(
         "$or", "[",
@@ -476,8 +438,7 @@ int adduser(User *user) {
     mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, NULL, NULL);
     const bson_t* doccpy;
     if (mongoc_cursor_next(cursor, &doccpy)) {
-        fprintf(repo->logger, "Error: Duplicate username or email found.\n");
-        printf("Error: Duplicate username or email found.\n");
+        LOG_ERROR("Error: Duplicate username or email found.");
         bson_destroy(query);
         mongoc_cursor_destroy(cursor);
         Cleanup(repo);
@@ -501,28 +462,24 @@ int adduser(User *user) {
 
     bson_error_t error;
     if (!mongoc_collection_insert_one(repo->collection, doc, NULL, NULL, &error)) {
-        fprintf(repo->logger, "Error: Insert failed\n");
-        printf("Error: Insert failed\n");
+        LOG_ERROR("Error: Insert failed");
         bson_destroy(doc);
         Cleanup(repo);
 
         return 2;
     }
     else {
-        fprintf(repo->logger, "Document inserted successfully.\n");
-        printf("Document inserted successfully.\n");
+        LOG_DEBUG("Document inserted successfully.");
     }
 
     bson_destroy(doc);
 
     char activation_link[41];
     if (!activation_hash(user->email, user->username, activation_link)) {
-        fprintf(repo->logger, "Hash generated successfully.\n");
-        printf("Hash generated successfully.\n");
+        LOG_DEBUG("Hash generated successfully.");
     }
     else {
-        fprintf(repo->logger, "Failed to generate hash.\n");
-        printf("Failed to generate hash.\n");
+        LOG_ERROR("Failed to generate hash.");
 
         return 5;
     }
@@ -535,11 +492,10 @@ int adduser(User *user) {
             "\r\n"
             "Vas aktivacioni kod: http://localhost:3000/activate?link=%s\r\n", user->email, (const char*)activation_link);
         fclose(payload_file);
-        fprintf(repo->logger, "Written to the payload file.\n");
+        LOG_DEBUG("Written to the payload file.");
     }
     else {
-        fprintf(repo->logger, "Failed to open payload file for writing.\n");
-        printf("Failed to open payload file for writing.\n");
+        LOG_ERROR("Failed to open payload file for writing.");
         Cleanup(repo);
 
         return 3;
@@ -547,13 +503,10 @@ int adduser(User *user) {
 
     payload_file = fopen("email_payload.txt", "r");
     if (!emailto(user->email, payload_file)) {
-        printf("ubicu se bukvalno.\n");
-        fprintf(repo->logger, "Email sent successfully.\n");
-        printf("Email sent successfully.\n");
+        LOG_DEBUG("Email sent successfully.");
     }
     else {
-        fprintf(repo->logger, "Failed to send email.\n");
-        printf("Failed to send email.\n");
+        LOG_ERROR("Failed to send email.");
         fclose(payload_file);
         Cleanup(repo);
 
@@ -569,11 +522,11 @@ int adduser(User *user) {
 
 int activate_user(const char* username, const char* email) {
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "users";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Aktiviranje korisnika.\n");
+    LOG_DEBUG("Aktiviranje korisnika.");
 
     bson_t* filter = BCON_NEW(
         "$and", "[",
@@ -581,11 +534,9 @@ int activate_user(const char* username, const char* email) {
         "{", "email", BCON_UTF8(email), "}",
         "]"
     );
-    printf("Oof.\n");
 
     // Define the update operation
     bson_t* update = BCON_NEW("$set", "{", "active", BCON_INT32(1), "}");
-    printf("Oof.\n");
 
     // Perform the update
     bson_error_t error;
@@ -597,14 +548,12 @@ int activate_user(const char* username, const char* email) {
         NULL,        // No reply document needed
         &error       // Error object
     );
-    printf("Oof.\n");
 
     if (result) {
-        printf("Document updated successfully.\n");
+        LOG_DEBUG("Document updated successfully.");
     }
     else {
-        fprintf(stderr, "Update failed: %s\n", error.message);
-        printf("I hate standard error.\n");
+        LOG_ERROR("Update failed: %s", error.message);
         Cleanup(repo);
 
         return 1;
@@ -618,11 +567,10 @@ int activate_user(const char* username, const char* email) {
             "\r\n"
             "Vas nalog je aktiviran.\r\n", username);
         fclose(payload_file);
-        fprintf(repo->logger, "Written to the payload file.\n");
+        LOG_DEBUG("Written to the payload file.");
     }
     else {
-        fprintf(repo->logger, "Failed to open payload file for writing.\n");
-        printf("Failed to open payload file for writing.\n");
+        LOG_ERROR("Failed to open payload file for writing.");
         Cleanup(repo);
 
         return 3;
@@ -630,13 +578,10 @@ int activate_user(const char* username, const char* email) {
 
     payload_file = fopen("confirmation.txt", "r");
     if (!emailto(email, payload_file)) {
-        printf("ubicu se bukvalno.\n");
-        fprintf(repo->logger, "Email sent successfully.\n");
-        printf("Email sent successfully.\n");
+        LOG_DEBUG("Email sent successfully.");
     }
     else {
-        fprintf(repo->logger, "Failed to send email.\n");
-        printf("Failed to send email.\n");
+        LOG_ERROR("Failed to send email.");
         fclose(payload_file);
         Cleanup(repo);
 
@@ -651,11 +596,11 @@ int activate_user(const char* username, const char* email) {
 
 int deactivate_code(const char* link) {
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "links";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Deaktiviranje koda.\n");
+    LOG_DEBUG("Deaktiviranje koda.");
 
     bson_t* filter = BCON_NEW(
         "$and", "[",
@@ -679,10 +624,10 @@ int deactivate_code(const char* link) {
     );
 
     if (result) {
-        printf("Document updated successfully2.\n");
+        LOG_DEBUG("Document updated successfully2.");
     }
     else {
-        fprintf(stderr, "Update failed: %s\n", error.message);
+        LOG_ERROR("Update failed: %s", error.message);
         Cleanup(repo);
 
         return 1;
@@ -694,12 +639,13 @@ int deactivate_code(const char* link) {
 }
 
 int check_activation(const char* link) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "links";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Provera aktivacionog koda.\n");
+    LOG_DEBUG("Provera aktivacionog koda.");
 
     const char* type = "activation";
 
@@ -724,7 +670,7 @@ int check_activation(const char* link) {
         if (bson_iter_init(&iter, doc)) {
             if (bson_iter_find(&iter, "username")) {
                 const char* found_username = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_username);
+                LOG_DEBUG("Found user: %s", found_username);
                 strncpy(username, found_username, sizeof(username));
                 username[sizeof(username) - 1] = '\0';
                 res1 = 0;
@@ -733,14 +679,14 @@ int check_activation(const char* link) {
             // Extract other fields
             if (bson_iter_find(&iter, "email")) {
                 const char* found_email = bson_iter_utf8(&iter, NULL);
-                printf("With email: %s\n", found_email);
+                LOG_DEBUG("With email: %s", found_email);
                 strncpy(email, found_email, sizeof(email));
                 email[sizeof(email) - 1] = '\0';
                 res2 = 0;
             }
             if (bson_iter_find(&iter, "active")) {
                 int active = bson_iter_int32(&iter);
-                printf("Active: %d\n", active);
+                LOG_DEBUG("Active: %d", active);
                 if (!active) {
                     already_activated = 1;
                 }
@@ -748,7 +694,7 @@ int check_activation(const char* link) {
         }
     }
     if (already_activated) {
-        printf("Link already used\n");
+        LOG_WARN("Link already used");
         bson_destroy(query);
         mongoc_cursor_destroy(cursor);
 
@@ -757,10 +703,8 @@ int check_activation(const char* link) {
 
     if (!res1 && !res2) {
         int activated = activate_user((const char*)username, (const char*)email);
-        printf("%s a %s\n", (const char*)username, (const char*)email);
-        printf("%d\n", activated);
         if (activated) {
-            printf("Activation failed\n");
+            LOG_ERROR("Activation failed");
             bson_destroy(query);
             mongoc_cursor_destroy(cursor);
 
@@ -768,7 +712,7 @@ int check_activation(const char* link) {
         }
         int deactivated = deactivate_code(link);
         if (deactivated) {
-            printf("Link deactivation failed\n");
+            LOG_ERROR("Link deactivation failed");
             bson_destroy(query);
             mongoc_cursor_destroy(cursor);
 
@@ -776,7 +720,7 @@ int check_activation(const char* link) {
         }
     }
     else {
-        printf("No such link\n");
+        LOG_DEBUG("No such link");
         bson_destroy(query);
         mongoc_cursor_destroy(cursor);
 
@@ -790,6 +734,7 @@ int check_activation(const char* link) {
 }
 
 int parse_credentials_from_json(const cJSON* json, char role[]) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
 
     cJSON* username_or_email = cJSON_GetObjectItem(json, "username_or_email");
     cJSON* password = cJSON_GetObjectItem(json, "password");
@@ -800,12 +745,11 @@ int parse_credentials_from_json(const cJSON* json, char role[]) {
     char hashed_password[41];
     password_hash(password->valuestring, hashed_password);
 
-    Repository* repo = New(log);
-    printf("repo = %p, repo->client = %p\n", (void*)repo, (void*)(repo ? repo->client : NULL));
+    Repository* repo = New();
+    LOG_DEBUG("repo = %p, repo->client = %p", (void*)repo, (void*)(repo ? repo->client : NULL));
     const char* db_name = "users";
     const char* collection_name = "users";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Trazenje korisnika.\n");
 
     // Build the query
     bson_t* query = BCON_NEW(
@@ -814,7 +758,6 @@ int parse_credentials_from_json(const cJSON* json, char role[]) {
         "{", "password", BCON_UTF8(hashed_password), "}",
         "]"
     );
-    printf("Trazenje nigera.\n");
 
     mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, NULL, NULL);
     const bson_t* doc;
@@ -823,12 +766,12 @@ int parse_credentials_from_json(const cJSON* json, char role[]) {
         if (bson_iter_init(&iter, doc)) {
             if (bson_iter_find(&iter, "role")) {
                 const char* found_role = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 strncpy(role, found_role, 10);
             }
             if (bson_iter_find(&iter, "active")) {
                 int active = bson_iter_int32(&iter);
-                printf("Active: %d\n", active);
+                LOG_DEBUG("Active: %d", active);
                 if (!active) {
                     bson_destroy(query);
                     mongoc_cursor_destroy(cursor);
@@ -837,15 +780,13 @@ int parse_credentials_from_json(const cJSON* json, char role[]) {
                 }
             }
         }
-        fprintf(repo->logger, "User found.\n");
-        printf("User found.\n");
+        LOG_DEBUG("User found.");
         bson_destroy(query);
         mongoc_cursor_destroy(cursor);
         Cleanup(repo);
 
         return 0;
     }
-    printf("Trazenje korisnika.\n");
 
     bson_destroy(query);
     mongoc_cursor_destroy(cursor);
@@ -864,12 +805,12 @@ int parse_credentials_from_json(const cJSON* json, char role[]) {
         if (bson_iter_init(&iter2, doc2)) {
             if (bson_iter_find(&iter2, "role")) {
                 const char* found_role = bson_iter_utf8(&iter2, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 strncpy(role, found_role, 10);
             }
             if (bson_iter_find(&iter2, "active")) {
                 int active = bson_iter_int32(&iter2);
-                printf("Active: %d\n", active);
+                LOG_DEBUG("Active: %d", active);
                 if (!active) {
                     bson_destroy(query2);
                     mongoc_cursor_destroy(cursor2);
@@ -878,8 +819,7 @@ int parse_credentials_from_json(const cJSON* json, char role[]) {
                 }
             }
         }
-        fprintf(repo->logger, "User found.\n");
-        printf("User found.\n");
+        LOG_DEBUG("User found.");
         bson_destroy(query2);
         mongoc_cursor_destroy(cursor2);
         Cleanup(repo);
@@ -895,13 +835,12 @@ int parse_credentials_from_json(const cJSON* json, char role[]) {
 }
 
 int find_users(const char* name, User users[], int size, int* number_of_results) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "users";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Trazenje korisnika.\n");
-    printf("IHATENIGGERS %d\n", size);
 
     bson_t* query = BCON_NEW(
         "$and", "[",
@@ -929,14 +868,15 @@ int find_users(const char* name, User users[], int size, int* number_of_results)
             strncpy(users[*number_of_results].last_name, bson_iter_utf8(&iter, NULL), sizeof(users[*number_of_results].last_name) - 1);
         }
 
-        printf("number of results: %d\n", *number_of_results);
+        LOG_DEBUG("number of results: %d", *number_of_results);
         ++(*number_of_results);
     }
-    printf("nigger %d\n", *number_of_results);
 
     if (mongoc_cursor_error(cursor, NULL)) {
-        fprintf(stderr, "Error occurred while iterating over the cursor.\n");
-
+        LOG_ERROR("Error occurred while iterating over the cursor.");
+        bson_destroy(query);
+        mongoc_cursor_destroy(cursor);
+        Cleanup(repo);
         return 1;
     }
 
@@ -948,17 +888,14 @@ int find_users(const char* name, User users[], int size, int* number_of_results)
 }
 
 int changepassword(const char* username_or_email, const char* new_password, const char* old_password) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
 
-    printf("Krekeri: %s\n%s\n%s\n", username_or_email, new_password, old_password);
-    Repository *repo = New(log); 
-    printf("repo = %p, repo->client = %p\n", (void*)repo, (void*)(repo ? repo->client : NULL));
-    printf("Changing niggers...\n");
+    Repository *repo = New(); 
+    LOG_DEBUG("repo = %p, repo->client = %p", (void*)repo, (void*)(repo ? repo->client : NULL));
     const char *db_name = "users";
-    printf("Changing faggots...\n");
     const char *collection_name = "users";
-    printf("Changing pajeets...\n");
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Changing password...\n");
+    LOG_DEBUG("Changing password...");
 
     bson_t* query = BCON_NEW(
         "$or", "[",
@@ -978,7 +915,7 @@ int changepassword(const char* username_or_email, const char* new_password, cons
             password_hash(old_password, (char*)hashed_old_password);
 
             if (strcmp(stored_password, hashed_old_password) != 0) {
-                printf("Password mismatch\n");
+                LOG_WARN("Password mismatch");
                 bson_destroy(query);
                 mongoc_cursor_destroy(cursor);
                 Cleanup(repo);
@@ -993,7 +930,7 @@ int changepassword(const char* username_or_email, const char* new_password, cons
             );
             bson_error_t error;
             if (!mongoc_collection_update_one(repo->collection, query, update, NULL, NULL, &error)) {
-                fprintf(stderr, "Update failed: %s\n", error.message);
+                LOG_ERROR("Update failed: %s", error.message);
                 bson_destroy(update);
                 bson_destroy(query);
                 mongoc_cursor_destroy(cursor);
@@ -1009,7 +946,7 @@ int changepassword(const char* username_or_email, const char* new_password, cons
         }
     }
 
-    printf("Iterating over cursor failed\n");
+    LOG_ERROR("Iterating over cursor failed");
     bson_destroy(query);
     mongoc_cursor_destroy(cursor);
     Cleanup(repo);
@@ -1017,14 +954,13 @@ int changepassword(const char* username_or_email, const char* new_password, cons
 }
 
 int find_user_and_send_magic(const char* username_or_email) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
 
-    Repository* repo = New(log);
-    printf("repo = %p, repo->client = %p\n", (void*)repo, (void*)(repo ? repo->client : NULL));
+    Repository* repo = New();
+    LOG_DEBUG("repo = %p, repo->client = %p", (void*)repo, (void*)(repo ? repo->client : NULL));
     const char* db_name = "users";
     const char* collection_name = "users";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Trazenje korisnika.\n");
-    fprintf(stderr, "Trazenje korisnika\n");
 
     int res = 1;
 
@@ -1032,8 +968,6 @@ int find_user_and_send_magic(const char* username_or_email) {
     bson_t* query = BCON_NEW(
         "email", BCON_UTF8(username_or_email)
     );
-    printf("Trazenje nigera.\n");
-    fprintf(stderr, "Trazenje nigera\n");
 
     User user;
 
@@ -1044,17 +978,17 @@ int find_user_and_send_magic(const char* username_or_email) {
         if (bson_iter_init(&iter, doc)) {
             if (bson_iter_find(&iter, "username")) {
                 const char* found_role = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 strncpy(user.username, found_role, sizeof(user.username));
             }
             if (bson_iter_find(&iter, "email")) {
                 const char* found_role = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 strncpy(user.email, found_role, sizeof(user.email));
             }
             if (bson_iter_find(&iter, "active")) {
                 int active = bson_iter_int32(&iter);
-                printf("Active: %d\n", active);
+                LOG_DEBUG("Active: %d", active);
                 if (!active) {
                     bson_destroy(query);
                     mongoc_cursor_destroy(cursor);
@@ -1063,9 +997,7 @@ int find_user_and_send_magic(const char* username_or_email) {
                 }
             }
         }
-        fprintf(repo->logger, "User found.\n");
-        printf("User found.\n");
-        fprintf(stderr, "Nigger found\n");
+        LOG_DEBUG("User found.");
         res = 0;
     }
 
@@ -1080,7 +1012,6 @@ int find_user_and_send_magic(const char* username_or_email) {
         char buffer[32];
         snprintf(buffer, sizeof(buffer), "%ld", (long)now);
         magic_hash_code = magic_hash((const char *)buffer, (const char *)user.username, activation_link);
-        fprintf(stderr, "Spar jobb ar jo dontes\n");
     }
     if (magic_hash_code == 0) {
         FILE* payload_file = fopen("magiclink.txt", "w");
@@ -1091,12 +1022,10 @@ int find_user_and_send_magic(const char* username_or_email) {
                 "\r\n"
                 "Vasa magicna veza: http://localhost:3000/magic?link=%s\r\n", user.email, (const char*)activation_link);
             fclose(payload_file);
-            fprintf(repo->logger, "Written to the payload file.\n");
-            printf("Written to the payload file.\n");
+            LOG_DEBUG("Written to the payload file.");
         }
         else {
-            fprintf(repo->logger, "Failed to open payload file for writing.\n");
-            printf("Failed to open payload file for writing.\n");
+            LOG_ERROR("Failed to open payload file for writing.");
             Cleanup(repo);
 
             return 2;
@@ -1104,10 +1033,8 @@ int find_user_and_send_magic(const char* username_or_email) {
 
         payload_file = fopen("magiclink.txt", "r");
         if (!emailto(user.email, payload_file)) {
-            printf("ubicu se bukvalno.\n");
-            fprintf(repo->logger, "Email sent successfully.\n");
-            printf("Email sent successfully.\n");
-            fprintf(stderr, "Email sent successfully\n");
+            LOG_DEBUG("Email sent successfully.");
+            LOG_DEBUG("Email sent successfully");
         }
 
         Cleanup(repo);
@@ -1115,8 +1042,6 @@ int find_user_and_send_magic(const char* username_or_email) {
         return 0;
     }
 
-    printf("Trazenje korisnika.\n");
-    fprintf(stderr, "Trazenje korisnika 2\n");
 
     bson_t* query2 = BCON_NEW(
         "username", BCON_UTF8(username_or_email)
@@ -1129,17 +1054,17 @@ int find_user_and_send_magic(const char* username_or_email) {
         if (bson_iter_init(&iter2, doc2)) {
             if (bson_iter_find(&iter2, "username")) {
                 const char* found_role = bson_iter_utf8(&iter2, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 strncpy(user.username, found_role, sizeof(user.username));
             }
             if (bson_iter_find(&iter2, "email")) {
                 const char* found_role = bson_iter_utf8(&iter2, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 strncpy(user.email, found_role, sizeof(user.email));
             }
             if (bson_iter_find(&iter2, "active")) {
                 int active = bson_iter_int32(&iter2);
-                printf("Active: %d\n", active);
+                LOG_DEBUG("Active: %d", active);
                 if (!active) {
                     bson_destroy(query);
                     mongoc_cursor_destroy(cursor);
@@ -1148,15 +1073,12 @@ int find_user_and_send_magic(const char* username_or_email) {
                 }
             }
         }
-        fprintf(repo->logger, "User found.\n");
-        printf("User found.\n");
-        fprintf(stderr, "Nigger found\n");
+        LOG_DEBUG("User found.");
         res = 0;
     }
 
     bson_destroy(query2);
     mongoc_cursor_destroy(cursor2);
-    fprintf(stderr, "Trazenje korisnika 3\n");
 
     if (res == 0) {
         time_t now = time(NULL);
@@ -1164,7 +1086,6 @@ int find_user_and_send_magic(const char* username_or_email) {
         char buffer[32];
         snprintf(buffer, sizeof(buffer), "%ld", (long)now);
         magic_hash_code = magic_hash((const char *)buffer, (const char *)user.username, activation_link);
-        fprintf(stderr, "Spar jobb ar jo dontes 2\n");
     }
     if (magic_hash_code == 0) {
         FILE* payload_file = fopen("magiclink.txt", "w");
@@ -1175,12 +1096,10 @@ int find_user_and_send_magic(const char* username_or_email) {
                 "\r\n"
                 "Vasa magicna veza: http://localhost:3000/magic?link=%s\r\n", user.email, (const char*)activation_link);
             fclose(payload_file);
-            fprintf(repo->logger, "Written to the payload file.\n");
-            printf("Written to the payload file.\n");
+            LOG_DEBUG("Written to the payload file.");
         }
         else {
-            fprintf(repo->logger, "Failed to open payload file for writing.\n");
-            printf("Failed to open payload file for writing.\n");
+            LOG_ERROR("Failed to open payload file for writing.");
             Cleanup(repo);
 
             return 2;
@@ -1188,10 +1107,8 @@ int find_user_and_send_magic(const char* username_or_email) {
 
         payload_file = fopen("magiclink.txt", "r");
         if (!emailto(user.email, payload_file)) {
-            printf("ubicu se bukvalno.\n");
-            fprintf(repo->logger, "Email sent successfully.\n");
-            printf("Email sent successfully.\n");
-            fprintf(stderr, "Email sent successfully\n");
+            LOG_DEBUG("Email sent successfully.");
+            LOG_DEBUG("Email sent successfully");
         }
 
         Cleanup(repo);
@@ -1205,14 +1122,14 @@ int find_user_and_send_magic(const char* username_or_email) {
 }
 
 int check_magic_link(const char *link, char **username) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "links";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Provera aktivacionog koda.\n");
-    fprintf(stderr, "I love rozen maiden5\n");
-    fprintf(stderr, "link: %s\n", link);
+    LOG_DEBUG("Provera aktivacionog koda.");
+    LOG_DEBUG("link: %s", link);
 
     const char* type = "magic";
 
@@ -1232,8 +1149,7 @@ int check_magic_link(const char *link, char **username) {
         if (bson_iter_init(&iter, doc)) {
             if (bson_iter_find(&iter, "timestamp")) {
                 const char* found_time = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_time);
-                fprintf(stderr, "I love rozen maiden6\n");
+                LOG_DEBUG("Found user: %s", found_time);
                 long expiration_time;
                 int sscanf_code = sscanf(found_time, "%ld", &expiration_time);
 
@@ -1245,21 +1161,19 @@ int check_magic_link(const char *link, char **username) {
 
                 if (current_time > expiration_time) {
 
-                    fprintf(stderr, "I love rozen maiden?\n");
-                    fprintf(stderr, "Expired\n");
+                    LOG_WARN("Expired");
                     *username = malloc(2);
                     snprintf(*username, 2, "*");
                     bson_destroy(query);
                     mongoc_cursor_destroy(cursor);
                     Cleanup(repo);
-                    fprintf(stderr, "Niggered\n");
 
                     return 1;
                 }
             }
             if (bson_iter_find(&iter, "username")) {
                 const char* found_username = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_username);
+                LOG_DEBUG("Found user: %s", found_username);
                 *username = malloc(strlen(found_username) + 1);
                 snprintf(*username, strlen(found_username) + 1, "%s", found_username);
             }
@@ -1274,14 +1188,13 @@ int check_magic_link(const char *link, char **username) {
 }
 
 int cheeky(const char *username, char **role) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
     
-    Repository* repo = New(log);
-    printf("repo = %p, repo->client = %p\n", (void*)repo, (void*)(repo ? repo->client : NULL));
+    Repository* repo = New();
+    LOG_DEBUG("repo = %p, repo->client = %p", (void*)repo, (void*)(repo ? repo->client : NULL));
     const char* db_name = "users";
     const char* collection_name = "users";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Trazenje korisnika.\n");
-    fprintf(stderr, "Trazenje korisnika\n");
 
     int res = 1;
 
@@ -1289,8 +1202,6 @@ int cheeky(const char *username, char **role) {
     bson_t* query = BCON_NEW(
         "username", BCON_UTF8(username)
     );
-    printf("Trazenje nigera.\n");
-    fprintf(stderr, "Trazenje nigera\n");
 
     mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, NULL, NULL);
     const bson_t* doc;
@@ -1299,7 +1210,7 @@ int cheeky(const char *username, char **role) {
         if (bson_iter_init(&iter, doc)) {
             if (bson_iter_find(&iter, "role")) {
                 const char* found_role = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 *role = malloc(strlen(found_role) + 1);
                 snprintf(*role, strlen(found_role) + 1, "%s", found_role);
             }
@@ -1310,14 +1221,13 @@ int cheeky(const char *username, char **role) {
 }
 
 int find_user_and_send_recovery(const char *email) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
     
-    Repository* repo = New(log);
-    printf("repo = %p, repo->client = %p\n", (void*)repo, (void*)(repo ? repo->client : NULL));
+    Repository* repo = New();
+    LOG_DEBUG("repo = %p, repo->client = %p", (void*)repo, (void*)(repo ? repo->client : NULL));
     const char* db_name = "users";
     const char* collection_name = "users";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Trazenje korisnika.\n");
-    fprintf(stderr, "Trazenje korisnika\n");
 
     int res = 1;
 
@@ -1325,8 +1235,6 @@ int find_user_and_send_recovery(const char *email) {
     bson_t* query = BCON_NEW(
         "email", BCON_UTF8(email)
     );
-    printf("Trazenje nigera.\n");
-    fprintf(stderr, "Trazenje nigera\n");
 
     User user;
 
@@ -1337,17 +1245,17 @@ int find_user_and_send_recovery(const char *email) {
         if (bson_iter_init(&iter, doc)) {
             if (bson_iter_find(&iter, "username")) {
                 const char* found_role = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 strncpy(user.username, found_role, sizeof(user.username));
             }
             if (bson_iter_find(&iter, "email")) {
                 const char* found_role = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 strncpy(user.email, found_role, sizeof(user.email));
             }
             if (bson_iter_find(&iter, "active")) {
                 int active = bson_iter_int32(&iter);
-                printf("Active: %d\n", active);
+                LOG_DEBUG("Active: %d", active);
                 if (!active) {
                     bson_destroy(query);
                     mongoc_cursor_destroy(cursor);
@@ -1356,9 +1264,7 @@ int find_user_and_send_recovery(const char *email) {
                 }
             }
         }
-        fprintf(repo->logger, "User found.\n");
-        printf("User found.\n");
-        fprintf(stderr, "Nigger found\n");
+        LOG_DEBUG("User found.");
         res = 0;
     }
 
@@ -1373,7 +1279,6 @@ int find_user_and_send_recovery(const char *email) {
         char buffer[32];
         snprintf(buffer, sizeof(buffer), "%ld", (long)now);
         magic_hash_code = recovery_hash((const char *)buffer, (const char *)user.username, activation_link);
-        fprintf(stderr, "Spar jobb ar jo dontes\n");
     }
     if (magic_hash_code == 0) {
         FILE* payload_file = fopen("magiclink.txt", "w");
@@ -1384,12 +1289,10 @@ int find_user_and_send_recovery(const char *email) {
                 "\r\n"
                 "Vasa veza za oporavak naloga: http://localhost:3000/recovery?link=%s\r\n", user.email, (const char*)activation_link);
             fclose(payload_file);
-            fprintf(repo->logger, "Written to the payload file.\n");
-            printf("Written to the payload file.\n");
+            LOG_DEBUG("Written to the payload file.");
         }
         else {
-            fprintf(repo->logger, "Failed to open payload file for writing.\n");
-            printf("Failed to open payload file for writing.\n");
+            LOG_ERROR("Failed to open payload file for writing.");
             Cleanup(repo);
 
             return 2;
@@ -1397,10 +1300,8 @@ int find_user_and_send_recovery(const char *email) {
 
         payload_file = fopen("magiclink.txt", "r");
         if (!emailto(user.email, payload_file)) {
-            printf("ubicu se bukvalno.\n");
-            fprintf(repo->logger, "Email sent successfully.\n");
-            printf("Email sent successfully.\n");
-            fprintf(stderr, "Email sent successfully\n");
+            LOG_DEBUG("Email sent successfully.");
+            LOG_DEBUG("Email sent successfully");
         }
 
         Cleanup(repo);
@@ -1408,8 +1309,6 @@ int find_user_and_send_recovery(const char *email) {
         return 0;
     }
 
-    printf("Trazenje korisnika.\n");
-    fprintf(stderr, "Trazenje korisnika 2\n");
 
     bson_t* query2 = BCON_NEW(
         "username", BCON_UTF8(email)
@@ -1422,17 +1321,17 @@ int find_user_and_send_recovery(const char *email) {
         if (bson_iter_init(&iter2, doc2)) {
             if (bson_iter_find(&iter2, "username")) {
                 const char* found_role = bson_iter_utf8(&iter2, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 strncpy(user.username, found_role, sizeof(user.username));
             }
             if (bson_iter_find(&iter2, "email")) {
                 const char* found_role = bson_iter_utf8(&iter2, NULL);
-                printf("Found user: %s\n", found_role);
+                LOG_DEBUG("Found user: %s", found_role);
                 strncpy(user.email, found_role, sizeof(user.email));
             }
             if (bson_iter_find(&iter2, "active")) {
                 int active = bson_iter_int32(&iter2);
-                printf("Active: %d\n", active);
+                LOG_DEBUG("Active: %d", active);
                 if (!active) {
                     bson_destroy(query);
                     mongoc_cursor_destroy(cursor);
@@ -1441,15 +1340,12 @@ int find_user_and_send_recovery(const char *email) {
                 }
             }
         }
-        fprintf(repo->logger, "User found.\n");
-        printf("User found.\n");
-        fprintf(stderr, "Nigger found\n");
+        LOG_DEBUG("User found.");
         res = 0;
     }
 
     bson_destroy(query2);
     mongoc_cursor_destroy(cursor2);
-    fprintf(stderr, "Trazenje korisnika 3\n");
 
     if (res == 0) {
         time_t now = time(NULL);
@@ -1457,7 +1353,6 @@ int find_user_and_send_recovery(const char *email) {
         char buffer[32];
         snprintf(buffer, sizeof(buffer), "%ld", (long)now);
         magic_hash_code = recovery_hash((const char *)buffer, (const char *)user.username, activation_link);
-        fprintf(stderr, "Spar jobb ar jo dontes 2\n");
     }
     if (magic_hash_code == 0) {
         FILE* payload_file = fopen("magiclink.txt", "w");
@@ -1468,12 +1363,10 @@ int find_user_and_send_recovery(const char *email) {
                 "\r\n"
                 "Vasa veza za oporavak naloga: http://localhost:3000/magic?link=%s\r\n", user.email, (const char*)activation_link);
             fclose(payload_file);
-            fprintf(repo->logger, "Written to the payload file.\n");
-            printf("Written to the payload file.\n");
+            LOG_DEBUG("Written to the payload file.");
         }
         else {
-            fprintf(repo->logger, "Failed to open payload file for writing.\n");
-            printf("Failed to open payload file for writing.\n");
+            LOG_ERROR("Failed to open payload file for writing.");
             Cleanup(repo);
 
             return 2;
@@ -1481,10 +1374,8 @@ int find_user_and_send_recovery(const char *email) {
 
         payload_file = fopen("magiclink.txt", "r");
         if (!emailto(user.email, payload_file)) {
-            printf("ubicu se bukvalno.\n");
-            fprintf(repo->logger, "Email sent successfully.\n");
-            printf("Email sent successfully.\n");
-            fprintf(stderr, "Email sent successfully\n");
+            LOG_DEBUG("Email sent successfully.");
+            LOG_DEBUG("Email sent successfully");
         }
 
         Cleanup(repo);
@@ -1499,13 +1390,12 @@ int find_user_and_send_recovery(const char *email) {
 
 int check_recovery_link(const char *link) {
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "links";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Provera aktivacionog koda.\n");
-    fprintf(stderr, "I love rozen maiden5\n");
-    fprintf(stderr, "link: %s\n", link);
+    LOG_DEBUG("Provera aktivacionog koda.");
+    LOG_DEBUG("link: %s", link);
 
     const char* type = "recovery";
 
@@ -1526,8 +1416,7 @@ int check_recovery_link(const char *link) {
         if (bson_iter_init(&iter, doc)) {
             if (bson_iter_find(&iter, "timestamp")) {
                 const char* found_time = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_time);
-                fprintf(stderr, "I love rozen maiden6\n");
+                LOG_DEBUG("Found user: %s", found_time);
                 long expiration_time;
                 int sscanf_code = sscanf(found_time, "%ld", &expiration_time);
 
@@ -1539,12 +1428,10 @@ int check_recovery_link(const char *link) {
 
                 if (current_time > expiration_time) {
 
-                    fprintf(stderr, "I love rozen maiden?\n");
-                    fprintf(stderr, "Expired\n");
+                    LOG_WARN("Expired");
                     bson_destroy(query);
                     mongoc_cursor_destroy(cursor);
                     Cleanup(repo);
-                    fprintf(stderr, "Niggered\n");
 
                     return 1;
                 }
@@ -1559,7 +1446,6 @@ int check_recovery_link(const char *link) {
         bson_destroy(query);
         mongoc_cursor_destroy(cursor);
         Cleanup(repo);
-        fprintf(stderr, "work pls 9999999999\n");
 
         return 0;
     }
@@ -1573,9 +1459,9 @@ int check_recovery_link(const char *link) {
 
 int updatepassword(const char *username, const char *new_password) {
 
-    fprintf(stderr, "Updating password\n");
+    LOG_DEBUG("Updating password");
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "users";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
@@ -1583,14 +1469,10 @@ int updatepassword(const char *username, const char *new_password) {
     bson_t* filter = BCON_NEW(
         "username", BCON_UTF8(username)
     );
-    printf("Oof.\n");
-    fprintf(stderr, "Zlaja Kakimic\n");
-    fprintf(stderr, "Username: %s\n", username);
+    LOG_DEBUG("Username: %s", username);
 
     char hashed_new_password[41] = {0};
-    fprintf(stderr, "new password: %sniger\n", new_password);
     password_hash(new_password, (char*)hashed_new_password);
-    fprintf(stderr, "hashed new password: %sniger\n", hashed_new_password);
 
     // Define the update operation
     bson_t *update = BCON_NEW(
@@ -1598,7 +1480,6 @@ int updatepassword(const char *username, const char *new_password) {
             "password", BCON_UTF8(hashed_new_password),
         "}"
     );
-    printf("Oof.\n");
 
     // Perform the update
     bson_error_t error;
@@ -1610,35 +1491,31 @@ int updatepassword(const char *username, const char *new_password) {
         NULL,        // No reply document needed
         &error       // Error object
     );
-    printf("Oof.\n");
-    fprintf(stderr, "FUCKING NIGGER EXECUTE5\n");
 
     if (result) {
-        printf("Document updated successfully.\n");
+        LOG_DEBUG("Document updated successfully.");
     }
     else {
-        fprintf(stderr, "Update failed: %s\n", error.message);
-        printf("I hate standard error.\n");
+        LOG_ERROR("Update failed: %s", error.message);
         bson_destroy(update);
         Cleanup(repo);
 
         return 1;
     }
     bson_destroy(update);
-    fprintf(stderr, "FUCKING NIGGER EXECUTE5\n");
 
     return 0;
 }
 
 int recoverpassword(const char* link, char* new_password) {
+    METRICS_TIME_SCOPE(METRIC_MONGO_DURATION, __func__);
 
-    Repository* repo = New(log);
+    Repository* repo = New();
     const char* db_name = "users";
     const char* collection_name = "links";
     repo->collection = mongoc_client_get_collection(repo->client, db_name, collection_name);
-    printf("Provera aktivacionog koda.\n");
-    fprintf(stderr, "I love rozen maiden5\n");
-    fprintf(stderr, "link: %s\n", link);
+    LOG_DEBUG("Provera aktivacionog koda.");
+    LOG_DEBUG("link: %s", link);
 
     const char* type = "recovery";
 
@@ -1654,21 +1531,18 @@ int recoverpassword(const char* link, char* new_password) {
     int found = 0;
     mongoc_cursor_t* cursor = mongoc_collection_find_with_opts(repo->collection, query, NULL, NULL);
     const bson_t* doc;
-    fprintf(stderr, "FUCKING NIGGER EXECUTE5\n");
     while (mongoc_cursor_next(cursor, &doc)) {
         // Extract and print "username" field
         bson_iter_t iter;
         if (bson_iter_init(&iter, doc)) {
             if (bson_iter_find(&iter, "username")) {
                 const char* found_username = bson_iter_utf8(&iter, NULL);
-                printf("Found user: %s\n", found_username);
-                fprintf(stderr, "Found user: %s\n", found_username);
+                LOG_DEBUG("Found user: %s", found_username);
                 snprintf(user.username, sizeof(user.username), "%s", found_username);
                 found = 1;
             }
         }
     }
-    fprintf(stderr, "FUCKING NIGGER EXECUTE5\n");
 
     if (!found) {
         bson_destroy(query);
@@ -1678,17 +1552,16 @@ int recoverpassword(const char* link, char* new_password) {
         return 1;
     }
 
-    fprintf(stderr, "FUCKING NIGGER EXECUTE5\n");
 
     bson_destroy(query);
     mongoc_cursor_destroy(cursor);
     Cleanup(repo);
-    fprintf(stderr, "Updating password\n");
+    LOG_DEBUG("Updating password");
 
     int update_res = updatepassword(user.username, new_password);
 
     if (!update_res) {
-        fprintf(stderr, "Updated password\n");
+        LOG_DEBUG("Updated password");
         return 0;
     }
 
@@ -1697,20 +1570,10 @@ int recoverpassword(const char* link, char* new_password) {
 
 int repo() {
 
-    log = fopen("log.txt", "w");
-    if (!log) {
-        printf("Error opening file!\n");
-        return 1;
-    }
-
     mongoc_init();
     getchar();
     mongoc_cleanup();
 
-    if (log) {
-        fclose(log);
-    }
-
     return 0;
 
 }
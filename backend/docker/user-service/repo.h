@@ -15,4 +15,7 @@ int cheeky(const char* username, char** role);
 int find_user_and_send_recovery(const char* email);
 int recoverpassword(const char* link, char* new_password);
 
+// SHA-1 of the password as 40 hex characters, password_location needs 41 bytes
+int password_hash(const char* password, char* password_location);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "request.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logger.h"
+
+#define BODY_INITIAL_CAPACITY 1024
+
+static size_t max_body_size = MAX_BODY_SIZE;
+
+void request_init(void) {
+    char* max_env = getenv("MAX_BODY_SIZE");
+    if (max_env && atol(max_env) > 0) {
+        max_body_size = (size_t)atol(max_env);
+    }
+
+    cJSON_Hooks hooks = { request_malloc, request_free };
+    cJSON_InitHooks(&hooks);
+}
+
+static int send_payload_too_large(struct MHD_Connection* connection, struct ConnectionInfo* conn_info) {
+    const char* error_response = "{\"error\": \"Payload Too Large\"}";
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        strlen(error_response),
+        (void*)error_response,
+        MHD_RESPMEM_PERSISTENT
+    );
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    MHD_add_response_header(response, "Connection", "close");
+    int ret = MHD_queue_response(connection, MHD_HTTP_PAYLOAD_TOO_LARGE, response);
+    MHD_destroy_response(response);
+    conn_info->rejected = 1;
+    return ret;
+}
+
+int request_begin(struct MHD_Connection* connection, const char* url, const char* method, void** con_cls) {
+    Arena* arena = arena_create(ARENA_BLOCK_SIZE);
+    if (arena == NULL) {
+        return MHD_NO;
+    }
+
+    struct ConnectionInfo* conn_info = arena_alloc(arena, sizeof(struct ConnectionInfo));
+    memset(conn_info, 0, sizeof(struct ConnectionInfo));
+    conn_info->arena = arena;
+    conn_info->route_series = metrics_route_series(method, NULL);  // Until the router matches
+    conn_info->start = metrics_now();
+    *con_cls = (void*)conn_info;
+    metrics_add(metrics_series(METRIC_HTTP_IN_FLIGHT, NULL), 1);
+
+    const char* content_length = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_CONTENT_LENGTH);
+    if (content_length) {
+        unsigned long long expected = strtoull(content_length, NULL, 10);
+        if (expected > max_body_size) {
+            LOG_DEBUG("Rejecting body of %llu bytes, limit is %zu", expected, max_body_size);
+            return send_payload_too_large(connection, conn_info);
+        }
+        conn_info->expected_size = (size_t)expected;
+    }
+
+    return MHD_YES;
+}
+
+int request_append(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const char* upload_data, size_t* upload_data_size) {
+
+    size_t chunk_size = *upload_data_size;
+    *upload_data_size = 0;
+
+    if (conn_info->rejected) {
+        return MHD_YES;
+    }
+    if (conn_info->json_size + chunk_size > max_body_size) {
+        return send_payload_too_large(connection, conn_info);
+    }
+
+#ifndef FAST_JSON
+    // Whole body in one chunk: parse it where it is, no copy needed
+    if (conn_info->json_size == 0 && chunk_size == conn_info->expected_size) {
+        arena_activate(conn_info->arena);
+        conn_info->json = cJSON_ParseWithLength(upload_data, chunk_size);
+        arena_activate(NULL);
+        conn_info->json_size = chunk_size;
+        return MHD_YES;
+    }
+#endif
+
+    size_t needed = conn_info->json_size + chunk_size;
+    if (needed > conn_info->json_capacity) {
+        size_t capacity = conn_info->expected_size;
+        if (capacity < needed) {
+            // No usable Content-Length, grow geometrically
+            capacity = conn_info->json_capacity ? conn_info->json_capacity : BODY_INITIAL_CAPACITY;
+            while (capacity < needed) {
+                capacity *= 2;
+            }
+        }
+        char* data = arena_realloc(conn_info->arena, conn_info->json_data, conn_info->json_size, capacity);
+        if (data == NULL) {
+            return MHD_NO;
+        }
+        conn_info->json_data = data;
+        conn_info->json_capacity = capacity;
+    }
+
+    memcpy(conn_info->json_data + conn_info->json_size, upload_data, chunk_size);
+    conn_info->json_size += chunk_size;
+    return MHD_YES;
+}
+
+cJSON* request_body_json(struct ConnectionInfo* conn_info) {
+    if (conn_info->json) {
+        cJSON* json = conn_info->json;
+        conn_info->json = NULL;
+        return json;
+    }
+    if (conn_info->json_data == NULL) {
+        return NULL;
+    }
+    return cJSON_ParseWithLength(conn_info->json_data, conn_info->json_size);
+}
+
+const char* request_body(struct ConnectionInfo* conn_info, size_t* size) {
+    *size = conn_info->json_data ? conn_info->json_size : 0;
+    return conn_info->json_data;
+}
+
+struct MHD_Response* create_request_response(char* body) {
+    enum MHD_ResponseMemoryMode mode = arena_owns(arena_active(), body) ? MHD_RESPMEM_PERSISTENT : MHD_RESPMEM_MUST_FREE;
+    return MHD_create_response_from_buffer(strlen(body), (void*)body, mode);
+}
+
+void request_completed(void* cls, struct MHD_Connection* connection,
+    void** con_cls, enum MHD_RequestTerminationCode toe) {
+
+    struct ConnectionInfo* conn_info = (struct ConnectionInfo*)(*con_cls);
+    if (conn_info == NULL) {
+        return;
+    }
+    metrics_observe(conn_info->route_series, metrics_now() - conn_info->start);
+    metrics_add(metrics_series(METRIC_HTTP_IN_FLIGHT, NULL), -1);
+
+    // Releases the body, parsed JSON and every response built for this request
+    arena_destroy(conn_info->arena);
+    *con_cls = NULL;
+}
@@ -0,0 +1,61 @@
+#ifndef REQUEST_H
+#define REQUEST_H
+
+#include <microhttpd.h>
+#include <cjson/cJSON.h>
+#include "arena.h"
+#include "metrics.h"
+
+// Default upper bound for a request body, overridable with MAX_BODY_SIZE
+#define MAX_BODY_SIZE 1048576
+
+// Structure to store incoming JSON data, lives in the request's arena
+struct ConnectionInfo {
+    Arena* arena;
+    char* json_data;        // Copied body, stays NULL when it was parsed in place
+    size_t json_size;       // Bytes received so far
+    size_t json_capacity;
+    size_t expected_size;   // From Content-Length, 0 when the client did not send one
+    cJSON* json;            // Body parsed straight from MHD's buffer
+    int rejected;
+    int route_series;       // Latency histogram for the matched route, "unmatched" until then
+    uint64_t start;
+};
+
+// Reads MAX_BODY_SIZE and routes cJSON allocations through the request arena
+void request_init(void);
+
+/**
+ * First callback for a request: creates its arena and ConnectionInfo, starts
+ * the request's latency timer, and answers 413 before any body is read when
+ * Content-Length is over the limit.
+ */
+int request_begin(struct MHD_Connection* connection, const char* url, const char* method, void** con_cls);
+
+/**
+ * Consumes one chunk of the upload. A body that arrives in a single chunk is
+ * parsed directly from MHD's buffer, anything else is copied into a buffer
+ * sized from Content-Length. FAST_JSON builds always copy, their decoders
+ * work on the raw bytes instead of a cJSON tree.
+ */
+int request_append(struct MHD_Connection* connection, struct ConnectionInfo* conn_info,
+    const char* upload_data, size_t* upload_data_size);
+
+// Hands the parsed body to the caller, NULL when there is none or it is not valid JSON
+cJSON* request_body_json(struct ConnectionInfo* conn_info);
+
+/**
+ * Raw body bytes, not NUL-terminated. Built with FAST_JSON every body is kept
+ * so the parse_*_from_body decoders can read it, otherwise a body that was
+ * parsed in place is only available through request_body_json.
+ */
+const char* request_body(struct ConnectionInfo* conn_info, size_t* size);
+
+// Arena-backed bodies stay valid until request_completed releases the arena
+struct MHD_Response* create_request_response(char* body);
+
+// Records the request's latency and releases its arena
+void request_completed(void* cls, struct MHD_Connection* connection,
+    void** con_cls, enum MHD_RequestTerminationCode toe);
+
+#endif